@@ -0,0 +1,235 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <Common/Blake2b.h>
+using namespace Common;
+
+#include <cstring>
+
+/**
+  * @class Common::Blake2b
+  *
+  * The last block must be compressed with a special flag, thus a full block is always kept
+  * in the buffer until more data are added or the result is asked.
+  */
+
+namespace
+{
+   const quint64 IV[8] = {
+      0x6A09E667F3BCC908ULL, 0xBB67AE8584CAA73BULL,
+      0x3C6EF372FE94F82BULL, 0xA54FF53A5F1D36F1ULL,
+      0x510E527FADE682D1ULL, 0x9B05688C2B3E6C1FULL,
+      0x1F83D9ABFB41BD6BULL, 0x5BE0CD19137E2179ULL
+   };
+
+   const uchar SIGMA[12][16] = {
+      {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+      { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+      { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+      {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+      {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+      {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+      { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+      { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+      {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+      { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+      {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+      { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+   };
+
+   inline quint64 rotr(quint64 x, int n)
+   {
+      return x >> n | x << (64 - n);
+   }
+
+   inline quint64 readLittleEndian(const uchar* p)
+   {
+      quint64 v = 0;
+      for (int i = 7; i >= 0; i--)
+         v = v << 8 | p[i];
+      return v;
+   }
+
+#  define BLAKE2B_G(a, b, c, d, x, y) \
+      a = a + b + x; d = rotr(d ^ a, 32); \
+      c = c + d;     b = rotr(b ^ c, 24); \
+      a = a + b + y; d = rotr(d ^ a, 16); \
+      c = c + d;     b = rotr(b ^ c, 63);
+}
+
+/**
+  * @param digestSize In bytes, from 1 to 'MAX_DIGEST_SIZE'.
+  */
+Blake2b::Blake2b(int digestSize) :
+   digestSize(digestSize)
+{
+   Q_ASSERT(digestSize > 0 && digestSize <= MAX_DIGEST_SIZE);
+   this->reset();
+}
+
+void Blake2b::reset()
+{
+   memcpy(this->state, IV, sizeof(this->state));
+   this->state[0] ^= 0x01010000ULL ^ static_cast<quint64>(this->digestSize); // Parameter block: fanout = 1, depth = 1, no key.
+   this->length = 0;
+   this->bufferSize = 0;
+}
+
+void Blake2b::addData(const char* data, int size)
+{
+   const uchar* bytes = reinterpret_cast<const uchar*>(data);
+
+   while (size > 0)
+   {
+      if (this->bufferSize == BLOCK_SIZE) // There is more data thus the buffered block isn't the last one.
+      {
+         this->length += BLOCK_SIZE;
+         compress(this->state, this->buffer, this->length, false);
+         this->bufferSize = 0;
+      }
+
+      // Compress directly from the given data when possible, always keeping at least one byte for the last block.
+      if (this->bufferSize == 0)
+         while (size > BLOCK_SIZE)
+         {
+            this->length += BLOCK_SIZE;
+            compress(this->state, bytes, this->length, false);
+            bytes += BLOCK_SIZE;
+            size -= BLOCK_SIZE;
+         }
+
+      const int n = qMin(size, BLOCK_SIZE - this->bufferSize);
+      memcpy(this->buffer + this->bufferSize, bytes, n);
+      this->bufferSize += n;
+      bytes += n;
+      size -= n;
+   }
+}
+
+/**
+  * Write the hash of all the data added since the last reset, the state is not modified.
+  * @param digest Must be at least 'digestSize' bytes length.
+  */
+void Blake2b::getResult(char* digest) const
+{
+   quint64 finalState[8];
+   memcpy(finalState, this->state, sizeof(finalState));
+
+   uchar lastBlock[BLOCK_SIZE] = {};
+   memcpy(lastBlock, this->buffer, this->bufferSize);
+   compress(finalState, lastBlock, this->length + this->bufferSize, true);
+
+   for (int i = 0; i < this->digestSize; i++)
+      digest[i] = static_cast<char>(finalState[i / 8] >> (8 * (i % 8)));
+}
+
+/**
+  * Write the intermediate state to 'data' which must be at least 'MAX_STATE_SIZE' bytes long.
+  * The format doesn't depend of the platform: the digest size, the eight words and the length in little endian,
+  * the number of buffered bytes and the buffered bytes.
+  * @return The number of bytes written.
+  */
+int Blake2b::saveState(uchar* data) const
+{
+   *data++ = static_cast<uchar>(this->digestSize);
+
+   for (int i = 0; i < 8; i++)
+      for (int j = 0; j < 8; j++)
+         *data++ = static_cast<uchar>(this->state[i] >> (8 * j));
+
+   for (int j = 0; j < 8; j++)
+      *data++ = static_cast<uchar>(this->length >> (8 * j));
+
+   *data++ = static_cast<uchar>(this->bufferSize);
+   memcpy(data, this->buffer, this->bufferSize);
+
+   return 1 + 8 * 8 + 8 + 1 + this->bufferSize;
+}
+
+/**
+  * Restore a state saved by 'saveState(..)' with the same digest size, more data can then be added.
+  * @return false if the state is malformed, in this case the hasher is reset.
+  */
+bool Blake2b::restoreState(const uchar* data, int size)
+{
+   this->reset();
+
+   if (size < 1 + 8 * 8 + 8 + 1 || data[0] != this->digestSize)
+      return false;
+
+   const int bufferSize = data[1 + 8 * 8 + 8];
+   if (bufferSize > BLOCK_SIZE || size != 1 + 8 * 8 + 8 + 1 + bufferSize)
+      return false;
+
+   data++;
+   for (int i = 0; i < 8; i++)
+   {
+      this->state[i] = 0;
+      for (int j = 0; j < 8; j++)
+         this->state[i] |= quint64(*data++) << (8 * j);
+   }
+
+   this->length = 0;
+   for (int j = 0; j < 8; j++)
+      this->length |= quint64(*data++) << (8 * j);
+
+   data++;
+   memcpy(this->buffer, data, bufferSize);
+   this->bufferSize = bufferSize;
+
+   return true;
+}
+
+/**
+  * @param counter The number of bytes compressed including the given block. The 64 high bits of the
+  *  counter are always 0 since we never hash more than 2^64 bytes.
+  */
+void Blake2b::compress(quint64* state, const uchar* block, quint64 counter, bool lastBlock)
+{
+   quint64 m[16];
+   for (int i = 0; i < 16; i++)
+      m[i] = readLittleEndian(block + 8 * i);
+
+   quint64 v[16];
+   for (int i = 0; i < 8; i++)
+   {
+      v[i] = state[i];
+      v[i + 8] = IV[i];
+   }
+   v[12] ^= counter;
+   if (lastBlock)
+      v[14] = ~v[14];
+
+   for (int r = 0; r < 12; r++)
+   {
+      const uchar* s = SIGMA[r];
+      BLAKE2B_G(v[0], v[4], v[8],  v[12], m[s[0]],  m[s[1]])
+      BLAKE2B_G(v[1], v[5], v[9],  v[13], m[s[2]],  m[s[3]])
+      BLAKE2B_G(v[2], v[6], v[10], v[14], m[s[4]],  m[s[5]])
+      BLAKE2B_G(v[3], v[7], v[11], v[15], m[s[6]],  m[s[7]])
+      BLAKE2B_G(v[0], v[5], v[10], v[15], m[s[8]],  m[s[9]])
+      BLAKE2B_G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]])
+      BLAKE2B_G(v[2], v[7], v[8],  v[13], m[s[12]], m[s[13]])
+      BLAKE2B_G(v[3], v[4], v[9],  v[14], m[s[14]], m[s[15]])
+   }
+
+   for (int i = 0; i < 8; i++)
+      state[i] ^= v[i] ^ v[i + 8];
+}
+
+#undef BLAKE2B_G
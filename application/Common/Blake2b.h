@@ -0,0 +1,57 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef COMMON_BLAKE2B_H
+#define COMMON_BLAKE2B_H
+
+#include <QtGlobal>
+
+namespace Common
+{
+   /**
+     * A BLAKE2b implementation (RFC 7693) without key and with a configurable digest size.
+     */
+   class Blake2b
+   {
+   public:
+      static const int BLOCK_SIZE = 128;
+      static const int MAX_DIGEST_SIZE = 64;
+      static const int MAX_STATE_SIZE = 1 + 8 * 8 + 8 + 1 + BLOCK_SIZE; ///< See 'saveState(..)'.
+
+      Blake2b(int digestSize);
+
+      void reset();
+      void addData(const char* data, int size);
+      void getResult(char* digest) const;
+
+      int saveState(uchar* data) const;
+      bool restoreState(const uchar* data, int size);
+
+   private:
+      static void compress(quint64* state, const uchar* block, quint64 counter, bool lastBlock);
+
+      const int digestSize;
+
+      quint64 state[8];
+      quint64 length; ///< Total number of bytes compressed, the buffered bytes are not included.
+      uchar buffer[BLOCK_SIZE];
+      int bufferSize;
+   };
+}
+
+#endif
@@ -0,0 +1,140 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef COMMON_BLOCKEDBLOOMFILTER_H
+#define COMMON_BLOCKEDBLOOMFILTER_H
+
+#include <cstring>
+
+#include <QVector>
+
+#include <Common/Hash.h>
+
+/**
+  * @class Common::BlockedBloomFilter
+  * A blocked Bloom filter for the class 'Common::Hash': all the bits of a hash are in the same block of 512 bits (one cache line),
+  * thus a test costs only one memory access whatever the filter size is.
+  *
+  * The filter is sized for a given capacity with 'BITS_PER_HASH' bits per hash, the probability of false positive is about 0.1 %
+  * as long as the number of added hashes doesn't exceed the capacity.
+  *
+  * As in 'BloomFilter' the positions are taken directly from the hash data, they are supposed to be uniformly distributed:
+  *  - Bytes 4 to 7: the block.
+  *  - Bytes 8 to 16: the 'K' positions (9 bits each) in the block.
+  * The bytes 0 to 3 aren't used, they can be used to distribute the hashes among some filters.
+  */
+
+namespace Common
+{
+   class BlockedBloomFilter
+   {
+   public:
+      static const int BITS_PER_HASH = 16;
+      static const int K = 8; // Number of bits set per hash.
+
+      BlockedBloomFilter(int capacity = 0)
+      {
+         this->reset(capacity);
+      }
+
+      inline void add(const Hash& hash);
+      inline bool test(const Hash& hash) const;
+      inline void reset(int capacity);
+
+      int getCapacity() const { return this->capacity; }
+
+   private:
+      static const int WORDS_PER_BLOCK = 8; // 8 * 64 bits = 512 bits.
+
+      inline quint64* block(const Hash& hash);
+      inline const quint64* block(const Hash& hash) const;
+      static inline int position(const Hash& hash, int i);
+
+      QVector<quint64> words;
+      quint32 blockMask; // The number of blocks is a power of two.
+      int capacity;
+   };
+}
+
+inline void Common::BlockedBloomFilter::add(const Hash& hash)
+{
+   quint64* block = this->block(hash);
+   for (int i = 0; i < K; i++)
+   {
+      const int p = position(hash, i);
+      block[p >> 6] |= Q_UINT64_C(1) << (p & 63);
+   }
+}
+
+/**
+  * Returns 'true' if the hash may exist in the set and 'false' if the hash doesn't exist in the set.
+  */
+inline bool Common::BlockedBloomFilter::test(const Hash& hash) const
+{
+   const quint64* block = this->block(hash);
+   for (int i = 0; i < K; i++)
+   {
+      const int p = position(hash, i);
+      if ((block[p >> 6] & Q_UINT64_C(1) << (p & 63)) == 0)
+         return false;
+   }
+   return true;
+}
+
+/**
+  * Remove all the hashes and resize the filter for the given capacity.
+  */
+inline void Common::BlockedBloomFilter::reset(int capacity)
+{
+   int nbBlocks = 1;
+   while (static_cast<qint64>(nbBlocks) * WORDS_PER_BLOCK * 64 < static_cast<qint64>(capacity) * BITS_PER_HASH)
+      nbBlocks <<= 1;
+
+   this->capacity = capacity;
+   this->blockMask = nbBlocks - 1;
+
+   if (this->words.size() == nbBlocks * WORDS_PER_BLOCK)
+      this->words.fill(0);
+   else
+      this->words = QVector<quint64>(nbBlocks * WORDS_PER_BLOCK, 0);
+}
+
+inline quint64* Common::BlockedBloomFilter::block(const Hash& hash)
+{
+   const uchar* data = reinterpret_cast<const uchar*>(hash.getData());
+   const quint32 n = data[4] | data[5] << 8 | data[6] << 16 | static_cast<quint32>(data[7]) << 24;
+   return this->words.data() + (n & this->blockMask) * WORDS_PER_BLOCK;
+}
+
+inline const quint64* Common::BlockedBloomFilter::block(const Hash& hash) const
+{
+   const uchar* data = reinterpret_cast<const uchar*>(hash.getData());
+   const quint32 n = data[4] | data[5] << 8 | data[6] << 16 | static_cast<quint32>(data[7]) << 24;
+   return this->words.constData() + (n & this->blockMask) * WORDS_PER_BLOCK;
+}
+
+/**
+  * Returns the position of the bit 'i' in the block, 0 <= i < K. The ninth bit of each position comes from the byte 16.
+  */
+inline int Common::BlockedBloomFilter::position(const Hash& hash, int i)
+{
+   const uchar* data = reinterpret_cast<const uchar*>(hash.getData());
+   return data[8 + i] | (data[16] >> i & 1) << 8;
+}
+
+#endif
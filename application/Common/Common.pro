@@ -40,7 +40,10 @@ SOURCES += \
     Network/Message.cpp \
     KnownExtensions.cpp \
     Hash_noShare.cpp \
-    Hash_share.cpp
+    Hash_share.cpp \
+    Sha1.cpp \
+    Blake2b.cpp \
+    ReadWriteLock.cpp
 
 HEADERS += Hashes.h \
     Hash.h \
@@ -68,6 +71,7 @@ HEADERS += Hashes.h \
     ConsoleReader.h \
     StringUtils.h \
     BloomFilter.h \
+    BlockedBloomFilter.h \
     Network/Message.h \
     KnownExtensions.h \
     Containers/Tree.h \
@@ -76,6 +80,10 @@ HEADERS += Hashes.h \
     Containers/MapArray.h \
     SelfWeakPointer.h \
     Hash_noShare.h \
-    Hash_share.h
+    Hash_share.h \
+    Sha1.h \
+    Blake2b.h \
+    HashAlgorithm.h \
+    ReadWriteLock.h
 
 
@@ -122,14 +122,6 @@ QString Hash::toStrCArray() const
    return str;
 }
 
-/**
-  * The special hash value with all bytes to 0 is defined as a null value.
-  */
-bool Hash::isNull() const noexcept
-{
-   return memcmp(this->data, NULL_HASH, HASH_SIZE) == 0;
-}
-
 /**
   * Return a new rand hash.
   */
@@ -182,14 +174,20 @@ Hash Hash::fromStr(const QString& str)
   * @class Common::Hasher
   *
   * To create hash from row data.
+  * The default algorithm is SHA-1, it is used for the peer IDs and the passwords. Only the chunk hashes may be computed with another algorithm.
   */
 
 MTRand Hasher::mtrand;
 
-Hasher::Hasher() :
-   cryptographicHash(QCryptographicHash::Sha1)
+Hasher::Hasher(HashAlgorithm algorithm) :
+   algorithm(algorithm),
+   blake2b(Hash::HASH_SIZE)
 {
-   this->reset();
+}
+
+HashAlgorithm Hasher::getAlgorithm() const
+{
+   return this->algorithm;
 }
 
 /**
@@ -211,15 +209,15 @@ Hasher::Hasher() :
       -0x70,  0x6A,  0x10,  0x11
    };
 
-   this->cryptographicHash.addData(salt, sizeof(salt));
+   this->sha1.addData(salt, sizeof(salt));
 }*/
 
 void Hasher::addSalt(quint64 salt)
 {
-   QByteArray saltArray(8, 0);
+   char saltArray[8];
    for (int i = 0; i < 8; i++)
       saltArray[i] = salt >> (8*i) & 0xFF;
-   this->cryptographicHash.addData(saltArray);
+   this->addData(saltArray, sizeof(saltArray));
 }
 
 /**
@@ -231,19 +229,82 @@ void Hasher::addData(const char* data, int size)
    Q_ASSERT(data);
    Q_ASSERT(size >= 0);
 
-   this->cryptographicHash.addData(data, size);
+   switch (this->algorithm)
+   {
+   case HashAlgorithm::SHA1:
+      this->sha1.addData(data, size);
+      break;
+   case HashAlgorithm::BLAKE2B_160:
+      this->blake2b.addData(data, size);
+      break;
+   }
 }
 
 Hash Hasher::getResult()
 {
    Hash result;
-   memcpy(result.data, this->cryptographicHash.result().constData(), Hash::HASH_SIZE);
+   switch (this->algorithm)
+   {
+   case HashAlgorithm::SHA1:
+      this->sha1.getResult(result.data);
+      break;
+   case HashAlgorithm::BLAKE2B_160:
+      this->blake2b.getResult(result.data);
+      break;
+   }
    return result;
 }
 
 void Hasher::reset()
 {
-   this->cryptographicHash.reset();
+   this->sha1.reset();
+   this->blake2b.reset();
+}
+
+/**
+  * Return the intermediate state, it can be used later by 'restoreState(..)' to continue the hashing
+  * without adding again the previous data. The state begins with the algorithm.
+  */
+QByteArray Hasher::saveState() const
+{
+   uchar state[1 + (Sha1::MAX_STATE_SIZE > Blake2b::MAX_STATE_SIZE ? Sha1::MAX_STATE_SIZE : Blake2b::MAX_STATE_SIZE)];
+   state[0] = static_cast<uchar>(this->algorithm);
+
+   int size = 0;
+   switch (this->algorithm)
+   {
+   case HashAlgorithm::SHA1:
+      size = this->sha1.saveState(state + 1);
+      break;
+   case HashAlgorithm::BLAKE2B_160:
+      size = this->blake2b.saveState(state + 1);
+      break;
+   }
+
+   return QByteArray(reinterpret_cast<const char*>(state), 1 + size);
+}
+
+/**
+  * Restore a state given by 'saveState()'.
+  * @return false if the state is malformed or comes from another algorithm, in this case the hasher is reset.
+  */
+bool Hasher::restoreState(const QByteArray& state)
+{
+   this->reset();
+
+   if (state.isEmpty() || static_cast<uchar>(state[0]) != static_cast<uchar>(this->algorithm))
+      return false;
+
+   const uchar* data = reinterpret_cast<const uchar*>(state.constData()) + 1;
+   switch (this->algorithm)
+   {
+   case HashAlgorithm::SHA1:
+      return this->sha1.restoreState(data, state.size() - 1);
+   case HashAlgorithm::BLAKE2B_160:
+      return this->blake2b.restoreState(data, state.size() - 1);
+   }
+
+   return false;
 }
 
 Common::Hash Hasher::hash(const QString& str)
@@ -294,4 +355,28 @@ Hash Hasher::hashWithRandomSalt(const Common::Hash& hash, quint64& salt)
    return Hasher::hashWithSalt(hash, salt);
 }
 
+/**
+  * Return the algorithms which can be used to compute the chunk hashes, the fastest on this CPU first.
+  */
+QList<HashAlgorithm> Hasher::getSupportedAlgorithms()
+{
+   if (Sha1::isSupported(Sha1::Backend::SHA_NI))
+      return { HashAlgorithm::SHA1, HashAlgorithm::BLAKE2B_160 };
+   else
+      return { HashAlgorithm::BLAKE2B_160, HashAlgorithm::SHA1 };
+}
+
+/**
+  * Return the fastest algorithm supported by both sides, SHA-1 is always supported.
+  * @param otherSupportedAlgorithms The algorithms supported by another peer, it may be empty for an old peer.
+  */
+HashAlgorithm Hasher::negotiateAlgorithm(const QList<HashAlgorithm>& otherSupportedAlgorithms)
+{
+   foreach (HashAlgorithm algorithm, Hasher::getSupportedAlgorithms())
+      if (otherSupportedAlgorithms.contains(algorithm))
+         return algorithm;
+
+   return HashAlgorithm::SHA1;
+}
+
 #endif
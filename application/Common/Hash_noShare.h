@@ -20,19 +20,29 @@
 #define COMMON_HASH_NO_SHARE_H
 
 #include <string>
+#include <cstring>
+#include <type_traits>
 
 #include <QString>
 #include <QByteArray>
+#include <QList>
 #include <QDataStream>
-#include <QCryptographicHash>
 
 #include <Libs/MersenneTwister.h>
 
 #include <Common/Uncopyable.h>
+#include <Common/Sha1.h>
+#include <Common/Blake2b.h>
+#include <Common/HashAlgorithm.h>
 
 namespace Common
 {
    class Hasher;
+
+   /**
+     * A value type holding the 20 bytes of a hash inline, without any heap allocation.
+     * It is trivially copyable: copying a hash or storing it in a 'QVector' is a plain memory copy.
+     */
    class Hash
    {
       static MTRand mtrand;
@@ -52,7 +62,7 @@ namespace Common
       Hash(const std::string& str);
       Hash(const QByteArray& a);
 
-      ~Hash() {}
+      ~Hash() = default;
 
       Hash& operator=(const Hash&) = default;
       Hash& operator=(Hash&&) = default;
@@ -66,7 +76,7 @@ namespace Common
 
       QString toStr() const;
       QString toStrCArray() const;
-      bool isNull() const noexcept;
+      inline bool isNull() const noexcept;
 
       static Hash rand();
       static Hash rand(quint32 seed);
@@ -82,6 +92,36 @@ namespace Common
       char data[HASH_SIZE];
    };
 
+   static_assert(std::is_trivially_copyable<Hash>::value, "Common::Hash must be trivially copyable");
+   static_assert(sizeof(Hash) == Hash::HASH_SIZE, "Common::Hash must not have any overhead");
+
+   /**
+     * Compare the hash as two 64 bits words and one 32 bits word instead of calling 'memcmp(..)'.
+     * The 'memcpy(..)' calls are optimized to unaligned loads by the compiler.
+     */
+   inline bool operator==(const Hash& h1, const Hash& h2)
+   {
+      quint64 a1, a2, b1, b2;
+      quint32 c1, c2;
+      memcpy(&a1, h1.getData(), 8); memcpy(&a2, h2.getData(), 8);
+      memcpy(&b1, h1.getData() + 8, 8); memcpy(&b2, h2.getData() + 8, 8);
+      memcpy(&c1, h1.getData() + 16, 4); memcpy(&c2, h2.getData() + 16, 4);
+      return ((a1 ^ a2) | (b1 ^ b2) | (c1 ^ c2)) == 0;
+   }
+
+   /**
+     * The special hash value with all bytes to 0 is defined as a null value.
+     */
+   inline bool Hash::isNull() const noexcept
+   {
+      quint64 a, b;
+      quint32 c;
+      memcpy(&a, this->data, 8);
+      memcpy(&b, this->data + 8, 8);
+      memcpy(&c, this->data + 16, 4);
+      return (a | b | c) == 0;
+   }
+
    /**
      * It will read an hash from a data stream and modify the given hash.
      */
@@ -106,11 +146,6 @@ namespace Common
       return stream;
    }
 
-   inline bool operator==(const Hash& h1, const Hash& h2)
-   {
-      return memcmp(h1.getData(), h2.getData(), Hash::HASH_SIZE) == 0;
-   }
-
    inline bool operator!=(const Hash& h1, const Hash& h2)
    {
       return !(h1 == h2);
@@ -127,7 +162,9 @@ namespace Common
    inline uint qHash(const Hash& h)
    {
       // Take the first sizeof(uint) bytes of the hash data.
-      return *(const uint*)(h.getData());
+      uint value;
+      memcpy(&value, h.getData(), sizeof(uint));
+      return value;
    }
 
    class Hasher : Uncopyable
@@ -135,12 +172,16 @@ namespace Common
       static MTRand mtrand;
 
    public:
-      Hasher();
+      Hasher(HashAlgorithm algorithm = HashAlgorithm::SHA1);
+      HashAlgorithm getAlgorithm() const;
       void addSalt(quint64 salt);
       void addData(const char*, int size);
       Hash getResult();
       void reset();
 
+      QByteArray saveState() const;
+      bool restoreState(const QByteArray& state);
+
       static Common::Hash hash(const QString& str);
       static Common::Hash hash(const Common::Hash& hash);
       static Common::Hash hashWithSalt(const QString& str, quint64 salt);
@@ -148,9 +189,16 @@ namespace Common
       static Common::Hash hashWithRandomSalt(const QString& str, quint64& salt);
       static Common::Hash hashWithRandomSalt(const Common::Hash& hash, quint64& salt);
 
+      static QList<HashAlgorithm> getSupportedAlgorithms();
+      static HashAlgorithm negotiateAlgorithm(const QList<HashAlgorithm>& otherSupportedAlgorithms);
+
    private:
-      QCryptographicHash cryptographicHash;
+      const HashAlgorithm algorithm;
+      Sha1 sha1;
+      Blake2b blake2b;
    };
 }
 
+Q_DECLARE_TYPEINFO(Common::Hash, Q_PRIMITIVE_TYPE);
+
 #endif
@@ -23,12 +23,15 @@
 
 #include <QString>
 #include <QByteArray>
+#include <QList>
 #include <QDataStream>
-#include <QCryptographicHash>
 
 #include <Libs/MersenneTwister.h>
 
 #include <Common/Uncopyable.h>
+#include <Common/Sha1.h>
+#include <Common/Blake2b.h>
+#include <Common/HashAlgorithm.h>
 
 namespace Common
 {
@@ -163,13 +166,17 @@ namespace Common
       static MTRand mtrand;
 
    public:
-      Hasher();
+      Hasher(HashAlgorithm algorithm = HashAlgorithm::SHA1);
+      HashAlgorithm getAlgorithm() const;
       // void addPredefinedSalt(); Deprecated.
       void addSalt(quint64 salt);
       void addData(const char*, int size);
       Hash getResult();
       void reset();
 
+      QByteArray saveState() const;
+      bool restoreState(const QByteArray& state);
+
       static Common::Hash hash(const QString& str);
       static Common::Hash hash(const Common::Hash& hash);
       static Common::Hash hashWithSalt(const QString& str, quint64 salt);
@@ -177,8 +184,13 @@ namespace Common
       static Common::Hash hashWithRandomSalt(const QString& str, quint64& salt);
       static Common::Hash hashWithRandomSalt(const Common::Hash& hash, quint64& salt);
 
+      static QList<HashAlgorithm> getSupportedAlgorithms();
+      static HashAlgorithm negotiateAlgorithm(const QList<HashAlgorithm>& otherSupportedAlgorithms);
+
    private:
-      QCryptographicHash cryptographicHash;
+      const HashAlgorithm algorithm;
+      Sha1 sha1;
+      Blake2b blake2b;
    };
 }
 
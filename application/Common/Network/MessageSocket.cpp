@@ -121,6 +121,22 @@ void MessageSocket::send(MessageHeader::MessageType type, const google::protobuf
    this->send(type, &message);
 }
 
+/**
+  * Send a message already serialized, it avoids to encode again a message sent many times.
+  */
+void MessageSocket::send(MessageHeader::MessageType type, const QByteArray& serializedMessage)
+{
+   if (!this->listening)
+      return;
+
+   MessageHeader header(type, serializedMessage.size(), this->localID);
+
+   MESSAGE_SOCKET_LOG_DEBUG(QString("Socket[%1]::send: %2 to %3\n<serialized message>").arg(this->num).arg(header.toStr()).arg(this->remoteID.toStr()));
+
+   MessageHeader::writeHeader(*this->socket, header);
+   this->socket->write(serializedMessage);
+}
+
 /**
   * Send a message without body.
   */
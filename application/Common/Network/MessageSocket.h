@@ -65,6 +65,7 @@ namespace Common
       virtual Hash getRemoteID() const;
 
       virtual void send(MessageHeader::MessageType type, const google::protobuf::Message& message);
+      virtual void send(MessageHeader::MessageType type, const QByteArray& serializedMessage);
       virtual void send(MessageHeader::MessageType type);
    private:
       virtual void send(MessageHeader::MessageType type, const google::protobuf::Message* message);
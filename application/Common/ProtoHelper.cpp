@@ -210,3 +210,13 @@ QString ProtoHelper::getDebugStr(const google::protobuf::Message& mess)
 
    return str;
 }
+
+/**
+  * Return the bytes of the given message as they would be written in a stream.
+  */
+QByteArray ProtoHelper::serialize(const google::protobuf::Message& mess)
+{
+   QByteArray bytes(mess.ByteSize(), Qt::Uninitialized);
+   mess.SerializeWithCachedSizesToArray(reinterpret_cast<google::protobuf::uint8*>(bytes.data()));
+   return bytes;
+}
@@ -79,6 +79,8 @@ namespace Common
       static bool isRoot(const Protos::Common::Entry& entry);
 
       static QString getDebugStr(const google::protobuf::Message& mess);
+
+      static QByteArray serialize(const google::protobuf::Message& mess);
    };
 }
 
@@ -0,0 +1,111 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#include <Common/ReadWriteLock.h>
+using namespace Common;
+
+/**
+  * @class Common::ReadWriteLock
+  *
+  * A recursive read/write lock: many threads can read at the same time, a writer is alone.
+  * Unlike 'QReadWriteLock' in recursive mode, the thread holding the write lock can also lock for reading,
+  * it allows a writer to call the reading methods of the same object.
+  * A thread holding a read lock must not lock for writing, it would wait for itself.
+  * The waiting writers have the priority over the new readers, except over the readers already holding a read lock.
+  */
+
+ReadWriteLock::ReadWriteLock() :
+   writer(nullptr), nbWriteLocks(0), nbWaitingWriters(0)
+{
+}
+
+void ReadWriteLock::lockForRead()
+{
+   const Qt::HANDLE self = QThread::currentThreadId();
+   QMutexLocker locker(&this->mutex);
+
+   if (this->writer == self)
+   {
+      this->nbWriteLocks++;
+      return;
+   }
+
+   QHash<Qt::HANDLE, int>::iterator i = this->readers.find(self);
+   if (i != this->readers.end())
+   {
+      i.value()++;
+      return;
+   }
+
+   while (this->writer || this->nbWaitingWriters > 0)
+      this->readersCondition.wait(&this->mutex);
+
+   this->readers.insert(self, 1);
+}
+
+void ReadWriteLock::lockForWrite()
+{
+   const Qt::HANDLE self = QThread::currentThreadId();
+   QMutexLocker locker(&this->mutex);
+
+   if (this->writer == self)
+   {
+      this->nbWriteLocks++;
+      return;
+   }
+
+   Q_ASSERT_X(!this->readers.contains(self), "ReadWriteLock::lockForWrite()", "A read lock can't be upgraded to a write lock");
+
+   this->nbWaitingWriters++;
+   while (this->writer || !this->readers.isEmpty())
+      this->writersCondition.wait(&this->mutex);
+   this->nbWaitingWriters--;
+
+   this->writer = self;
+   this->nbWriteLocks = 1;
+}
+
+void ReadWriteLock::unlock()
+{
+   const Qt::HANDLE self = QThread::currentThreadId();
+   QMutexLocker locker(&this->mutex);
+
+   if (this->writer == self)
+   {
+      if (--this->nbWriteLocks > 0)
+         return;
+      this->writer = nullptr;
+   }
+   else
+   {
+      QHash<Qt::HANDLE, int>::iterator i = this->readers.find(self);
+      if (i == this->readers.end())
+         return;
+      if (--i.value() > 0)
+         return;
+      this->readers.erase(i);
+      if (!this->readers.isEmpty())
+         return;
+   }
+
+   if (this->nbWaitingWriters > 0)
+      this->writersCondition.wakeOne();
+   else
+      this->readersCondition.wakeAll();
+}
@@ -0,0 +1,73 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#ifndef COMMON_READWRITELOCK_H
+#define COMMON_READWRITELOCK_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QThread>
+
+#include <Common/Uncopyable.h>
+
+namespace Common
+{
+   class ReadWriteLock : Uncopyable
+   {
+   public:
+      ReadWriteLock();
+
+      void lockForRead();
+      void lockForWrite();
+      void unlock();
+
+   private:
+      QMutex mutex;
+      QWaitCondition readersCondition;
+      QWaitCondition writersCondition;
+
+      QHash<Qt::HANDLE, int> readers; ///< The number of read locks held by each thread.
+      Qt::HANDLE writer; ///< The thread holding the write lock, 'nullptr' if none.
+      int nbWriteLocks; ///< The number of locks held by the writer, its read locks are counted here too.
+      int nbWaitingWriters;
+   };
+
+   class ReadLocker : Uncopyable
+   {
+   public:
+      ReadLocker(ReadWriteLock* lock) : lock(lock) { this->lock->lockForRead(); }
+      ~ReadLocker() { this->lock->unlock(); }
+
+   private:
+      ReadWriteLock* lock;
+   };
+
+   class WriteLocker : Uncopyable
+   {
+   public:
+      WriteLocker(ReadWriteLock* lock) : lock(lock) { this->lock->lockForWrite(); }
+      ~WriteLocker() { this->lock->unlock(); }
+
+   private:
+      ReadWriteLock* lock;
+   };
+}
+
+#endif
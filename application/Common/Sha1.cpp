@@ -0,0 +1,399 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <Common/Sha1.h>
+using namespace Common;
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define SHA1_X86 1
+#  if defined(_MSC_VER)
+#     include <intrin.h>
+#     define SHA1_TARGET_SHA_NI
+#  else
+#     include <cpuid.h>
+#     define SHA1_TARGET_SHA_NI __attribute__((target("sha,ssse3,sse4.1")))
+#  endif
+#  include <immintrin.h>
+#endif
+
+/**
+  * @class Common::Sha1
+  *
+  * The result must be exactly the same as 'QCryptographicHash(QCryptographicHash::Sha1)' for all backends.
+  * The fastest backend supported by the CPU is chosen at the first use, 'setBackend(..)' should only be used by the tests and the benchmarks.
+  */
+
+namespace
+{
+   inline quint32 rotl(quint32 x, int n)
+   {
+      return x << n | x >> (32 - n);
+   }
+
+   inline quint32 readBigEndian(const uchar* p)
+   {
+      return quint32(p[0]) << 24 | quint32(p[1]) << 16 | quint32(p[2]) << 8 | quint32(p[3]);
+   }
+
+   /**
+     * One round, the roles of the five variables rotate instead of moving the values.
+     */
+#  define SHA1_ROUND(a, b, c, d, e, f, k, i) \
+      e += rotl(a, 5) + (f) + (k) + w[(i) % 16]; \
+      b = rotl(b, 30);
+
+#  define SHA1_SCHEDULE(i) \
+      w[(i) % 16] = rotl(w[((i) + 13) % 16] ^ w[((i) + 8) % 16] ^ w[((i) + 2) % 16] ^ w[(i) % 16], 1);
+
+#  define SHA1_FIVE_ROUNDS(i, F, k) \
+      if ((i) >= 16) { SHA1_SCHEDULE(i) }     SHA1_ROUND(a, b, c, d, e, F(b, c, d), k, i) \
+      if ((i) + 1 >= 16) { SHA1_SCHEDULE((i) + 1) } SHA1_ROUND(e, a, b, c, d, F(a, b, c), k, (i) + 1) \
+      if ((i) + 2 >= 16) { SHA1_SCHEDULE((i) + 2) } SHA1_ROUND(d, e, a, b, c, F(e, a, b), k, (i) + 2) \
+      if ((i) + 3 >= 16) { SHA1_SCHEDULE((i) + 3) } SHA1_ROUND(c, d, e, a, b, F(d, e, a), k, (i) + 3) \
+      if ((i) + 4 >= 16) { SHA1_SCHEDULE((i) + 4) } SHA1_ROUND(b, c, d, e, a, F(c, d, e), k, (i) + 4)
+
+#  define SHA1_CH(b, c, d) (d ^ (b & (c ^ d)))
+#  define SHA1_PARITY(b, c, d) (b ^ c ^ d)
+#  define SHA1_MAJ(b, c, d) ((b & c) | (d & (b | c)))
+
+   void compressGeneric(quint32* state, const uchar* blocks, int nbBlocks)
+   {
+      quint32 w[16];
+
+      for (; nbBlocks > 0; nbBlocks--, blocks += Sha1::BLOCK_SIZE)
+      {
+         for (int i = 0; i < 16; i++)
+            w[i] = readBigEndian(blocks + 4 * i);
+
+         quint32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+         SHA1_FIVE_ROUNDS(0, SHA1_CH, 0x5A827999)      SHA1_FIVE_ROUNDS(5, SHA1_CH, 0x5A827999)
+         SHA1_FIVE_ROUNDS(10, SHA1_CH, 0x5A827999)     SHA1_FIVE_ROUNDS(15, SHA1_CH, 0x5A827999)
+         SHA1_FIVE_ROUNDS(20, SHA1_PARITY, 0x6ED9EBA1) SHA1_FIVE_ROUNDS(25, SHA1_PARITY, 0x6ED9EBA1)
+         SHA1_FIVE_ROUNDS(30, SHA1_PARITY, 0x6ED9EBA1) SHA1_FIVE_ROUNDS(35, SHA1_PARITY, 0x6ED9EBA1)
+         SHA1_FIVE_ROUNDS(40, SHA1_MAJ, 0x8F1BBCDC)    SHA1_FIVE_ROUNDS(45, SHA1_MAJ, 0x8F1BBCDC)
+         SHA1_FIVE_ROUNDS(50, SHA1_MAJ, 0x8F1BBCDC)    SHA1_FIVE_ROUNDS(55, SHA1_MAJ, 0x8F1BBCDC)
+         SHA1_FIVE_ROUNDS(60, SHA1_PARITY, 0xCA62C1D6) SHA1_FIVE_ROUNDS(65, SHA1_PARITY, 0xCA62C1D6)
+         SHA1_FIVE_ROUNDS(70, SHA1_PARITY, 0xCA62C1D6) SHA1_FIVE_ROUNDS(75, SHA1_PARITY, 0xCA62C1D6)
+
+         state[0] += a;
+         state[1] += b;
+         state[2] += c;
+         state[3] += d;
+         state[4] += e;
+      }
+   }
+
+#  undef SHA1_ROUND
+#  undef SHA1_SCHEDULE
+#  undef SHA1_FIVE_ROUNDS
+#  undef SHA1_CH
+#  undef SHA1_PARITY
+#  undef SHA1_MAJ
+
+#ifdef SHA1_X86
+   /**
+     * One step of four rounds. 'k' is the step number [0, 19], the message schedule
+     * of the next steps is computed along with the rounds.
+     */
+#  define SHA1_NI_STEP(k) \
+      if (k < 4) \
+         m[k] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 16 * k)), BYTE_SWAP); \
+      if (k == 0) \
+         e[0] = _mm_add_epi32(e[0], m[0]); \
+      else \
+         e[k % 2] = _mm_sha1nexte_epu32(e[k % 2], m[k % 4]); \
+      e[(k + 1) % 2] = abcd; \
+      if (k >= 3 && k <= 18) \
+         m[(k + 1) % 4] = _mm_sha1msg2_epu32(m[(k + 1) % 4], m[k % 4]); \
+      abcd = _mm_sha1rnds4_epu32(abcd, e[k % 2], k / 5); \
+      if (k >= 1 && k <= 16) \
+         m[(k + 3) % 4] = _mm_sha1msg1_epu32(m[(k + 3) % 4], m[k % 4]); \
+      if (k >= 2 && k <= 17) \
+         m[(k + 2) % 4] = _mm_xor_si128(m[(k + 2) % 4], m[k % 4]);
+
+   SHA1_TARGET_SHA_NI
+   void compressShaNi(quint32* state, const uchar* blocks, int nbBlocks)
+   {
+      const __m128i BYTE_SWAP = _mm_set_epi64x(0x0001020304050607LL, 0x08090A0B0C0D0E0FLL);
+
+      __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+      __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+      for (; nbBlocks > 0; nbBlocks--, blocks += Sha1::BLOCK_SIZE)
+      {
+         const __m128i abcdSaved = abcd;
+         const __m128i e0Saved = e0;
+
+         __m128i m[4];
+         __m128i e[2] = { e0, e0 };
+
+         SHA1_NI_STEP(0)  SHA1_NI_STEP(1)  SHA1_NI_STEP(2)  SHA1_NI_STEP(3)
+         SHA1_NI_STEP(4)  SHA1_NI_STEP(5)  SHA1_NI_STEP(6)  SHA1_NI_STEP(7)
+         SHA1_NI_STEP(8)  SHA1_NI_STEP(9)  SHA1_NI_STEP(10) SHA1_NI_STEP(11)
+         SHA1_NI_STEP(12) SHA1_NI_STEP(13) SHA1_NI_STEP(14) SHA1_NI_STEP(15)
+         SHA1_NI_STEP(16) SHA1_NI_STEP(17) SHA1_NI_STEP(18) SHA1_NI_STEP(19)
+
+         e0 = _mm_sha1nexte_epu32(e[0], e0Saved);
+         abcd = _mm_add_epi32(abcd, abcdSaved);
+      }
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+      state[4] = static_cast<quint32>(_mm_extract_epi32(e0, 3));
+   }
+
+#  undef SHA1_NI_STEP
+
+   bool cpuHasShaNi()
+   {
+      quint32 ecx1, ebx7;
+#  if defined(_MSC_VER)
+      int info[4];
+      __cpuid(info, 0);
+      if (info[0] < 7)
+         return false;
+      __cpuid(info, 1);
+      ecx1 = info[2];
+      __cpuidex(info, 7, 0);
+      ebx7 = info[1];
+#  else
+      unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+      if (__get_cpuid_max(0, nullptr) < 7 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+         return false;
+      ecx1 = ecx;
+      __cpuid_count(7, 0, eax, ebx, ecx, edx);
+      ebx7 = ebx;
+#  endif
+      const bool ssse3 = ecx1 & (1 << 9);
+      const bool sse41 = ecx1 & (1 << 19);
+      const bool sha = ebx7 & (1 << 29);
+      return ssse3 && sse41 && sha;
+   }
+#endif
+}
+
+Sha1::Sha1()
+{
+   this->reset();
+}
+
+void Sha1::reset()
+{
+   this->state[0] = 0x67452301;
+   this->state[1] = 0xEFCDAB89;
+   this->state[2] = 0x98BADCFE;
+   this->state[3] = 0x10325476;
+   this->state[4] = 0xC3D2E1F0;
+   this->length = 0;
+   this->bufferSize = 0;
+}
+
+void Sha1::addData(const char* data, int size)
+{
+   const uchar* bytes = reinterpret_cast<const uchar*>(data);
+   this->length += size;
+
+   if (this->bufferSize > 0)
+   {
+      const int n = qMin(size, BLOCK_SIZE - this->bufferSize);
+      memcpy(this->buffer + this->bufferSize, bytes, n);
+      this->bufferSize += n;
+      bytes += n;
+      size -= n;
+
+      if (this->bufferSize < BLOCK_SIZE)
+         return;
+
+      compressFunction()(this->state, this->buffer, 1);
+      this->bufferSize = 0;
+   }
+
+   const int nbBlocks = size / BLOCK_SIZE;
+   if (nbBlocks > 0)
+   {
+      compressFunction()(this->state, bytes, nbBlocks);
+      bytes += nbBlocks * BLOCK_SIZE;
+      size -= nbBlocks * BLOCK_SIZE;
+   }
+
+   memcpy(this->buffer, bytes, size);
+   this->bufferSize = size;
+}
+
+/**
+  * Write the SHA-1 of all the data added since the last reset, the state is not modified.
+  * @param digest Must be at least 'DIGEST_SIZE' bytes length.
+  */
+void Sha1::getResult(char* digest) const
+{
+   quint32 finalState[5];
+   memcpy(finalState, this->state, sizeof(finalState));
+
+   // Padding: a '1' bit, some '0' bits and the length in bits (big endian) to fill the last block(s).
+   uchar lastBlocks[2 * BLOCK_SIZE] = {};
+   memcpy(lastBlocks, this->buffer, this->bufferSize);
+   lastBlocks[this->bufferSize] = 0x80;
+
+   const int nbBlocks = this->bufferSize + 1 + 8 <= BLOCK_SIZE ? 1 : 2;
+   const quint64 lengthInBits = this->length * 8;
+   for (int i = 0; i < 8; i++)
+      lastBlocks[nbBlocks * BLOCK_SIZE - 1 - i] = static_cast<uchar>(lengthInBits >> (8 * i));
+
+   compressFunction()(finalState, lastBlocks, nbBlocks);
+
+   for (int i = 0; i < 5; i++)
+      for (int j = 0; j < 4; j++)
+         digest[4 * i + j] = static_cast<char>(finalState[i] >> (24 - 8 * j));
+}
+
+/**
+  * Write the intermediate state to 'data' which must be at least 'MAX_STATE_SIZE' bytes long.
+  * The format doesn't depend of the platform: the five words and the length in little endian followed by the buffered bytes.
+  * @return The number of bytes written.
+  */
+int Sha1::saveState(uchar* data) const
+{
+   for (int i = 0; i < 5; i++)
+      for (int j = 0; j < 4; j++)
+         *data++ = static_cast<uchar>(this->state[i] >> (8 * j));
+
+   for (int j = 0; j < 8; j++)
+      *data++ = static_cast<uchar>(this->length >> (8 * j));
+
+   memcpy(data, this->buffer, this->bufferSize);
+
+   return 5 * 4 + 8 + this->bufferSize;
+}
+
+/**
+  * Restore a state saved by 'saveState(..)', more data can then be added.
+  * @return false if the state is malformed, in this case the hasher is reset.
+  */
+bool Sha1::restoreState(const uchar* data, int size)
+{
+   this->reset();
+
+   if (size < 5 * 4 + 8)
+      return false;
+
+   quint32 state[5] = {};
+   for (int i = 0; i < 5; i++)
+      for (int j = 0; j < 4; j++)
+         state[i] |= quint32(*data++) << (8 * j);
+
+   quint64 length = 0;
+   for (int j = 0; j < 8; j++)
+      length |= quint64(*data++) << (8 * j);
+
+   const int bufferSize = static_cast<int>(length % BLOCK_SIZE);
+   if (size != 5 * 4 + 8 + bufferSize)
+      return false;
+
+   memcpy(this->state, state, sizeof(this->state));
+   this->length = length;
+   memcpy(this->buffer, data, bufferSize);
+   this->bufferSize = bufferSize;
+
+   return true;
+}
+
+Sha1::Backend Sha1::getBackend()
+{
+   return currentBackend();
+}
+
+/**
+  * Force a backend, not thread-safe: the hashers must not be used concurrently.
+  * @return false if the backend isn't supported by the CPU, in this case the backend isn't changed.
+  */
+bool Sha1::setBackend(Backend backend)
+{
+   if (!isSupported(backend))
+      return false;
+
+   switch (backend)
+   {
+   case Backend::GENERIC:
+      compressFunction() = &compressGeneric;
+      break;
+
+   case Backend::SHA_NI:
+#ifdef SHA1_X86
+      compressFunction() = &compressShaNi;
+#endif
+      break;
+   }
+
+   currentBackend() = backend;
+   return true;
+}
+
+bool Sha1::isSupported(Backend backend)
+{
+   switch (backend)
+   {
+   case Backend::GENERIC:
+      return true;
+
+   case Backend::SHA_NI:
+#ifdef SHA1_X86
+      static const bool shaNiSupported = cpuHasShaNi();
+      return shaNiSupported;
+#else
+      return false;
+#endif
+   }
+
+   return false;
+}
+
+const char* Sha1::getBackendName(Backend backend)
+{
+   switch (backend)
+   {
+   case Backend::GENERIC:
+      return "Generic";
+   case Backend::SHA_NI:
+      return "SHA-NI";
+   }
+
+   return "?";
+}
+
+Sha1::CompressFunction& Sha1::compressFunction()
+{
+#ifdef SHA1_X86
+   static CompressFunction compress = fastestBackend() == Backend::SHA_NI ? &compressShaNi : &compressGeneric;
+#else
+   static CompressFunction compress = &compressGeneric;
+#endif
+   return compress;
+}
+
+Sha1::Backend& Sha1::currentBackend()
+{
+   static Backend backend = fastestBackend();
+   return backend;
+}
+
+Sha1::Backend Sha1::fastestBackend()
+{
+   return isSupported(Backend::SHA_NI) ? Backend::SHA_NI : Backend::GENERIC;
+}
@@ -0,0 +1,70 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef COMMON_SHA1_H
+#define COMMON_SHA1_H
+
+#include <QtGlobal>
+
+namespace Common
+{
+   /**
+     * A SHA-1 implementation used by 'Common::Hasher'.
+     * The compression function is chosen at runtime depending of the CPU capabilities, see 'Sha1::Backend'.
+     */
+   class Sha1
+   {
+   public:
+      static const int DIGEST_SIZE = 20;
+      static const int BLOCK_SIZE = 64;
+      static const int MAX_STATE_SIZE = 5 * 4 + 8 + BLOCK_SIZE; ///< See 'saveState(..)'.
+
+      enum class Backend
+      {
+         GENERIC, ///< Portable implementation.
+         SHA_NI ///< Intel SHA extensions (x86 only), requires SSSE3 and SSE4.1 too.
+      };
+
+      Sha1();
+
+      void reset();
+      void addData(const char* data, int size);
+      void getResult(char* digest) const;
+
+      int saveState(uchar* data) const;
+      bool restoreState(const uchar* data, int size);
+
+      static Backend getBackend();
+      static bool setBackend(Backend backend);
+      static bool isSupported(Backend backend);
+      static const char* getBackendName(Backend backend);
+
+   private:
+      typedef void (*CompressFunction)(quint32* state, const uchar* blocks, int nbBlocks);
+      static CompressFunction& compressFunction();
+      static Backend& currentBackend();
+      static Backend fastestBackend();
+
+      quint32 state[5];
+      quint64 length; ///< Total number of bytes added.
+      uchar buffer[BLOCK_SIZE];
+      int bufferSize;
+   };
+}
+
+#endif
@@ -1,16 +1,54 @@
 #include <BenchmarkTests.h>
 
 #include <set>
+#include <new>
+#include <atomic>
+#include <cstdlib>
 
 #include <QtDebug>
 #include <QMap>
+#include <QList>
+#include <QVector>
 #include <QElapsedTimer>
+#include <QByteArray>
+#include <QCryptographicHash>
 
 #include <Libs/MersenneTwister.h>
 
+#include <Protos/common.pb.h>
+
 #include <Containers/SortedArray.h>
+#include <Hash.h>
+#include <Sha1.h>
 using namespace Common;
 
+/**
+  * The global allocator is replaced for this executable to count the number of allocations.
+  * See 'BenchmarkTests::hashAllocations()'.
+  */
+namespace
+{
+   std::atomic<quint64> nbAllocations(0);
+}
+
+void* operator new(std::size_t size)
+{
+   nbAllocations++;
+   if (void* p = std::malloc(size == 0 ? 1 : size))
+      return p;
+   throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+   std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+   std::free(p);
+}
+
 BenchmarkTests::BenchmarkTests()
 {
 }
@@ -167,3 +205,108 @@ void BenchmarkTests::sortedArray()
    }
    qDebug() << timer.elapsed();
 }
+
+/**
+  * Throughput of each SHA-1 backend supported by the CPU compared to 'QCryptographicHash'.
+  */
+void BenchmarkTests::hasherThroughput()
+{
+   const int bufferSize = 128 * 1024; // Same as the default setting 'buffer_size_reading'.
+   const int nbBuffers = 8 * 1024; // 1 GiB.
+
+   MTRand mtRand(42);
+   QByteArray buffer(bufferSize, 0);
+   for (int i = 0; i < buffer.size(); i++)
+      buffer[i] = static_cast<char>(mtRand.randInt(255));
+
+   QElapsedTimer timer;
+
+   qDebug() << "QCryptographicHash, throughput [MB/s]:";
+   timer.start();
+   QCryptographicHash cryptographicHash(QCryptographicHash::Sha1);
+   for (int i = 0; i < nbBuffers; i++)
+      cryptographicHash.addData(buffer.constData(), buffer.size());
+   const QByteArray reference = cryptographicHash.result();
+   qDebug() << 1000.0 * bufferSize * nbBuffers / 1024 / 1024 / qMax(timer.elapsed(), 1LL);
+
+   const Sha1::Backend initialBackend = Sha1::getBackend();
+
+   for (Sha1::Backend backend : { Sha1::Backend::GENERIC, Sha1::Backend::SHA_NI })
+   {
+      if (!Sha1::setBackend(backend))
+      {
+         qDebug() << "Sha1, backend" << Sha1::getBackendName(backend) << "not supported";
+         continue;
+      }
+
+      qDebug() << "Sha1, backend" << Sha1::getBackendName(backend) << ", throughput [MB/s]:";
+      timer.start();
+      Hasher hasher;
+      for (int i = 0; i < nbBuffers; i++)
+         hasher.addData(buffer.constData(), buffer.size());
+      const Hash result = hasher.getResult();
+      qDebug() << 1000.0 * bufferSize * nbBuffers / 1024 / 1024 / qMax(timer.elapsed(), 1LL);
+
+      QCOMPARE(result.getByteArray(), reference);
+   }
+
+   Sha1::setBackend(initialBackend);
+}
+
+/**
+  * Number of heap allocations done to extract the chunk hashes of an IMAlive message before asking the file manager
+  * if they are known, see 'UDPListener::processPendingMulticastDatagrams()'.
+  * A 'Common::Hash' is stored inline and is trivially copyable, thus a 'QVector<Common::Hash>' needs only one allocation
+  * whereas a 'QList<Common::Hash>' allocates each of its element.
+  */
+void BenchmarkTests::hashAllocations()
+{
+   const int nbChunks = 100; // Roughly the number of chunks sent in an IMAlive message.
+   const int nbMessages = 100000;
+
+   Protos::Common::Entry message; // Has a repeated field 'chunk' like the IMAlive message.
+   for (int i = 0; i < nbChunks; i++)
+      message.add_chunk()->set_hash(Hash::rand().getData(), Hash::HASH_SIZE);
+
+   QElapsedTimer timer;
+
+   quint64 nbAllocationsBefore = nbAllocations;
+   timer.start();
+   for (int n = 0; n < nbMessages; n++)
+   {
+      QList<Hash> hashes;
+      hashes.reserve(message.chunk_size());
+      for (int i = 0; i < message.chunk_size(); i++)
+         hashes << message.chunk(i).hash();
+   }
+   const quint64 nbAllocationsList = nbAllocations - nbAllocationsBefore;
+   qDebug() << "QList<Hash>, allocations per message:" << double(nbAllocationsList) / nbMessages << ", time:" << timer.elapsed() << "ms";
+
+   nbAllocationsBefore = nbAllocations;
+   timer.start();
+   for (int n = 0; n < nbMessages; n++)
+   {
+      QVector<Hash> hashes;
+      hashes.reserve(message.chunk_size());
+      for (int i = 0; i < message.chunk_size(); i++)
+         hashes << message.chunk(i).hash();
+   }
+   const quint64 nbAllocationsVector = nbAllocations - nbAllocationsBefore;
+   qDebug() << "QVector<Hash>, allocations per message:" << double(nbAllocationsVector) / nbMessages << ", time:" << timer.elapsed() << "ms";
+
+   QCOMPARE(nbAllocationsVector, quint64(nbMessages));
+
+   // Copying, comparing and hashing a hash must never allocate.
+   const Hash h1 = Hash::rand();
+   nbAllocationsBefore = nbAllocations;
+   uint sum = 0;
+   for (int n = 0; n < nbMessages; n++)
+   {
+      Hash h2 = h1;
+      Hash h3(std::move(h2));
+      if (h3 == h1 && !h3.isNull())
+         sum += qHash(h3);
+   }
+   QCOMPARE(nbAllocations - nbAllocationsBefore, quint64(0));
+   QCOMPARE(sum, nbMessages * qHash(h1));
+}
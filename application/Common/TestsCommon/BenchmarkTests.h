@@ -11,6 +11,8 @@ public:
 
 private slots:
    void sortedArray();
+   void hasherThroughput();
+   void hashAllocations();
 
 };
 
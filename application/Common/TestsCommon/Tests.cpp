@@ -26,6 +26,9 @@
 #include <QMap>
 #include <QDir>
 #include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QThread>
+#include <QAtomicInt>
 
 #include <Libs/MersenneTwister.h>
 
@@ -44,7 +47,9 @@
 #include <ZeroCopyStreamQIODevice.h>
 #include <ProtoHelper.h>
 #include <BloomFilter.h>
+#include <Sha1.h>
 #include <TransferRateCalculator.h>
+#include <ReadWriteLock.h>
 using namespace Common;
 
 Tests::Tests()
@@ -573,6 +578,123 @@ void Tests::hasher()
    QVERIFY(h4 == h5);
 }
 
+/**
+  * Each backend must give the same result as 'QCryptographicHash' whatever the size of the data and how they are added.
+  */
+void Tests::sha1Backends()
+{
+   MTRand mtRand(42);
+   QByteArray data(1000, 0);
+   for (int i = 0; i < data.size(); i++)
+      data[i] = static_cast<char>(mtRand.randInt(255));
+
+   const Sha1::Backend initialBackend = Sha1::getBackend();
+
+   for (Sha1::Backend backend : { Sha1::Backend::GENERIC, Sha1::Backend::SHA_NI })
+   {
+      if (!Sha1::setBackend(backend))
+      {
+         qDebug() << "Backend not supported:" << Sha1::getBackendName(backend);
+         continue;
+      }
+
+      for (int size = 0; size <= 200; size++)
+         for (int split = 0; split <= size; split += 13)
+         {
+            Hasher hasher;
+            hasher.addData(data.constData(), split);
+            hasher.addData(data.constData() + split, size - split);
+
+            QCryptographicHash reference(QCryptographicHash::Sha1);
+            reference.addData(data.constData(), size);
+
+            QCOMPARE(hasher.getResult().getByteArray(), reference.result());
+         }
+
+      Hasher hasher;
+      hasher.addData(data.constData(), data.size());
+      QCOMPARE(hasher.getResult().getByteArray(), QCryptographicHash::hash(data, QCryptographicHash::Sha1));
+      QCOMPARE(Hasher::hash(QString("abc")).toStr(), QString("a9993e364706816aba3e25717850c26c9cd0d89d"));
+   }
+
+   Sha1::setBackend(initialBackend);
+}
+
+void Tests::blake2bHasher()
+{
+   QCOMPARE(Hasher(HashAlgorithm::BLAKE2B_160).getResult().toStr(), QString("3345524abf6bbe1809449224b5972c41790b6cf2"));
+
+   Hasher hasherABC(HashAlgorithm::BLAKE2B_160);
+   hasherABC.addData("abc", 3);
+   QCOMPARE(hasherABC.getResult().toStr(), QString("384264f676f39536840523f284921cdc68b6846b"));
+
+   QByteArray data(1000, 0);
+   for (int i = 0; i < data.size(); i++)
+      data[i] = static_cast<char>(i % 256);
+
+   // The result mustn't depend of how the data are split, in particular around the 128 bytes blocks.
+   for (int split = 0; split <= data.size(); split += 64)
+   {
+      Hasher hasher(HashAlgorithm::BLAKE2B_160);
+      hasher.addData(data.constData(), split);
+      hasher.addData(data.constData() + split, data.size() - split);
+      QCOMPARE(hasher.getResult().toStr(), QString("bf2818c04dc2fa6dfb864eee4f8901b6a27b0d08"));
+   }
+
+   Hasher hasher(HashAlgorithm::BLAKE2B_160);
+   hasher.addData(data.constData(), data.size());
+   hasher.reset();
+   hasher.addData("abc", 3);
+   QCOMPARE(hasher.getResult(), hasherABC.getResult());
+}
+
+void Tests::hashAlgorithmNegotiation()
+{
+   const QList<HashAlgorithm> supported = Hasher::getSupportedAlgorithms();
+   QVERIFY(supported.contains(HashAlgorithm::SHA1));
+   QVERIFY(supported.contains(HashAlgorithm::BLAKE2B_160));
+
+   QCOMPARE(Hasher::negotiateAlgorithm(supported), supported.first());
+   QCOMPARE(Hasher::negotiateAlgorithm({ HashAlgorithm::BLAKE2B_160 }), HashAlgorithm::BLAKE2B_160);
+   QCOMPARE(Hasher::negotiateAlgorithm({ HashAlgorithm::SHA1 }), HashAlgorithm::SHA1);
+   QCOMPARE(Hasher::negotiateAlgorithm({}), HashAlgorithm::SHA1); // An old peer only knows SHA-1.
+}
+
+void Tests::hasherState()
+{
+   MTRand mtRand(42);
+   QByteArray data(1000, 0);
+   for (int i = 0; i < data.size(); i++)
+      data[i] = static_cast<char>(mtRand.randInt(255));
+
+   for (HashAlgorithm algorithm : { HashAlgorithm::SHA1, HashAlgorithm::BLAKE2B_160 })
+   {
+      Hasher reference(algorithm);
+      reference.addData(data.constData(), data.size());
+      const Hash expected = reference.getResult();
+
+      for (int split = 0; split <= data.size(); split += 37)
+      {
+         Hasher hasher(algorithm);
+         hasher.addData(data.constData(), split);
+         const QByteArray state = hasher.saveState();
+
+         Hasher resumedHasher(algorithm);
+         QVERIFY(resumedHasher.restoreState(state));
+         resumedHasher.addData(data.constData() + split, data.size() - split);
+         QCOMPARE(resumedHasher.getResult(), expected);
+      }
+   }
+
+   // A state can't be restored by a hasher using another algorithm or if it is truncated.
+   Hasher sha1Hasher(HashAlgorithm::SHA1);
+   sha1Hasher.addData(data.constData(), 100);
+   Hasher blake2bHasher(HashAlgorithm::BLAKE2B_160);
+   QVERIFY(!blake2bHasher.restoreState(sha1Hasher.saveState()));
+   QVERIFY(!blake2bHasher.restoreState(QByteArray()));
+   QVERIFY(!Hasher(HashAlgorithm::SHA1).restoreState(sha1Hasher.saveState().left(10)));
+}
+
 void Tests::bloomFilter()
 {
    BloomFilter bloomFilter;
@@ -607,6 +729,91 @@ void Tests::bloomFilter()
    qDebug() << "Measurement of the probability (p) for n =" << n << "with" << NB_TESTS << "tests:" << static_cast<double>(nbOfFalsePositive) / NB_TESTS;
 }
 
+/**
+  * Some readers and some writers lock recursively, a writer also locks for reading.
+  */
+void Tests::readWriteLock()
+{
+   const int NB_READERS = 4;
+   const int NB_WRITERS = 2;
+   const int NB_ITERATIONS = 5000;
+
+   struct Shared
+   {
+      ReadWriteLock lock;
+      QAtomicInt nbReadersInside;
+      QAtomicInt nbWritersInside;
+      QAtomicInt nbErrors;
+      int value = 0;
+   } shared;
+
+   class Reader : public QThread
+   {
+   public:
+      Reader(Shared& shared, int nbIterations) : shared(shared), nbIterations(nbIterations) {}
+      void run() override
+      {
+         for (int i = 0; i < this->nbIterations; i++)
+         {
+            ReadLocker locker(&this->shared.lock);
+            this->shared.nbReadersInside.ref();
+            {
+               ReadLocker locker2(&this->shared.lock); // Must not wait for a waiting writer.
+               if (this->shared.nbWritersInside.load() != 0)
+                  this->shared.nbErrors.ref();
+            }
+            this->shared.nbReadersInside.deref();
+         }
+      }
+   private:
+      Shared& shared;
+      const int nbIterations;
+   };
+
+   class Writer : public QThread
+   {
+   public:
+      Writer(Shared& shared, int nbIterations) : shared(shared), nbIterations(nbIterations) {}
+      void run() override
+      {
+         for (int i = 0; i < this->nbIterations; i++)
+         {
+            WriteLocker locker(&this->shared.lock);
+            this->shared.nbWritersInside.ref();
+            {
+               ReadLocker locker2(&this->shared.lock);
+               WriteLocker locker3(&this->shared.lock);
+               if (this->shared.nbWritersInside.load() != 1 || this->shared.nbReadersInside.load() != 0)
+                  this->shared.nbErrors.ref();
+               this->shared.value++;
+            }
+            this->shared.nbWritersInside.deref();
+         }
+      }
+   private:
+      Shared& shared;
+      const int nbIterations;
+   };
+
+   QList<QThread*> threads;
+   for (int i = 0; i < NB_READERS; i++)
+      threads << new Reader(shared, NB_ITERATIONS);
+   for (int i = 0; i < NB_WRITERS; i++)
+      threads << new Writer(shared, NB_ITERATIONS);
+
+   foreach (QThread* thread, threads)
+      thread->start();
+
+   foreach (QThread* thread, threads)
+   {
+      QVERIFY(thread->wait(60000));
+      delete thread;
+   }
+
+   QCOMPARE(shared.nbErrors.load(), 0);
+   QCOMPARE(shared.value, NB_WRITERS * NB_ITERATIONS);
+}
+
 void Tests::messageHeader()
 {
    const char data[] = {
@@ -70,10 +70,17 @@ private slots:
    void compareTwoHash();
    void hashMoveConstuctorAndAssignment();
    void hasher();
+   void sha1Backends();
+   void blake2bHasher();
+   void hashAlgorithmNegotiation();
+   void hasherState();
 
    // BloomFilter class.
    void bloomFilter();
 
+   // ReadWriteLock class.
+   void readWriteLock();
+
    void messageHeader();
 
    // ZeroCopyOutputStreamQIODevice and ZeroCopyInputStreamQIODevice classes.
@@ -188,6 +188,17 @@ void Core::checkSettingsIntegrity()
    this->checkSetting("save_cache_period", 1000u, 4294967295u);
 
    this->checkSetting("get_entries_timeout", 1000u, 60u * 1000u);
+   this->checkSetting("number_of_hashing_threads", 1u, 64u);
+   this->checkSetting("max_hashing_threads_per_device", 1u, 64u);
+   this->checkSetting("number_of_hashing_threads_per_file", 1u, 64u);
+   this->checkSetting("chunk_hash_algorithm", 1u, 2u);
+   this->checkSetting("number_of_hashing_read_ahead_buffers", 2u, 64u);
+   this->checkSetting("chunk_leaf_size", 0u, 64u * 1024u * 1024u);
+   this->checkSetting("search_cache_size", 0u, 1024u * 1024u * 1024u);
+   this->checkSetting("encoded_entries_cache_size", 0u, 1024u * 1024u * 1024u);
+   this->checkSetting("cache_journal_max_size", 1024u * 1024u, 4294967295u);
+   this->checkSetting("number_of_scanning_threads", 1u, 64u);
+   this->checkSetting("file_event_quiet_period", 0u, 60u * 1000u);
    this->checkSetting("pending_socket_timeout", 10u, 30u * 1000u);
    this->checkSetting("peer_timeout_factor", 1.0, 10.0);
    this->checkSetting("idle_socket_timeout", 1000u, 60u * 60u * 1000u);
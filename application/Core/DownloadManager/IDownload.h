@@ -56,6 +56,7 @@ namespace DM
       FILE_NON_EXISTENT = 0x27,
       GOT_TOO_MUCH_DATA = 0x28,
       HASH_MISSMATCH = 0x29,
+      HASH_ALGORITHM_NOT_SUPPORTED = 0x2A, // The hashes of the remote entry are computed with an algorithm not supported by both peers.
 
       DIRECTORY_SCANNING_IN_PROGRESS = 0x31,
       UNABLE_TO_GET_ENTRIES = 0x32
@@ -80,7 +80,12 @@ QList<Protos::Common::FindResult> MockFileManager::find(const QString& words, co
    return QList<Protos::Common::FindResult>();
 }
 
-QBitArray MockFileManager::haveChunks(const QList<Common::Hash>& hashes)
+QList<QByteArray> MockFileManager::findEncoded(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize, quint64 tag)
+{
+   return QList<QByteArray>();
+}
+
+QBitArray MockFileManager::haveChunks(const QVector<Common::Hash>& hashes)
 {
    return QBitArray();
 }
@@ -100,6 +105,16 @@ int MockFileManager::getProgress() const
    return 0;
 }
 
+MockFileManager::SearchCacheStats MockFileManager::getSearchCacheStats() const
+{
+   return SearchCacheStats { 0, 0, 0, 0 };
+}
+
+MockFileManager::FileEventStats MockFileManager::getFileEventStats() const
+{
+   return FileEventStats { 0, 0, 0, 0, 0 };
+}
+
 void MockFileManager::dumpWordIndex() const
 {
 
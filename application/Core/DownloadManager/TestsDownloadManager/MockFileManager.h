@@ -24,10 +24,13 @@ public:
    Protos::Common::Entries getEntries();
    QList<Protos::Common::FindResult> find(const QString& words, int maxNbResult, int maxSize);
    QList<Protos::Common::FindResult> find(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize);
-   QBitArray haveChunks(const QList<Common::Hash>& hashes);
+   QList<QByteArray> findEncoded(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize, quint64 tag);
+   QBitArray haveChunks(const QVector<Common::Hash>& hashes);
    quint64 getAmount();
    CacheStatus getCacheStatus() const;
    int getProgress() const;
+   SearchCacheStats getSearchCacheStats() const;
+   FileEventStats getFileEventStats() const;
    void dumpWordIndex() const;
    void printSimilarFiles() const;
 };
@@ -56,7 +56,8 @@ void MockPeerManager::updatePeer(
    const QString& coreVersion,
    quint32 downloadRate,
    quint32 uploadRate,
-   quint32 protocolVersion
+   quint32 protocolVersion,
+   const QList<Common::HashAlgorithm>& supportedHashAlgorithms
 )
 {
    // Never called by the download manager.
@@ -25,7 +25,8 @@ public:
       const QString& coreVersion,
       quint32 downloadRate,
       quint32 uploadRate,
-      quint32 protocolVersion
+      quint32 protocolVersion,
+      const QList<Common::HashAlgorithm>& supportedHashAlgorithms
    );
    void removePeer(const Common::Hash& ID, const QHostAddress& IP);
    void removeAllPeers();
@@ -36,12 +36,15 @@ using namespace DM;
 
 const int ChunkDownloader::MINIMUM_DELTA_TIME_TO_COMPUTE_SPEED(100); // [ms]
 
-ChunkDownloader::ChunkDownloader(LinkedPeers& linkedPeers, OccupiedPeers& occupiedPeersDownloadingChunk, Common::TransferRateCalculator& transferRateCalculator, Common::ThreadPool& threadPool, Common::Hash chunkHash) :
+ChunkDownloader::ChunkDownloader(LinkedPeers& linkedPeers, OccupiedPeers& occupiedPeersDownloadingChunk, Common::TransferRateCalculator& transferRateCalculator, Common::ThreadPool& threadPool, Common::Hash chunkHash, Common::HashAlgorithm hashAlgorithm) :
    linkedPeers(linkedPeers),
    occupiedPeersDownloadingChunk(occupiedPeersDownloadingChunk),
    transferRateCalculator(transferRateCalculator),
    threadPool(threadPool),
    chunkHash(chunkHash),
+   hashAlgorithm(hashAlgorithm),
+   ownHashAlgorithm(static_cast<quint32>(hashAlgorithm) == SETTINGS.get<quint32>("chunk_hash_algorithm")),
+   leafSize(0),
    socket(0),
    downloading(false),
    closeTheSocket(false),
@@ -133,7 +136,7 @@ void ChunkDownloader::run()
 
    try
    {
-      QSharedPointer<FM::IDataWriter> writer = this->chunk->getDataWriter();
+      QSharedPointer<FM::IDataWriter> writer = this->ownHashAlgorithm ? this->chunk->getDataWriter() : this->chunk->getDataWriter(this->chunkHash, this->hashAlgorithm);
 
       static const int SOCKET_TIMEOUT = SETTINGS.get<quint32>("socket_timeout");
       static const int TIME_PERIOD_CHOOSE_ANOTHER_PEER = 1000.0 * SETTINGS.get<double>("time_recheck_chunk_factor") * SETTINGS.get<quint32>("chunk_size") / SETTINGS.get<quint32>("lan_speed");
@@ -279,10 +282,30 @@ void ChunkDownloader::finished()
       this->downloadingEnded();
 }
 
+/**
+  * The leaf hashes are given to the chunk, now or when it is set.
+  * They are ignored if they have been computed with another algorithm than ours.
+  */
+void ChunkDownloader::setLeafHashes(int leafSize, const QVector<Common::Hash>& leafHashes)
+{
+   if (!this->ownHashAlgorithm)
+      return;
+
+   this->leafSize = leafSize;
+   this->leafHashes = leafHashes;
+
+   if (!this->chunk.isNull())
+      this->chunk->setLeafHashes(this->leafSize, this->leafHashes);
+}
+
 void ChunkDownloader::setChunk(const QSharedPointer<FM::IChunk>& chunk)
 {
    this->chunk = chunk;
-   this->chunk->setHash(this->chunkHash);
+   if (this->ownHashAlgorithm)
+      this->chunk->setHash(this->chunkHash);
+
+   if (this->leafSize > 0)
+      this->chunk->setLeafHashes(this->leafSize, this->leafHashes);
 }
 
 QSharedPointer<FM::IChunk> ChunkDownloader::getChunk() const
@@ -21,6 +21,7 @@
 
 #include <QSharedPointer>
 #include <QList>
+#include <QVector>
 #include <QThread>
 #include <QElapsedTimer>
 
@@ -53,7 +54,7 @@ namespace DM
 
       Q_OBJECT
    public:
-      ChunkDownloader(LinkedPeers& linkedPeers, OccupiedPeers& occupiedPeersDownloadingChunk, Common::TransferRateCalculator& transferRateCalculator, Common::ThreadPool& threadPool, Common::Hash chunkHash);
+      ChunkDownloader(LinkedPeers& linkedPeers, OccupiedPeers& occupiedPeersDownloadingChunk, Common::TransferRateCalculator& transferRateCalculator, Common::ThreadPool& threadPool, Common::Hash chunkHash, Common::HashAlgorithm hashAlgorithm);
       ~ChunkDownloader();
 
       void stop();
@@ -67,6 +68,7 @@ namespace DM
       void run();
       void finished();
 
+      void setLeafHashes(int leafSize, const QVector<Common::Hash>& leafHashes);
       void setChunk(const QSharedPointer<FM::IChunk>& chunk);
       QSharedPointer<FM::IChunk> getChunk() const;
 
@@ -112,6 +114,10 @@ namespace DM
       Common::ThreadPool& threadPool;
 
       Common::Hash chunkHash;
+      const Common::HashAlgorithm hashAlgorithm; // The algorithm of 'chunkHash', it may differ from ours, see 'FileDownload::getHashAlgorithm()'.
+      const bool ownHashAlgorithm; // If false the chunk doesn't get 'chunkHash', it's only used to check the data.
+      int leafSize; // 0 if the leaf hashes are unknown.
+      QVector<Common::Hash> leafHashes;
       QSharedPointer<FM::IChunk> chunk;
 
       QList<PM::IPeer*> peers; // The peers which own this chunk.
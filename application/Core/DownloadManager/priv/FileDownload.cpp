@@ -65,10 +65,11 @@ FileDownload::FileDownload(
    this->setStatus(static_cast<Status>(status));
 
    // We create a 'ChunkDownloader' for each known chunk in the entry.
+   // The hashes computed with an algorithm not supported by both sides are ignored, they can't be checked.
    for (int i = 0; i < this->NB_CHUNK; i++)
    {
-      QSharedPointer<ChunkDownloader> chunkDownloader = (i < this->remoteEntry.chunk_size() && this->remoteEntry.chunk(i).has_hash()) ?
-         (new ChunkDownloader(this->linkedPeers, this->occupiedPeersDownloadingChunk, this->transferRateCalculator, this->threadPool, Common::Hash(this->remoteEntry.chunk(i).hash())))->grabStrongRef()
+      QSharedPointer<ChunkDownloader> chunkDownloader = (this->hasSupportedHashAlgorithm() && i < this->remoteEntry.chunk_size() && this->remoteEntry.chunk(i).has_hash()) ?
+         (new ChunkDownloader(this->linkedPeers, this->occupiedPeersDownloadingChunk, this->transferRateCalculator, this->threadPool, Common::Hash(this->remoteEntry.chunk(i).hash()), this->getHashAlgorithm()))->grabStrongRef()
          : QSharedPointer<ChunkDownloader>();
 
       this->chunkDownloaders << chunkDownloader;
@@ -325,7 +326,9 @@ void FileDownload::remove()
 bool FileDownload::retrieveHashes()
 {
    // If we've already got all the chunk hashes it's unecessary to re-ask them.
+   // The source peer would send hashes computed with an algorithm we can't check.
    if (
+      !this->hasSupportedHashAlgorithm() ||
       this->nbHashesKnown == this->NB_CHUNK ||
       this->status == COMPLETE ||
       this->status == DELETED ||
@@ -372,6 +375,12 @@ bool FileDownload::updateStatus()
    if (Download::updateStatus())
       return true;
 
+   if (!this->hasSupportedHashAlgorithm())
+   {
+      this->setStatus(HASH_ALGORITHM_NOT_SUPPORTED);
+      return false;
+   }
+
    Status newStatus = this->status;
 
    if (this->nbHashesKnown == NB_CHUNK)
@@ -493,9 +502,18 @@ void FileDownload::nextHash(const Protos::Core::HashResult& hashResult)
       return;
    }
 
-   QSharedPointer<ChunkDownloader> chunkDownloader = (new ChunkDownloader(this->linkedPeers, this->occupiedPeersDownloadingChunk, this->transferRateCalculator, this->threadPool, hash))->grabStrongRef();
+   QSharedPointer<ChunkDownloader> chunkDownloader = (new ChunkDownloader(this->linkedPeers, this->occupiedPeersDownloadingChunk, this->transferRateCalculator, this->threadPool, hash, this->getHashAlgorithm()))->grabStrongRef();
    this->chunkDownloaders[num] = chunkDownloader;
 
+   if (hashResult.has_leaf_size())
+   {
+      QVector<Common::Hash> leafHashes;
+      leafHashes.reserve(hashResult.leaf_hash_size());
+      for (int i = 0; i < hashResult.leaf_hash_size(); i++)
+         leafHashes << hashResult.leaf_hash(i).hash();
+      chunkDownloader->setLeafHashes(hashResult.leaf_size(), leafHashes);
+   }
+
    // If the file has already been created, the chunks are known.
    auto chunk = this->chunksWithoutDownloader.take(num);
    if (!chunk.isNull())
@@ -537,6 +555,32 @@ void FileDownload::chunkDownloaderFinished()
    this->updateStatus();
 }
 
+/**
+  * Negotiate the algorithm used to check the data of this download: the fastest one supported by both sides among the
+  * ones the source peer can give the hashes with, SHA-1 if there is none. See 'IMAlive.supported_hash_algorithm'.
+  * The source only owns the hashes of the algorithm its files are hashed with, see 'Entry.hash_algorithm'.
+  * If it isn't ours the chunks don't keep the received hashes, the file is hashed again once complete, see 'IChunk::getDataWriter(..)'.
+  */
+Common::HashAlgorithm FileDownload::getHashAlgorithm() const
+{
+   const Common::HashAlgorithm entryAlgorithm = static_cast<Common::HashAlgorithm>(this->remoteEntry.hash_algorithm());
+
+   QList<Common::HashAlgorithm> sourceAlgorithms;
+   if (this->peerSource->getSupportedHashAlgorithms().contains(entryAlgorithm))
+      sourceAlgorithms << entryAlgorithm;
+
+   return Common::Hasher::negotiateAlgorithm(sourceAlgorithms);
+}
+
+/**
+  * The hashes of the remote entry can be used only if they are computed with the negotiated algorithm.
+  * An old peer only supports SHA-1.
+  */
+bool FileDownload::hasSupportedHashAlgorithm() const
+{
+   return this->getHashAlgorithm() == static_cast<Common::HashAlgorithm>(this->remoteEntry.hash_algorithm());
+}
+
 /**
   * Look if a file in the cache ('FM::IFileManager') owns the known hashes. If so, the chunks ('FM:IChunk') are given to each 'ChunkDownload' and
   * 'this->local_entry().exists' is set to true.
@@ -97,6 +97,8 @@ namespace DM
       void chunkDownloaderFinished();
 
    private:
+      Common::HashAlgorithm getHashAlgorithm() const;
+      bool hasSupportedHashAlgorithm() const;
       bool tryToLinkToAnExistingFile();
       void connectChunkDownloaderSignals(const QSharedPointer<ChunkDownloader>& chunkDownload);
       bool createFile();
@@ -44,6 +44,7 @@ using namespace DM;
       case FILE_NON_EXISTENT: return "FILE_NON_EXISTENT";
       case GOT_TOO_MUCH_DATA: return "GOT_TOO_MUCH_DATA";
       case HASH_MISSMATCH: return "HASH_MISSMATCH";
+      case HASH_ALGORITHM_NOT_SUPPORTED: return "HASH_ALGORITHM_NOT_SUPPORTED";
       case DIRECTORY_SCANNING_IN_PROGRESS: return "DIRECTORY_SCANNING_IN_PROGRESS";
       case UNABLE_TO_GET_ENTRIES: return "UNABLE_TO_GET_ENTRIES";
       }
@@ -24,9 +24,11 @@ win32 {
 
 unix {
    SOURCES += priv/FileUpdater/WaitConditionLinux.cpp \
-      priv/FileUpdater/DirWatcherLinux.cpp
+      priv/FileUpdater/DirWatcherLinux.cpp \
+      priv/FileUpdater/DirWatcherFanotify.cpp
    HEADERS += priv/FileUpdater/WaitConditionLinux.h \
-      priv/FileUpdater/DirWatcherLinux.h
+      priv/FileUpdater/DirWatcherLinux.h \
+      priv/FileUpdater/DirWatcherFanotify.h
 }
 
 macx {
@@ -50,6 +52,9 @@ SOURCES += priv/Builder.cpp \
     priv/Cache/DataReader.cpp \
     priv/Cache/DataWriter.cpp \
     priv/Cache/Cache.cpp \
+    priv/Cache/CacheJournal.cpp \
+    priv/Cache/CacheIndex.cpp \
+    priv/Cache/CacheSnapshotWriter.cpp \
     ../../Protos/files_cache.pb.cc \
     priv/FileUpdater/WaitCondition.cpp \
     priv/GetHashesResult.cpp \
@@ -57,8 +62,18 @@ SOURCES += priv/Builder.cpp \
     priv/Global.cpp \
     priv/Cache/FilePool.cpp \
     priv/Cache/FileHasher.cpp \
+    priv/Cache/LeafHasher.cpp \
     priv/GetEntriesResult.cpp \
-    priv/SizeIndexEntries.cpp
+    priv/FindResultEncoder.cpp \
+    priv/SearchCache.cpp \
+    priv/SizeIndexEntries.cpp \
+    priv/FileUpdater/HashingThread.cpp \
+    priv/FileUpdater/DirScanner.cpp \
+    priv/FileUpdater/EventCoalescer.cpp \
+    priv/FileUpdater/FilesToHash.cpp \
+    priv/Cache/NamePool.cpp \
+    priv/Cache/EntryArena.cpp \
+    priv/Cache/EncodedEntriesCache.cpp
 HEADERS += IGetHashesResult.h \
     IFileManager.h \
     IChunk.h \
@@ -74,6 +89,7 @@ HEADERS += IGetHashesResult.h \
     priv/ChunkIndex/Chunks.h \
     priv/WordIndex/WordIndex.h \
     priv/WordIndex/Node.h \
+    priv/WordIndex/Trie.h \
     ../../Protos/core_protocol.pb.h \
     ../../Protos/common.pb.h \
     IDataReader.h \
@@ -82,6 +98,9 @@ HEADERS += IGetHashesResult.h \
     priv/Cache/DataReader.h \
     priv/Cache/DataWriter.h \
     priv/Cache/Cache.h \
+    priv/Cache/CacheJournal.h \
+    priv/Cache/CacheIndex.h \
+    priv/Cache/CacheSnapshotWriter.h \
     priv/Exceptions.h \
     Exceptions.h \
     ../../Protos/files_cache.pb.h \
@@ -92,8 +111,20 @@ HEADERS += IGetHashesResult.h \
     priv/FileUpdater/DirWatcherLinux.h \
     priv/Cache/FilePool.h \
     priv/Cache/FileHasher.h \
+    priv/Cache/LeafHasher.h \
     IGetEntriesResult.h \
     priv/GetEntriesResult.h \
+    priv/FindResultEncoder.h \
+    priv/SearchCache.h \
     priv/ExtensionIndex.h \
-    priv/SizeIndexEntries.h
+    priv/TrigramIndex.h \
+    priv/SizeIndexEntries.h \
+    priv/FileUpdater/HashingThread.h \
+    priv/FileUpdater/DirScanner.h \
+    priv/FileUpdater/EventCoalescer.h \
+    priv/FileUpdater/FilesToHash.h \
+    priv/Cache/NamePool.h \
+    priv/Cache/SortedEntries.h \
+    priv/Cache/EntryArena.h \
+    priv/Cache/EncodedEntriesCache.h
 OTHER_FILES +=
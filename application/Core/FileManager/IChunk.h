@@ -20,6 +20,7 @@
 #define FILEMANAGER_ICHUNK_H
 
 #include <QSharedPointer>
+#include <QVector>
 
 #include <Protos/common.pb.h>
 
@@ -77,6 +78,13 @@ namespace FM
         */
       virtual QSharedPointer<IDataWriter> getDataWriter() = 0;
 
+      /**
+        * The data are checked against the given hash computed with another algorithm than ours, see the setting 'chunk_hash_algorithm'.
+        * The hash isn't given to the chunk: it's computed with our algorithm once the file is complete.
+        * @exception See 'getDataWriter()'.
+        */
+      virtual QSharedPointer<IDataWriter> getDataWriter(const Common::Hash& expectedHash, Common::HashAlgorithm algorithm) = 0;
+
       /**
         * Number of the chunk, start at 0.
         * The chunk number 0 is the first data chunk in a file and the chunk number 'getNbTotalChunk() - 1' is the last one.
@@ -98,6 +106,13 @@ namespace FM
         */
       virtual void setHash(const Common::Hash&) = 0;
 
+      /**
+        * Set the hashes of the leaves of the chunk received from a peer, they are used to check the data during the download.
+        * They are provisional: they aren't given to the other peers and are replaced by the hashes computed from the data once the whole chunk hash matches.
+        * @param leafSize The size of the leaves, the last one may be smaller.
+        */
+      virtual void setLeafHashes(int leafSize, const QVector<Common::Hash>& hashes) = 0;
+
       virtual int getKnownBytes() const = 0;
 
       virtual int getChunkSize() const = 0;
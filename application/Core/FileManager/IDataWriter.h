@@ -33,7 +33,7 @@ namespace FM
         * @exception IOErrorException
         * @exception ChunkDeletedException When trying to write to a deleted chunk.
         * @exception TryToWriteBeyondTheEndOfChunkException
-        * @exception hashMissmatchException This occurs only when the setting 'check_received_data_integrity' is enabled. When this exception is thrown the chunk data are reset.
+        * @exception hashMissmatchException This occurs only when the setting 'check_received_data_integrity' is enabled. When this exception is thrown the chunk data are reset, only from the corrupted leaf if the leaf hashes are known (see 'IChunk::setLeafHashes(..)').
         */
       virtual bool write(const char* buffer, int nbBytes) = 0;
    };
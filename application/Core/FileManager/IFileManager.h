@@ -20,8 +20,10 @@
 #define FILEMANAGER_IFILEMANAGER_H
 
 #include <QList>
+#include <QVector>
 #include <QStringList>
 #include <QBitArray>
+#include <QByteArray>
 #include <QPair>
 #include <QSharedPointer>
 
@@ -141,15 +143,25 @@ namespace FM
         * @param maxSize This is the size in bytes each 'FindResult' can't exceed. (Because UDP datagrams have a maximum size).
         * It should not be here but it's far more harder to split the result outside this method.
         * @remarks Will not fill the fields 'FindResult.tag' and 'FindResult.peer_id'.
+        * @remarks The entries are packed as tightly as possible: a small entry may be put in a previous 'FindResult' which
+        * has room for it, the order must be restored with 'EntryLevel.level'.
         */
       virtual QList<Protos::Common::FindResult> find(const QString& words, int maxNbResult, int maxSize) = 0;
       virtual QList<Protos::Common::FindResult> find(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize) = 0;
 
+      /**
+        * Same as 'find(..)' but the results are directly serialized, each 'QByteArray' is a whole 'Protos::Common::FindResult'
+        * of at most 'maxSize' bytes with the field 'tag' set. Each entry is serialized only once.
+        * The field 'FindResult.peer_id' is not filled.
+        * @remarks The results are cached until a file or a directory changes, see the setting 'search_cache_size'.
+        */
+      virtual QList<QByteArray> findEncoded(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize, quint64 tag) = 0;
+
       /**
         * Ask if we have the given hashes. For each hashes a bit is set (1 if the hash is known or 0 otherwise) into the returned QBitArray.
         * Returns a null QBitArray if we own any of the given hashes.
         */
-      virtual QBitArray haveChunks(const QList<Common::Hash>& hashes) = 0;
+      virtual QBitArray haveChunks(const QVector<Common::Hash>& hashes) = 0;
 
       /**
         * Return the amount of shared data.
@@ -171,6 +183,33 @@ namespace FM
         */
       virtual int getProgress() const = 0;
 
+      struct SearchCacheStats
+      {
+         quint64 nbHits;
+         quint64 nbMisses;
+         int nbSearches; ///< The number of search results currently cached.
+         int size; ///< [byte].
+      };
+
+      /**
+        * The counters of the cache of the search results, see 'find(..)'.
+        */
+      virtual SearchCacheStats getSearchCacheStats() const = 0;
+
+      struct FileEventStats
+      {
+         quint64 nbEventsReceived; ///< The events given by the directory watcher.
+         quint64 nbEventsCoalesced; ///< The events merged with an earlier event on the same path or cancelled by a deletion.
+         quint64 nbEventsProcessed; ///< The events applied to the file cache.
+         quint64 nbUnstablePaths; ///< How many times a path was found still changing after the quiet period.
+         int nbPendingPaths; ///< The paths waiting for the end of their quiet period.
+      };
+
+      /**
+        * The counters of the coalescing of the file system events, see the setting 'file_event_quiet_period'.
+        */
+      virtual FileEventStats getFileEventStats() const = 0;
+
       /**
         * Dump the word index as text in the warning logger.
         * Use only for debugging purpose.
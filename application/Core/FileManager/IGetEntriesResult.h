@@ -20,8 +20,7 @@
 #define FILEMANAGER_IGET_ENTRIES_RESULT_H
 
 #include <QObject>
-
-#include <Protos/core_protocol.pb.h>
+#include <QByteArray>
 
 #include <Common/Timeoutable.h>
 
@@ -38,7 +37,10 @@ namespace FM
       virtual void start() = 0;
 
    signals:
-      void result(const Protos::Core::GetEntriesResult::EntryResult&);
+      /**
+        * The result is a serialized 'Protos::Core::GetEntriesResult::EntryResult', it can be sent as is.
+        */
+      void result(const QByteArray& encodedResult);
    };
 }
 #endif
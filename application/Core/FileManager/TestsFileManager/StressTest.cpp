@@ -471,7 +471,7 @@ void StressTest::haveChunk()
 
    qDebug() << "===== StressTest::haveChunk() =====";
 
-   QList<Common::Hash> hashes;
+   QVector<Common::Hash> hashes;
 
    int n = this->randGen.rand(10000) + 1000;
    while (n--)
@@ -20,15 +20,22 @@
 using namespace FM;
 
 #include <string>
+#include <algorithm>
 using namespace std;
 
 #include <QtDebug>
 #include <QRegExp>
 #include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
 #include <QTextStream>
 #include <QDataStream>
 #include <QStringList>
 #include <QDirIterator>
+#include <QThread>
+#include <QAtomicInt>
+#include <QSignalSpy>
+#include <QElapsedTimer>
 
 #include <Protos/core_settings.pb.h>
 
@@ -42,13 +49,18 @@ using namespace std;
 
 #include <IChunk.h>
 #include <IGetHashesResult.h>
+#include <IGetEntriesResult.h>
 #include <Exceptions.h>
 #include <priv/Constants.h>
 #include <priv/WordIndex/WordIndex.h>
+#include <priv/Cache/CacheJournal.h>
+#include <priv/FileUpdater/DirScanner.h>
+#include <priv/FileUpdater/EventCoalescer.h>
 
 #include <HashesReceiver.h>
 
-Tests::Tests()
+Tests::Tests(bool runBenchmarks) :
+   runBenchmarks(runBenchmarks)
 {
 }
 
@@ -70,9 +82,11 @@ void Tests::initTestCase()
    }
 
    Common::PersistentData::rmValue(Common::Constants::FILE_CACHE, Common::Global::DataFolderType::LOCAL); // Reset the stored cache.
+   CacheJournal::removeAllJournals();
 
    SETTINGS.setFilename("core_settings_file_manager_tests.txt");
    SETTINGS.setSettingsMessage(new Protos::Core::Settings());
+   SETTINGS.set("file_event_quiet_period", 50u); // Some tests only wait 100 ms for the file system events to be processed.
 }
 
 void Tests::testWordIndex()
@@ -142,6 +156,346 @@ void Tests::testWordIndex()
    QVERIFY(result10.size() == 0);
 }
 
+/**
+  * The items matching the most terms come first, then those matching exactly their terms.
+  */
+void Tests::testWordIndexSomeWords()
+{
+   qDebug() << "===== testWordIndexSomeWords() =====";
+
+   WordIndex<int> index;
+   index.addItem(QStringList { "alpha", "beta", "gamma" }, 1);
+   index.addItem(QStringList { "alpha", "beta" }, 2);
+   index.addItem(QStringList { "alphabet" }, 4); // Matches 'alpha' partially.
+   index.addItem(QStringList { "alpha" }, 3);
+   index.addItem(QStringList { "delta" }, 5);
+
+   const QList<NodeResult<int>> result = index.search(QStringList { "alpha", "beta", "gamma" }, 300);
+   QCOMPARE(result.size(), 4);
+   QCOMPARE(result[0].value, 1);
+   QCOMPARE(result[0].level, 0);
+   QCOMPARE(result[1].value, 2);
+   QCOMPARE(result[1].level, 4); // 1 * (3 + 1) for the group of three terms.
+   QCOMPARE(result[2].value, 3);
+   QCOMPARE(result[2].level, 13); // 4 + 3 * (2 + 1) for the group of two terms.
+   QCOMPARE(result[3].value, 4);
+   QCOMPARE(result[3].level, 16); // 13 + 3 (partial match).
+
+   QCOMPARE(WordIndex<int>::resultToList(index.search(QStringList { "alpha", "beta", "gamma" }, 2)), QList<int>({ 1, 2 }));
+   QCOMPARE(index.search(QStringList { "alpha", "beta", "gamma" }).size(), 4);
+}
+
+/**
+  * Add and remove a lot of words sharing some prefixes, the nodes and the fragments of the trie must be reused or released.
+  */
+void Tests::testWordIndexManyWords()
+{
+   qDebug() << "===== testWordIndexManyWords() =====";
+
+   const int NB_WORDS = 20000;
+
+   WordIndex<int> index;
+   const QString emptyIndex = index.toStringLog();
+
+   for (int round = 0; round < 3; round++)
+   {
+      for (int i = 0; i < NB_WORDS; i++)
+         index.addItem(QString("word%1").arg(i * 7919 % NB_WORDS, 0, 36), i);
+
+      QCOMPARE(index.search("word").size(), NB_WORDS);
+      QCOMPARE(WordIndex<int>::resultToList(index.search(QString("word%1").arg(1234 * 7919 % NB_WORDS, 0, 36))).first(), 1234);
+
+      // Remove the items in an other order than they were added.
+      for (int i = NB_WORDS - 1; i >= 0; i--)
+         QVERIFY(index.rmItem(QString("word%1").arg(i * 7919 % NB_WORDS, 0, 36), i));
+
+      QVERIFY(index.search("word").isEmpty());
+      QCOMPARE(index.toStringLog(), emptyIndex);
+   }
+}
+
+/**
+  * Some threads search in a 'WordIndex' while an other one adds and removes items.
+  */
+void Tests::testWordIndexConcurrentSearches()
+{
+   qDebug() << "===== testWordIndexConcurrentSearches() =====";
+
+   const int NB_PERMANENT_ITEMS = 100;
+   const int NB_SEARCHERS = 4;
+   const int NB_SEARCHES = 2000;
+
+   WordIndex<int> index;
+   for (int i = 0; i < NB_PERMANENT_ITEMS; i++)
+      index.addItem("permanent", i);
+
+   class Writer : public QThread
+   {
+   public:
+      Writer(WordIndex<int>& index) : index(index) {}
+      void run() override
+      {
+         while (!this->stop.load())
+         {
+            for (int i = 0; i < 100; i++)
+               this->index.addItem(QStringList { "transient", QString("transient%1").arg(i) }, 1000 + i);
+            for (int i = 0; i < 100; i++)
+               this->index.rmItem(QStringList { "transient", QString("transient%1").arg(i) }, 1000 + i);
+         }
+      }
+      QAtomicInt stop;
+   private:
+      WordIndex<int>& index;
+   };
+
+   class Searcher : public QThread
+   {
+   public:
+      Searcher(const WordIndex<int>& index, int nbSearches, int nbPermanentItems) : nbErrors(0), index(index), nbSearches(nbSearches), nbPermanentItems(nbPermanentItems) {}
+      void run() override
+      {
+         for (int i = 0; i < this->nbSearches; i++)
+         {
+            if (this->index.search("permanent").size() != this->nbPermanentItems)
+               this->nbErrors++;
+
+            for (const NodeResult<int>& result : this->index.search(QStringList { "transient", "permanent" }, 1000))
+               if (result.value >= this->nbPermanentItems && (result.value < 1000 || result.value >= 1100))
+                  this->nbErrors++;
+         }
+      }
+      int nbErrors;
+   private:
+      const WordIndex<int>& index;
+      const int nbSearches;
+      const int nbPermanentItems;
+   };
+
+   Writer writer(index);
+   writer.start();
+
+   QList<Searcher*> searchers;
+   for (int i = 0; i < NB_SEARCHERS; i++)
+   {
+      searchers << new Searcher(index, NB_SEARCHES, NB_PERMANENT_ITEMS);
+      searchers.last()->start();
+   }
+
+   int nbErrors = 0;
+   for (QListIterator<Searcher*> i(searchers); i.hasNext();)
+   {
+      Searcher* searcher = i.next();
+      searcher->wait();
+      nbErrors += searcher->nbErrors;
+      delete searcher;
+   }
+
+   writer.stop.store(1);
+   writer.wait();
+
+   QCOMPARE(nbErrors, 0);
+
+   QCOMPARE(index.search("permanent").size(), NB_PERMANENT_ITEMS);
+   QCOMPARE(index.search("transient").size(), 0);
+}
+
+void Tests::cacheJournalReplay()
+{
+   qDebug() << "===== cacheJournalReplay() =====";
+
+   const string sharedDirId(Common::Hash::HASH_SIZE, 'x');
+   const string hash(Common::Hash::HASH_SIZE, 'h');
+
+   // The snapshot: "/a/f1", "/a/f2", "/a/f5" and "/a/f6", each with one chunk. "/a/f5" has been created after a rename of the journal.
+   Protos::FileCache::Hashes hashes;
+   hashes.set_journal_generation(3);
+   Protos::FileCache::Hashes::SharedDir* sharedDir = hashes.add_shareddir();
+   sharedDir->mutable_id()->set_hash(sharedDirId);
+   Protos::FileCache::Hashes::Dir* dirA = sharedDir->mutable_root()->add_dir();
+   dirA->set_name("a");
+   for (const char* filename : { "f1", "f2", "f5", "f6" })
+   {
+      Protos::FileCache::Hashes::File* file = dirA->add_file();
+      file->set_filename(filename);
+      file->set_size(42);
+      file->set_date_last_modified(QString(filename) == "f5" ? 3000 : 1000);
+      file->add_chunk()->set_known_bytes(42);
+   }
+
+   auto newRecord = [&](Protos::FileCache::JournalRecord::Type type, const QStringList& dirs, const QString& name) {
+      Protos::FileCache::JournalRecord record;
+      record.set_type(type);
+      record.mutable_shared_dir_id()->set_hash(sharedDirId);
+      for (QStringListIterator i(dirs); i.hasNext();)
+         record.add_dir(i.next().toStdString());
+      record.set_name(name.toStdString());
+      return record;
+   };
+
+   {
+      CacheJournal journal;
+      journal.open(2); // Already included in the snapshot.
+      journal.append(newRecord(Protos::FileCache::JournalRecord::REMOVE, { "a" }, "f1"));
+
+      QCOMPARE(journal.rotate(), 3u);
+      Protos::FileCache::JournalRecord chunkRecord = newRecord(Protos::FileCache::JournalRecord::CHUNK, { "a", "b" }, "f3");
+      chunkRecord.set_size(100);
+      chunkRecord.set_date_last_modified(2000);
+      chunkRecord.set_nb_chunks(3);
+      chunkRecord.set_chunk_num(1);
+      chunkRecord.mutable_chunk()->set_known_bytes(10);
+      chunkRecord.mutable_chunk()->mutable_hash()->set_hash(hash);
+      journal.append(chunkRecord);
+      Protos::FileCache::JournalRecord renameRecord = newRecord(Protos::FileCache::JournalRecord::RENAME, { "a" }, "f2");
+      renameRecord.set_new_name("f4");
+      renameRecord.set_size(42);
+      renameRecord.set_date_last_modified(1000);
+      journal.append(renameRecord);
+      journal.append(renameRecord); // Replaying twice a record doesn't change the result.
+      Protos::FileCache::JournalRecord reusedNameRecord = newRecord(Protos::FileCache::JournalRecord::RENAME, { "a" }, "f5");
+      reusedNameRecord.set_new_name("f6");
+      reusedNameRecord.set_size(42);
+      reusedNameRecord.set_date_last_modified(1000);
+      journal.append(reusedNameRecord); // Already in the snapshot, the current "/a/f5" is another file.
+      QVERIFY(journal.getSize() > 0);
+   }
+
+   // A record cut by a crash.
+   QFile lastJournal(Common::Global::getDataFolder(Common::Global::DataFolderType::LOCAL) + '/' + Common::Constants::FILE_CACHE + ".journal.3");
+   QVERIFY(lastJournal.open(QIODevice::WriteOnly | QIODevice::Append));
+   lastJournal.write(QByteArray("\xff\x00\x00\x00\x08", 5));
+   lastJournal.close();
+
+   int nbRecords;
+   QCOMPARE(CacheJournal::replay(hashes, nbRecords), 3u);
+   QCOMPARE(nbRecords, 4);
+
+   QCOMPARE(dirA->file_size(), 4);
+   QVERIFY(dirA->file(0).filename() == "f1");
+   QVERIFY(dirA->file(1).filename() == "f4");
+   QVERIFY(dirA->file(2).filename() == "f5");
+   QVERIFY(dirA->file(3).filename() == "f6");
+   QVERIFY(dirA->file(2).date_last_modified() == 3000);
+   QCOMPARE(dirA->dir_size(), 1);
+   QVERIFY(dirA->dir(0).name() == "b");
+   QCOMPARE(dirA->dir(0).file_size(), 1);
+   const Protos::FileCache::Hashes::File& f3 = dirA->dir(0).file(0);
+   QVERIFY(f3.filename() == "f3");
+   QVERIFY(f3.size() == 100);
+   QCOMPARE(f3.chunk_size(), 3);
+   QVERIFY(!f3.chunk(0).has_hash());
+   QCOMPARE(f3.chunk(1).known_bytes(), 10u);
+   QVERIFY(f3.chunk(1).hash().hash() == hash);
+
+   // Once a new snapshot is written the older journals are removed.
+   CacheJournal::removeJournals(4);
+   QCOMPARE(CacheJournal::replay(hashes, nbRecords), 3u);
+   QCOMPARE(nbRecords, 0);
+}
+
+void Tests::dirScannerRead()
+{
+   qDebug() << "===== dirScannerRead() =====";
+
+   QVERIFY(Common::Global::createFile("scannedDir/a.txt"));
+   QVERIFY(Common::Global::createFile("scannedDir/.hidden"));
+   QVERIFY(Common::Global::createFile("scannedDir/subdir/"));
+   QFile file("scannedDir/a.txt");
+   QVERIFY(file.open(QIODevice::WriteOnly));
+   file.write("abc");
+   file.close();
+#if defined(Q_OS_UNIX)
+   QVERIFY(QFile::link("a.txt", "scannedDir/link.txt"));
+#endif
+
+   QDateTime dateLastModified;
+   QList<DirScanner::ScannedEntry> entries;
+   QVERIFY(DirScanner::read("scannedDir", dateLastModified, entries));
+   QCOMPARE(dateLastModified, QFileInfo("scannedDir").lastModified());
+
+   // Only 'a.txt' and 'subdir', the hidden files and the symbolic links are ignored.
+   QCOMPARE(entries.size(), 2);
+   sort(entries.begin(), entries.end(), [](const DirScanner::ScannedEntry& e1, const DirScanner::ScannedEntry& e2) { return e1.name < e2.name; });
+   QCOMPARE(entries[0].name, QString("a.txt"));
+   QVERIFY(!entries[0].isDir);
+   QCOMPARE(entries[0].size, 3LL);
+   QCOMPARE(entries[0].dateLastModified, QFileInfo("scannedDir/a.txt").lastModified());
+   QCOMPARE(entries[1].name, QString("subdir"));
+   QVERIFY(entries[1].isDir);
+
+   entries.clear();
+   QVERIFY(!DirScanner::read("scannedDir/unexisting", dateLastModified, entries));
+   QVERIFY(entries.isEmpty());
+
+   Common::Global::recursiveDeleteDirectory("scannedDir");
+}
+
+void Tests::eventCoalescerMergeEvents()
+{
+   qDebug() << "===== eventCoalescerMergeEvents() =====";
+
+   const QString dirPath = QDir::currentPath().append("/coalescedDir");
+   QVERIFY(Common::Global::createFile("coalescedDir/a.bin"));
+   QVERIFY(Common::Global::createFile("coalescedDir/b.bin"));
+   QVERIFY(Common::Global::createFile("coalescedDir/c.bin"));
+   QTest::qSleep(100);
+
+   EventCoalescer coalescer(50);
+   QCOMPARE(coalescer.getTimeToNextCheck(), -1);
+
+   // 'a.bin' is being written, 'b.bin' is created then deleted and 'c.bin' is renamed.
+   QList<WatcherEvent> events;
+   events << WatcherEvent(WatcherEvent::NEW, dirPath + "/a.bin");
+   for (int i = 0; i < 10; i++)
+      events << WatcherEvent(WatcherEvent::CONTENT_CHANGED, dirPath + "/a.bin");
+   events << WatcherEvent(WatcherEvent::NEW, dirPath + "/b.bin");
+   events << WatcherEvent(WatcherEvent::DELETED, dirPath + "/b.bin");
+   events << WatcherEvent(WatcherEvent::CONTENT_CHANGED, dirPath + "/c.bin");
+   events << WatcherEvent(WatcherEvent::MOVE, dirPath + "/c.bin", dirPath + "/d.bin");
+   coalescer.add(events);
+   QVERIFY(QFile::rename("coalescedDir/c.bin", "coalescedDir/d.bin"));
+
+   // The 'DELETED' and 'MOVE' events aren't delayed.
+   QCOMPARE(coalescer.getTimeToNextCheck(), 0);
+   QList<WatcherEvent> readyEvents = coalescer.takeReadyEvents();
+   QCOMPARE(readyEvents.size(), 2);
+   QCOMPARE(readyEvents[0].type, WatcherEvent::DELETED);
+   QCOMPARE(readyEvents[1].type, WatcherEvent::MOVE);
+   QVERIFY(coalescer.getTimeToNextCheck() > 0);
+   QVERIFY(coalescer.isPending(dirPath + "/a.bin"));
+   QVERIFY(!coalescer.isPending(dirPath + "/b.bin"));
+   QVERIFY(!coalescer.isPending(dirPath + "/c.bin"));
+   QVERIFY(coalescer.isPending(dirPath + "/d.bin"));
+
+   // 'a.bin' is still modified after the quiet period.
+   QTest::qSleep(60);
+   QFile file("coalescedDir/a.bin");
+   QVERIFY(file.open(QIODevice::WriteOnly));
+   file.write("abc");
+   file.close();
+   readyEvents = coalescer.takeReadyEvents();
+   QCOMPARE(readyEvents.size(), 1);
+   QCOMPARE(readyEvents[0].type, WatcherEvent::CONTENT_CHANGED);
+   QCOMPARE(readyEvents[0].path1, dirPath + "/d.bin");
+
+   QTest::qSleep(60);
+   readyEvents = coalescer.takeReadyEvents();
+   QCOMPARE(readyEvents.size(), 1);
+   QCOMPARE(readyEvents[0].type, WatcherEvent::NEW);
+   QCOMPARE(readyEvents[0].path1, dirPath + "/a.bin");
+   QCOMPARE(coalescer.getTimeToNextCheck(), -1);
+   QVERIFY(!coalescer.isPending(dirPath + "/a.bin"));
+
+   const IFileManager::FileEventStats stats = coalescer.getStats();
+   QCOMPARE(stats.nbEventsReceived, 15ull);
+   QCOMPARE(stats.nbEventsCoalesced, 11ull); // Ten 'CONTENT_CHANGED' merged into 'NEW' and one 'NEW' cancelled by 'DELETED'.
+   QCOMPARE(stats.nbEventsProcessed, 4ull);
+   QCOMPARE(stats.nbUnstablePaths, 1ull);
+   QCOMPARE(stats.nbPendingPaths, 0);
+
+   Common::Global::recursiveDeleteDirectory("coalescedDir");
+}
+
 void Tests::createFileManager()
 {
    qDebug() << "===== createFileManager() =====";
@@ -519,6 +873,50 @@ void Tests::browseSomedirectories()
    qDebug() << Common::ProtoHelper::getDebugStr(entries3);
 }
 
+/**
+  * The listing sent to the peers is encoded once and sent again as long as the directory doesn't change.
+  */
+void Tests::browseEncodedEntries()
+{
+   qDebug() << "===== browseEncodedEntries() =====";
+
+   const Protos::Common::Entries sharedDirs = this->fileManager->getEntries();
+   QVERIFY(sharedDirs.entry_size() != 0);
+   const Protos::Common::Entry& sharedDir = sharedDirs.entry(0);
+   const QString newFilePath = this->fileManager->getSharedDir(sharedDir.shared_dir().id().hash()).append("encoded.txt");
+
+   QByteArray encodedResults[3];
+   for (int i = 0; i < 3; i++)
+   {
+      // A new file is added before the last browse.
+      if (i == 2)
+      {
+         QVERIFY(Common::Global::createFile(newFilePath));
+         QTest::qSleep(100);
+      }
+
+      QSharedPointer<IGetEntriesResult> getEntriesResult = this->fileManager->getScannedEntries(sharedDir);
+      QSignalSpy resultSpy(getEntriesResult.data(), SIGNAL(result(QByteArray)));
+      getEntriesResult->start(); // The directory is already scanned, the result is emitted immediately.
+      QCOMPARE(resultSpy.count(), 1);
+      encodedResults[i] = resultSpy.first().first().toByteArray();
+   }
+
+   Protos::Core::GetEntriesResult::EntryResult entryResult;
+   QVERIFY(entryResult.ParseFromArray(encodedResults[0].constData(), encodedResults[0].size()));
+   QCOMPARE(entryResult.status(), Protos::Core::GetEntriesResult::EntryResult::OK);
+   QCOMPARE(entryResult.entries().SerializeAsString(), this->fileManager->getEntries(sharedDir).SerializeAsString());
+   QCOMPARE(encodedResults[1], encodedResults[0]);
+
+   QVERIFY(encodedResults[2] != encodedResults[0]);
+   Protos::Core::GetEntriesResult::EntryResult entryResultAfterChange;
+   QVERIFY(entryResultAfterChange.ParseFromArray(encodedResults[2].constData(), encodedResults[2].size()));
+   QCOMPARE(entryResultAfterChange.entries().entry_size(), entryResult.entries().entry_size() + 1);
+
+   QVERIFY(QFile::remove(newFilePath));
+   QTest::qSleep(100);
+}
+
 void Tests::findExistingFilesWithOneWord()
 {
    qDebug() << "===== findExistingFilesWithOneWord() =====";
@@ -611,6 +1009,57 @@ void Tests::findFilesWithResultFragmentation()
    }
 }
 
+void Tests::findFilesEncoded()
+{
+   qDebug() << "===== findFilesEncoded() =====";
+
+   const int FRAGMENT_MAX_SIZE = 200;
+   const quint64 TAG = 42;
+
+   QString terms("bbb");
+   const QList<QByteArray>& payloads = this->fileManager->findEncoded(terms, QList<QString>(), 0, std::numeric_limits<qint64>::max(), Protos::Common::FindPattern::FILE_DIR, 10000, FRAGMENT_MAX_SIZE, TAG);
+   const QList<Protos::Common::FindResult>& results = this->fileManager->find(terms, 10000, FRAGMENT_MAX_SIZE);
+
+   QStringList namesEncoded;
+   for (int i = 0; i < payloads.size(); i++)
+   {
+      QVERIFY(payloads[i].size() <= FRAGMENT_MAX_SIZE);
+
+      Protos::Common::FindResult result;
+      QVERIFY(result.ParseFromArray(payloads[i].constData(), payloads[i].size()));
+      QCOMPARE(result.tag(), TAG);
+      QCOMPARE(result.ByteSize(), payloads[i].size());
+      for (int j = 0; j < result.entry_size(); j++)
+         namesEncoded << Common::ProtoHelper::getStr(result.entry(j).entry(), &Protos::Common::Entry::name);
+   }
+
+   QStringList names;
+   for (int i = 0; i < results.size(); i++)
+      for (int j = 0; j < results[i].entry_size(); j++)
+         names << Common::ProtoHelper::getStr(results[i].entry(j).entry(), &Protos::Common::Entry::name);
+
+   namesEncoded.sort();
+   names.sort();
+   QCOMPARE(namesEncoded, names);
+}
+
+void Tests::findCachedResults()
+{
+   qDebug() << "===== findCachedResults() =====";
+
+   QString terms("aaaa bbbb");
+   const FM::IFileManager::SearchCacheStats statsBefore = this->fileManager->getSearchCacheStats();
+   const QList<QByteArray> results1 = this->fileManager->findEncoded(terms, QList<QString>(), 0, std::numeric_limits<qint64>::max(), Protos::Common::FindPattern::FILE_DIR, 10000, 65536, 1);
+   const QList<QByteArray> results2 = this->fileManager->findEncoded("AAAA  bbbb", QList<QString>(), 0, std::numeric_limits<qint64>::max(), Protos::Common::FindPattern::FILE_DIR, 10000, 65536, 1); // Same words once normalized.
+   const FM::IFileManager::SearchCacheStats statsAfter = this->fileManager->getSearchCacheStats();
+
+   QCOMPARE(statsAfter.nbMisses, statsBefore.nbMisses + 1);
+   QCOMPARE(statsAfter.nbHits, statsBefore.nbHits + 1);
+   QVERIFY(statsAfter.nbSearches > 0);
+
+   QCOMPARE(results1, results2);
+}
+
 void Tests::findFilesWithSomeWordsAndExtensions()
 {
    qDebug() << "===== findFilesWithSomeWordsAndExtensions() =====";
@@ -694,11 +1143,125 @@ void Tests::findFilesBySizeRange()
    this->compareExpectedResult(results.first(), expectedResult);
 }
 
+void Tests::findDirectoriesWithOneWord()
+{
+   qDebug() << "===== findDirectoriesWithOneWord() =====";
+
+   QString terms("subdir");
+
+   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, QList<QString>(), 0, std::numeric_limits<qint64>::max(), Protos::Common::FindPattern::DIR, 10000, 65536);
+   QVERIFY(!results.isEmpty());
+   this->printSearch(terms, results.first());
+   for (int i = 0; i < results.first().entry_size(); i++)
+      QCOMPARE(results.first().entry(i).entry().type(), Protos::Common::Entry::DIR);
+
+   results = this->fileManager->find(terms, QList<QString>(), 0, std::numeric_limits<qint64>::max(), Protos::Common::FindPattern::FILE, 10000, 65536);
+   QVERIFY(results.isEmpty());
+}
+
+/**
+  * Some threads browse the shared directories (GET_ENTRIES) and some other search (FIND) while files are
+  * created and removed in a shared directory, which makes the file updater scan it.
+  * It measures the number of requests and their worst latency, the readers of the cache shouldn't wait for each other.
+  */
+void Tests::cacheContention()
+{
+   qDebug() << "===== cacheContention() =====";
+
+   if (!this->runBenchmarks)
+      QSKIP("Benchmark, run it with the argument '-benchmark'");
+
+   const int DURATION = 3000; // [ms].
+   const int NB_BROWSERS = 2;
+   const int NB_SEARCHERS = 2;
+   const int NB_FILES_PER_ROUND = 50;
+
+   class Client : public QThread
+   {
+   public:
+      Client(IFileManager* fileManager, bool browse) : nbRequests(0), maxLatency(0), fileManager(fileManager), browse(browse) {}
+      void run() override
+      {
+         QElapsedTimer latencyTimer;
+         while (!this->stop.load())
+         {
+            latencyTimer.start();
+            if (this->browse)
+            {
+               const Protos::Common::Entries roots = this->fileManager->getEntries();
+               for (int i = 0; i < roots.entry_size(); i++)
+               {
+                  const Protos::Common::Entries entries = this->fileManager->getEntries(roots.entry(i));
+                  if (entries.entry_size() > 0)
+                     this->fileManager->getEntries(entries.entry(0));
+               }
+            }
+            else
+            {
+               this->fileManager->find("aaaa", 10000, 65536);
+               this->fileManager->find("subdir", QList<QString>(), 0, std::numeric_limits<qint64>::max(), Protos::Common::FindPattern::DIR, 10000, 65536);
+            }
+            this->maxLatency = qMax(this->maxLatency, latencyTimer.elapsed());
+            this->nbRequests++;
+         }
+      }
+      QAtomicInt stop;
+      int nbRequests;
+      qint64 maxLatency;
+   private:
+      IFileManager* fileManager;
+      const bool browse;
+   };
+
+   QList<Client*> clients;
+   for (int i = 0; i < NB_BROWSERS + NB_SEARCHERS; i++)
+   {
+      clients << new Client(this->fileManager.data(), i < NB_BROWSERS);
+      clients.last()->start();
+   }
+
+   // The scanning. The result is checked once the clients are stopped, a 'QVERIFY' would return with the threads still running.
+   int nbRounds = 0;
+   bool filesCreatedAndDeleted = true;
+   QElapsedTimer timer;
+   timer.start();
+   while (filesCreatedAndDeleted && timer.elapsed() < DURATION)
+   {
+      for (int i = 0; filesCreatedAndDeleted && i < NB_FILES_PER_ROUND; i++)
+         filesCreatedAndDeleted = Common::Global::createFile(QString("sharedDirs/share1/contention/%1/file%2.txt").arg(nbRounds).arg(i));
+      QTest::qSleep(100);
+      filesCreatedAndDeleted &= Common::Global::recursiveDeleteDirectory(QString("sharedDirs/share1/contention/%1").arg(nbRounds));
+      nbRounds++;
+   }
+
+   for (QListIterator<Client*> i(clients); i.hasNext();)
+   {
+      Client* client = i.next();
+      client->stop.store(1);
+      client->wait();
+   }
+
+   bool allClientsServed = true;
+   for (int i = 0; i < clients.size(); i++)
+   {
+      qDebug() << (i < NB_BROWSERS ? "Browser" : "Searcher") << i << ":" << clients[i]->nbRequests << "requests in" << DURATION << "ms, max latency:" << clients[i]->maxLatency << "ms";
+      allClientsServed &= clients[i]->nbRequests > 0;
+      delete clients[i];
+   }
+   qDebug() << "Number of scanning rounds:" << nbRounds << "with" << NB_FILES_PER_ROUND << "files each";
+
+   QVERIFY(filesCreatedAndDeleted);
+   QVERIFY(allClientsServed);
+
+   QVERIFY(Common::Global::recursiveDeleteDirectory("sharedDirs/share1/contention"));
+   QTest::qSleep(500); // Let the file updater remove the directory.
+}
+
 void Tests::haveChunks()
 {
    qDebug() << "===== haveChunks() =====";
 
-   QList<Common::Hash> hashes;
+   QVector<Common::Hash> hashes;
    hashes
       << Common::Hash::fromStr("f6126deaa5e1d9692d54e3bef0507721372ee7f8") // "/sharedDirs/share3/aaaa bbbb cccc.txt"
       << Common::Hash::fromStr("4c24e58c47746ea04296df9342185d9b3a447899") // "/sharedDirs/share1/v.txt"
@@ -728,6 +1291,27 @@ void Tests::printAmount()
    qDebug() << "Sharing amount: " << this->fileManager->getAmount() << " bytes";
 }
 
+void Tests::reloadTheCacheFromItsIndex()
+{
+   qDebug() << "===== reloadTheCacheFromItsIndex() =====";
+
+   const quint64 amount = this->fileManager->getAmount();
+   const QList<Protos::Common::FindResult> results = this->fileManager->find("aaaa", 10000, 65536);
+   QVERIFY(!results.isEmpty());
+
+   this->fileManager.clear(); // Writes the snapshot and the index of the cache.
+   this->fileManager = Builder::newFileManager();
+
+   QSignalSpy fileCacheLoadedSpy(this->fileManager.data(), SIGNAL(fileCacheLoaded()));
+   while (fileCacheLoadedSpy.isEmpty())
+      QTest::qWait(100);
+
+   QCOMPARE(this->fileManager->getAmount(), amount);
+   const QList<Protos::Common::FindResult> resultsAfterReload = this->fileManager->find("aaaa", 10000, 65536);
+   QVERIFY(!resultsAfterReload.isEmpty());
+   QCOMPARE(resultsAfterReload.first().entry_size(), results.first().entry_size());
+}
+
 void Tests::rmSharedDirectory()
 {
    qDebug() << "===== rmSharedDirectory() =====";
@@ -736,46 +1320,104 @@ void Tests::rmSharedDirectory()
    this->fileManager->setSharedDirs(this->sharedDirs);
 }
 
-/**
-  * The following case tests the Bloom filter performance
-  * used in the class 'Chunks'.
-  * The bloom filter can be enable in "Chunks.h".
-  */
 #include <priv/ChunkIndex/Chunks.h>
 #include <priv/Cache/Chunk.h>
 #include <priv/Cache/Directory.h>
 #include <priv/Cache/File.h>
-void Tests::chunksPerformance()
+void Tests::chunksContainsMany()
 {
-   qDebug() << "===== chunksPerformance() =====";
-     
-   const int HASH_POOL_SIZE = 100000;
-   const int NB_HASHES_TO_CHECK = 10000000;
- 
+   qDebug() << "===== chunksContainsMany() =====";
+
    Chunks chunks;
-  
-   for (int i = 0; i < HASH_POOL_SIZE; i++)
+
+   QList<QSharedPointer<Chunk>> knownChunks;
+   for (int i = 0; i < 10000; i++)
    {
       QSharedPointer<Chunk> chunk(new Chunk(nullptr, 0, 0));
       chunk->setHash(Common::Hash::rand());
       chunks.add(chunk);
+      knownChunks << chunk;
    }
 
-   Common::Hashes hashes;
-   const int nbHashes = 100;
-   for (int i = 0; i < nbHashes; i++)
-      hashes << Common::Hash::rand();
+   // Two files may have the same chunk.
+   QSharedPointer<Chunk> duplicateChunk(new Chunk(nullptr, 0, 0));
+   duplicateChunk->setHash(knownChunks[0]->getHash());
+   chunks.add(duplicateChunk);
+   QCOMPARE(chunks.size(), 10001);
+   QCOMPARE(chunks.values(knownChunks[0]->getHash()).size(), 2);
 
-   QElapsedTimer timer;
-   timer.start();
+   QVector<Common::Hash> hashes;
+   for (int i = 0; i < 1000; i++)
+      hashes << (i % 2 == 0 ? knownChunks[i]->getHash() : Common::Hash::rand());
+   hashes << Common::Hash();
 
-   for (int i = 0; i < NB_HASHES_TO_CHECK; i++)
+   QBitArray result = chunks.containsMany(hashes);
+   QCOMPARE(result.size(), hashes.size());
+   for (int i = 0; i < hashes.size(); i++)
+      QCOMPARE(result.testBit(i), i < 1000 && i % 2 == 0);
+
+   // The Bloom filters are rebuilt when many chunks are removed.
+   chunks.rm(knownChunks[0]);
+   QVERIFY(chunks.contains(knownChunks[0]->getHash()));
+   chunks.rm(duplicateChunk);
+   QVERIFY(!chunks.contains(knownChunks[0]->getHash()));
+
+   for (int i = 1; i < knownChunks.size(); i += 2)
+      chunks.rm(knownChunks[i]);
+   QCOMPARE(chunks.size(), 5000 - 1);
+
+   result = chunks.containsMany(hashes);
+   for (int i = 0; i < hashes.size(); i++)
+      QCOMPARE(result.testBit(i), i > 0 && i < 1000 && i % 2 == 0);
+}
+
+/**
+  * Measure the time of 'Chunks::contains(..)' and 'Chunks::containsMany(..)' for unknown hashes,
+  * the common case when receiving an IMAlive message.
+  */
+void Tests::chunksPerformance()
+{
+   qDebug() << "===== chunksPerformance() =====";
+
+   const int NB_HASHES_TO_CHECK = 10000000;
+
+   for (int hashPoolSize : { 100000, 1000000 })
    {
-      if(chunks.contains(hashes[i % nbHashes]))
-         QFAIL("chunks cannot contains a random chunk");
-   }
+      Chunks chunks;
+
+      for (int i = 0; i < hashPoolSize; i++)
+      {
+         QSharedPointer<Chunk> chunk(new Chunk(nullptr, 0, 0));
+         chunk->setHash(Common::Hash::rand());
+         chunks.add(chunk);
+      }
+
+      QVector<Common::Hash> hashes;
+      const int nbHashes = 100;
+      for (int i = 0; i < nbHashes; i++)
+         hashes << Common::Hash::rand();
+
+      QElapsedTimer timer;
+      timer.start();
+
+      for (int i = 0; i < NB_HASHES_TO_CHECK; i++)
+      {
+         if (chunks.contains(hashes[i % nbHashes]))
+            QFAIL("chunks cannot contains a random chunk");
+      }
+
+      qDebug() << "Time to check if" << NB_HASHES_TO_CHECK << "hashes exist among a pool of" << hashPoolSize << "hashes with 'contains(..)':" << timer.elapsed() << "ms";
+
+      timer.start();
+
+      for (int i = 0; i < NB_HASHES_TO_CHECK / nbHashes; i++)
+      {
+         if (chunks.containsMany(hashes).count(true) != 0)
+            QFAIL("chunks cannot contains a random chunk");
+      }
 
-   qDebug() << "Time to check if" << NB_HASHES_TO_CHECK << "hashes exist among a pool of" << HASH_POOL_SIZE << "hashes:" << timer.elapsed() << "ms";
+      qDebug() << "Time to check if" << NB_HASHES_TO_CHECK << "hashes exist among a pool of" << hashPoolSize << "hashes with 'containsMany(..)':" << timer.elapsed() << "ms";
+   }
 }
 
 #include <priv/ExtensionIndex.h>
@@ -915,6 +1557,104 @@ void Tests::extensionIndexSearchWithSomeExtensions()
    }
 }
 
+#include <priv/TrigramIndex.h>
+
+void Tests::trigramIndexSearch()
+{
+   QHash<int, QString> names {
+      { 1, "report2023final.pdf" },
+      { 2, "Report 2023.odt" },
+      { 3, "photos_2022" },
+      { 4, "Éte2023" },
+      { 5, "abcb_cbc" }
+   };
+
+   TrigramIndex<int> index([&](const int& item) { return names[item]; });
+   for (auto i = names.begin(); i != names.end(); ++i)
+      index.addItem(i.value(), i.key());
+
+   QCOMPARE(index.getNbItems(), 5);
+   QVERIFY(index.getMemoryUsage() > 0);
+
+   QList<int> result = index.search(QStringList { "2023" });
+   qSort(result);
+   QCOMPARE(result, QList<int>({ 1, 2, 4 }));
+
+   QCOMPARE(index.search(QStringList { "ete" }), QList<int>({ 4 })); // Case and accents are ignored.
+   QCOMPARE(index.search(QStringList { "PORT", "nal" }), QList<int>({ 1 }));
+   QCOMPARE(index.search(QStringList { "port", "f" }), QList<int>({ 1 })); // A short term is only checked on the results of the others.
+   QVERIFY(index.search(QStringList { "f" }).isEmpty());
+   QVERIFY(index.search(QStringList { "2024" }).isEmpty());
+   QVERIFY(index.search(QStringList { "abcbc" }).isEmpty()); // The item 5 has all the trigrams but not the whole term.
+   QCOMPARE(index.search(QStringList { "2023" }, 2).size(), 2);
+   QCOMPARE(index.search(QStringList { "2023" }, 10, [](const int& item) { return item != 2; }).size(), 2);
+}
+
+void Tests::trigramIndexRmAndRenameItems()
+{
+   QHash<int, QString> names;
+   TrigramIndex<int> index([&](const int& item) { return names[item]; });
+
+   // Enough items to compact the index many times.
+   for (int round = 0; round < 3; round++)
+   {
+      for (int i = 0; i < 5000; i++)
+      {
+         names[i] = QString("file%1abc").arg(i);
+         index.addItem(names[i], i);
+      }
+
+      // Rename the half of them.
+      for (int i = 0; i < 5000; i += 2)
+      {
+         names[i] = QString("renamed%1xyz").arg(i);
+         index.addItem(names[i], i);
+      }
+
+      QCOMPARE(index.search(QStringList { "abc" }).size(), 2500);
+      QCOMPARE(index.search(QStringList { "xyz" }).size(), 2500);
+      QCOMPARE(index.search(QStringList { "le123ab" }), QList<int>({ 123 }));
+
+      for (int i = 0; i < 5000; i++)
+      {
+         index.rmItem(i);
+         names.remove(i);
+      }
+
+      QCOMPARE(index.getNbItems(), 0);
+      QVERIFY(index.search(QStringList { "abc" }).isEmpty());
+   }
+}
+
+#include <priv/Cache/NamePool.h>
+
+void Tests::namePoolInternNames()
+{
+   qDebug() << "===== namePoolInternNames() =====";
+
+   NamePool pool;
+
+   QString name1 = pool.get(QString("cover") + ".jpg");
+   QString name2 = pool.get(QString("cover.") + "jpg");
+   QString name3 = pool.get("Cover.jpg");
+   QCOMPARE(name1, QString("cover.jpg"));
+   QCOMPARE(name1.constData(), name2.constData()); // The same data are shared.
+   QVERIFY(name1.constData() != name3.constData());
+   QCOMPARE(pool.get(name3.toLower()).constData(), name1.constData());
+   QCOMPARE(pool.size(), 2);
+
+   // Only the unused names are removed.
+   name3.clear();
+   QCOMPARE(pool.squeeze(), 1);
+   QCOMPARE(pool.size(), 1);
+
+   name1.clear();
+   QCOMPARE(pool.squeeze(), 0);
+   name2.clear();
+   QCOMPARE(pool.squeeze(), 1);
+   QCOMPARE(pool.size(), 0);
+}
+
 void Tests::cleanupTestCase()
 {
    qDebug() << "===== cleanupTestCase() =====";
@@ -34,12 +34,18 @@ class Tests : public QObject
 
    Q_OBJECT
 public:
-   Tests();
+   Tests(bool runBenchmarks = false);
 
 private slots:
    void initTestCase();
 
    void testWordIndex();
+   void testWordIndexSomeWords();
+   void testWordIndexManyWords();
+   void testWordIndexConcurrentSearches();
+   void cacheJournalReplay();
+   void dirScannerRead();
+   void eventCoalescerMergeEvents();
 
    void createFileManager();
 
@@ -81,6 +87,7 @@ private slots:
 
    /***** Browse the shared directories *****/
    void browseSomedirectories();
+   void browseEncodedEntries();
 
    /***** Find files and directories by keywords *****/
    void findExistingFilesWithOneWord();
@@ -88,24 +95,32 @@ private slots:
    void findFilesWithSomeWords1();
    void findFilesWithSomeWords2();
    void findFilesWithResultFragmentation();
+   void findFilesEncoded();
+   void findCachedResults();
    void findFilesWithSomeWordsAndExtensions();
    void findFilesWithSomeWordsAndExtensionsAndSizeRange();
    void findFilesByExtensions();
    void findFilesByExtensionsAndSizeRange();
    void findFilesBySizeRange();
+   void findDirectoriesWithOneWord();
+
+   /***** Concurrent accesses to the cache *****/
+   void cacheContention();
 
    /***** Ask if the given hashes are known *****/
    void haveChunks();
 
    /***** Ask for the amount of shared byte *****/
    void printAmount();
+   void reloadTheCacheFromItsIndex();
 
    /***** Removing shared directories *****/
    void rmSharedDirectory();
 
    /********** Unit tests of internals classes **********/
 
-   /***** Speed test of the class 'Chunks' *****/
+   /***** The class 'Chunks' *****/
+   void chunksContainsMany();
    void chunksPerformance();
 
    /***** The exenstion index class *****/
@@ -115,6 +130,13 @@ private slots:
    void extensionIndexSearchWithOneExtension();
    void extensionIndexSearchWithSomeExtensions();
 
+   /***** The trigram index class *****/
+   void trigramIndexSearch();
+   void trigramIndexRmAndRenameItems();
+
+   /***** The name pool class *****/
+   void namePoolInternNames();
+
    void cleanupTestCase();
 
 private:
@@ -128,6 +150,8 @@ private:
 
    static void compareStrRegexp(const QString& regexp, const QString& str);
 
+   const bool runBenchmarks; ///< The benchmarks are skipped unless the argument '-benchmark' is given, see 'main(..)'.
+
    QStringList sharedDirs;
    QSharedPointer<IFileManager> fileManager;
 };
@@ -18,6 +18,7 @@
   
 #include <QCoreApplication>
 #include <QTest>
+#include <QStringList>
 
 #include <Tests.h>
 #include <StressTests.h>
@@ -33,7 +34,10 @@ int main(int argc, char *argv[])
    }
    else
    {
-      Tests tests;
-      return QTest::qExec(&tests, argc, argv);
+      // '-benchmark' isn't a QTest argument, it enables the benchmarks of 'Tests'.
+      QStringList arguments = a.arguments();
+      const bool runBenchmarks = arguments.removeAll("-benchmark") > 0;
+      Tests tests(runBenchmarks);
+      return QTest::qExec(&tests, arguments);
    }
 }
@@ -28,10 +28,12 @@ using namespace FM;
 
 #include <Exceptions.h>
 #include <priv/Log.h>
+#include <priv/Global.h>
 #include <priv/Exceptions.h>
 #include <priv/Constants.h>
 #include <priv/Cache/SharedDirectory.h>
 #include <priv/Cache/File.h>
+#include <priv/Cache/CacheIndex.h>
 
 /**
   * @class FM::Cache
@@ -45,7 +47,7 @@ using namespace FM;
   */
 
 Cache::Cache() :
-   mutex(QMutex::Recursive)
+   encodedEntriesCache(SETTINGS.get<quint32>("encoded_entries_cache_size"))
 {
    qRegisterMetaType<Entry*>("Entry*");
 }
@@ -87,7 +89,7 @@ void Cache::forall(std::function<void(Entry*)> fun) const
   */
 Protos::Common::Entries Cache::getSharedEntries() const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
 
    Protos::Common::Entries result;
 
@@ -127,7 +129,7 @@ Directory* Cache::getDirectory(const Protos::Common::Entry& dir) const
    if (!dir.has_shared_dir())
       return nullptr;
 
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
 
    foreach (SharedDirectory* sharedDir, this->sharedDirs)
    {
@@ -153,13 +155,18 @@ Directory* Cache::getDirectory(const Protos::Common::Entry& dir) const
    return nullptr;
 }
 
+EncodedEntriesCache& Cache::getEncodedEntriesCache()
+{
+   return this->encodedEntriesCache;
+}
+
 /**
   * @param path The absolute path to a directory or a file.
   * @return Returns a directory or a file, it can be a shared directory. Returns 'nullptr' if no entry found.
   */
 Entry* Cache::getEntry(const QString& path) const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
 
    foreach (SharedDirectory* sharedDir, this->sharedDirs)
    {
@@ -205,7 +212,7 @@ Entry* Cache::getEntry(const QString& path) const
   */
 File* Cache::getFile(const Protos::Common::Entry& fileEntry) const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
 
    if (!fileEntry.has_shared_dir())
    {
@@ -261,7 +268,8 @@ File* Cache::getFile(const Protos::Common::Entry& fileEntry) const
   */
 QList<QSharedPointer<IChunk>> Cache::newFile(Protos::Common::Entry& fileEntry)
 {
-   QMutexLocker locker(&this->mutex);
+   QMutexLocker newEntryLocker(&this->newEntryMutex);
+   Common::ReadLocker locker(&this->lock);
 
    const QString& dirPath = QDir::cleanPath(Common::ProtoHelper::getStr(fileEntry, &Protos::Common::Entry::path));
    const qint64 spaceNeeded = fileEntry.size() + SETTINGS.get<quint32>("minimum_free_space");
@@ -348,7 +356,8 @@ QList<QSharedPointer<IChunk>> Cache::newFile(Protos::Common::Entry& fileEntry)
   */
 void Cache::newDirectory(Protos::Common::Entry& dirEntry)
 {
-   QMutexLocker locker(&this->mutex);
+   QMutexLocker newEntryLocker(&this->newEntryMutex);
+   Common::ReadLocker locker(&this->lock);
 
    const QString& dirPath = QDir::cleanPath(Common::ProtoHelper::getStr(dirEntry, &Protos::Common::Entry::path)) + '/' + Common::ProtoHelper::getStr(dirEntry, &Protos::Common::Entry::name);
 
@@ -372,7 +381,7 @@ void Cache::newDirectory(Protos::Common::Entry& dirEntry)
 
 QList<Common::SharedDir> Cache::getSharedDirs() const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
 
    QList<Common::SharedDir> list;
 
@@ -384,6 +393,8 @@ QList<Common::SharedDir> Cache::getSharedDirs() const
 
 SharedDirectory* Cache::getSharedDirectory(const Common::Hash& ID) const
 {
+   Common::ReadLocker locker(&this->lock);
+
    for (QListIterator<SharedDirectory*> i(this->sharedDirs); i.hasNext();)
    {
       SharedDirectory* dir = i.next();
@@ -398,7 +409,7 @@ SharedDirectory* Cache::getSharedDirectory(const Common::Hash& ID) const
   */
 void Cache::setSharedDirs(const QStringList& dirs)
 {
-   QMutexLocker locker(&this->mutex);
+   Common::WriteLocker locker(&this->lock);
 
    QStringList dirsNotFound;
 
@@ -442,7 +453,7 @@ void Cache::setSharedDirs(const QStringList& dirs)
   */
 QPair<Common::SharedDir, QString> Cache::addASharedDir(const QString& absoluteDir)
 {
-   QMutexLocker locker(&this->mutex);
+   Common::WriteLocker locker(&this->lock);
 
    QString absoluteDirCleaned = Common::Global::cleanDirPath(absoluteDir);
 
@@ -489,7 +500,7 @@ QPair<Common::SharedDir, QString> Cache::addASharedDir(const QString& absoluteDi
   */
 void Cache::removeSharedDir(SharedDirectory* dir, Directory* dir2)
 {
-   QMutexLocker locker(&this->mutex);
+   Common::WriteLocker locker(&this->lock);
 
    if (this->sharedDirs.contains(dir))
    {
@@ -500,7 +511,7 @@ void Cache::removeSharedDir(SharedDirectory* dir, Directory* dir2)
 
 SharedDirectory* Cache::getSuperSharedDirectory(const QString& path) const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
    const QStringList& folders = path.split('/', QString::SkipEmptyParts);
 
    for (QListIterator<SharedDirectory*> i(this->sharedDirs); i.hasNext();)
@@ -523,7 +534,7 @@ SharedDirectory* Cache::getSuperSharedDirectory(const QString& path) const
 
 QList<SharedDirectory*> Cache::getSubSharedDirectories(const QString& path) const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
    QList<SharedDirectory*> ret;
 
    const QStringList& folders = path.split('/', QString::SkipEmptyParts);
@@ -553,7 +564,7 @@ QList<SharedDirectory*> Cache::getSubSharedDirectories(const QString& path) cons
   */
 bool Cache::isShared(const QString& path) const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
    foreach (SharedDirectory* dir, this->sharedDirs)
       if (dir->getFullPath() == path)
          return true;
@@ -570,7 +581,7 @@ bool Cache::isShared(const QString& path) const
   */
 Directory* Cache::getFittestDirectory(const QString& path) const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
 
    foreach (SharedDirectory* sharedDir, this->sharedDirs)
    {
@@ -619,10 +630,11 @@ void Cache::createSharedDirs(const Protos::FileCache::Hashes& hashes)
   */
 void Cache::populateHashes(Protos::FileCache::Hashes& hashes) const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
 
    hashes.set_version(FILE_CACHE_VERSION);
    hashes.set_chunksize(SETTINGS.get<quint32>("chunk_size"));
+   hashes.set_hash_algorithm(static_cast<Protos::Common::HashAlgorithm>(Global::getHashAlgorithm()));
 
    for (QListIterator<SharedDirectory*> i(this->sharedDirs); i.hasNext();)
    {
@@ -635,9 +647,18 @@ void Cache::populateHashes(Protos::FileCache::Hashes& hashes) const
    }
 }
 
+/**
+  * Copy the whole tree to be persisted later, see 'CacheIndex'.
+  */
+QByteArray Cache::buildIndex(quint32 journalGeneration) const
+{
+   Common::ReadLocker locker(&this->lock);
+   return CacheIndex::build(this->sharedDirs, journalGeneration);
+}
+
 quint64 Cache::getAmount() const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
 
    quint64 amount = 0;
    for(QListIterator<SharedDirectory*> i(this->sharedDirs); i.hasNext();)
@@ -652,6 +673,7 @@ void Cache::onEntryAdded(Entry* entry)
 
 void Cache::onEntryRemoved(Entry* entry)
 {
+   this->forgetPreviousHashes(entry);
    emit entryRemoved(entry);
 }
 
@@ -672,11 +694,19 @@ void Cache::onEntryResized(Entry* entry, qint64 oldSize)
 
 void Cache::onChunkHashKnown(const QSharedPointer<Chunk>& chunk)
 {
+   File* file = chunk->getFile();
+   if (file)
+      file->chunksChanged();
+
    emit chunkHashKnown(chunk);
 }
 
 void Cache::onChunkRemoved(const QSharedPointer<Chunk>& chunk)
 {
+   File* file = chunk->getFile();
+   if (file)
+      file->chunksChanged();
+
    emit chunkRemoved(chunk);
 }
 
@@ -685,6 +715,46 @@ void Cache::onScanned(Directory* dir)
    emit directoryScanned(dir);
 }
 
+/**
+  * After a change of the setting "chunk_hash_algorithm" the hashes of the previous algorithm are kept in the file cache
+  * until the files are hashed again, they are never sent to the other peers. If the setting is restored before the end
+  * of the hashing the files don't have to be hashed again. See 'File::restoreFromFileCache(..)' and 'File::populateHashesFile(..)'.
+  * @param hashes The hashes of the file as saved in the file cache.
+  */
+void Cache::keepPreviousHashes(const Entry* file, const Protos::FileCache::Hashes::File& hashes)
+{
+   QMutexLocker locker(&this->previousHashesMutex);
+   this->previousHashes.insert(file, hashes);
+}
+
+/**
+  * @return 'false' if there is no hash of a previous algorithm for the given file.
+  */
+bool Cache::getPreviousHashes(const Entry* file, Protos::FileCache::Hashes::File& hashes) const
+{
+   QMutexLocker locker(&this->previousHashesMutex);
+   auto i = this->previousHashes.constFind(file);
+   if (i == this->previousHashes.constEnd())
+      return false;
+   hashes.CopyFrom(i.value());
+   return true;
+}
+
+bool Cache::hasPreviousHashes(const Entry* file) const
+{
+   QMutexLocker locker(&this->previousHashesMutex);
+   return this->previousHashes.contains(file);
+}
+
+/**
+  * Called when a file is removed or when all its hashes have been computed with the current algorithm.
+  */
+void Cache::forgetPreviousHashes(const Entry* file)
+{
+   QMutexLocker locker(&this->previousHashesMutex);
+   this->previousHashes.remove(file);
+}
+
 void Cache::deleteEntry(Entry* entry)
 {
    delete entry;
@@ -739,7 +809,7 @@ Common::SharedDir Cache::makeSharedDir(const SharedDirectory* dir)
   */
 void Cache::createSharedDirs(const QStringList& dirs, const QList<Common::Hash>& ids)
 {
-   QMutexLocker locker(&this->mutex);
+   Common::WriteLocker locker(&this->lock);
 
    QStringList dirsNotFound;
 
@@ -784,7 +854,7 @@ void Cache::createSharedDirs(const QStringList& dirs, const QList<Common::Hash>&
   */
 Directory* Cache::getWriteableDirectory(const QString& path, qint64 spaceNeeded) const
 {
-   QMutexLocker locker(&this->mutex);
+   Common::ReadLocker locker(&this->lock);
 
    const QStringList folders = path.split('/', QString::SkipEmptyParts);
 
@@ -22,8 +22,10 @@
 #include <QObject>
 #include <QPair>
 #include <QList>
+#include <QByteArray>
 #include <QStringList>
 #include <QMutex>
+#include <QHash>
 #include <QSharedPointer>
 
 #include <Protos/files_cache.pb.h>
@@ -31,11 +33,14 @@
 
 #include <Common/Uncopyable.h>
 #include <Common/SharedDir.h>
+#include <Common/ReadWriteLock.h>
 
 #include <priv/FileUpdater/DirWatcher.h>
 #include <priv/Cache/SharedDirectory.h>
 #include <priv/Cache/Chunk.h>
 #include <priv/Cache/FilePool.h>
+#include <priv/Cache/NamePool.h>
+#include <priv/Cache/EncodedEntriesCache.h>
 
 namespace FM
 {
@@ -54,6 +59,7 @@ namespace FM
       Protos::Common::Entries getSharedEntries() const;
       Protos::Common::Entries getEntries(const Protos::Common::Entry& dir, int maxNbHashesPerEntry = std::numeric_limits<int>::max()) const;
       Directory* getDirectory(const Protos::Common::Entry& dir) const;
+      EncodedEntriesCache& getEncodedEntriesCache();
 
       Entry* getEntry(const QString& path) const;
       File* getFile(const Protos::Common::Entry& fileEntry) const;
@@ -74,10 +80,12 @@ namespace FM
 
       void createSharedDirs(const Protos::FileCache::Hashes& hashes);
       void populateHashes(Protos::FileCache::Hashes& hashes) const;
+      QByteArray buildIndex(quint32 journalGeneration) const;
 
       quint64 getAmount() const;
 
       FilePool& getFilePool() { return this->filePool; }
+      NamePool& getNamePool() { return this->namePool; }
 
       void onEntryAdded(Entry* entry);
       void onEntryRemoved(Entry* entry);
@@ -90,6 +98,11 @@ namespace FM
 
       void onScanned(Directory* dir);
 
+      void keepPreviousHashes(const Entry* file, const Protos::FileCache::Hashes::File& hashes);
+      bool getPreviousHashes(const Entry* file, Protos::FileCache::Hashes::File& hashes) const;
+      bool hasPreviousHashes(const Entry* file) const;
+      void forgetPreviousHashes(const Entry* file);
+
    public slots:
       void deleteEntry(Entry* entry);
 
@@ -120,8 +133,16 @@ namespace FM
       QList<SharedDirectory*> sharedDirs;
 
       FilePool filePool;
+      NamePool namePool;
+
+      // The files and the directories have their own mutex, see 'Entry'.
+      mutable Common::ReadWriteLock lock; ///< Protects the shared directories: browsing, searching and persisting only read them and don't wait for each other.
+      QMutex newEntryMutex; ///< Serializes 'newFile(..)' and 'newDirectory(..)': two downloads of the same file mustn't create it twice.
+
+      QHash<const Entry*, Protos::FileCache::Hashes::File> previousHashes; ///< The hashes computed with a previous algorithm, see 'keepPreviousHashes(..)'.
+      mutable QMutex previousHashesMutex;
 
-      mutable QMutex mutex; ///< To protect all the data into the cache, files and directories.
+      EncodedEntriesCache encodedEntriesCache; ///< The serialized listings of the directories, see 'Directory::getEncodedEntries(..)'.
    };
 }
 #endif
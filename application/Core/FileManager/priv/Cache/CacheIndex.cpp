@@ -0,0 +1,332 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#include <priv/Cache/CacheIndex.h>
+using namespace FM;
+
+#include <string>
+
+#include <QLinkedList>
+#include <QPair>
+#include <QDateTime>
+
+#include <Common/Global.h>
+#include <Common/Constants.h>
+#include <Common/Settings.h>
+#include <Common/Hash.h>
+#include <Common/ProtoHelper.h>
+#include <Common/PersistentData.h>
+
+#include <priv/Log.h>
+#include <priv/Global.h>
+#include <priv/Cache/SharedDirectory.h>
+#include <priv/Cache/Directory.h>
+#include <priv/Cache/File.h>
+
+/**
+  * @class FM::CacheIndex
+  *
+  * A copy of the whole cache tree, written with each snapshot of the file cache and read through a memory mapping at startup.
+  * Unlike the snapshot, it contains all the directories and files, with the modification date of each directory.
+  * The tree can thus be rebuilt without scanning the shared directories, the directories are then validated in the background
+  * by comparing their modification date and the ones of their files, see 'FileUpdater::validateSomeRestoredDirs()'.
+  * The index is only valid while the journals from its generation are empty, see 'CacheJournal'.
+  *
+  * The records are written with a 'QDataStream':
+  *  - Directory: name, modification date in ms since Epoch (-1 if unknown), the number of files, each file as a serialized
+  *    'Protos::FileCache::Hashes::File', the number of sub-directories and their offset. A directory is written after its sub-directories.
+  *  - Table of the shared directories, after all the directories: the number of shared directories, then for each one its id, its path and
+  *    the offset of its root.
+  *  - Trailer, at the end: the offset of the table, the journal generation, the chunk size, the hash algorithm, the version and the magic number.
+  * Thus a directory is read only when it's restored.
+  */
+
+const quint32 CacheIndex::MAGIC_NUMBER(0xD1A2C1D0);
+const quint32 CacheIndex::VERSION(1);
+const QString CacheIndex::INDEX_SUFFIX(".index");
+const int CacheIndex::TRAILER_SIZE(8 + 5 * 4);
+
+/**
+  * Copy the given shared directories and their content, the cache must be locked.
+  */
+QByteArray CacheIndex::build(const QList<SharedDirectory*>& sharedDirs, quint32 journalGeneration)
+{
+   QByteArray index;
+   QDataStream stream(&index, QIODevice::WriteOnly);
+   CacheIndex::setStreamFormat(stream);
+
+   QList<qint64> rootOffsets;
+   for (QListIterator<SharedDirectory*> i(sharedDirs); i.hasNext();)
+      rootOffsets << CacheIndex::writeDir(stream, i.next());
+
+   const qint64 tableOffset = stream.device()->pos();
+   stream << static_cast<quint32>(sharedDirs.size());
+   for (int i = 0; i < sharedDirs.size(); i++)
+      stream << sharedDirs[i]->getId().getByteArray() << sharedDirs[i]->getFullPath() << rootOffsets[i];
+
+   stream << tableOffset << journalGeneration << SETTINGS.get<quint32>("chunk_size") << static_cast<quint32>(Global::getHashAlgorithm()) << VERSION << MAGIC_NUMBER;
+
+   return index;
+}
+
+/**
+  * Replace the current index by the given one once it's completely written.
+  * @exception PersistentDataIOException
+  */
+void CacheIndex::write(const QByteArray& index)
+{
+   const QString filepath = CacheIndex::getFilepath();
+   const QString tempFilepath = filepath + ".temp";
+
+   {
+      QFile file(tempFilepath);
+      if (!file.open(QIODevice::WriteOnly) || file.write(index) != index.size())
+         throw Common::PersistentDataIOException(QString("Unable to write the file cache index : %1, error : %2").arg(tempFilepath).arg(file.errorString()));
+   }
+
+   if (!Common::Global::rename(tempFilepath, filepath))
+      throw Common::PersistentDataIOException(QString("Unable to rename the file cache index : %1").arg(tempFilepath));
+}
+
+/**
+  * Must be called before writing a snapshot, if the index isn't written afterwards it doesn't match the snapshot anymore.
+  */
+void CacheIndex::remove()
+{
+   QFile::remove(CacheIndex::getFilepath());
+}
+
+CacheIndex::CacheIndex() :
+   data(nullptr), size(0), journalGeneration(0), chunkSize(0), hashAlgorithm(0)
+{
+}
+
+CacheIndex::~CacheIndex()
+{
+   if (this->data)
+      this->file.unmap(this->data);
+}
+
+/**
+  * Map the index and read its table of shared directories.
+  * @return 'false' if there is no index or if it's corrupted.
+  */
+bool CacheIndex::open()
+{
+   this->file.setFileName(CacheIndex::getFilepath());
+   if (!this->file.open(QIODevice::ReadOnly))
+      return false;
+
+   this->size = this->file.size();
+   if (this->size < TRAILER_SIZE)
+      return false;
+
+   this->data = this->file.map(0, this->size);
+   if (!this->data)
+   {
+      L_WARN(QString("Unable to map the file cache index : %1, error : %2").arg(this->file.fileName()).arg(this->file.errorString()));
+      return false;
+   }
+
+   const QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(this->data), this->size);
+   QDataStream stream(bytes);
+   CacheIndex::setStreamFormat(stream);
+
+   qint64 tableOffset;
+   quint32 version, magicNumber;
+   stream.device()->seek(this->size - TRAILER_SIZE);
+   stream >> tableOffset >> this->journalGeneration >> this->chunkSize >> this->hashAlgorithm >> version >> magicNumber;
+   if (magicNumber != MAGIC_NUMBER || version != VERSION || tableOffset < 0 || tableOffset > this->size - TRAILER_SIZE)
+   {
+      L_WARN(QString("The file cache index is corrupted or has an unknown version : %1").arg(this->file.fileName()));
+      return false;
+   }
+
+   stream.device()->seek(tableOffset);
+   quint32 nbSharedDirs;
+   stream >> nbSharedDirs;
+   for (quint32 i = 0; i < nbSharedDirs && stream.status() == QDataStream::Ok; i++)
+   {
+      SharedDirRecord sharedDir;
+      stream >> sharedDir.id >> sharedDir.path >> sharedDir.rootOffset;
+      this->sharedDirs << sharedDir;
+   }
+
+   return stream.status() == QDataStream::Ok;
+}
+
+quint32 CacheIndex::getJournalGeneration() const
+{
+   return this->journalGeneration;
+}
+
+quint32 CacheIndex::getChunkSize() const
+{
+   return this->chunkSize;
+}
+
+quint32 CacheIndex::getHashAlgorithm() const
+{
+   return this->hashAlgorithm;
+}
+
+/**
+  * Add the shared directories to the given structure, without their content. See 'Cache::createSharedDirs(..)'.
+  */
+void CacheIndex::populateSharedDirs(Protos::FileCache::Hashes& hashes) const
+{
+   for (QListIterator<SharedDirRecord> i(this->sharedDirs); i.hasNext();)
+   {
+      const SharedDirRecord& sharedDir = i.next();
+      Protos::FileCache::Hashes::SharedDir* sharedDirMess = hashes.add_shareddir();
+      sharedDirMess->mutable_id()->set_hash(sharedDir.id.constData(), sharedDir.id.size());
+      Common::ProtoHelper::setStr(*sharedDirMess, &Protos::FileCache::Hashes_SharedDir::set_path, sharedDir.path);
+      sharedDirMess->mutable_root()->set_name("");
+   }
+}
+
+/**
+  * Create the directories and the files of the given shared directory from the index and restore their hashes, the file system isn't read.
+  * @param filesWithoutHashes [out] The complete files which miss some hashes.
+  * @return 'false' if the shared directory isn't in the index or if the index is corrupted, in this case the shared directory may be partially restored.
+  */
+bool CacheIndex::restore(SharedDirectory* sharedDir, QList<File*>& filesWithoutHashes)
+{
+   const QByteArray id = sharedDir->getId().getByteArray();
+
+   qint64 rootOffset = -1;
+   for (QListIterator<SharedDirRecord> i(this->sharedDirs); i.hasNext() && rootOffset == -1;)
+   {
+      const SharedDirRecord& record = i.next();
+      if (record.id == id)
+         rootOffset = record.rootOffset;
+   }
+
+   if (rootOffset == -1)
+      return false;
+
+   const QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(this->data), this->size);
+   QDataStream stream(bytes);
+   CacheIndex::setStreamFormat(stream);
+
+   // The parent directory and the offset of the directory to restore, the root has no parent.
+   QLinkedList<QPair<Directory*, qint64>> dirsToRestore;
+   dirsToRestore << qMakePair<Directory*, qint64>(nullptr, rootOffset);
+
+   Protos::FileCache::Hashes::File fileMess;
+   QByteArray fileBytes;
+   while (!dirsToRestore.isEmpty())
+   {
+      const QPair<Directory*, qint64> current = dirsToRestore.takeFirst();
+      if (current.second < 0 || current.second >= this->size - TRAILER_SIZE || !stream.device()->seek(current.second))
+         return false;
+
+      QString name;
+      qint64 dateLastModified;
+      quint32 nbFiles;
+      stream >> name >> dateLastModified >> nbFiles;
+      if (stream.status() != QDataStream::Ok)
+         return false;
+
+      Directory* dir = current.first ? current.first->createSubDir(name) : sharedDir;
+      if (dateLastModified >= 0)
+         dir->setDateLastModified(QDateTime::fromMSecsSinceEpoch(dateLastModified));
+
+      for (quint32 i = 0; i < nbFiles; i++)
+      {
+         stream >> fileBytes;
+         if (stream.status() != QDataStream::Ok || !fileMess.ParseFromArray(fileBytes.constData(), fileBytes.size()))
+            return false;
+
+         const QString filename = Common::ProtoHelper::getStr(fileMess, &Protos::FileCache::Hashes_File::filename);
+         File* file = dir->getFile(filename);
+         if (!file)
+            file = new File(dir, filename, fileMess.size(), QDateTime::fromMSecsSinceEpoch(fileMess.date_last_modified()));
+
+         file->restoreFromFileCache(fileMess);
+         if (file->getSize() > 0 && !file->hasAllHashes() && file->isComplete())
+            filesWithoutHashes << file;
+      }
+
+      quint32 nbSubDirs;
+      stream >> nbSubDirs;
+      for (quint32 i = 0; i < nbSubDirs && stream.status() == QDataStream::Ok; i++)
+      {
+         qint64 offset;
+         stream >> offset;
+
+         // A directory is written after its sub-directories: any other offset would be a corruption and may lead to a cycle.
+         if (offset >= current.second)
+            return false;
+
+         dirsToRestore << qMakePair(dir, offset);
+      }
+
+      if (stream.status() != QDataStream::Ok)
+         return false;
+   }
+
+   return true;
+}
+
+/**
+  * Write the sub-directories of the given directory then the directory itself.
+  * @return The offset of the directory record.
+  */
+qint64 CacheIndex::writeDir(QDataStream& stream, const Directory* dir)
+{
+   QList<qint64> subDirOffsets;
+   for (QLinkedListIterator<Directory*> i(dir->getSubDirs()); i.hasNext();)
+      subDirOffsets << CacheIndex::writeDir(stream, i.next());
+
+   const qint64 offset = stream.device()->pos();
+
+   const QDateTime dateLastModified = dir->getDateLastModified();
+   stream << dir->getName() << (dateLastModified.isNull() ? qint64(-1) : dateLastModified.toMSecsSinceEpoch());
+
+   const QLinkedList<File*> files = dir->getFiles();
+   stream << static_cast<quint32>(files.size());
+
+   Protos::FileCache::Hashes::File fileMess;
+   std::string fileBytes;
+   for (QLinkedListIterator<File*> i(files); i.hasNext();)
+   {
+      fileMess.Clear();
+      i.next()->populateHashesFile(fileMess);
+      fileMess.SerializeToString(&fileBytes);
+      stream.writeBytes(fileBytes.data(), static_cast<uint>(fileBytes.size()));
+   }
+
+   stream << static_cast<quint32>(subDirOffsets.size());
+   for (QListIterator<qint64> i(subDirOffsets); i.hasNext();)
+      stream << i.next();
+
+   return offset;
+}
+
+QString CacheIndex::getFilepath()
+{
+   return Common::Global::getDataFolder(Common::Global::DataFolderType::LOCAL) + '/' + Common::Constants::FILE_CACHE + INDEX_SUFFIX;
+}
+
+void CacheIndex::setStreamFormat(QDataStream& stream)
+{
+   stream.setVersion(QDataStream::Qt_5_0);
+   stream.setByteOrder(QDataStream::LittleEndian);
+}
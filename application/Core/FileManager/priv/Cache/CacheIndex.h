@@ -0,0 +1,86 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#ifndef FILEMANAGER_CACHEINDEX_H
+#define FILEMANAGER_CACHEINDEX_H
+
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QFile>
+#include <QDataStream>
+
+#include <Protos/files_cache.pb.h>
+
+#include <Common/Uncopyable.h>
+
+namespace FM
+{
+   class SharedDirectory;
+   class Directory;
+   class File;
+
+   class CacheIndex : Common::Uncopyable
+   {
+      static const quint32 MAGIC_NUMBER;
+      static const quint32 VERSION;
+      static const QString INDEX_SUFFIX;
+      static const int TRAILER_SIZE;
+
+   public:
+      static QByteArray build(const QList<SharedDirectory*>& sharedDirs, quint32 journalGeneration);
+      static void write(const QByteArray& index);
+      static void remove();
+
+      CacheIndex();
+      ~CacheIndex();
+
+      bool open();
+
+      quint32 getJournalGeneration() const;
+      quint32 getChunkSize() const;
+      quint32 getHashAlgorithm() const;
+
+      void populateSharedDirs(Protos::FileCache::Hashes& hashes) const;
+      bool restore(SharedDirectory* sharedDir, QList<File*>& filesWithoutHashes);
+
+   private:
+      static qint64 writeDir(QDataStream& stream, const Directory* dir);
+      static QString getFilepath();
+      static void setStreamFormat(QDataStream& stream);
+
+      struct SharedDirRecord
+      {
+         QByteArray id;
+         QString path;
+         qint64 rootOffset;
+      };
+
+      QFile file;
+      uchar* data;
+      qint64 size;
+
+      quint32 journalGeneration;
+      quint32 chunkSize;
+      quint32 hashAlgorithm;
+      QList<SharedDirRecord> sharedDirs;
+   };
+}
+
+#endif
@@ -0,0 +1,408 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#include <priv/Cache/CacheJournal.h>
+using namespace FM;
+
+#include <algorithm>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
+#include <QByteArray>
+#include <QtEndian>
+
+#include <Common/Global.h>
+#include <Common/Constants.h>
+#include <Common/Hash.h>
+#include <Common/ProtoHelper.h>
+
+#include <priv/Log.h>
+#include <priv/Global.h>
+#include <priv/Cache/Entry.h>
+#include <priv/Cache/File.h>
+#include <priv/Cache/Chunk.h>
+#include <priv/Cache/SharedDirectory.h>
+
+/**
+  * @class FM::CacheJournal
+  *
+  * An append-only log of the changes made to the cache since the last snapshot (see 'Common::Constants::FILE_CACHE').
+  * Writing a snapshot means copying the whole cache, so between two snapshots only the changes are appended to the journal:
+  * a known or removed chunk hash, a removed entry or a renamed entry. A resized file is recorded as removed, its hashes are obsolete.
+  *
+  * Each snapshot begins a new generation of journal (see 'rotate()') and records it in 'Hashes::journal_generation',
+  * the journals of the older generations can be removed once the snapshot is written.
+  * At startup the journals are replayed on top of the snapshot, a record cut by a crash ends the replay of its journal.
+  *
+  * The records are idempotent, replaying a change already included in the snapshot doesn't alter it.
+  * The moves of entries aren't recorded, they are saved by the next snapshot.
+  */
+
+const QString CacheJournal::JOURNAL_SUFFIX(".journal.");
+
+CacheJournal::CacheJournal() :
+   generation(0)
+{
+}
+
+/**
+  * Open the journal of the given generation, the new records are appended to the existing ones.
+  */
+void CacheJournal::open(quint32 generation)
+{
+   QMutexLocker locker(&this->mutex);
+   this->openFile(generation);
+}
+
+/**
+  * Close the current journal and begin the next generation.
+  * @return The generation of the new journal.
+  */
+quint32 CacheJournal::rotate()
+{
+   QMutexLocker locker(&this->mutex);
+   this->openFile(this->generation + 1);
+   return this->generation;
+}
+
+/**
+  * @return The size in bytes of the current journal.
+  */
+qint64 CacheJournal::getSize() const
+{
+   QMutexLocker locker(&this->mutex);
+   return this->file.isOpen() ? this->file.size() : 0;
+}
+
+/**
+  * Record the current hash and known bytes of the given chunk.
+  * @warning Can be called from differents thread like a 'Downloader' or the 'FileUpdater'.
+  */
+void CacheJournal::chunkChanged(const Chunk& chunk)
+{
+   File* file = chunk.getFile();
+   if (!file)
+      return;
+
+   Protos::FileCache::JournalRecord record;
+   record.set_type(Protos::FileCache::JournalRecord::CHUNK);
+   if (!CacheJournal::setPath(record, *file))
+      return;
+
+   record.set_size(file->getSize());
+   record.set_date_last_modified(file->getDateLastModified().toMSecsSinceEpoch());
+   record.set_nb_chunks(file->getNbChunks());
+   record.set_chunk_num(chunk.getNum());
+   chunk.populateHashesChunk(*record.mutable_chunk());
+   record.mutable_chunk()->set_hash_algorithm(static_cast<Protos::Common::HashAlgorithm>(Global::getHashAlgorithm())); // The snapshot may have been written with another algorithm.
+
+   this->append(record);
+}
+
+void CacheJournal::entryRemoved(const Entry& entry)
+{
+   Protos::FileCache::JournalRecord record;
+   record.set_type(Protos::FileCache::JournalRecord::REMOVE);
+   if (CacheJournal::setPath(record, entry))
+      this->append(record);
+}
+
+void CacheJournal::entryRenamed(const Entry& entry, const QString& oldName)
+{
+   Protos::FileCache::JournalRecord record;
+   record.set_type(Protos::FileCache::JournalRecord::RENAME);
+   if (!CacheJournal::setPath(record, entry))
+      return;
+
+   Common::ProtoHelper::setStr(record, &Protos::FileCache::JournalRecord::set_name, oldName);
+   Common::ProtoHelper::setStr(record, &Protos::FileCache::JournalRecord::set_new_name, entry.getName());
+
+   if (const File* file = dynamic_cast<const File*>(&entry))
+   {
+      record.set_size(file->getSize());
+      record.set_date_last_modified(file->getDateLastModified().toMSecsSinceEpoch());
+   }
+
+   this->append(record);
+}
+
+/**
+  * Write the record at the end of the current journal, preceded by its size.
+  * The journal is flushed to let the record survive a crash of the process.
+  */
+void CacheJournal::append(const Protos::FileCache::JournalRecord& record)
+{
+   const int recordSize = record.ByteSize(); // Also caches the sizes of the sub-messages for 'SerializeWithCachedSizesToArray(..)'.
+   QByteArray buffer(static_cast<int>(sizeof(quint32)) + recordSize, Qt::Uninitialized);
+   qToLittleEndian<quint32>(recordSize, reinterpret_cast<uchar*>(buffer.data()));
+   record.SerializeWithCachedSizesToArray(reinterpret_cast<google::protobuf::uint8*>(buffer.data() + sizeof(quint32)));
+
+   QMutexLocker locker(&this->mutex);
+
+   if (!this->file.isOpen())
+      return;
+
+   if (this->file.write(buffer) != buffer.size() || !this->file.flush())
+      L_ERRO(QString("Unable to write to the cache journal '%1': %2").arg(this->file.fileName()).arg(this->file.errorString()));
+}
+
+/**
+  * Apply the journals written after the given snapshot to it.
+  * @param nbRecords [out] The number of applied records.
+  * @return The generation of the last journal read or the generation of the snapshot if there is no journal.
+  */
+quint32 CacheJournal::replay(Protos::FileCache::Hashes& hashes, int& nbRecords)
+{
+   nbRecords = 0;
+   quint32 lastGeneration = hashes.journal_generation();
+
+   foreach (quint32 generation, CacheJournal::getGenerations())
+   {
+      if (generation < hashes.journal_generation())
+         continue;
+
+      lastGeneration = generation;
+
+      QFile file(CacheJournal::getFilepath(generation));
+      if (!file.open(QIODevice::ReadOnly))
+      {
+         L_WARN(QString("Unable to read the cache journal '%1': %2").arg(file.fileName()).arg(file.errorString()));
+         continue;
+      }
+
+      const QByteArray data = file.readAll();
+
+      Protos::FileCache::JournalRecord record;
+      int offset = 0;
+      while (offset + static_cast<int>(sizeof(quint32)) <= data.size())
+      {
+         const quint32 recordSize = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data.constData() + offset));
+         if (recordSize > static_cast<quint32>(data.size() - offset - sizeof(quint32)) || !record.ParseFromArray(data.constData() + offset + sizeof(quint32), recordSize))
+         {
+            L_WARN(QString("The cache journal '%1' is truncated at %2 bytes, the remaining records are ignored").arg(file.fileName()).arg(offset));
+            break;
+         }
+
+         offset += sizeof(quint32) + recordSize;
+         CacheJournal::apply(hashes, record);
+         nbRecords++;
+      }
+   }
+
+   return lastGeneration;
+}
+
+/**
+  * @return 'true' if a journal of the given generation or a newer one isn't empty.
+  */
+bool CacheJournal::hasRecordsSince(quint32 generation)
+{
+   foreach (quint32 journalGeneration, CacheJournal::getGenerations())
+      if (journalGeneration >= generation && QFileInfo(CacheJournal::getFilepath(journalGeneration)).size() > 0)
+         return true;
+   return false;
+}
+
+/**
+  * Remove the journals older than the given generation, they are included in a snapshot.
+  */
+void CacheJournal::removeJournals(quint32 beforeGeneration)
+{
+   foreach (quint32 generation, CacheJournal::getGenerations())
+      if (generation < beforeGeneration)
+         QFile::remove(CacheJournal::getFilepath(generation));
+}
+
+void CacheJournal::removeAllJournals()
+{
+   foreach (quint32 generation, CacheJournal::getGenerations())
+      QFile::remove(CacheJournal::getFilepath(generation));
+}
+
+/**
+  * Must be called with 'mutex' locked.
+  */
+void CacheJournal::openFile(quint32 generation)
+{
+   this->file.close();
+   this->generation = generation;
+   this->file.setFileName(CacheJournal::getFilepath(generation));
+   if (!this->file.open(QIODevice::WriteOnly | QIODevice::Append))
+      L_ERRO(QString("Unable to open the cache journal '%1': %2").arg(this->file.fileName()).arg(this->file.errorString()));
+}
+
+/**
+  * Set the shared directory, the parent directories and the name of the given entry.
+  * @return 'false' if the entry is a shared directory, its changes are saved by a snapshot.
+  */
+bool CacheJournal::setPath(Protos::FileCache::JournalRecord& record, const Entry& entry)
+{
+   const SharedDirectory* root = entry.getRoot();
+   if (!root || root == &entry)
+      return false;
+
+   record.mutable_shared_dir_id()->set_hash(root->getId().getData(), Common::Hash::HASH_SIZE);
+   foreach (QString dir, entry.getPath().split('/', QString::SkipEmptyParts))
+      Common::ProtoHelper::addRepeatedStr(record, &Protos::FileCache::JournalRecord::add_dir, dir);
+   Common::ProtoHelper::setStr(record, &Protos::FileCache::JournalRecord::set_name, entry.getName());
+
+   return true;
+}
+
+void CacheJournal::apply(Protos::FileCache::Hashes& hashes, const Protos::FileCache::JournalRecord& record)
+{
+   Protos::FileCache::Hashes::Dir* dir = CacheJournal::getDir(hashes, record, record.type() == Protos::FileCache::JournalRecord::CHUNK);
+   if (!dir)
+      return;
+
+   switch (record.type())
+   {
+   case Protos::FileCache::JournalRecord::CHUNK:
+      {
+         Protos::FileCache::Hashes::File* file = nullptr;
+         for (int i = 0; i < dir->file_size() && !file; i++)
+            if (dir->file(i).filename() == record.name())
+               file = dir->mutable_file(i);
+
+         if (!file)
+         {
+            file = dir->add_file();
+            file->set_filename(record.name());
+         }
+
+         // The file has changed since its hashes were saved.
+         if (file->size() != record.size() || file->date_last_modified() != record.date_last_modified())
+         {
+            file->set_size(record.size());
+            file->set_date_last_modified(record.date_last_modified());
+            file->clear_chunk();
+         }
+
+         // The chunks without hash are kept with no known byte, as 'Hashes::File' requires all the chunks of a file.
+         while (file->chunk_size() > static_cast<int>(record.nb_chunks()))
+            file->mutable_chunk()->RemoveLast();
+         while (file->chunk_size() < static_cast<int>(record.nb_chunks()))
+            file->add_chunk()->set_known_bytes(0);
+
+         if (static_cast<int>(record.chunk_num()) < file->chunk_size())
+            file->mutable_chunk(record.chunk_num())->CopyFrom(record.chunk());
+      }
+      break;
+
+   case Protos::FileCache::JournalRecord::REMOVE:
+      for (int i = dir->file_size() - 1; i >= 0; i--)
+         if (dir->file(i).filename() == record.name())
+            dir->mutable_file()->DeleteSubrange(i, 1);
+      for (int i = dir->dir_size() - 1; i >= 0; i--)
+         if (dir->dir(i).name() == record.name())
+            dir->mutable_dir()->DeleteSubrange(i, 1);
+      break;
+
+   // A rename may already be in the snapshot, the old name may then be used by another entry which must be kept.
+   case Protos::FileCache::JournalRecord::RENAME:
+      for (int i = 0; i < dir->file_size(); i++)
+         if (dir->file(i).filename() == record.name())
+         {
+            if (record.has_size() && (dir->file(i).size() != record.size() || dir->file(i).date_last_modified() != record.date_last_modified()))
+               return;
+
+            for (int j = dir->file_size() - 1; j >= 0; j--)
+               if (dir->file(j).filename() == record.new_name())
+               {
+                  dir->mutable_file()->DeleteSubrange(j, 1);
+                  if (j < i)
+                     i--;
+               }
+            dir->mutable_file(i)->set_filename(record.new_name());
+            return;
+         }
+
+      // A directory can't be renamed over an existing one.
+      for (int i = 0; i < dir->dir_size(); i++)
+         if (dir->dir(i).name() == record.new_name())
+            return;
+
+      for (int i = 0; i < dir->dir_size(); i++)
+         if (dir->dir(i).name() == record.name())
+         {
+            dir->mutable_dir(i)->set_name(record.new_name());
+            return;
+         }
+      break;
+   }
+}
+
+/**
+  * @param create If 'true' the missing directories are added.
+  * @return The parent directory of the entry of the given record or 'nullptr' if it doesn't exist.
+  */
+Protos::FileCache::Hashes::Dir* CacheJournal::getDir(Protos::FileCache::Hashes& hashes, const Protos::FileCache::JournalRecord& record, bool create)
+{
+   for (int i = 0; i < hashes.shareddir_size(); i++)
+   {
+      if (hashes.shareddir(i).id().hash() != record.shared_dir_id().hash())
+         continue;
+
+      Protos::FileCache::Hashes::Dir* dir = hashes.mutable_shareddir(i)->mutable_root();
+      for (int j = 0; j < record.dir_size() && dir; j++)
+      {
+         Protos::FileCache::Hashes::Dir* subDir = nullptr;
+         for (int k = 0; k < dir->dir_size() && !subDir; k++)
+            if (dir->dir(k).name() == record.dir(j))
+               subDir = dir->mutable_dir(k);
+
+         if (!subDir && create)
+         {
+            subDir = dir->add_dir();
+            subDir->set_name(record.dir(j));
+         }
+
+         dir = subDir;
+      }
+      return dir;
+   }
+
+   return nullptr;
+}
+
+/**
+  * @return The generations of the existing journals, sorted.
+  */
+QList<quint32> CacheJournal::getGenerations()
+{
+   const QString prefix = Common::Constants::FILE_CACHE + JOURNAL_SUFFIX;
+
+   QList<quint32> generations;
+   foreach (QString filename, QDir(Common::Global::getDataFolder(Common::Global::DataFolderType::LOCAL)).entryList(QStringList() << prefix + '*', QDir::Files))
+   {
+      bool ok;
+      const quint32 generation = filename.mid(prefix.size()).toUInt(&ok);
+      if (ok)
+         generations << generation;
+   }
+
+   std::sort(generations.begin(), generations.end());
+   return generations;
+}
+
+QString CacheJournal::getFilepath(quint32 generation)
+{
+   return Common::Global::getDataFolder(Common::Global::DataFolderType::LOCAL) + '/' + Common::Constants::FILE_CACHE + JOURNAL_SUFFIX + QString::number(generation);
+}
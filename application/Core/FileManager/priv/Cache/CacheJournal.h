@@ -0,0 +1,73 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#ifndef FILEMANAGER_CACHEJOURNAL_H
+#define FILEMANAGER_CACHEJOURNAL_H
+
+#include <QString>
+#include <QList>
+#include <QFile>
+#include <QMutex>
+
+#include <Protos/files_cache.pb.h>
+
+#include <Common/Uncopyable.h>
+
+namespace FM
+{
+   class Entry;
+   class Chunk;
+
+   class CacheJournal : Common::Uncopyable
+   {
+      static const QString JOURNAL_SUFFIX;
+
+   public:
+      CacheJournal();
+
+      void open(quint32 generation);
+      quint32 rotate();
+      qint64 getSize() const;
+
+      void chunkChanged(const Chunk& chunk);
+      void entryRemoved(const Entry& entry);
+      void entryRenamed(const Entry& entry, const QString& oldName);
+      void append(const Protos::FileCache::JournalRecord& record);
+
+      static quint32 replay(Protos::FileCache::Hashes& hashes, int& nbRecords);
+      static bool hasRecordsSince(quint32 generation);
+      static void removeJournals(quint32 beforeGeneration);
+      static void removeAllJournals();
+
+   private:
+      void openFile(quint32 generation);
+
+      static bool setPath(Protos::FileCache::JournalRecord& record, const Entry& entry);
+      static void apply(Protos::FileCache::Hashes& hashes, const Protos::FileCache::JournalRecord& record);
+      static Protos::FileCache::Hashes::Dir* getDir(Protos::FileCache::Hashes& hashes, const Protos::FileCache::JournalRecord& record, bool create);
+      static QList<quint32> getGenerations();
+      static QString getFilepath(quint32 generation);
+
+      mutable QMutex mutex;
+      QFile file;
+      quint32 generation;
+   };
+}
+
+#endif
@@ -0,0 +1,83 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#include <priv/Cache/CacheSnapshotWriter.h>
+using namespace FM;
+
+#include <Common/PersistentData.h>
+#include <Common/Constants.h>
+#include <Common/Global.h>
+
+#include <priv/Log.h>
+#include <priv/Cache/CacheJournal.h>
+#include <priv/Cache/CacheIndex.h>
+
+/**
+  * @class FM::CacheSnapshotWriter
+  *
+  * Write a snapshot of the cache in its own thread, the cache can be modified during the writing.
+  * The cache index is written after the snapshot, see 'CacheIndex'.
+  * Once written, the journals included in the snapshot are removed, see 'CacheJournal'.
+  */
+
+CacheSnapshotWriter::CacheSnapshotWriter() :
+   snapshot(nullptr)
+{
+}
+
+CacheSnapshotWriter::~CacheSnapshotWriter()
+{
+   this->wait();
+}
+
+/**
+  * Write the given snapshot, the previous one is waited if it's still being written.
+  * @param snapshot Will be deleted by the writer.
+  * @param index Not written if empty.
+  */
+void CacheSnapshotWriter::write(Protos::FileCache::Hashes* snapshot, const QByteArray& index)
+{
+   this->wait();
+   this->snapshot = snapshot;
+   this->index = index;
+   this->start(QThread::LowPriority);
+}
+
+void CacheSnapshotWriter::run()
+{
+   L_DEBU("Writing the cache snapshot . . .");
+
+   try
+   {
+      CacheIndex::remove(); // It would not match the new snapshot.
+      Common::PersistentData::setValue(Common::Constants::FILE_CACHE, *this->snapshot, Common::Global::DataFolderType::LOCAL);
+      if (!this->index.isEmpty())
+         CacheIndex::write(this->index);
+      CacheJournal::removeJournals(this->snapshot->journal_generation());
+      L_DEBU("Cache snapshot written");
+   }
+   catch (Common::PersistentDataIOException& err)
+   {
+      L_ERRO(err.message);
+   }
+
+   delete this->snapshot;
+   this->snapshot = nullptr;
+   this->index.clear();
+}
@@ -0,0 +1,49 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#ifndef FILEMANAGER_CACHESNAPSHOTWRITER_H
+#define FILEMANAGER_CACHESNAPSHOTWRITER_H
+
+#include <QThread>
+#include <QByteArray>
+
+#include <Protos/files_cache.pb.h>
+
+#include <Common/Uncopyable.h>
+
+namespace FM
+{
+   class CacheSnapshotWriter : public QThread, Common::Uncopyable
+   {
+   public:
+      CacheSnapshotWriter();
+      ~CacheSnapshotWriter();
+
+      void write(Protos::FileCache::Hashes* snapshot, const QByteArray& index = QByteArray());
+
+   protected:
+      void run();
+
+   private:
+      Protos::FileCache::Hashes* snapshot;
+      QByteArray index;
+   };
+}
+
+#endif
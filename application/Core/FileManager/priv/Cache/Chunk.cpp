@@ -27,6 +27,7 @@ using namespace FM;
 #include <priv/Cache/SharedDirectory.h>
 #include <priv/Cache/DataReader.h>
 #include <priv/Cache/DataWriter.h>
+#include <priv/Cache/LeafHasher.h>
 
 /**
   * @class FM::Chunk
@@ -41,17 +42,30 @@ using namespace FM;
 int Chunk::CHUNK_SIZE(0);
 
 Chunk::Chunk(File* file, int num, quint32 knownBytes) :
-   file(file), num(num), knownBytes(knownBytes)
+   file(file), num(num), knownBytes(knownBytes), hasherStateKnownBytes(0), leafSize(0), leafHashesVerified(false)
 {
    L_DEBU(QString("New chunk[%1] : %2. File : %3").arg(num).arg(hash.toStr()).arg(this->file ? this->file->getFullPath() : "<no file defined>"));
 }
 
 Chunk::Chunk(File* file, int num, quint32 knownBytes, const Common::Hash& hash) :
-   file(file), num(num), knownBytes(knownBytes), hash(hash)
+   file(file), num(num), knownBytes(knownBytes), hash(hash), hasherStateKnownBytes(0), leafSize(0), leafHashesVerified(false)
 {
    L_DEBU(QString("New chunk[%1] : %2. File : %3").arg(num).arg(hash.toStr()).arg(this->file ? this->file->getFullPath() : "<no file defined>"));
 }
 
+/**
+  * The chunk and the reference counter of its 'QSharedPointer' are allocated together.
+  */
+QSharedPointer<Chunk> Chunk::create(File* file, int num, quint32 knownBytes)
+{
+   return QSharedPointer<Chunk>::create(file, num, knownBytes);
+}
+
+QSharedPointer<Chunk> Chunk::create(File* file, int num, quint32 knownBytes, const Common::Hash& hash)
+{
+   return QSharedPointer<Chunk>::create(file, num, knownBytes, hash);
+}
+
 Chunk::~Chunk()
 {
    L_DEBU(QString("Chunk Deleted[%1] : %2. File : %3").arg(num).
@@ -71,6 +85,19 @@ Chunk* Chunk::restoreFromFileCache(const Protos::FileCache::Hashes_Chunk& chunk)
 
    if (chunk.has_hash())
       this->hash = chunk.hash().hash();
+
+   if (chunk.has_hasher_state())
+      this->setHasherState(QByteArray(chunk.hasher_state().data(), static_cast<int>(chunk.hasher_state().size())), this->knownBytes);
+
+   if (chunk.has_leaf_size())
+   {
+      QVector<Common::Hash> leafHashes;
+      leafHashes.reserve(chunk.leaf_hash_size());
+      for (int i = 0; i < chunk.leaf_hash_size(); i++)
+         leafHashes << chunk.leaf_hash(i).hash();
+      this->setVerifiedLeafHashes(chunk.leaf_size(), leafHashes);
+   }
+
    return this;
 }
 
@@ -79,6 +106,21 @@ void Chunk::populateHashesChunk(Protos::FileCache::Hashes_Chunk& chunk) const
    chunk.set_known_bytes(this->knownBytes);
    if (!this->hash.isNull())
       chunk.mutable_hash()->set_hash(this->hash.getData(), Common::Hash::HASH_SIZE);
+
+   int hasherStateKnownBytes = 0;
+   QVector<Common::Hash> hasherStateLeafHashes;
+   const QByteArray& hasherState = this->getHasherState(hasherStateKnownBytes, hasherStateLeafHashes);
+   if (!hasherState.isEmpty() && hasherStateKnownBytes == this->knownBytes && this->knownBytes < this->getChunkSize())
+      chunk.set_hasher_state(hasherState.constData(), hasherState.size());
+
+   // The received leaf hashes aren't persisted until they are verified.
+   QMutexLocker locker(&this->mutex);
+   if (this->leafSize > 0 && this->leafHashesVerified)
+   {
+      chunk.set_leaf_size(this->leafSize);
+      for (QVectorIterator<Common::Hash> i(this->leafHashes); i.hasNext();)
+         chunk.add_leaf_hash()->set_hash(i.next().getData(), Common::Hash::HASH_SIZE);
+   }
 }
 
 void Chunk::removeItsIncompleteFile()
@@ -97,6 +139,14 @@ bool Chunk::populateEntry(Protos::Common::Entry* entry) const
    return false;
 }
 
+/**
+  * @return The file owning this chunk or 'nullptr' if the file has been deleted.
+  */
+File* Chunk::getFile() const
+{
+   return this->file;
+}
+
 QString Chunk::getFilePath() const
 {
    if (this->file)
@@ -111,7 +161,12 @@ QSharedPointer<IDataReader> Chunk::getDataReader()
 
 QSharedPointer<IDataWriter> Chunk::getDataWriter()
 {
-   return QSharedPointer<IDataWriter>(new DataWriter(*this));
+   return QSharedPointer<IDataWriter>(new DataWriter(*this, Common::Hash(), Global::getHashAlgorithm()));
+}
+
+QSharedPointer<IDataWriter> Chunk::getDataWriter(const Common::Hash& expectedHash, Common::HashAlgorithm algorithm)
+{
+   return QSharedPointer<IDataWriter>(new DataWriter(*this, expectedHash, algorithm));
 }
 
 void Chunk::newDataWriterCreated()
@@ -193,9 +248,124 @@ int Chunk::getKnownBytes() const
    return this->knownBytes;
 }
 
+/**
+  * The hasher state saved beyond the new known bytes is forgotten, the data it has hashed may be rewritten differently.
+  */
 void Chunk::setKnownBytes(int bytes)
 {
    this->knownBytes = bytes;
+
+   QMutexLocker locker(&this->mutex);
+   if (this->hasherStateKnownBytes > bytes)
+   {
+      this->hasherState.clear();
+      this->hasherStateLeafHashes.clear();
+   }
+}
+
+/**
+  * Return the hasher state saved by the last 'DataWriter' or an empty array if it is beyond the current known bytes.
+  * @param hashedBytes [out] The number of bytes hashed by the returned state, it may be lesser than the known bytes.
+  * @param computedLeafHashes [out] The hashes of the leaves computed from these bytes, empty if they weren't kept.
+  */
+QByteArray Chunk::getHasherState(int& hashedBytes, QVector<Common::Hash>& computedLeafHashes) const
+{
+   QMutexLocker locker(&this->mutex);
+
+   if (this->hasherState.isEmpty() || this->hasherStateKnownBytes > this->knownBytes)
+      return QByteArray();
+
+   hashedBytes = this->hasherStateKnownBytes;
+   computedLeafHashes = this->hasherStateLeafHashes;
+   return this->hasherState;
+}
+
+/**
+  * Set the state of a hasher which has hashed the 'hashedBytes' first bytes.
+  */
+void Chunk::setHasherState(const QByteArray& state, int hashedBytes, const QVector<Common::Hash>& computedLeafHashes)
+{
+   QMutexLocker locker(&this->mutex);
+
+   this->hasherState = state;
+   this->hasherStateKnownBytes = hashedBytes;
+   this->hasherStateLeafHashes = computedLeafHashes;
+}
+
+/**
+  * Return the leaf size and the leaf hashes, they may have been received from a peer and not verified yet.
+  */
+int Chunk::getLeafHashes(QVector<Common::Hash>& hashes) const
+{
+   QMutexLocker locker(&this->mutex);
+   hashes = this->leafHashes;
+   return this->leafSize;
+}
+
+/**
+  * Return the leaf size and the leaf hashes if they have been computed from the chunk data, 0 otherwise.
+  * Only these hashes can be given to the other peers.
+  */
+int Chunk::getVerifiedLeafHashes(QVector<Common::Hash>& hashes) const
+{
+   QMutexLocker locker(&this->mutex);
+   if (!this->leafHashesVerified)
+      return 0;
+
+   hashes = this->leafHashes;
+   return this->leafSize;
+}
+
+/**
+  * Set the leaf hashes received from a peer, they are provisional: they are only used to check the downloaded data
+  * and are replaced by the computed ones when the whole chunk hash matches, see 'DataWriter'.
+  * The hashes are ignored if their number doesn't match the leaf size or if the verified ones are already known.
+  */
+void Chunk::setLeafHashes(int leafSize, const QVector<Common::Hash>& hashes)
+{
+   if (leafSize <= 0 || hashes.size() != LeafHasher::getNbLeaves(this->getChunkSize(), leafSize))
+   {
+      L_DEBU(QString("Chunk[%1] setLeafHashes(..) : invalid leaf hashes, leaf size = %2, number of hashes = %3").arg(this->num).arg(leafSize).arg(hashes.size()));
+      return;
+   }
+
+   QMutexLocker locker(&this->mutex);
+   if (this->leafSize > 0 && this->leafHashesVerified)
+      return;
+
+   this->leafSize = leafSize;
+   this->leafHashes = hashes;
+   this->leafHashesVerified = false;
+}
+
+/**
+  * Set the leaf hashes computed from the chunk data.
+  */
+void Chunk::setVerifiedLeafHashes(int leafSize, const QVector<Common::Hash>& hashes)
+{
+   if (leafSize <= 0 || hashes.size() != LeafHasher::getNbLeaves(this->getChunkSize(), leafSize))
+   {
+      L_DEBU(QString("Chunk[%1] setVerifiedLeafHashes(..) : invalid leaf hashes, leaf size = %2, number of hashes = %3").arg(this->num).arg(leafSize).arg(hashes.size()));
+      return;
+   }
+
+   QMutexLocker locker(&this->mutex);
+   this->leafSize = leafSize;
+   this->leafHashes = hashes;
+   this->leafHashesVerified = true;
+}
+
+/**
+  * Forget the received leaf hashes, called when they don't match the downloaded data.
+  */
+void Chunk::dropProvisionalLeafHashes()
+{
+   QMutexLocker locker(&this->mutex);
+   if (this->leafHashesVerified)
+      return;
+
+   this->leafSize = 0;
+   this->leafHashes.clear();
 }
 
 int Chunk::getChunkSize() const
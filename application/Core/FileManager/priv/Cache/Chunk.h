@@ -22,6 +22,7 @@
 #include <exception>
 
 #include <QByteArray>
+#include <QMutex>
 
 #include <Protos/files_cache.pb.h>
 
@@ -52,6 +53,9 @@ namespace FM
       Chunk(File* file, int num, quint32 knownBytes);
       Chunk(File* file, int num, quint32 knownBytes, const Common::Hash& hash);
 
+      static QSharedPointer<Chunk> create(File* file, int num, quint32 knownBytes);
+      static QSharedPointer<Chunk> create(File* file, int num, quint32 knownBytes, const Common::Hash& hash);
+
       ~Chunk();
 
       QString toStringLog() const;
@@ -63,10 +67,12 @@ namespace FM
       void removeItsIncompleteFile();
       bool populateEntry(Protos::Common::Entry* entry) const;
 
+      File* getFile() const;
       QString getFilePath() const;
 
       QSharedPointer<IDataReader> getDataReader();
       QSharedPointer<IDataWriter> getDataWriter();
+      QSharedPointer<IDataWriter> getDataWriter(const Common::Hash& expectedHash, Common::HashAlgorithm algorithm);
 
       void newDataWriterCreated();
       void newDataReaderCreated();
@@ -90,6 +96,15 @@ namespace FM
       int getKnownBytes() const;
       void setKnownBytes(int bytes);
 
+      QByteArray getHasherState(int& hashedBytes, QVector<Common::Hash>& computedLeafHashes) const;
+      void setHasherState(const QByteArray& state, int hashedBytes, const QVector<Common::Hash>& computedLeafHashes = QVector<Common::Hash>());
+
+      int getLeafHashes(QVector<Common::Hash>& hashes) const;
+      int getVerifiedLeafHashes(QVector<Common::Hash>& hashes) const;
+      void setLeafHashes(int leafSize, const QVector<Common::Hash>& hashes);
+      void setVerifiedLeafHashes(int leafSize, const QVector<Common::Hash>& hashes);
+      void dropProvisionalLeafHashes();
+
       int getChunkSize() const;
       bool isComplete() const;
 
@@ -98,10 +113,20 @@ namespace FM
       bool matchesEntry(const Protos::Common::Entry& entry) const;
 
    private:
+      // The members are ordered to minimize the padding, there is one chunk for each 64 MiB of shared data.
+      // The fixed part takes 88 bytes on 64-bit targets, the hasher state and the leaf hashes are allocated apart once they are known.
       File* file;
       const int num; // First is 0.
       int knownBytes; ///< Relative offset, 0 means we don't have any byte and 'getChunkSize()' means we have all the chunk data.
       Common::Hash hash;
+      int hasherStateKnownBytes;
+      int leafSize; ///< 0 if the leaf hashes are unknown.
+      bool leafHashesVerified; ///< False if the leaf hashes have been received from a peer and not checked yet, see 'setLeafHashes(..)'.
+
+      mutable QMutex mutex; // Protects the hasher state and the leaf hashes, they are set by a 'DataWriter' or a 'FileHasher' and read when the cache is persisted.
+      QByteArray hasherState; ///< The state of the hasher after the 'hasherStateKnownBytes' first bytes, see 'DataWriter'.
+      QVector<Common::Hash> hasherStateLeafHashes; ///< The hashes of the leaves computed from the 'hasherStateKnownBytes' first bytes, not persisted.
+      QVector<Common::Hash> leafHashes;
    };
 }
 
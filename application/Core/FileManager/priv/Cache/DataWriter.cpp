@@ -23,23 +23,39 @@ using namespace FM;
 
 #include <Exceptions.h>
 #include <priv/Log.h>
+#include <priv/Global.h>
 #include <priv/Cache/DataReader.h>
+#include <priv/Cache/LeafHasher.h>
 
 /**
   * @remarks The setting "check_received_data_integrity" can be changed at runtime.
+  * @param expectedHash If not null the data are checked against this hash computed with 'algorithm' instead of the hash of the chunk.
+  *        The leaves and the saved hasher states aren't used in this case, they belong to our algorithm.
   * @exception IOErrorException
   * @exception ChunkDeletedException
   * @exception ChunkDataUnknownException
   */
-DataWriter::DataWriter(Chunk& chunk) :
-   CHECK_DATA_INTEGRITY(SETTINGS.get<bool>("check_received_data_integrity")), chunk(chunk)
+DataWriter::DataWriter(Chunk& chunk, const Common::Hash& expectedHash, Common::HashAlgorithm algorithm) :
+   CHECK_DATA_INTEGRITY(SETTINGS.get<bool>("check_received_data_integrity")), hasher(algorithm), hashedBytes(0), chunk(chunk), expectedHash(expectedHash),
+   leafSize(0), leafHasher(algorithm)
 {
+   this->initLeaves();
    this->computeChunkHash();
    this->chunk.newDataWriterCreated();
 }
 
 DataWriter::~DataWriter()
 {
+   // The next writer of a partial chunk will continue from this state instead of reading the known bytes again.
+   // With the leaves it continues from the beginning of the current leaf, only this leaf is read again.
+   if (this->CHECK_DATA_INTEGRITY && this->expectedHash.isNull() && this->hashedBytes > 0 && this->hashedBytes == this->chunk.getKnownBytes() && !this->chunk.isComplete())
+   {
+      if (this->leafSize > 0)
+         this->chunk.setHasherState(this->hasherStateAtLeafStart, this->hashedBytes - this->hashedBytes % this->leafSize, this->computedLeafHashes);
+      else
+         this->chunk.setHasherState(this->hasher.saveState(), this->hashedBytes);
+   }
+
    this->chunk.dataWriterDeleted();
 }
 
@@ -47,23 +63,75 @@ bool DataWriter::write(const char* buffer, int nbBytes)
 {
    if (this->CHECK_DATA_INTEGRITY)
    {
-      this->hasher.addData(buffer, nbBytes);
-      if (this->chunk.getKnownBytes() + nbBytes == this->chunk.getChunkSize() && this->hasher.getResult() != this->chunk.getHash())
+      this->addData(buffer, nbBytes, true);
+
+      if (this->chunk.getKnownBytes() + nbBytes == this->chunk.getChunkSize())
       {
-         this->chunk.setKnownBytes(0);
-         throw hashMissmatchException();
+         if (this->hasher.getResult() != (this->expectedHash.isNull() ? this->chunk.getHash() : this->expectedHash))
+         {
+            this->chunk.setKnownBytes(0);
+            this->chunk.dropProvisionalLeafHashes();
+            throw hashMissmatchException();
+         }
+
+         // The data are verified, the leaf hashes computed from them replace the received ones.
+         if (this->leafSize > 0 && this->computedLeafHashes.size() == LeafHasher::getNbLeaves(this->chunk.getChunkSize(), this->leafSize))
+            this->chunk.setVerifiedLeafHashes(this->leafSize, this->computedLeafHashes);
       }
    }
 
    return this->chunk.write(buffer, nbBytes);
 }
 
+/**
+  * The leaves are checked if their hashes are known, see 'Chunk::setLeafHashes(..)'.
+  * Otherwise they are only computed if the setting "chunk_leaf_size" isn't 0.
+  */
+void DataWriter::initLeaves()
+{
+   if (!this->CHECK_DATA_INTEGRITY || !this->expectedHash.isNull())
+      return;
+
+   this->leafSize = this->chunk.getLeafHashes(this->leafHashes);
+   if (this->leafSize == 0)
+      this->leafSize = Global::getLeafSize();
+}
+
 /**
   * Compute the hash of the first known data of the current chunk ('this->chunk'), the result is held by 'this->hasher'.
+  * The state saved by a previous writer is used if there is one, the known data after this state are read.
   */
 void DataWriter::computeChunkHash()
 {
-   if (this->CHECK_DATA_INTEGRITY && this->chunk.getKnownBytes() > 0)
+   if (!this->CHECK_DATA_INTEGRITY)
+      return;
+
+   const int knownBytes = this->chunk.getKnownBytes();
+   if (knownBytes > 0)
+   {
+      int hasherStateKnownBytes = 0;
+      const QByteArray& hasherState = this->expectedHash.isNull() ? this->chunk.getHasherState(hasherStateKnownBytes, this->computedLeafHashes) : QByteArray();
+
+      // The leaves computed by the previous writer must match the current leaf size, otherwise all the data are read again.
+      if (!hasherState.isEmpty() && (this->leafSize == 0 || (hasherStateKnownBytes % this->leafSize == 0 && this->computedLeafHashes.size() == hasherStateKnownBytes / this->leafSize)))
+      {
+         if (this->hasher.restoreState(hasherState))
+            this->hashedBytes = hasherStateKnownBytes;
+         else
+            L_WARN(QString("Unable to restore the hasher state of the chunk %1").arg(this->chunk.toStringLog()));
+      }
+
+      if (this->hashedBytes == 0)
+      {
+         this->hasher.reset();
+         this->computedLeafHashes.clear();
+      }
+   }
+
+   if (this->leafSize > 0)
+      this->hasherStateAtLeafStart = this->hasher.saveState();
+
+   if (this->hashedBytes < knownBytes)
    {
       try
       {
@@ -71,14 +139,10 @@ void DataWriter::computeChunkHash()
          char buffer[BUFFER_SIZE];
 
          DataReader reader(this->chunk);
-         int offset = 0;
          int bytesRead = 0;
 
-         while (bytesRead = reader.read(buffer, offset))
-         {
-            this->hasher.addData(buffer, bytesRead);
-            offset += bytesRead;
-         }
+         while (this->hashedBytes < knownBytes && (bytesRead = reader.read(buffer, this->hashedBytes)))
+            this->addData(buffer, qMin(bytesRead, knownBytes - this->hashedBytes), false);
       }
       // If the file can't be read it may be created later.
       catch (UnableToOpenFileInReadModeException&)
@@ -86,4 +150,63 @@ void DataWriter::computeChunkHash()
          L_WARN("UnableToOpenFileInReadModeException");
       }
    }
+
+   // The leaves can't be followed if the known data haven't been entirely hashed.
+   if (this->hashedBytes != knownBytes)
+      this->leafSize = 0;
+}
+
+/**
+  * Add the data to the hashers and compute the hash of each completed leaf.
+  * @param checkLeaves If true, the leaves are checked against the known leaf hashes.
+  * @exception hashMissmatchException If a leaf is corrupted. The data before this leaf are kept, thus only the corrupted leaf has to be downloaded again.
+  *            The provisional leaf hashes are dropped because they may be wrong themselves, the whole chunk hash will then decide.
+  */
+void DataWriter::addData(const char* buffer, int nbBytes, bool checkLeaves)
+{
+   if (this->leafSize == 0)
+   {
+      this->hasher.addData(buffer, nbBytes);
+      this->hashedBytes += nbBytes;
+      return;
+   }
+
+   const int initialKnownBytes = this->chunk.getKnownBytes();
+
+   int offset = 0;
+   while (offset < nbBytes)
+   {
+      const int n = qMin(nbBytes - offset, this->leafSize - this->hashedBytes % this->leafSize);
+      this->hasher.addData(buffer + offset, n);
+      this->leafHasher.addData(buffer + offset, n);
+      this->hashedBytes += n;
+      offset += n;
+
+      if (this->hashedBytes % this->leafSize != 0 && this->hashedBytes != this->chunk.getChunkSize())
+         continue;
+
+      const int leafNum = (this->hashedBytes - 1) / this->leafSize;
+      const Common::Hash leafHash = this->leafHasher.getResult();
+      this->leafHasher.reset();
+
+      if (checkLeaves && leafNum < this->leafHashes.size() && leafHash != this->leafHashes[leafNum])
+      {
+         const int leafStart = leafNum * this->leafSize;
+         L_DEBU(QString("Leaf %1 corrupted, the data are kept up to %2 bytes. Chunk : %3").arg(leafNum).arg(leafStart).arg(this->chunk.toStringLog()));
+
+         this->hasher.restoreState(this->hasherStateAtLeafStart);
+         this->hashedBytes = leafStart;
+
+         if (leafStart > initialKnownBytes)
+            this->chunk.write(buffer, leafStart - initialKnownBytes);
+         else
+            this->chunk.setKnownBytes(leafStart);
+
+         this->chunk.dropProvisionalLeafHashes();
+         throw hashMissmatchException();
+      }
+
+      this->computedLeafHashes << leafHash;
+      this->hasherStateAtLeafStart = this->hasher.saveState();
+   }
 }
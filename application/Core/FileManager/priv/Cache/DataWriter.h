@@ -19,6 +19,9 @@
 #ifndef FILEMANAGER_DATAWRITER_H
 #define FILEMANAGER_DATAWRITER_H
 
+#include <QVector>
+#include <QByteArray>
+
 #include <Common/Uncopyable.h>
 #include <Common/Hash.h>
 
@@ -30,18 +33,28 @@ namespace FM
    class DataWriter : public IDataWriter, Common::Uncopyable
    {
    public:
-      DataWriter(Chunk& chunk);
+      DataWriter(Chunk& chunk, const Common::Hash& expectedHash, Common::HashAlgorithm algorithm);
       ~DataWriter();
 
       bool write(const char* buffer, int nbBytes);
 
    private:
+      void initLeaves();
       void computeChunkHash();
+      void addData(const char* buffer, int nbBytes, bool checkLeaves);
 
       const bool CHECK_DATA_INTEGRITY;
 
       Common::Hasher hasher;
+      int hashedBytes; ///< The number of bytes of the chunk added to 'hasher'.
       Chunk& chunk;
+      const Common::Hash expectedHash; ///< Null if the data are checked against the hash of the chunk.
+
+      int leafSize; ///< 0 if the leaf hashes aren't computed.
+      QVector<Common::Hash> leafHashes; ///< The expected leaf hashes, they may have been received from a peer. Empty if unknown.
+      QVector<Common::Hash> computedLeafHashes; ///< The hashes of the complete leaves computed from the data.
+      Common::Hasher leafHasher; ///< Hashes the current leaf from its beginning.
+      QByteArray hasherStateAtLeafStart; ///< The state of 'hasher' at the beginning of the current leaf, restored if the leaf is corrupted.
    };
 }
 
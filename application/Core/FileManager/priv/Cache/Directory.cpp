@@ -30,16 +30,19 @@ using namespace FM;
 #include <priv/FileManager.h>
 #include <priv/Cache/File.h>
 #include <priv/Cache/SharedDirectory.h>
+#include <priv/Cache/Cache.h>
+
+QAtomicInt Directory::pathGeneration;
+EntryArena Directory::arena(sizeof(Directory));
 
 /**
   * @exception UnableToCreateNewDirException (may be thrown only if 'createPhysically' is true).
   */
 Directory::Directory(Directory* parent, const QString& name, bool createPhysically) :
-   Entry(parent->cache, name),
+   Entry(parent->cache, Type::DIRECTORY, name),
    parent(parent),
-   subDirs(&Directory::entrySortingFun),
-   files(&Directory::entrySortingFun),
-   scanned(true)
+   scanned(true),
+   cachedPath(nullptr)
 {
    QMutexLocker locker(&this->mutex);
    L_DEBU(QString("New Directory : %1, createPhysically = %2").arg(this->getFullPath()).arg(createPhysically));
@@ -59,27 +62,45 @@ Directory::Directory(Directory* parent, const QString& name, bool createPhysical
   * Called by the root (SharedDirectory) which will not have parent and name.
   */
 Directory::Directory(Cache* cache, const QString& name) :
-   Entry(cache, name),
+   Entry(cache, Type::DIRECTORY, name),
    parent(0),
-   subDirs(&Directory::entrySortingFun),
-   files(&Directory::entrySortingFun),
-   scanned(true)
+   scanned(true),
+   cachedPath(nullptr)
 {
 }
 
 Directory::~Directory()
 {
    L_DEBU(QString("Directory deleted: %1").arg(this->getName()));
+   delete this->cachedPath.loadAcquire();
+}
+
+/**
+  * The directories are allocated in an arena, see 'EntryArena'.
+  * The shared directories are bigger and are allocated normally.
+  */
+void* Directory::operator new(size_t size)
+{
+   return Directory::arena.allocate(size);
+}
+
+void Directory::operator delete(void* p, size_t size)
+{
+   Directory::arena.release(p, size);
 }
 
 void Directory::del(bool invokeDelete)
 {
+   // A next directory may be allocated at the same address, see 'EncodedEntriesCache::remove(..)'.
+   this->invalidateEncodedEntries();
+   this->cache->getEncodedEntriesCache().remove(this);
+
    {
       QMutexLocker locker(&this->mutex);
 
       this->deleteSubDirs();
 
-      foreach (File* f, this->files.getList())
+      foreach (File* f, this->files.getVector())
          f->del();
 
       if (this->parent)
@@ -105,13 +126,13 @@ QList<File*> Directory::restoreFromFileCache(const Protos::FileCache::Hashes::Di
    {
       // Sub directories . . .
       for (int i = 0; i < dir.dir_size(); i++)
-         for (QLinkedListIterator<Directory*> d(this->subDirs.getList()); d.hasNext();)
+         for (QVectorIterator<Directory*> d(this->subDirs.getVector()); d.hasNext();)
             ret << d.next()->restoreFromFileCache(dir.dir(i));
 
       // . . . And files.
-      QLinkedList<File*> filesNotInDir = this->files.getList();
+      QLinkedList<File*> filesNotInDir = this->files.toLinkedList();
       for (int i = 0; i < dir.file_size(); i++)
-         for (QLinkedListIterator<File*> j(this->files.getList()); j.hasNext();)
+         for (QVectorIterator<File*> j(this->files.getVector()); j.hasNext();)
          {
             File* f = j.next();
             if (f->restoreFromFileCache(dir.file(i)) && f->hasAllHashes())
@@ -138,28 +159,28 @@ QList<File*> Directory::restoreFromFileCache(const Protos::FileCache::Hashes::Di
 
 void Directory::populateHashesDir(Protos::FileCache::Hashes::Dir& dirToFill) const
 {
-   QLinkedList<Directory*> subDirsCopy;
-   QLinkedList<File*> filesCopy;
+   QVector<Directory*> subDirsCopy;
+   QVector<File*> filesCopy;
 
    {
       QMutexLocker locker(&this->mutex);
       Common::ProtoHelper::setStr(dirToFill, &Protos::FileCache::Hashes_Dir::set_name, this->getName());
-      subDirsCopy = this->subDirs.getList();
-      filesCopy = this->files.getList();
+      subDirsCopy = this->subDirs.getVector();
+      filesCopy = this->files.getVector();
    }
 
-   for (QLinkedListIterator<File*> i(filesCopy); i.hasNext();)
+   for (QVectorIterator<File*> i(filesCopy); i.hasNext();)
    {
       File* f = i.next();
 
-      if (f->hasOneOrMoreHashes())
+      if (f->hasOneOrMoreHashes() || this->cache->hasPreviousHashes(f))
       {
          Protos::FileCache::Hashes_File* file = dirToFill.add_file();
          f->populateHashesFile(*file);
       }
    }
 
-   for (QLinkedListIterator<Directory*> dir(subDirsCopy); dir.hasNext();)
+   for (QVectorIterator<Directory*> dir(subDirsCopy); dir.hasNext();)
    {
       dir.next()->populateHashesDir(*dirToFill.add_dir());
    }
@@ -173,17 +194,62 @@ void Directory::populateEntry(Protos::Common::Entry* dir, bool setSharedDir) con
 
    // Do not count the unfinished files.
    bool isEmpty = true;
-   for (QLinkedListIterator<File*> i(this->files.getList()); i.hasNext();)
+   for (QVectorIterator<File*> i(this->files.getVector()); i.hasNext();)
       if (i.next()->isComplete())
       {
          isEmpty = false;
          break;
       }
 
-   dir->set_is_empty(this->subDirs.getList().isEmpty() && isEmpty);
+   dir->set_is_empty(this->subDirs.isEmpty() && isEmpty);
    dir->set_type(Protos::Common::Entry_Type_DIR);
 }
 
+/**
+  * Return the listing of this directory as a serialized 'Protos::Core::GetEntriesResult::EntryResult':
+  * the sub directories then the complete files, each file having at most 'maxNbHashesPerEntry' hashes.
+  * The listing is kept in the 'EncodedEntriesCache' until a child is added, removed, renamed or resized or a hash of a file changes, see 'invalidateEncodedEntries()'.
+  * It's also stale when a directory is renamed or moved because each entry contains its path.
+  */
+QByteArray Directory::getEncodedEntries(int maxNbHashesPerEntry) const
+{
+   const int version = this->entriesVersion.loadAcquire();
+   const int generation = Directory::pathGeneration.loadAcquire();
+
+   EncodedEntriesCache& encodedEntriesCache = this->cache->getEncodedEntriesCache();
+
+   QByteArray encodedEntries;
+   if (encodedEntriesCache.get(this, maxNbHashesPerEntry, version, generation, encodedEntries))
+      return encodedEntries;
+
+   Protos::Core::GetEntriesResult::EntryResult result;
+   result.set_status(Protos::Core::GetEntriesResult::EntryResult::OK);
+
+   foreach (Directory* dir, this->getSubDirs())
+      dir->populateEntry(result.mutable_entries()->add_entry());
+
+   foreach (File* file, this->getFiles())
+      if (file->isComplete())
+         file->populateEntry(result.mutable_entries()->add_entry(), false, maxNbHashesPerEntry);
+
+   encodedEntries = Common::ProtoHelper::serialize(result);
+
+   // If the listing has changed during the encoding the result isn't cached.
+   if (this->entriesVersion.loadAcquire() == version && Directory::pathGeneration.loadAcquire() == generation)
+      encodedEntriesCache.insert(this, maxNbHashesPerEntry, version, generation, encodedEntries);
+
+   return encodedEntries;
+}
+
+/**
+  * Must be called after each change of the listing, see 'getEncodedEntries(..)'.
+  * The outdated listings are released the next time they are asked or when they are evicted from the 'EncodedEntriesCache'.
+  */
+void Directory::invalidateEncodedEntries()
+{
+   this->entriesVersion.fetchAndAddOrdered(1);
+}
+
 /**
   * Remove physically all unfinished file.
   */
@@ -192,10 +258,10 @@ void Directory::removeUnfinishedFiles()
    QMutexLocker locker(&this->mutex);
 
    // Removes incomplete file we don't know.
-   foreach (File* f, this->files.getList())
+   foreach (File* f, this->files.getVector())
       f->removeUnfinishedFiles();
 
-   foreach (Directory* d, this->subDirs.getList())
+   foreach (Directory* d, this->subDirs.getVector())
       d->removeUnfinishedFiles();
 }
 
@@ -217,6 +283,8 @@ void Directory::moveInto(Directory* directory)
    this->parent->subDirDeleted(this);
    directory->add(this);
    this->parent = directory;
+
+   Directory::invalidateCachedPaths();
 }
 
 /**
@@ -228,12 +296,14 @@ void Directory::fileDeleted(File* file)
 
    (*this) -= file->getSize();
    this->files.removeOne(file);
+   this->contentChanged();
 }
 
 void Directory::subDirDeleted(Directory* dir)
 {
    QMutexLocker locker(&this->mutex);
    this->subDirs.removeOne(dir);
+   this->contentChanged();
 }
 
 QString Directory::getPath() const
@@ -252,6 +322,8 @@ QString Directory::getPath() const
 
 /**
   * We use "this->name" instead of "this->getName()" to improve a bit the performance during searching (See 'QSort(..)' in 'FileManager::find(..)').
+  * The path is cached until a directory is renamed or moved somewhere in the tree, see 'invalidateCachedPaths()'.
+  * No lock is taken: the cached path is immutable and replaced atomically, only when the path of this directory has actually changed.
   */
 QString Directory::getFullPath() const
 {
@@ -260,7 +332,30 @@ QString Directory::getFullPath() const
    if (!this->parent)
       return this->getName().append('/');
 
-   return this->parent->getFullPath().append(this->name).append('/');
+   // The generation is incremented after a rename or a move, thus a path computed after reading it is valid for it.
+   const int generation = Directory::pathGeneration.loadAcquire();
+
+   CachedPath* cached = this->cachedPath.loadAcquire();
+   if (cached && cached->generation.loadAcquire() == generation)
+      return cached->path;
+
+   const QString fullPath = this->parent->getFullPath().append(this->name).append('/');
+
+   // Most of the renames and moves are elsewhere in the tree.
+   if (cached && cached->path == fullPath)
+   {
+      cached->generation.storeRelease(generation);
+      return fullPath;
+   }
+
+   CachedPath* newCached = new CachedPath(fullPath, generation, cached);
+   if (!this->cachedPath.testAndSetOrdered(cached, newCached))
+   {
+      // Already replaced by another thread.
+      newCached->previous = nullptr;
+      delete newCached;
+   }
+   return fullPath;
 }
 
 SharedDirectory* Directory::getRoot() const
@@ -275,6 +370,8 @@ void Directory::rename(const QString& newName)
    Entry::rename(newName);
    if (this->parent)
       this->parent->subdirNameChanged(this);
+
+   Directory::invalidateCachedPaths();
 }
 
 bool Directory::isAChildOf(const Directory* dir) const
@@ -295,34 +392,26 @@ bool Directory::isAChildOf(const Directory* dir) const
 Directory* Directory::getSubDir(const QString& name) const
 {
    QMutexLocker locker(&this->mutex);
-
-   for (QLinkedListIterator<Directory*> i(this->subDirs.getList()); i.hasNext();)
-   {
-      Directory* d = i.next();
-      if (d->getName() == name)
-         return d;
-   }
-
-   return nullptr;
+   return this->subDirs.find(name);
 }
 
 QLinkedList<Directory*> Directory::getSubDirs() const
 {
    QMutexLocker locker(&this->mutex);
-   return this->subDirs.getList();
+   return this->subDirs.toLinkedList();
 }
 
 QLinkedList<File*> Directory::getFiles() const
 {
    QMutexLocker locker(&this->mutex);
-   return this->files.getList();
+   return this->files.toLinkedList();
 }
 
 QList<File*> Directory::getCompleteFiles() const
 {
    QMutexLocker locker(&this->mutex);
    QList<File*> completeFiles;
-   foreach (File* file, this->files.getList())
+   foreach (File* file, this->files.getVector())
    {
       if (file->isComplete())
          completeFiles << file;
@@ -363,11 +452,7 @@ Directory* Directory::createSubDirs(const QStringList& names, bool physically)
 File* Directory::getFile(const QString& name) const
 {
    QMutexLocker locker(&this->mutex);
-   foreach (File* f, this->files.getList())
-      if (f->getName() == name)
-         return f;
-
-   return nullptr;
+   return this->files.find(name);
 }
 
 /**
@@ -378,6 +463,7 @@ void Directory::add(File* file)
    QMutexLocker locker(&this->mutex);
    this->files.insert(file);
    (*this) += file->getSize();
+   this->contentChanged();
 }
 
 void Directory::fileSizeChanged(qint64 oldSize, qint64 newSize)
@@ -401,27 +487,33 @@ void Directory::stealContent(Directory* dir)
 
    // L_DEBU(QString("this = %1, dir = %2").arg(this->getFullPath()).arg(dir->getFullPath()));
 
-   this->subDirs.insert(dir->subDirs.getList());
-   this->files.insert(dir->files.getList());
+   this->subDirs.insert(dir->subDirs.getVector());
+   this->files.insert(dir->files.getVector());
 
-   foreach (Directory* d, dir->subDirs.getList())
+   foreach (Directory* d, dir->subDirs.getVector())
    {
       d->parent = this;
       (*this) += d->getSize();
       (*dir) -= d->getSize();
    }
 
-   foreach (File* f, dir->files.getList())
+   foreach (File* f, dir->files.getVector())
       f->changeDirectory(this);
 
    dir->subDirs.clear();
    dir->files.clear();
+
+   this->contentChanged();
+   dir->contentChanged();
+
+   Directory::invalidateCachedPaths();
 }
 
 void Directory::add(Directory* dir)
 {
    QMutexLocker locker(&this->mutex);
    this->subDirs.insert(dir);
+   this->contentChanged();
 }
 
 bool Directory::isScanned() const
@@ -442,6 +534,18 @@ void Directory::setScanned(bool value)
       this->cache->onScanned(this);
 }
 
+QDateTime Directory::getDateLastModified() const
+{
+   QMutexLocker locker(&this->mutex);
+   return this->dateLastModified;
+}
+
+void Directory::setDateLastModified(const QDateTime& dateLastModified)
+{
+   QMutexLocker locker(&this->mutex);
+   this->dateLastModified = dateLastModified;
+}
+
 /**
   * Must be called only by a file.
   */
@@ -449,11 +553,12 @@ void Directory::fileNameChanged(File* file)
 {
    QMutexLocker locker(&this->mutex);
    this->files.itemChanged(file);
+   this->contentChanged(); // The file may have become complete or unfinished.
 }
 
 void Directory::deleteSubDirs()
 {
-   foreach (Directory* d, this->subDirs.getList())
+   foreach (Directory* d, this->subDirs.getVector())
       d->del();
 }
 
@@ -461,6 +566,37 @@ void Directory::subdirNameChanged(Directory* dir)
 {
    QMutexLocker locker(&this->mutex);
    this->subDirs.itemChanged(dir);
+   this->invalidateEncodedEntries();
+}
+
+/**
+  * A child has been added or removed or a file has become complete or unfinished.
+  * The parent listing is also stale because it contains the 'is_empty' field of this directory.
+  */
+void Directory::contentChanged()
+{
+   this->invalidateEncodedEntries();
+   if (this->parent)
+      this->parent->invalidateEncodedEntries();
+}
+
+Directory::CachedPath::CachedPath(const QString& path, int generation, CachedPath* previous) :
+   path(path), generation(generation), previous(previous)
+{
+}
+
+Directory::CachedPath::~CachedPath()
+{
+   delete this->previous;
+}
+
+/**
+  * All the cached paths become stale, they will be computed again the next time they are asked.
+  * Renaming or moving a directory is rare compared to the number of times a path is asked.
+  */
+void Directory::invalidateCachedPaths()
+{
+   Directory::pathGeneration.fetchAndAddOrdered(1);
 }
 
 /**
@@ -472,6 +608,7 @@ Directory& Directory::operator+=(qint64 size)
    QMutexLocker locker(&this->mutex);
 
    this->setSize(this->getSize() + size);
+   this->invalidateEncodedEntries(); // The size of a child has changed, the ancestors are invalidated by the recursive call.
 
    if (this->parent)
       (*this->parent) += size;
@@ -484,6 +621,7 @@ Directory& Directory::operator-=(qint64 size)
    QMutexLocker locker(&this->mutex);
 
    this->setSize(this->getSize() - size);
+   this->invalidateEncodedEntries();
 
    if (this->parent)
       (*this->parent) -= size;
@@ -503,7 +641,7 @@ DirIterator::DirIterator(Directory* dir, bool includeRoot)
    if (includeRoot)
       this->dirsToVisit << dir;
    else
-      this->dirsToVisit = dir->subDirs.getList();
+      this->dirsToVisit = dir->subDirs.toLinkedList();
 }
 
 /**
@@ -516,6 +654,7 @@ Directory* DirIterator::next()
 
    Directory* dir = this->dirsToVisit.front();
    this->dirsToVisit.removeFirst();
-   this->dirsToVisit << dir->subDirs.getList();
+   foreach (Directory* subDir, dir->subDirs.getVector())
+      this->dirsToVisit << subDir;
    return dir;
 }
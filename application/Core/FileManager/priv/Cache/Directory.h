@@ -22,15 +22,22 @@
 #include <QString>
 #include <QList>
 #include <QFileInfo>
+#include <QDateTime>
 #include <QMutex>
 #include <QMap>
+#include <QVector>
+#include <QLinkedList>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QByteArray>
 
 #include <Protos/common.pb.h>
 #include <Protos/files_cache.pb.h>
-
-#include <Common/Containers/SortedList.h>
+#include <Protos/core_protocol.pb.h>
 
 #include <priv/Cache/Entry.h>
+#include <priv/Cache/EntryArena.h>
+#include <priv/Cache/SortedEntries.h>
 
 namespace FM
 {
@@ -48,6 +55,9 @@ namespace FM
 
    public:
       virtual ~Directory();
+
+      static void* operator new(size_t size);
+      static void operator delete(void* p, size_t size);
       virtual void del(bool invokeDelete = true);
 
       QList<File*> restoreFromFileCache(const Protos::FileCache::Hashes::Dir& dir);
@@ -55,6 +65,9 @@ namespace FM
 
       virtual void populateEntry(Protos::Common::Entry* dir, bool setSharedDir = false) const;
 
+      QByteArray getEncodedEntries(int maxNbHashesPerEntry) const;
+      void invalidateEncodedEntries();
+
       virtual void removeUnfinishedFiles();
 
       virtual void moveInto(Directory* directory);
@@ -91,25 +104,50 @@ namespace FM
       bool isScanned() const;
       void setScanned(bool value);
 
+      QDateTime getDateLastModified() const;
+      void setDateLastModified(const QDateTime& dateLastModified);
+
       void fileNameChanged(File* file);
 
    protected:
       void deleteSubDirs();
+      static void invalidateCachedPaths();
 
    private:
       void subdirNameChanged(Directory* dir);
+      void contentChanged();
 
       Directory& operator+=(qint64);
       Directory& operator-=(qint64);
 
-      static inline bool entrySortingFun(const Entry* const& e1, const Entry* const& e2) { return (*e1) < (*e2); }
-
       Directory* parent;
 
-      Common::SortedList<Directory*> subDirs; ///< Sorted by name.
-      Common::SortedList<File*> files; ///< Sorted by name.
+      SortedEntries<Directory> subDirs; ///< Sorted by name.
+      SortedEntries<File> files; ///< Sorted by name.
 
       bool scanned;
+      QDateTime dateLastModified; ///< The modification date of the physical directory when it was last scanned, null if unknown. See 'FileUpdater::validateSomeRestoredDirs()'.
+
+      /**
+        * An immutable full path, only its generation is updated. A replaced path may still be read by another thread,
+        * thus it's kept in the 'previous' chain until the directory is deleted.
+        */
+      struct CachedPath
+      {
+         CachedPath(const QString& path, int generation, CachedPath* previous);
+         ~CachedPath();
+
+         const QString path;
+         QAtomicInt generation; ///< The last generation for which 'path' is known to be valid.
+         CachedPath* previous;
+      };
+
+      static QAtomicInt pathGeneration; ///< Incremented each time a directory is renamed or moved, the cached paths of an older generation are stale.
+      mutable QAtomicPointer<CachedPath> cachedPath; ///< Read without lock by 'getFullPath()'.
+
+      QAtomicInt entriesVersion; ///< Incremented each time the listing of this directory changes, the encoded entries of an older version are stale. See 'EncodedEntriesCache'.
+
+      static EntryArena arena;
    };
 
    class DirIterator
@@ -0,0 +1,84 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/Cache/EncodedEntriesCache.h>
+using namespace FM;
+
+#include <QMutexLocker>
+
+/**
+  * @param maxSize [byte]. The maximum total size of the cached listings, 0 to disable the cache.
+  */
+EncodedEntriesCache::EncodedEntriesCache(int maxSize) :
+   cache(maxSize)
+{
+}
+
+/**
+  * @return 'false' if there is no listing for the given directory and number of hashes or if it's outdated.
+  */
+bool EncodedEntriesCache::get(const Directory* dir, int maxNbHashesPerEntry, int version, int pathGeneration, QByteArray& encodedEntries)
+{
+   QMutexLocker locker(&this->mutex);
+
+   if (CachedEntries* entries = this->cache.object(dir))
+   {
+      if (entries->version != version || entries->pathGeneration != pathGeneration)
+      {
+         this->cache.remove(dir);
+         return false;
+      }
+
+      auto i = entries->encodedEntries.constFind(maxNbHashesPerEntry);
+      if (i != entries->encodedEntries.constEnd())
+      {
+         encodedEntries = i.value();
+         return true;
+      }
+   }
+
+   return false;
+}
+
+/**
+  * The outdated listings of the directory are replaced.
+  */
+void EncodedEntriesCache::insert(const Directory* dir, int maxNbHashesPerEntry, int version, int pathGeneration, const QByteArray& encodedEntries)
+{
+   QMutexLocker locker(&this->mutex);
+
+   CachedEntries* entries = this->cache.take(dir);
+   if (!entries || entries->version != version || entries->pathGeneration != pathGeneration)
+   {
+      delete entries;
+      entries = new CachedEntries { version, pathGeneration, QHash<int, QByteArray>(), 0 };
+   }
+
+   entries->size += encodedEntries.size() - entries->encodedEntries.value(maxNbHashesPerEntry).size();
+   entries->encodedEntries.insert(maxNbHashesPerEntry, encodedEntries);
+   this->cache.insert(dir, entries, entries->size);
+}
+
+/**
+  * Must be called when a directory is deleted, its memory may be reused by a new one.
+  */
+void EncodedEntriesCache::remove(const Directory* dir)
+{
+   QMutexLocker locker(&this->mutex);
+   this->cache.remove(dir);
+}
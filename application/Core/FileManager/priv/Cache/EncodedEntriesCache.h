@@ -0,0 +1,62 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_ENCODED_ENTRIES_CACHE_H
+#define FILEMANAGER_ENCODED_ENTRIES_CACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QCache>
+#include <QMutex>
+
+#include <Common/Uncopyable.h>
+
+namespace FM
+{
+   class Directory;
+
+   /**
+     * A LRU cache of the serialized listings of the directories sent to the peers, see 'Directory::getEncodedEntries(..)'.
+     * A directory may have one listing per maximum number of hashes per entry, its cost is the size of its listings in bytes.
+     * The listings are outdated when the version of the directory or the path generation has changed since their encoding.
+     * This class is thread safe.
+     */
+   class EncodedEntriesCache : Common::Uncopyable
+   {
+   public:
+      EncodedEntriesCache(int maxSize);
+
+      bool get(const Directory* dir, int maxNbHashesPerEntry, int version, int pathGeneration, QByteArray& encodedEntries);
+      void insert(const Directory* dir, int maxNbHashesPerEntry, int version, int pathGeneration, const QByteArray& encodedEntries);
+      void remove(const Directory* dir);
+
+   private:
+      struct CachedEntries
+      {
+         int version;
+         int pathGeneration;
+         QHash<int, QByteArray> encodedEntries; ///< By maximum number of hashes per entry.
+         int size;
+      };
+
+      QCache<const Directory*, CachedEntries> cache;
+      QMutex mutex; // Protects 'cache', 'QCache' modifies itself when an object is read.
+   };
+}
+
+#endif
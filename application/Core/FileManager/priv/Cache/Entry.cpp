@@ -28,9 +28,11 @@ using namespace FM;
 #include <priv/Cache/Cache.h>
 #include <priv/Cache/SharedDirectory.h>
 
-Entry::Entry(Cache* cache, const QString& name, qint64 size) :
-   cache(cache), name(name), size(size), mutex(QMutex::Recursive)
+Entry::Entry(Cache* cache, Type type, const QString& name, qint64 size) :
+   cache(cache), size(size), type(type), mutex(QMutex::Recursive)
 {
+   this->setName(name);
+
    if (cache)
       this->cache->onEntryAdded(this);
 }
@@ -96,10 +98,29 @@ void Entry::rename(const QString& newName)
       return;
 
    const QString oldName = this->name;
-   this->name = newName;
+   this->setName(newName);
    this->cache->onEntryRenamed(this, oldName);
 }
 
+/**
+  * Set the name and the sort key, both are taken from the 'NamePool' of the cache.
+  * The parent directory must be told with 'Directory::fileNameChanged(..)' or 'Directory::subdirNameChanged(..)'
+  * to keep its entries sorted.
+  */
+void Entry::setName(const QString& name)
+{
+   if (this->cache)
+   {
+      this->name = this->cache->getNamePool().get(name);
+      this->sortKey = this->cache->getNamePool().get(name.toLower());
+   }
+   else
+   {
+      this->name = name;
+      this->sortKey = name.toLower();
+   }
+}
+
 qint64 Entry::getSize() const
 {
    return this->size;
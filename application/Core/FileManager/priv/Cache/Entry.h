@@ -34,8 +34,19 @@ namespace FM
 
    class Entry : Common::Uncopyable
    {
+   public:
+      /**
+        * Stored in each entry to know its kind without a 'dynamic_cast', for example to filter the search results.
+        * A 'SharedDirectory' is a 'DIRECTORY'.
+        */
+      enum class Type : quint8
+      {
+         FILE,
+         DIRECTORY
+      };
+
    protected:
-      Entry(Cache* cache, const QString& name, qint64 size = 0);
+      Entry(Cache* cache, Type type, const QString& name, qint64 size = 0);
 
    public:
       virtual ~Entry();
@@ -68,6 +79,7 @@ namespace FM
       virtual void moveInto(Directory* directory) = 0;
 
       QString getName() const;
+      inline const QString& getSortKey() const { return this->sortKey; }
       QString getNameWithoutExtension() const;
       QString getExtension() const;
       virtual void rename(const QString& newName);
@@ -75,26 +87,38 @@ namespace FM
       qint64 getSize() const;
       void setSize(qint64 newSize);
 
+      inline Type getType() const { return this->type; }
+
    protected:
+      void setName(const QString& name);
+
       Cache* cache; // To announce when an entry, chunk is created or deleted.
 
-      QString name;
+      QString name; ///< Interned, see 'NamePool'.
+      QString sortKey; ///< The name in lower case, to sort the entries without converting their names at each comparison. Interned too.
 
    private:
       qint64 size;
+      const Type type;
 
    protected:
+      /**
+        * One mutex per entry. The locks are taken in both directions of the tree: 'Directory::del(..)' locks a directory then its files
+        * and sub-directories while 'File::rename(..)' and 'Directory::rename(..)' lock an entry then its parent. A striped or shared lock
+        * would make two unrelated entries share a mutex and could deadlock on these opposite orders, a single global lock would
+        * serialize the scanning, the hashing and the downloads on the whole cache.
+        */
       mutable QMutex mutex;
    };
 
    inline bool operator<(const Entry& e1, const Entry& e2)
    {
-      return e1.getName().toLower() < e2.getName().toLower();
+      return e1.getSortKey() < e2.getSortKey();
    }
 
    inline bool operator>(const Entry& e1, const Entry& e2)
    {
-      return e1.getName().toLower() > e2.getName().toLower();
+      return e1.getSortKey() > e2.getSortKey();
    }
 
    inline uint qHash(const Entry* entry)
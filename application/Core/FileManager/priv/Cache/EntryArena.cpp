@@ -0,0 +1,100 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#include <priv/Cache/EntryArena.h>
+using namespace FM;
+
+#include <new>
+
+#include <QMutexLocker>
+
+/**
+  * @class FM::EntryArena
+  *
+  * Allocate the files and the directories of the cache in blocks of contiguous slots instead of one heap
+  * allocation per entry. A cache can hold millions of entries, the entries of a same directory are mostly
+  * allocated at the same time and are close in memory, the overhead of the allocator is removed.
+  * The objects of a different size than the slot size (for example a 'SharedDirectory') are allocated normally.
+  * This class is thread safe.
+  */
+
+EntryArena::EntryArena(size_t slotSize) :
+   slotSize((qMax(slotSize, sizeof(FreeSlot)) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT),
+   freeSlots(nullptr),
+   nbAllocatedSlots(0)
+{
+}
+
+void* EntryArena::allocate(size_t size)
+{
+   if (size > this->slotSize || size + ALIGNMENT <= this->slotSize)
+      return ::operator new(size);
+
+   QMutexLocker locker(&this->mutex);
+
+   if (!this->freeSlots)
+      this->allocateBlock();
+
+   FreeSlot* slot = this->freeSlots;
+   this->freeSlots = slot->next;
+   this->nbAllocatedSlots++;
+   return slot;
+}
+
+void EntryArena::release(void* p, size_t size)
+{
+   if (!p)
+      return;
+
+   if (size > this->slotSize || size + ALIGNMENT <= this->slotSize)
+   {
+      ::operator delete(p);
+      return;
+   }
+
+   QMutexLocker locker(&this->mutex);
+
+   FreeSlot* slot = static_cast<FreeSlot*>(p);
+   slot->next = this->freeSlots;
+   this->freeSlots = slot;
+   this->nbAllocatedSlots--;
+}
+
+int EntryArena::getNbAllocatedSlots() const
+{
+   QMutexLocker locker(&this->mutex);
+   return this->nbAllocatedSlots;
+}
+
+/**
+  * Cut a new block into slots and put them in the free list.
+  */
+void EntryArena::allocateBlock()
+{
+   const size_t nbSlots = qMax<size_t>(BLOCK_SIZE / this->slotSize, 1);
+   char* block = static_cast<char*>(::operator new(nbSlots * this->slotSize));
+   this->blocks << block;
+
+   for (size_t i = nbSlots; i > 0; i--)
+   {
+      FreeSlot* slot = reinterpret_cast<FreeSlot*>(block + (i - 1) * this->slotSize);
+      slot->next = this->freeSlots;
+      this->freeSlots = slot;
+   }
+}
@@ -0,0 +1,61 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#ifndef FILEMANAGER_ENTRYARENA_H
+#define FILEMANAGER_ENTRYARENA_H
+
+#include <cstddef>
+
+#include <QList>
+#include <QMutex>
+
+#include <Common/Uncopyable.h>
+
+namespace FM
+{
+   class EntryArena : Common::Uncopyable
+   {
+      static const size_t BLOCK_SIZE = 64 * 1024;
+      static const size_t ALIGNMENT = 16;
+
+   public:
+      EntryArena(size_t slotSize);
+
+      void* allocate(size_t size);
+      void release(void* p, size_t size);
+
+      int getNbAllocatedSlots() const;
+
+   private:
+      void allocateBlock();
+
+      struct FreeSlot
+      {
+         FreeSlot* next;
+      };
+
+      const size_t slotSize;
+      FreeSlot* freeSlots;
+      QList<char*> blocks; ///< Never released, the memory is reused by the next entries.
+      int nbAllocatedSlots;
+      mutable QMutex mutex;
+   };
+}
+
+#endif
@@ -42,6 +42,8 @@ using namespace FM;
 #include <priv/Cache/SharedDirectory.h>
 #include <priv/Cache/Chunk.h>
 
+EntryArena File::arena(sizeof(File));
+
 /**
   * @class FM::File
   *
@@ -76,7 +78,7 @@ File::File(
    const Common::Hashes& hashes,
    bool createPhysically
 ) :
-   Entry(dir->getCache(), name + (createPhysically && size > 0 ? Global::getUnfinishedSuffix() : ""), size),
+   Entry(dir->getCache(), Type::FILE, name + (createPhysically && size > 0 ? Global::getUnfinishedSuffix() : ""), size),
    dir(dir),
    dateLastModified(dateLastModified),
    complete(!Global::isFileUnfinished(Entry::getName())),
@@ -108,6 +110,19 @@ File::~File()
    L_DEBU(QString("File deleted: %1").arg(this->getName()));
 }
 
+/**
+  * The files are allocated in an arena, see 'EntryArena'.
+  */
+void* File::operator new(size_t size)
+{
+   return File::arena.allocate(size);
+}
+
+void File::operator delete(void* p, size_t size)
+{
+   File::arena.release(p, size);
+}
+
 void File::del(bool invokeDelete)
 {
    this->dir->fileDeleted(this);
@@ -150,7 +165,8 @@ void File::setToUnfinished(qint64 size, const Common::Hashes& hashes)
 
    this->complete = false;
    this->cache->onEntryRemoved(this);
-   this->name.append(Global::getUnfinishedSuffix());
+   this->setName(this->name + Global::getUnfinishedSuffix());
+   this->dir->fileNameChanged(this);
    this->setSize(size);
    this->dateLastModified = QDateTime::currentDateTime();
    this->deleteAllChunks();
@@ -177,8 +193,16 @@ bool File::restoreFromFileCache(const Protos::FileCache::Hashes::File& file)
    {
       L_DEBU(QString("Restoring file '%1' from the file cache").arg(this->getFullPath()));
 
+      bool hasPreviousHashes = false;
       for (int i = 0; i < file.chunk_size(); i++)
       {
+         // A hash computed with a previous algorithm is useless but it's kept in the file cache until the chunk is hashed again.
+         if (file.chunk(i).has_hash_algorithm() && static_cast<Common::HashAlgorithm>(file.chunk(i).hash_algorithm()) != Global::getHashAlgorithm())
+         {
+            hasPreviousHashes = true;
+            continue;
+         }
+
          this->chunks[i]->restoreFromFileCache(file.chunk(i));
          if (this->chunks[i]->hasHash())
          {
@@ -187,6 +211,9 @@ bool File::restoreFromFileCache(const Protos::FileCache::Hashes::File& file)
          }
       }
 
+      if (hasPreviousHashes)
+         this->cache->keepPreviousHashes(this, file);
+
       return true;
    }
    return false;
@@ -200,11 +227,31 @@ void File::populateHashesFile(Protos::FileCache::Hashes_File& fileToFill) const
    fileToFill.set_size(this->getSize());
    fileToFill.set_date_last_modified(this->getDateLastModified().toMSecsSinceEpoch());
 
-   for (QVectorIterator<QSharedPointer<Chunk>> i(this->chunks); i.hasNext();)
+   // The hashes of a previous algorithm are valid only if the file hasn't changed, see 'Cache::keepPreviousHashes(..)'.
+   Protos::FileCache::Hashes_File previousHashes;
+   const bool previousHashesKept = this->cache->getPreviousHashes(this, previousHashes);
+   const bool hasPreviousHashes =
+      previousHashesKept &&
+      previousHashes.size() == fileToFill.size() &&
+      previousHashes.date_last_modified() == fileToFill.date_last_modified() &&
+      previousHashes.chunk_size() == this->chunks.size();
+
+   bool hasAllHashes = true;
+   for (int i = 0; i < this->chunks.size(); i++)
    {
       Protos::FileCache::Hashes_Chunk* chunk = fileToFill.add_chunk();
-      i.next()->populateHashesChunk(*chunk);
+      this->chunks[i]->populateHashesChunk(*chunk);
+
+      if (!chunk->has_hash())
+      {
+         hasAllHashes = false;
+         if (hasPreviousHashes && previousHashes.chunk(i).has_hash_algorithm())
+            chunk->CopyFrom(previousHashes.chunk(i));
+      }
    }
+
+   if (previousHashesKept && (hasAllHashes || !hasPreviousHashes))
+      this->cache->forgetPreviousHashes(this);
 }
 
 /**
@@ -225,6 +272,10 @@ void File::populateEntry(Protos::Common::Entry* entry, bool setSharedDir, int ma
 
    entry->clear_chunk();
 
+   // The default algorithm isn't set to keep the entry small.
+   if (Global::getHashAlgorithm() != Common::HashAlgorithm::SHA1)
+      entry->set_hash_algorithm(static_cast<Protos::Common::HashAlgorithm>(Global::getHashAlgorithm()));
+
    int nb = 0;
    for (QVectorIterator<QSharedPointer<Chunk>> i(this->chunks); i.hasNext();)
    {
@@ -250,9 +301,9 @@ bool File::matchesEntry(const Protos::Common::Entry& entry) const
 /**
   * Return true if the size and the last modification date correspond to the given file information.
   */
-bool File::correspondTo(const QFileInfo& fileInfo, bool checkTheDateToo)
+bool File::correspondTo(qint64 size, const QDateTime& dateLastModified, bool checkTheDateToo)
 {
-   return this->getSize() == fileInfo.size() && (!checkTheDateToo || this->getDateLastModified() == fileInfo.lastModified());
+   return this->getSize() == size && (!checkTheDateToo || this->getDateLastModified() == dateLastModified);
 }
 
 QString File::getPath() const
@@ -469,7 +520,7 @@ void File::chunkComplete(const Chunk* chunk)
    int nbChunkComplete = 0;
    for (int i = 0; i < this->chunks.size(); ++i)
    {
-      if (this->chunks[i].data() == chunk)
+      if (this->chunks[i].data() == chunk && chunk->hasHash()) // A chunk downloaded with another algorithm has no hash, see 'IChunk::getDataWriter(..)'.
          this->cache->onChunkHashKnown(this->chunks[i]);
 
       if (this->chunks[i]->isComplete())
@@ -480,6 +531,15 @@ void File::chunkComplete(const Chunk* chunk)
       this->setAsComplete();
 }
 
+/**
+  * Called by the cache when the hash of a chunk is known or when a chunk is removed.
+  * The hashes are part of the listing of the directory.
+  */
+void File::chunksChanged()
+{
+   this->dir->invalidateEncodedEntries();
+}
+
 int File::getNbChunks()
 {
    return this->getSize() / Chunk::CHUNK_SIZE + (this->getSize() % Chunk::CHUNK_SIZE == 0 ? 0 : 1);
@@ -587,7 +647,8 @@ void File::setAsComplete()
       {
          this->complete = true;
          this->dateLastModified = QFileInfo(newPath).lastModified();
-         this->name = Global::removeUnfinishedSuffix(this->name);
+         this->setName(Global::removeUnfinishedSuffix(this->name));
+         this->dir->fileNameChanged(this);
          this->cache->onEntryAdded(this); // To add the name to the index. (a bit tricky).
       }
    }
@@ -647,14 +708,14 @@ void File::setHashes(const Common::Hashes& hashes)
 
       if (i < hashes.size() && !hashes[i].isNull())
       {
-         QSharedPointer<Chunk> chunk(new Chunk(this, i, chunkKnownBytes, hashes[i]));
+         QSharedPointer<Chunk> chunk = Chunk::create(this, i, chunkKnownBytes, hashes[i]);
          this->chunks << chunk;
          if (chunk->isComplete())
             this->cache->onChunkHashKnown(chunk);
       }
       else
          // If there is too few hashes then null hashes are added.
-         this->chunks << QSharedPointer<Chunk>(new Chunk(this, i, chunkKnownBytes));
+         this->chunks << Chunk::create(this, i, chunkKnownBytes);
    }
 }
 
@@ -664,8 +725,10 @@ void FileForHasher::setSize(qint64 size)
 {
    if (this->getSize() != size)
    {
-      this->dir->fileSizeChanged(this->getSize(), size);
+      // The directory is told after the change to invalidate its listing, see 'Directory::getEncodedEntries(..)'.
+      const qint64 oldSize = this->getSize();
       File::setSize(size);
+      this->dir->fileSizeChanged(oldSize, size);
    }
 }
 
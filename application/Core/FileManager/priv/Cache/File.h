@@ -36,6 +36,7 @@
 #include <Common/Hashes.h>
 
 #include <priv/Cache/Entry.h>
+#include <priv/Cache/EntryArena.h>
 
 namespace FM
 {
@@ -58,6 +59,9 @@ namespace FM
 
       virtual ~File();
 
+      static void* operator new(size_t size);
+      static void operator delete(void* p, size_t size);
+
    public:
       void del(bool invokeDelete = true);
 
@@ -72,7 +76,7 @@ namespace FM
       void populateEntry(Protos::Common::Entry* entry, bool setSharedDir, int maxHashes) const;
       bool matchesEntry(const Protos::Common::Entry& entry) const;
 
-      bool correspondTo(const QFileInfo& fileInfo, bool checkTheDateToo = true);
+      bool correspondTo(qint64 size, const QDateTime& dateLastModified, bool checkTheDateToo = true);
 
       QString getPath() const;
       QString getFullPath() const;
@@ -95,6 +99,7 @@ namespace FM
 
       bool isComplete();
       void chunkComplete(const Chunk* chunk);
+      void chunksChanged();
 
       int getNbChunks();
 
@@ -127,6 +132,8 @@ namespace FM
       QFile* fileInReadMode;
       QMutex writeLock; ///< Protect the file from concurrent access from different downloaders.
       QMutex readLock; ///< Protect the file from concurrent access from different uploaders.
+
+      static EntryArena arena;
    };
 
    /**
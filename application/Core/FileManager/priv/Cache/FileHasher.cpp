@@ -22,8 +22,14 @@ using namespace FM;
 #include <QMutexLocker>
 #include <QString>
 #include <QFile>
+#include <QByteArray>
+#include <QList>
 #include <QElapsedTimer>
 
+#if defined(Q_OS_LINUX)
+   #include <fcntl.h>
+#endif
+
 #include <Common/Global.h>
 #include <Common/Settings.h>
 #include <Common/Hash.h>
@@ -32,15 +38,268 @@ using namespace FM;
 #include <Exceptions.h>
 #include <priv/Cache/Cache.h>
 #include <priv/Cache/File.h>
+#include <priv/Cache/LeafHasher.h>
 #include <priv/Log.h>
+#include <priv/Global.h>
 
 /**
   * @class FileHasher
   *
   * The class can compute the hashes of a given file (FM::File*).
   * A 'Chunk' object is added to the file for each hash computed.
+  *
+  * If the setting 'number_of_hashing_threads_per_file' is greater than one the full chunks of a large file
+  * are hashed concurrently by some 'ChunkHashingThread', each hash is published as soon as it is known.
+  *
+  * The remaining data are read by a 'ReadAheadThread' while the previous buffer is hashed.
+  * On Linux the data hashed are removed from the page cache (posix_fadvise(..)) to keep the pages of the files being uploaded.
   */
 
+/**
+  * Tell the kernel that the data of the given file range won't be read again. Does nothing on the other platforms than Linux.
+  */
+static void dropFromPageCache(QFile& file, qint64 offset, qint64 length)
+{
+#if defined(Q_OS_LINUX)
+   if (length > 0)
+      posix_fadvise(file.handle(), offset, length, POSIX_FADV_DONTNEED);
+#else
+   Q_UNUSED(file);
+   Q_UNUSED(offset);
+   Q_UNUSED(length);
+#endif
+}
+
+/**
+  * Read a file from its current position in some buffers ahead of the hashing. Thus the disk and the CPU work at the same time.
+  * The file mustn't be used by another thread as long as this object exists.
+  */
+class FileHasher::ReadAheadThread : public QThread
+{
+public:
+   static const int READ_ERROR = -1;
+   static const int LOCK_ERROR = -2;
+
+   ReadAheadThread(QFile& file, int bufferSize, int nbBuffers) :
+      file(file), buffers(nbBuffers), sizes(nbBuffers, 0), nbFilledBuffers(0), nextBufferToRead(0), nextBufferToFill(0), currentBufferOwned(false), toStop(false)
+   {
+      for (int i = 0; i < this->buffers.size(); i++)
+         this->buffers[i].resize(bufferSize);
+
+      this->start();
+   }
+
+   ~ReadAheadThread()
+   {
+      this->mutex.lock();
+      this->toStop = true;
+      this->bufferReleased.wakeOne();
+      this->mutex.unlock();
+
+      this->wait();
+   }
+
+   /**
+     * Wait for the next buffer to be read. The data remain valid until the next call.
+     * @return The number of bytes read, 0 at the end of the file, 'READ_ERROR' or 'LOCK_ERROR' if the file can't be read.
+     */
+   int nextBuffer(const char*& data)
+   {
+      QMutexLocker locker(&this->mutex);
+
+      // The previous buffer can be filled again.
+      if (this->currentBufferOwned)
+      {
+         this->nextBufferToRead = (this->nextBufferToRead + 1) % this->buffers.size();
+         this->nbFilledBuffers--;
+         this->bufferReleased.wakeOne();
+      }
+
+      while (this->nbFilledBuffers == 0)
+         this->bufferFilled.wait(&this->mutex);
+
+      this->currentBufferOwned = true;
+      data = this->buffers[this->nextBufferToRead].constData();
+      return this->sizes[this->nextBufferToRead];
+   }
+
+protected:
+   void run()
+   {
+      static const qint64 PAGE_CACHE_DROP_STEP = 8 * 1024 * 1024; // [Byte].
+
+#if defined(Q_OS_LINUX)
+      posix_fadvise(this->file.handle(), this->file.pos(), 0, POSIX_FADV_SEQUENTIAL);
+#endif
+      qint64 notDroppedPos = this->file.pos();
+
+      forever
+      {
+         {
+            QMutexLocker locker(&this->mutex);
+            while (this->nbFilledBuffers == this->buffers.size() && !this->toStop)
+               this->bufferReleased.wait(&this->mutex);
+
+            if (this->toStop)
+               break;
+         }
+
+         // The buffer 'nextBufferToFill' is only accessed by this thread until it is counted as filled.
+         QByteArray& buffer = this->buffers[this->nextBufferToFill];
+         int bytesRead = 0;
+         {
+            Common::FileLocker fileLocker(this->file, buffer.size(), Common::FileLocker::READ);
+            bytesRead = fileLocker.isLocked() ? this->file.read(buffer.data(), buffer.size()) : LOCK_ERROR;
+         }
+
+         if (bytesRead <= 0 || this->file.pos() - notDroppedPos >= PAGE_CACHE_DROP_STEP)
+         {
+            dropFromPageCache(this->file, notDroppedPos, this->file.pos() - notDroppedPos);
+            notDroppedPos = this->file.pos();
+         }
+
+         QMutexLocker locker(&this->mutex);
+         this->sizes[this->nextBufferToFill] = bytesRead;
+         this->nextBufferToFill = (this->nextBufferToFill + 1) % this->buffers.size();
+         this->nbFilledBuffers++;
+         this->bufferFilled.wakeOne();
+
+         if (bytesRead <= 0)
+            break;
+      }
+   }
+
+private:
+   QFile& file;
+
+   QVector<QByteArray> buffers;
+   QVector<int> sizes; // The number of bytes read in each buffer, may also be 'READ_ERROR' or 'LOCK_ERROR'.
+   int nbFilledBuffers; // Including the buffer being hashed.
+   int nextBufferToRead;
+   int nextBufferToFill;
+   bool currentBufferOwned; // True if the buffer 'nextBufferToRead' is being hashed.
+
+   bool toStop;
+   QMutex mutex;
+   QWaitCondition bufferFilled;
+   QWaitCondition bufferReleased;
+};
+
+/**
+  * Hash some full chunks of a file with its own file handle. The chunks are taken one by one from a counter shared
+  * by all the threads hashing the same file.
+  */
+class FileHasher::ChunkHashingThread : public QThread
+{
+public:
+   ChunkHashingThread(FileHasher& fileHasher, const QString& filePath, const QVector<QSharedPointer<Chunk>>& chunks, QAtomicInt& nextChunkNum, int endChunkNum) :
+      fileHasher(fileHasher), filePath(filePath), chunks(chunks), nextChunkNum(nextChunkNum), endChunkNum(endChunkNum), amountHashed(0), failed(false)
+   {
+   }
+
+   qint64 getAmountHashed() const
+   {
+      return this->amountHashed;
+   }
+
+   /**
+     * True if the file can't be read or if it has shrunk.
+     */
+   bool hasFailed() const
+   {
+      return this->failed;
+   }
+
+protected:
+   void run()
+   {
+      static const int BUFFER_SIZE = SETTINGS.get<quint32>("buffer_size_reading");
+
+      QFile file(this->filePath);
+      if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+      {
+         L_WARN(QString("Unable to open this file : %1").arg(this->filePath));
+         this->failed = true;
+         return;
+      }
+
+      QByteArray buffer(BUFFER_SIZE, 0);
+      Common::Hasher hasher(Global::getHashAlgorithm());
+      LeafHasher leafHasher(Global::getLeafSize());
+
+      forever
+      {
+         const int chunkNum = this->nextChunkNum.fetchAndAddOrdered(1);
+         if (chunkNum >= this->endChunkNum)
+            return;
+
+         const QSharedPointer<Chunk>& chunk = this->chunks[chunkNum];
+         if (chunk->hasHash() && chunk->getKnownBytes() == Chunk::CHUNK_SIZE)
+            continue;
+
+         if (!file.seek(static_cast<qint64>(chunkNum) * Chunk::CHUNK_SIZE))
+         {
+            this->failed = true;
+            return;
+         }
+
+         int bytesReadChunk = 0;
+         while (bytesReadChunk < Chunk::CHUNK_SIZE)
+         {
+            {
+               QMutexLocker locker(&this->fileHasher.hashingMutex);
+               if (this->fileHasher.toStopHashing)
+                  return;
+            }
+
+            int bytesRead = 0;
+            {
+               Common::FileLocker fileLocker(file, BUFFER_SIZE, Common::FileLocker::READ);
+               if (!fileLocker.isLocked())
+               {
+                  L_WARN(QString("Unable to acquire the lock for this file : %1").arg(this->filePath));
+                  this->failed = true;
+                  return;
+               }
+               bytesRead = file.read(buffer.data(), qMin(BUFFER_SIZE, Chunk::CHUNK_SIZE - bytesReadChunk));
+            }
+
+            if (bytesRead <= 0) // An error occured or the file has shrunk, the sequential hashing will take care of it.
+            {
+               this->failed = true;
+               return;
+            }
+
+            hasher.addData(buffer.constData(), bytesRead);
+            leafHasher.addData(buffer.constData(), bytesRead);
+            bytesReadChunk += bytesRead;
+         }
+
+         {
+            QMutexLocker locker(&this->fileHasher.hashingMutex);
+            if (this->fileHasher.toStopHashing)
+               return;
+            this->fileHasher.setChunkHash(chunk, hasher.getResult(), bytesReadChunk, leafHasher.getResult());
+         }
+
+         dropFromPageCache(file, static_cast<qint64>(chunkNum) * Chunk::CHUNK_SIZE, bytesReadChunk);
+
+         hasher.reset();
+         leafHasher.reset();
+         this->amountHashed += bytesReadChunk;
+      }
+   }
+
+private:
+   FileHasher& fileHasher;
+   const QString filePath;
+   const QVector<QSharedPointer<Chunk>> chunks;
+   QAtomicInt& nextChunkNum;
+   const int endChunkNum;
+   qint64 amountHashed;
+   bool failed;
+};
+
 FileHasher::FileHasher() :
    currentFileCache(0),
    hashing(false),
@@ -55,7 +314,8 @@ FileHasher::FileHasher() :
   * from 'FileUpdated' thread.
   *
   * @param fileCache The file to hash.
-  * @param n Number of hashes to compute, 0 if we want to compute all the hashes.
+  * @param n Number of hashes to compute, 0 if we want to compute all the hashes. When the chunks are hashed concurrently
+  *  at least 'number_of_hashing_threads_per_file' hashes are computed.
   * @param[out] amountHashed Write the number of bytes hashed. It may be a null pointer ('nullptr') if this information isn't needed.
   * @exception IOErrorException Thrown when the file cannot be opened or read. Some chunk may be computed before this exception is thrown.
   */
@@ -80,6 +340,47 @@ bool FileHasher::start(FileForHasher* fileCache, int n, int* amountHashed)
 
    L_USER(tr("Computing hashes of %1 . . .").arg(filePath));
 
+   // The full chunks of a large file can be hashed concurrently. The last chunk is always hashed below because the file size may have changed.
+   static const int NUMBER_OF_HASHING_THREADS_PER_FILE = SETTINGS.get<quint32>("number_of_hashing_threads_per_file");
+   if (NUMBER_OF_HASHING_THREADS_PER_FILE > 1)
+   {
+      const QVector<QSharedPointer<Chunk>>& chunks = this->currentFileCache->getChunks();
+
+      int firstChunkNum = 0;
+      while (firstChunkNum < chunks.size() && chunks[firstChunkNum]->hasHash() && chunks[firstChunkNum]->getKnownBytes() == Chunk::CHUNK_SIZE)
+         firstChunkNum++;
+
+      const int endChunkNum = static_cast<int>(qMin(static_cast<qint64>(chunks.size() - 1), this->currentFileCache->getSize() / Chunk::CHUNK_SIZE));
+
+      if (endChunkNum - firstChunkNum >= 2)
+      {
+         bool failed = false;
+         locker.unlock();
+         const qint64 bytesHashed = this->computeChunksInParallel(filePath, chunks, firstChunkNum, n == 0 ? endChunkNum : qMin(endChunkNum, firstChunkNum + qMax(n, NUMBER_OF_HASHING_THREADS_PER_FILE)), failed);
+         locker.relock();
+
+         if (amountHashed)
+            *amountHashed += bytesHashed;
+
+         if (this->toStopHashing)
+         {
+            this->hashingStopped.wakeOne();
+            this->toStopHashing = false;
+            this->hashing = false;
+            this->currentFileCache = 0;
+            return false;
+         }
+
+         // The last chunk remains to be hashed.
+         if (!failed && n != 0)
+         {
+            this->hashing = false;
+            this->currentFileCache = 0;
+            return false;
+         }
+      }
+   }
+
    // Same performance with or without "QIODevice::Unbuffered".
    AutoReleasedFile file(FileHasher::filePool, filePath, QIODevice::ReadOnly | QIODevice::Unbuffered, this->currentFileCache->getSize() <= Chunk::CHUNK_SIZE);
 
@@ -115,9 +416,11 @@ bool FileHasher::start(FileForHasher* fileCache, int n, int* amountHashed)
 #endif
 
    static const int BUFFER_SIZE = SETTINGS.get<quint32>("buffer_size_reading");
-   char buffer[BUFFER_SIZE];
+   static const int NUMBER_OF_READ_AHEAD_BUFFERS = SETTINGS.get<quint32>("number_of_hashing_read_ahead_buffers");
+   ReadAheadThread readAheadThread(*file, BUFFER_SIZE, NUMBER_OF_READ_AHEAD_BUFFERS);
 
-   Common::Hasher hasher;
+   Common::Hasher hasher(Global::getHashAlgorithm());
+   LeafHasher leafHasher(Global::getLeafSize());
    bool endOfFile = false;
    qint64 bytesReadTotal = 0;
 
@@ -140,35 +443,30 @@ bool FileHasher::start(FileForHasher* fileCache, int n, int* amountHashed)
             return false;
          }
 
-         int bytesRead = 0;
+         const char* buffer;
+         const int bytesRead = readAheadThread.nextBuffer(buffer);
+         switch (bytesRead)
          {
-            Common::FileLocker fileLocker(*file, BUFFER_SIZE, Common::FileLocker::READ);
-            if (!fileLocker.isLocked())
-            {
-               this->toStopHashing = false;
-               this->hashing = false;
-               this->currentFileCache = 0;
-               L_WARN(QString("Unable to acquire the lock for this file : %1").arg(filePath));
-               throw IOErrorException();
-            }
-
-            bytesRead = file->read(buffer, BUFFER_SIZE);
-            switch (bytesRead)
-            {
-            case -1:
-               this->toStopHashing = false;
-               this->hashing = false;
-               this->currentFileCache = 0;
-               L_ERRO(QString("Error during reading the file %1").arg(filePath));
-               throw IOErrorException();
-            case 0:
-               endOfFile = true;
-               this->currentFileCache->setSize(bytesReadChunk + bytesReadTotal + bytesSkipped);
-               goto endReading;
-            }
+         case ReadAheadThread::LOCK_ERROR:
+            this->toStopHashing = false;
+            this->hashing = false;
+            this->currentFileCache = 0;
+            L_WARN(QString("Unable to acquire the lock for this file : %1").arg(filePath));
+            throw IOErrorException();
+         case ReadAheadThread::READ_ERROR:
+            this->toStopHashing = false;
+            this->hashing = false;
+            this->currentFileCache = 0;
+            L_ERRO(QString("Error during reading the file %1").arg(filePath));
+            throw IOErrorException();
+         case 0:
+            endOfFile = true;
+            this->currentFileCache->setSize(bytesReadChunk + bytesReadTotal + bytesSkipped);
+            goto endReading;
          }
 
          hasher.addData(buffer, bytesRead);
+         leafHasher.addData(buffer, bytesRead);
 
          bytesReadChunk += bytesRead;
       }
@@ -185,22 +483,14 @@ bool FileHasher::start(FileForHasher* fileCache, int n, int* amountHashed)
 
          if (chunks.size() <= chunkNum) // The size of the file has increased during the read . . .
          {
-            QSharedPointer<Chunk> newChunk(new Chunk(this->currentFileCache, chunkNum, bytesReadChunk, hash));
+            QSharedPointer<Chunk> newChunk = Chunk::create(this->currentFileCache, chunkNum, bytesReadChunk, hash);
             this->currentFileCache->addChunk(newChunk);
+            newChunk->setVerifiedLeafHashes(leafHasher.getLeafSize(), leafHasher.getResult());
             this->currentFileCache->getCache()->onChunkHashKnown(newChunk);
          }
          else
          {
-            if (chunks[chunkNum]->getHash() != hash)
-            {
-               if (chunks[chunkNum]->hasHash())
-                  this->currentFileCache->getCache()->onChunkRemoved(chunks[chunkNum]); // To remove the chunk from the chunk index (TODO: find a more elegant way).
-
-               chunks[chunkNum]->setHash(hash);
-               chunks[chunkNum]->setKnownBytes(bytesReadChunk);
-
-               this->currentFileCache->getCache()->onChunkHashKnown(chunks[chunkNum]);
-            }
+            this->setChunkHash(chunks[chunkNum], hash, bytesReadChunk, leafHasher.getResult());
          }
 
          if (--n == 0)
@@ -208,6 +498,7 @@ bool FileHasher::start(FileForHasher* fileCache, int n, int* amountHashed)
       }
 
       hasher.reset();
+      leafHasher.reset();
       chunkNum += 1;
    }
 
@@ -251,6 +542,62 @@ bool FileHasher::start(FileForHasher* fileCache, int n, int* amountHashed)
    return true;
 }
 
+/**
+  * Hash the chunks from 'firstChunkNum' to 'endChunkNum' (excluded) with 'number_of_hashing_threads_per_file' threads.
+  * The chunks must be full and their hash are set as soon as they are computed.
+  * @param[out] failed Set to true if a chunk couldn't be read, the remaining chunks must be hashed sequentially.
+  * @return The amount of bytes hashed.
+  */
+qint64 FileHasher::computeChunksInParallel(const QString& filePath, const QVector<QSharedPointer<Chunk>>& chunks, int firstChunkNum, int endChunkNum, bool& failed)
+{
+   static const int NUMBER_OF_HASHING_THREADS_PER_FILE = SETTINGS.get<quint32>("number_of_hashing_threads_per_file");
+
+   L_DEBU(QString("Hashing the chunks %1 to %2 of %3 concurrently").arg(firstChunkNum).arg(endChunkNum - 1).arg(filePath));
+
+   QAtomicInt nextChunkNum(firstChunkNum);
+
+   QList<ChunkHashingThread*> threads;
+   for (int i = 0; i < qMin(NUMBER_OF_HASHING_THREADS_PER_FILE, endChunkNum - firstChunkNum); i++)
+   {
+      ChunkHashingThread* thread = new ChunkHashingThread(*this, filePath, chunks, nextChunkNum, endChunkNum);
+      thread->start();
+      threads << thread;
+   }
+
+   qint64 amountHashed = 0;
+   foreach (ChunkHashingThread* thread, threads)
+   {
+      thread->wait();
+      amountHashed += thread->getAmountHashed();
+      failed |= thread->hasFailed();
+      delete thread;
+   }
+
+   return amountHashed;
+}
+
+/**
+  * Set the computed hash of a chunk and publish it, see 'Cache::onChunkHashKnown(..)'.
+  * 'hashingMutex' must be locked.
+  */
+void FileHasher::setChunkHash(const QSharedPointer<Chunk>& chunk, const Common::Hash& hash, int knownBytes, const QVector<Common::Hash>& leafHashes)
+{
+   // Set before the publication to be sent with the chunk hash, see 'GetHashesResult'.
+   if (!leafHashes.isEmpty())
+      chunk->setVerifiedLeafHashes(Global::getLeafSize(), leafHashes);
+
+   if (chunk->getHash() != hash)
+   {
+      if (chunk->hasHash())
+         this->currentFileCache->getCache()->onChunkRemoved(chunk); // To remove the chunk from the chunk index (TODO: find a more elegant way).
+
+      chunk->setHash(hash);
+      chunk->setKnownBytes(knownBytes);
+
+      this->currentFileCache->getCache()->onChunkHashKnown(chunk);
+   }
+}
+
 void FileHasher::stop()
 {
    QMutexLocker locker(&this->hashingMutex);
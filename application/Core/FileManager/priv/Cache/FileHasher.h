@@ -22,14 +22,20 @@
 #include <QObject>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QThread>
+#include <QAtomicInt>
+#include <QVector>
+#include <QSharedPointer>
 
 #include <Common/Uncopyable.h>
+#include <Common/Hash.h>
 
 #include <priv/Cache/FilePool.h>
 
 namespace FM
 {
    class Entry;
+   class Chunk;
    class FileForHasher;
 
    class FileHasher : public QObject, Common::Uncopyable
@@ -45,6 +51,12 @@ namespace FM
       void entryRemoved(Entry* entry);
 
    private:
+      class ChunkHashingThread;
+      class ReadAheadThread;
+
+      qint64 computeChunksInParallel(const QString& filePath, const QVector<QSharedPointer<Chunk>>& chunks, int firstChunkNum, int endChunkNum, bool& failed);
+      void setChunkHash(const QSharedPointer<Chunk>& chunk, const Common::Hash& hash, int knownBytes, const QVector<Common::Hash>& leafHashes);
+
       void internalStop();
 
       FileForHasher* currentFileCache;
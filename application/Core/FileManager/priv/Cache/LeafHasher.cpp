@@ -0,0 +1,91 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/Cache/LeafHasher.h>
+using namespace FM;
+
+#include <priv/Global.h>
+
+/**
+  * @class FM::LeafHasher
+  *
+  * Compute the hashes of the consecutive leaves of a chunk, the last leaf may be smaller than the others.
+  * With these hashes a corrupted download can be detected before the end of the chunk and only the corrupted leaf has to be downloaded again.
+  * The leaves are hashed with the same algorithm as the chunks, see 'Global::getHashAlgorithm()'.
+  * A leaf size of 0 disables the hashing, 'getResult()' returns then no hash.
+  */
+
+LeafHasher::LeafHasher(int leafSize) :
+   leafSize(leafSize), hasher(Global::getHashAlgorithm()), currentLeafBytes(0)
+{
+}
+
+int LeafHasher::getLeafSize() const
+{
+   return this->leafSize;
+}
+
+void LeafHasher::addData(const char* data, int size)
+{
+   if (this->leafSize <= 0)
+      return;
+
+   while (size > 0)
+   {
+      const int n = qMin(size, this->leafSize - this->currentLeafBytes);
+      this->hasher.addData(data, n);
+      this->currentLeafBytes += n;
+      data += n;
+      size -= n;
+
+      if (this->currentLeafBytes == this->leafSize)
+      {
+         this->hashes << this->hasher.getResult();
+         this->hasher.reset();
+         this->currentLeafBytes = 0;
+      }
+   }
+}
+
+/**
+  * Return the hashes of all the leaves added since the last reset, including the last incomplete one.
+  */
+QVector<Common::Hash> LeafHasher::getResult()
+{
+   QVector<Common::Hash> result = this->hashes;
+   if (this->currentLeafBytes > 0)
+      result << this->hasher.getResult();
+   return result;
+}
+
+void LeafHasher::reset()
+{
+   this->hasher.reset();
+   this->currentLeafBytes = 0;
+   this->hashes.clear();
+}
+
+/**
+  * Return the number of leaves of a chunk of 'chunkSize' bytes, 0 if the leaves are disabled.
+  */
+int LeafHasher::getNbLeaves(int chunkSize, int leafSize)
+{
+   if (leafSize <= 0)
+      return 0;
+   return (chunkSize + leafSize - 1) / leafSize;
+}
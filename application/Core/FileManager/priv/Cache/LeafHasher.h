@@ -0,0 +1,50 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_LEAFHASHER_H
+#define FILEMANAGER_LEAFHASHER_H
+
+#include <QVector>
+
+#include <Common/Uncopyable.h>
+#include <Common/Hash.h>
+
+namespace FM
+{
+   class LeafHasher : Common::Uncopyable
+   {
+   public:
+      LeafHasher(int leafSize);
+
+      int getLeafSize() const;
+
+      void addData(const char* data, int size);
+      QVector<Common::Hash> getResult();
+      void reset();
+
+      static int getNbLeaves(int chunkSize, int leafSize);
+
+   private:
+      const int leafSize;
+      Common::Hasher hasher;
+      int currentLeafBytes;
+      QVector<Common::Hash> hashes;
+   };
+}
+
+#endif
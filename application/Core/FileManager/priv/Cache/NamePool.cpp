@@ -0,0 +1,78 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#include <priv/Cache/NamePool.h>
+using namespace FM;
+
+#include <QMutexLocker>
+
+/**
+  * @class FM::NamePool
+  *
+  * The names of the entries are interned: the entries having the same name, like "cover.jpg" or "src",
+  * share the same string data. The case-folded sort keys are interned too, a name already in lower case
+  * and its sort key are a single string, see 'Entry::setName(..)'.
+  * This class is thread safe.
+  */
+
+/**
+  * Return the interned copy of the given name.
+  */
+QString NamePool::get(const QString& name)
+{
+   QMutexLocker locker(&this->mutex);
+
+   QSet<QString>::const_iterator i = this->names.constFind(name);
+   if (i != this->names.constEnd())
+      return *i;
+
+   QString internedName = name;
+   internedName.squeeze(); // The given name may come with some extra capacity.
+   this->names.insert(internedName);
+   return internedName;
+}
+
+/**
+  * Remove the names which aren't used by any entry anymore.
+  * @return The number of removed names.
+  */
+int NamePool::squeeze()
+{
+   QMutexLocker locker(&this->mutex);
+
+   int nbRemoved = 0;
+   for (QSet<QString>::iterator i = this->names.begin(); i != this->names.end();)
+   {
+      if (i->isDetached()) // Only referenced by the pool.
+      {
+         i = this->names.erase(i);
+         nbRemoved++;
+      }
+      else
+         ++i;
+   }
+
+   return nbRemoved;
+}
+
+int NamePool::size() const
+{
+   QMutexLocker locker(&this->mutex);
+   return this->names.size();
+}
@@ -25,6 +25,7 @@ using namespace FM;
 #include <Common/Global.h>
 
 #include <Exceptions.h>
+#include <priv/Global.h>
 #include <priv/Log.h>
 #include <priv/Exceptions.h>
 #include <priv/Cache/Cache.h>
@@ -102,6 +103,8 @@ void SharedDirectory::init()
       Directory::del(false);
       throw SuperDirectoryExistsException(dir->getFullPath(), this->getFullPath());
    }
+
+   this->deviceId = Global::getDeviceId(this->getFullPath());
 }
 
 SharedDirectory::~SharedDirectory()
@@ -130,6 +133,7 @@ void SharedDirectory::moveInto(Directory* directory)
 void SharedDirectory::moveInto(const QString& path)
 {
    this->path = Common::Global::cleanDirPath(path);
+   Directory::invalidateCachedPaths();
 }
 
 QString SharedDirectory::getPath() const
@@ -152,6 +156,14 @@ Common::Hash SharedDirectory::getId() const
    return this->id;
 }
 
+/**
+  * The device isn't read again by 'moveInto(const QString&)': a directory can't be renamed to another device.
+  */
+const QString& SharedDirectory::getDeviceId() const
+{
+   return this->deviceId;
+}
+
 /**
   * Special for Windows root:
   * name of "C:\" is "C:".
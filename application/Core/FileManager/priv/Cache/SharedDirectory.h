@@ -66,12 +66,15 @@ namespace FM
 
       Common::Hash getId() const;
 
+      const QString& getDeviceId() const;
+
    private:
       static QString dirName(const QString& path);
       QString pathWithoutDirName(const QString& path);
 
       QString path; // Always ended by a slash '/'.
       Common::Hash id;
+      QString deviceId; ///< Read once in 'init()', see 'Global::getDeviceId(..)'.
    };
 }
 #endif
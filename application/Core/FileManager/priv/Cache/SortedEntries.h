@@ -0,0 +1,180 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#ifndef FILEMANAGER_SORTEDENTRIES_H
+#define FILEMANAGER_SORTEDENTRIES_H
+
+#include <QString>
+#include <QVector>
+#include <QLinkedList>
+
+namespace FM
+{
+   /**
+     * The files or the sub-directories of a directory, sorted by their sort key ('Entry::getSortKey()').
+     * Kept in a vector to find an entry by its name with a binary search, the lists cost one pointer by entry.
+     * The same entry can't be inserted twice, two entries may have the same sort key.
+     * Don't forget to call 'itemChanged(..)' when the name of an entry changes.
+     * This class isn't thread safe, it's protected by the mutex of its directory.
+     */
+   template <typename T>
+   class SortedEntries
+   {
+   public:
+      void insert(T* entry);
+
+      template <typename Container>
+      void insert(const Container& entries);
+
+      void itemChanged(T* entry);
+      void removeOne(T* entry);
+      void clear();
+
+      T* find(const QString& name) const;
+
+      inline bool isEmpty() const { return this->entries.isEmpty(); }
+      inline const QVector<T*>& getVector() const { return this->entries; }
+      QLinkedList<T*> toLinkedList() const;
+
+   private:
+      int lowerBound(const QString& sortKey) const;
+      int upperBound(const QString& sortKey) const;
+      int indexOf(const T* entry) const;
+
+      QVector<T*> entries;
+   };
+}
+
+/**
+  * The entry is put after the entries having the same sort key.
+  */
+template <typename T>
+void FM::SortedEntries<T>::insert(T* entry)
+{
+   if (this->indexOf(entry) != -1)
+      return;
+
+   this->entries.insert(this->upperBound(entry->getSortKey()), entry);
+}
+
+template <typename T>
+template <typename Container>
+void FM::SortedEntries<T>::insert(const Container& entries)
+{
+   foreach (T* entry, entries)
+      this->insert(entry);
+}
+
+template <typename T>
+void FM::SortedEntries<T>::itemChanged(T* entry)
+{
+   const int i = this->entries.indexOf(entry); // The position of the entry isn't valid anymore, its sort key has changed.
+   if (i == -1)
+      return;
+
+   this->entries.remove(i);
+   this->entries.insert(this->upperBound(entry->getSortKey()), entry);
+}
+
+template <typename T>
+void FM::SortedEntries<T>::removeOne(T* entry)
+{
+   int i = this->indexOf(entry);
+   if (i == -1)
+      i = this->entries.indexOf(entry); // In case of its name has been changed without calling 'itemChanged(..)'.
+
+   if (i != -1)
+      this->entries.remove(i);
+}
+
+template <typename T>
+void FM::SortedEntries<T>::clear()
+{
+   this->entries.clear();
+}
+
+/**
+  * Return the entry having exactly the given name, 'nullptr' if there is none.
+  */
+template <typename T>
+T* FM::SortedEntries<T>::find(const QString& name) const
+{
+   const QString sortKey = name.toLower();
+   for (int i = this->lowerBound(sortKey); i < this->entries.size() && this->entries[i]->getSortKey() == sortKey; i++)
+      if (this->entries[i]->getName() == name)
+         return this->entries[i];
+
+   return nullptr;
+}
+
+template <typename T>
+QLinkedList<T*> FM::SortedEntries<T>::toLinkedList() const
+{
+   QLinkedList<T*> list;
+   foreach (T* entry, this->entries)
+      list << entry;
+   return list;
+}
+
+template <typename T>
+int FM::SortedEntries<T>::lowerBound(const QString& sortKey) const
+{
+   int begin = 0;
+   int end = this->entries.size();
+   while (begin < end)
+   {
+      const int middle = (begin + end) / 2;
+      if (this->entries[middle]->getSortKey() < sortKey)
+         begin = middle + 1;
+      else
+         end = middle;
+   }
+   return begin;
+}
+
+template <typename T>
+int FM::SortedEntries<T>::upperBound(const QString& sortKey) const
+{
+   int begin = 0;
+   int end = this->entries.size();
+   while (begin < end)
+   {
+      const int middle = (begin + end) / 2;
+      if (sortKey < this->entries[middle]->getSortKey())
+         end = middle;
+      else
+         begin = middle + 1;
+   }
+   return begin;
+}
+
+/**
+  * Find the position of an entry among the entries having its sort key.
+  */
+template <typename T>
+int FM::SortedEntries<T>::indexOf(const T* entry) const
+{
+   for (int i = this->lowerBound(entry->getSortKey()); i < this->entries.size() && this->entries[i]->getSortKey() == entry->getSortKey(); i++)
+      if (this->entries[i] == entry)
+         return i;
+
+   return -1;
+}
+
+#endif
@@ -19,6 +19,10 @@
 #include <priv/ChunkIndex/Chunks.h>
 using namespace FM;
 
+#include <algorithm>
+
+#include <QVarLengthArray>
+
 #include <priv/Cache/Chunk.h>
 #include <priv/Log.h>
 
@@ -29,40 +33,65 @@ using namespace FM;
   * - Add identical files 'a' and 'b'.
   * - remove 'a'. 'b' wouldn't be remove from Chunks at the same time.
   *
-  * We may use a Bloom filter to reduce the time of a call to 'contains(..)', 'value(..)' and 'values(..)'.
-  * Some measurements (compiled with GCC 4.6 and -02):
-  *  - The filter reduces the call time of 'contains()' from about 20% with 30'000 hashes
-  *    and about 15% with 100'000 hashes.
-  *  - The filter increases the call time of 'contains()' from about 100% with 1'000'000 hashes.
-  *  - 100'000'000 calls of 'contains(..)' for 100'000 known chunks takes 3.6s on a i5 @ 2.5 GHz.
-  *    It's 36 ns per call.
-  * See the method 'chunksPerformance()' in 'TestsFileManager' for more information.
+  * The hashes are distributed among 'NB_SHARDS' shards by their first byte, each shard has its own read/write lock.
+  * Thus the lookups (IMAlive from all the peers) don't wait for each other and rarely wait for an insertion.
+  *
+  * Each shard has a blocked Bloom filter to answer quickly for the unknown hashes, which are the common case.
+  * A Bloom filter can't remove a hash: the filter is rebuilt when the number of removed hashes exceeds the number of
+  * remaining hashes and it is resized when the number of hashes exceeds its capacity.
+  *
+  * See the methods 'chunksPerformance()' and 'chunksContainsMany()' in 'TestsFileManager' for more information.
   */
 
+Chunks::Shard::Shard() :
+   nbRemovedSinceRebuild(0)
+{
+}
+
+/**
+  * The write lock must be held.
+  */
+void Chunks::Shard::rebuildFilter(int capacity)
+{
+   this->filter.reset(capacity);
+   for (auto i = this->chunks.constBegin(); i != this->chunks.constEnd(); ++i)
+      this->filter.add(i.key());
+   this->nbRemovedSinceRebuild = 0;
+}
+
+inline int Chunks::shardNum(const Common::Hash& hash)
+{
+   return static_cast<uchar>(hash.getData()[0]) % NB_SHARDS;
+}
+
 void Chunks::add(const QSharedPointer<Chunk>& chunk)
 {
-   if (chunk->getHash().isNull())
+   const Common::Hash hash = chunk->getHash();
+   if (hash.isNull())
       return;
 
-   QMutexLocker locker(&this->mutex);
-   this->insert(chunk->getHash(), chunk);
-#ifdef BLOOM_FILTER_ON
-   this->bloomFilter.add(chunk->getHash());
-#endif
+   Shard& shard = this->shards[shardNum(hash)];
+   QWriteLocker locker(&shard.lock);
+
+   shard.chunks.insert(hash, chunk);
+
+   if (shard.chunks.size() > shard.filter.getCapacity())
+      shard.rebuildFilter(2 * shard.chunks.size());
+   else
+      shard.filter.add(hash);
 }
 
 void Chunks::rm(const QSharedPointer<Chunk>& chunk)
 {
-   if (chunk->getHash().isNull())
+   const Common::Hash hash = chunk->getHash();
+   if (hash.isNull())
       return;
 
-   QMutexLocker locker(&this->mutex);
-   this->remove(chunk->getHash(), chunk);
-#ifdef BLOOM_FILTER_ON
-   if (this->isEmpty())
-      this->bloomFilter.reset();
-#endif
-   // L_DEBU(QString("Nb chunks: %1").arg(this->size()));
+   Shard& shard = this->shards[shardNum(hash)];
+   QWriteLocker locker(&shard.lock);
+
+   if (shard.chunks.remove(hash, chunk) > 0 && ++shard.nbRemovedSinceRebuild > shard.chunks.size())
+      shard.rebuildFilter(2 * shard.chunks.size());
 }
 
 QSharedPointer<Chunk> Chunks::value(const Common::Hash& hash) const
@@ -70,12 +99,13 @@ QSharedPointer<Chunk> Chunks::value(const Common::Hash& hash) const
    if (hash.isNull())
       return QSharedPointer<Chunk>();
 
-   QMutexLocker locker(&this->mutex);
-#ifdef BLOOM_FILTER_ON
-   if (!this->bloomFilter.test(hash))
+   const Shard& shard = this->shards[shardNum(hash)];
+   QReadLocker locker(&shard.lock);
+
+   if (!shard.filter.test(hash))
       return QSharedPointer<Chunk>();
-#endif
-   return QMultiHash<Common::Hash, QSharedPointer<Chunk>>::value(hash);
+
+   return shard.chunks.value(hash);
 }
 
 QList<QSharedPointer<Chunk>> Chunks::values(const Common::Hash& hash) const
@@ -83,12 +113,13 @@ QList<QSharedPointer<Chunk>> Chunks::values(const Common::Hash& hash) const
    if (hash.isNull())
       return QList<QSharedPointer<Chunk>>();
 
-   QMutexLocker locker(&this->mutex);
-#ifdef BLOOM_FILTER_ON
-   if (!this->bloomFilter.test(hash))
+   const Shard& shard = this->shards[shardNum(hash)];
+   QReadLocker locker(&shard.lock);
+
+   if (!shard.filter.test(hash))
       return QList<QSharedPointer<Chunk>>();
-#endif
-   return QMultiHash<Common::Hash, QSharedPointer<Chunk>>::values(hash);
+
+   return shard.chunks.values(hash);
 }
 
 bool Chunks::contains(const Common::Hash& hash) const
@@ -96,10 +127,56 @@ bool Chunks::contains(const Common::Hash& hash) const
    if (hash.isNull())
       return false;
 
-   QMutexLocker locker(&this->mutex);   
-#ifdef BLOOM_FILTER_ON
-   if (!this->bloomFilter.test(hash))
-      return false;
-#endif
-   return QMultiHash<Common::Hash, QSharedPointer<Chunk>>::contains(hash);
+   const Shard& shard = this->shards[shardNum(hash)];
+   QReadLocker locker(&shard.lock);
+
+   return shard.filter.test(hash) && shard.chunks.contains(hash);
+}
+
+/**
+  * Same as calling 'contains(..)' for each hash but each shard is locked only once.
+  * @return The bit 'i' is set if 'hashes[i]' is known. The array has always the same size as 'hashes'.
+  */
+QBitArray Chunks::containsMany(const QVector<Common::Hash>& hashes) const
+{
+   QBitArray result(hashes.size());
+
+   // The indexes of the hashes sorted by shard.
+   QVarLengthArray<int, 256> indexes;
+   indexes.reserve(hashes.size());
+   for (int i = 0; i < hashes.size(); i++)
+      if (!hashes[i].isNull())
+         indexes.append(i);
+
+   std::sort(indexes.begin(), indexes.end(), [&](int i1, int i2) { return shardNum(hashes[i1]) < shardNum(hashes[i2]); });
+
+   for (int i = 0; i < indexes.size();)
+   {
+      const int currentShardNum = shardNum(hashes[indexes[i]]);
+      const Shard& shard = this->shards[currentShardNum];
+      QReadLocker locker(&shard.lock);
+
+      for (; i < indexes.size() && shardNum(hashes[indexes[i]]) == currentShardNum; i++)
+      {
+         const Common::Hash& hash = hashes[indexes[i]];
+         if (shard.filter.test(hash) && shard.chunks.contains(hash))
+            result.setBit(indexes[i]);
+      }
+   }
+
+   return result;
+}
+
+/**
+  * The number of indexed chunks.
+  */
+int Chunks::size() const
+{
+   int size = 0;
+   for (int i = 0; i < NB_SHARDS; i++)
+   {
+      QReadLocker locker(&this->shards[i].lock);
+      size += this->shards[i].chunks.size();
+   }
+   return size;
 }
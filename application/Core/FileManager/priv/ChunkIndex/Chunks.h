@@ -19,39 +19,50 @@
 #ifndef FILEMANAGER_CHUNKS_H
 #define FILEMANAGER_CHUNKS_H
 
-// Uncomment this directive to enable the Bloom filter.
-// It will speed up the call to the methods 'value(..)', 'values(..)' and 'contains(..)' by 15% for less than 100'000 chunks in memory
-// but slow down by 100% for more than 1'000'000 chunks in memory, this is why it is disable by default.
-// #define BLOOM_FILTER_ON
-
 #include <QHash>
+#include <QList>
+#include <QVector>
+#include <QBitArray>
 #include <QSharedPointer>
-#include <QMutex>
+#include <QReadWriteLock>
 
 #include <Common/Hash.h>
-#ifdef BLOOM_FILTER_ON
-   #include <Common/BloomFilter.h>
-#endif
+#include <Common/BlockedBloomFilter.h>
+#include <Common/Uncopyable.h>
 
 namespace FM
 {
    class Chunk;
 
-   class Chunks : private QMultiHash<Common::Hash, QSharedPointer<Chunk>>
+   class Chunks : Common::Uncopyable
    {
    public:
+      static const int NB_SHARDS = 64;
+
       void add(const QSharedPointer<Chunk>& chunk);
       void rm(const QSharedPointer<Chunk>& chunk);
       QSharedPointer<Chunk> value(const Common::Hash& hash) const;
       QList<QSharedPointer<Chunk>> values(const Common::Hash& hash) const;
       bool contains(const Common::Hash& hash) const;
+      QBitArray containsMany(const QVector<Common::Hash>& hashes) const;
+      int size() const;
 
    private:
-      mutable QMutex mutex; // From the documentation : "they (containers) are thread-safe in situations where they are used as read-only containers by all threads used to access them.".
+      struct Shard
+      {
+         Shard();
 
-#ifdef BLOOM_FILTER_ON
-      BloomFilter bloomFilter;
-#endif
+         void rebuildFilter(int capacity);
+
+         mutable QReadWriteLock lock;
+         QMultiHash<Common::Hash, QSharedPointer<Chunk>> chunks;
+         Common::BlockedBloomFilter filter; // Contains all the hashes of 'chunks' and the removed ones since the last rebuild.
+         int nbRemovedSinceRebuild;
+      };
+
+      static inline int shardNum(const Common::Hash& hash);
+
+      Shard shards[NB_SHARDS];
    };
 }
 #endif
@@ -25,6 +25,8 @@ namespace FM
       QList<T> search(const QString& extension, int limit = std::numeric_limits<int>::max(), std::function<bool(const T&)> predicat = nullptr) const;
       QList<T> search(const QList<QString>& extensions, int limit = std::numeric_limits<int>::max(), std::function<bool(const T&)> predicat = nullptr) const;
 
+      int count(const QList<QString>& extensions) const;
+
    private:
       QHash<QString, QSet<T>> index;
       mutable QMutex mutex;
@@ -113,4 +115,22 @@ QList<T> FM::ExtensionIndex<T>::search(const QList<QString>& extensions, int lim
    return result;
 }
 
+/**
+  * Return the number of items 'search(extensions)' would return, in O(number of extensions).
+  */
+template<typename T>
+int FM::ExtensionIndex<T>::count(const QList<QString>& extensions) const
+{
+   QMutexLocker locker(&this->mutex);
+
+   int n = 0;
+   for (QListIterator<QString> i(extensions); i.hasNext();)
+   {
+      auto setIterator = this->index.find(i.next().toLower());
+      if (setIterator != this->index.constEnd())
+         n += setIterator->count();
+   }
+   return n;
+}
+
 #endif
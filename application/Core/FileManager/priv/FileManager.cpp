@@ -25,6 +25,7 @@ using namespace FM;
 #include <QStringList>
 #include <QStringBuilder>
 #include <QList>
+#include <QSet>
 #include <QVector>
 #include <QDir>
 #include <QMutableListIterator>
@@ -39,22 +40,30 @@ using namespace FM;
 #include <Common/Constants.h>
 #include <Common/Global.h>
 #include <Common/StringUtils.h>
+#include <Common/ProtoHelper.h>
 #include <Exceptions.h>
 #include <priv/Global.h>
 #include <priv/Constants.h>
 #include <priv/GetHashesResult.h>
 #include <priv/GetEntriesResult.h>
+#include <priv/FindResultEncoder.h>
 #include <priv/Cache/Entry.h>
 #include <priv/Cache/File.h>
 #include <priv/Cache/Directory.h>
 #include <priv/Cache/SharedDirectory.h>
 #include <priv/Cache/Chunk.h>
+#include <priv/Cache/CacheIndex.h>
 
 LOG_INIT_CPP(FileManager)
 
 FileManager::FileManager() :
    fileUpdater(this),
    cache(),
+   infixSearch(SETTINGS.get<bool>("enable_infix_search")),
+   trigramIndex([](Entry* const& entry) { return entry->getName(); }),
+   searchCache(SETTINGS.get<quint32>("search_cache_size")),
+   cacheJournalMaxSize(SETTINGS.get<quint32>("cache_journal_max_size")),
+   fastCacheLoading(SETTINGS.get<bool>("fast_cache_loading")),
    mutexPersistCache(QMutex::Recursive),
    cacheLoading(true),
    cacheChanged(false)
@@ -88,6 +97,7 @@ FileManager::~FileManager()
    this->fileUpdater.stop();
    this->cacheChanged = true;
    this->forcePersistCacheToFile();
+   this->cacheSnapshotWriter.wait();
    this->timerPersistCache.stop();
    this->cache.disconnect(this);
    L_DEBU("FileManager deleted");
@@ -192,104 +202,52 @@ Protos::Common::Entries FileManager::getEntries()
 
 QList<Protos::Common::FindResult> FileManager::find(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize)
 {
-   bool filterBySizeOn = minFileSize > 0 || maxFileSize != std::numeric_limits<qint64>::max();
-   bool filterByExtensionsOn = !extensions.isEmpty();
-   bool filterByCategoryOn = category != Protos::Common::FindPattern::FILE_DIR;
-   bool filterOn = filterBySizeOn || filterByExtensionsOn || filterByCategoryOn;
-
-   QList<NodeResult<Entry*>> result;
+   QList<Protos::Common::FindResult> findResults;
+   QVector<int> freeSpaces;
+   const int capacity = FindResultEncoder::getCapacity(maxSize);
 
-   if (!words.isEmpty())
-   {
-      result = !filterOn ?
-         this->wordIndex.search(Common::StringUtils::splitInWords(words), maxNbResult) :
-         this->wordIndex.search(Common::StringUtils::splitInWords(words), maxNbResult, [&](const Entry* entry) {
-            return (!filterBySizeOn || entry->getSize() >= minFileSize && entry->getSize() <= maxFileSize) &&
-                   (!filterByExtensionsOn || extensions.contains(entry->getExtension())) &&
-                   (!filterByCategoryOn || (category == Protos::Common::FindPattern::FILE && dynamic_cast<const File*>(entry) || category == Protos::Common::FindPattern::DIR && dynamic_cast<const Directory*>(entry)));
-         });
-   }
-   else if (filterBySizeOn || filterByExtensionsOn)
+   // The entries are packed as the ones sent to the other peers, see 'searchEncoded(..)'.
+   const QList<NodeResult<Entry*>>& result = this->search(words, extensions, minFileSize, maxFileSize, category, maxNbResult);
+   for (QListIterator<NodeResult<Entry*>> i(result); i.hasNext();)
    {
-      QList<Entry*> intermediateResult;
+      Protos::Common::FindResult::EntryLevel entryLevel;
+      populateEntryLevel(entryLevel, i.next());
 
-      if (!extensions.isEmpty())
+      const int j = FindResultEncoder::firstFit(freeSpaces, capacity, FindResultEncoder::getEncodedSize(entryLevel));
+      if (j == -1)
       {
-         if (filterBySizeOn || filterByCategoryOn)
-            intermediateResult = this->extensionIndex.search(extensions, maxNbResult, [&](const Entry* entry) {
-               return (!filterBySizeOn || entry->getSize() >= minFileSize && entry->getSize() <= maxFileSize) && (!filterByCategoryOn || (category == Protos::Common::FindPattern::FILE && dynamic_cast<const File*>(entry) || category == Protos::Common::FindPattern::DIR && dynamic_cast<const Directory*>(entry)));
-            });
-         else
-            intermediateResult = this->extensionIndex.search(extensions, maxNbResult);
+         L_WARN(QString("The entry '%1' is too big to be sent as a search result").arg(Common::ProtoHelper::getStr(entryLevel.entry(), &Protos::Common::Entry::name)));
+         continue;
       }
-      else
+
+      if (j == findResults.size())
       {
-         if (filterByCategoryOn)
-            intermediateResult = this->sizeIndex.search(minFileSize, maxFileSize, maxNbResult, [&](const Entry* entry) {
-               return category == Protos::Common::FindPattern::FILE && dynamic_cast<const File*>(entry) || category == Protos::Common::FindPattern::DIR && dynamic_cast<const Directory*>(entry);
-            });
-         else
-            intermediateResult = this->sizeIndex.search(minFileSize, maxFileSize, maxNbResult);
+         findResults << Protos::Common::FindResult();
+         findResults.last().set_tag(std::numeric_limits<quint64>::max());
       }
 
-      for (QListIterator<Entry*> i(intermediateResult); i.hasNext();)
-         result << NodeResult<Entry*>(i.next());
+      findResults[j].add_entry()->Swap(&entryLevel);
    }
 
-   QList<Protos::Common::FindResult> findResults;
-   findResults << Protos::Common::FindResult();
-   findResults.last().set_tag(std::numeric_limits<quint64>::max()); // Worst case to compute the size (int fields have a variable size).
-
-   const int EMPTY_FIND_RESULT_SIZE = findResults.last().ByteSize();
-   int findResultCurrentSize = EMPTY_FIND_RESULT_SIZE; // [Byte].
-
-   for (QListIterator<NodeResult<Entry*>> i(result); i.hasNext();)
-   {
-      const NodeResult<Entry*>& entry = i.next();
-      Protos::Common::FindResult::EntryLevel* entryLevel = findResults.last().add_entry();
-      entryLevel->set_level(entry.level);
-
-      File* file = dynamic_cast<File*>(entry.value);
-      if (file)
-         file->populateEntry(entryLevel->mutable_entry(), true, NB_MAX_HASHES_PER_ENTRY_SEARCH);
-      else
-         entry.value->populateEntry(entryLevel->mutable_entry(), true);
-
-      // We wouldn't use 'findResults.last().ByteSize()' because is too slow. Instead we call 'ByteSize()' for each entry and sum it.
-      const int entryByteSize = entryLevel->ByteSize() + 8; // Each entry take a bit of memory overhead . . . (Value found in an empiric way . . .).
-      findResultCurrentSize += entryByteSize;
+   return findResults;
+}
 
-      if (findResultCurrentSize > maxSize)
-      {
-         google::protobuf::RepeatedPtrField<Protos::Common::FindResult::EntryLevel>* entries = findResults.last().mutable_entry();
-         findResults << Protos::Common::FindResult();
-         if (entries->size() > 0)
-         {
-            findResults.last().add_entry()->CopyFrom(entries->Get(entries->size()-1));
-            entries->RemoveLast();
-         }
-         findResultCurrentSize = EMPTY_FIND_RESULT_SIZE + entryByteSize;
-      }
-   }
+QList<QByteArray> FileManager::findEncoded(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize, quint64 tag)
+{
+   QList<QByteArray> findResults;
 
-   if (findResults.last().entry_size() == 0)
-      findResults.removeLast();
+   const QList<QByteArray>& payloads = this->searchEncoded(words, extensions, minFileSize, maxFileSize, category, maxNbResult, maxSize);
+   for (QListIterator<QByteArray> i(payloads); i.hasNext();)
+      findResults << FindResultEncoder::withTag(i.next(), tag);
 
    return findResults;
 }
 
-QBitArray FileManager::haveChunks(const QList<Common::Hash>& hashes)
+QBitArray FileManager::haveChunks(const QVector<Common::Hash>& hashes)
 {
-   QBitArray result(hashes.size()); // All bits to 0 by default.
-   bool ownsAtLeastOneChunk = false;
-   for (int i = 0; i < hashes.size(); i++)
-      if (this->chunks.contains(hashes[i]))
-      {
-         result.setBit(i, true);
-         ownsAtLeastOneChunk = true;
-      }
+   const QBitArray& result = this->chunks.containsMany(hashes);
 
-   if (!ownsAtLeastOneChunk)
+   if (result.count(true) == 0)
       return QBitArray();
 
    return result;
@@ -319,6 +277,16 @@ int FileManager::getProgress() const
    return this->fileUpdater.getProgress();
 }
 
+IFileManager::SearchCacheStats FileManager::getSearchCacheStats() const
+{
+   return this->searchCache.getStats();
+}
+
+IFileManager::FileEventStats FileManager::getFileEventStats() const
+{
+   return this->fileUpdater.getFileEventStats();
+}
+
 void FileManager::dumpWordIndex() const
 {
    L_WARN(this->wordIndex.toStringLog());
@@ -376,6 +344,136 @@ Entry* FileManager::getEntry(const QString& path)
    return this->cache.getEntry(path);
 }
 
+/**
+  * Return the serialized results, without their tag (see 'FindResultEncoder'). They are cached until an entry changes.
+  */
+QList<QByteArray> FileManager::searchEncoded(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize)
+{
+   // Only the words are normalized, the order of the extensions matters when the number of results is limited.
+   const QString wordsKey = words.isEmpty() ? QString() : QString("#") + Common::StringUtils::splitInWords(words).join(' '); // '#' to distinguish blank words from no words.
+   const QString key =
+      wordsKey % '|' % QStringList(extensions).join('/') % '|' %
+      QString::number(minFileSize) % '|' % QString::number(maxFileSize) % '|' %
+      QString::number(category) % '|' % QString::number(maxNbResult) % '|' % QString::number(maxSize);
+
+   QList<QByteArray> payloads;
+   if (this->searchCache.get(key, payloads))
+      return payloads;
+
+   const int generation = this->searchCache.getGeneration();
+
+   FindResultEncoder encoder(maxSize);
+   Protos::Common::FindResult::EntryLevel entryLevel; // Reused to keep its allocated memory.
+
+   const QList<NodeResult<Entry*>>& result = this->search(words, extensions, minFileSize, maxFileSize, category, maxNbResult);
+   for (QListIterator<NodeResult<Entry*>> i(result); i.hasNext();)
+   {
+      entryLevel.Clear();
+      populateEntryLevel(entryLevel, i.next());
+      if (!encoder.add(entryLevel))
+         L_WARN(QString("The entry '%1' is too big to be sent as a search result").arg(Common::ProtoHelper::getStr(entryLevel.entry(), &Protos::Common::Entry::name)));
+   }
+
+   payloads = encoder.takePayloads();
+   this->searchCache.insert(key, payloads, generation);
+   return payloads;
+}
+
+/**
+  * Return the entries matching the given criteria, sorted by level.
+  */
+QList<NodeResult<Entry*>> FileManager::search(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult)
+{
+   const bool filterBySizeOn = minFileSize > 0 || maxFileSize != std::numeric_limits<qint64>::max();
+   const bool filterByExtensionsOn = !extensions.isEmpty();
+   const bool filterByCategoryOn = category != Protos::Common::FindPattern::FILE_DIR;
+   const Entry::Type entryType = category == Protos::Common::FindPattern::DIR ? Entry::Type::DIRECTORY : Entry::Type::FILE;
+
+   // Returns a predicate checking the criteria which aren't already ensured by the index the entries come from.
+   auto makeFilter = [&](bool checkSize, bool checkExtension) -> std::function<bool(Entry* const&)> {
+      checkSize &= filterBySizeOn;
+      checkExtension &= filterByExtensionsOn;
+      if (!checkSize && !checkExtension && !filterByCategoryOn)
+         return nullptr;
+
+      return [=, &extensions](const Entry* entry) {
+         return (!filterByCategoryOn || entry->getType() == entryType) &&
+                (!checkSize || entry->getSize() >= minFileSize && entry->getSize() <= maxFileSize) &&
+                (!checkExtension || extensions.contains(entry->getExtension()));
+      };
+   };
+
+   // The cardinality of each criterion is estimated to start with the most selective index.
+   const int nbEntriesByExtensions = filterByExtensionsOn ? this->extensionIndex.count(extensions) : std::numeric_limits<int>::max();
+   const int nbEntriesBySize = filterBySizeOn ? this->sizeIndex.estimateCount(minFileSize, maxFileSize) : std::numeric_limits<int>::max();
+   const bool sizeIndexFirst = nbEntriesBySize < nbEntriesByExtensions;
+
+   // The entries matching all the criteria except the words, taken from the most selective of 'extensionIndex' and 'sizeIndex'.
+   auto searchByExtensionsOrSize = [&](int limit) {
+      return sizeIndexFirst ?
+         this->sizeIndex.search(minFileSize, maxFileSize, limit, makeFilter(false, true)) :
+         this->extensionIndex.search(extensions, limit, makeFilter(true, false));
+   };
+
+   QList<NodeResult<Entry*>> result;
+
+   if (!words.isEmpty())
+   {
+      const QStringList& terms = Common::StringUtils::splitInWords(words);
+      const int nbEntriesMin = qMin(nbEntriesByExtensions, nbEntriesBySize);
+
+      // The word index gives the ranking, it is always used. If the other criteria are more selective than the words their entries
+      // are intersected with the ones of the word index instead of checking each criterion on each entry found by the words.
+      std::function<bool(Entry* const&)> filter = nullptr;
+      QSet<Entry*> candidates;
+      if (nbEntriesMin != std::numeric_limits<int>::max() && this->wordIndex.estimateCount(terms, nbEntriesMin + 1) > nbEntriesMin)
+      {
+         candidates = searchByExtensionsOrSize(std::numeric_limits<int>::max()).toSet();
+         if (candidates.isEmpty())
+            return result;
+         filter = [&](Entry* const& entry) { return candidates.contains(entry); };
+      }
+      else
+         filter = makeFilter(true, true);
+
+      result = this->wordIndex.search(terms, maxNbResult, filter);
+
+      // The names containing the terms anywhere (not only at the beginning of their words) come after.
+      if (this->infixSearch && result.size() < maxNbResult)
+      {
+         QSet<Entry*> entriesFound;
+         for (QListIterator<NodeResult<Entry*>> i(result); i.hasNext();)
+            entriesFound.insert(i.next().value);
+
+         const int infixLevel = result.isEmpty() ? 0 : result.last().level + 1;
+         const QList<Entry*>& infixResult = this->trigramIndex.search(terms, maxNbResult, filter);
+         for (QListIterator<Entry*> i(infixResult); i.hasNext() && result.size() < maxNbResult;)
+         {
+            Entry* entry = i.next();
+            if (!entriesFound.contains(entry))
+               result << NodeResult<Entry*>(entry, infixLevel);
+         }
+      }
+   }
+   else if (filterBySizeOn || filterByExtensionsOn)
+   {
+      for (QListIterator<Entry*> i(searchByExtensionsOrSize(maxNbResult)); i.hasNext();)
+         result << NodeResult<Entry*>(i.next());
+   }
+
+   return result;
+}
+
+void FileManager::populateEntryLevel(Protos::Common::FindResult::EntryLevel& entryLevel, const NodeResult<Entry*>& entry)
+{
+   entryLevel.set_level(entry.level);
+
+   if (entry.value->getType() == Entry::Type::FILE)
+      static_cast<File*>(entry.value)->populateEntry(entryLevel.mutable_entry(), true, NB_MAX_HASHES_PER_ENTRY_SEARCH);
+   else
+      entry.value->populateEntry(entryLevel.mutable_entry(), true);
+}
+
 void FileManager::newSharedDirectory(SharedDirectory* sharedDir)
 {
    this->fileUpdater.addRoot(sharedDir);
@@ -395,6 +493,7 @@ void FileManager::deleteSharedDir(SharedDirectory* sharedDirectory)
 
 void FileManager::entryAdded(Entry* entry)
 {
+   this->searchCache.invalidate();
    if (entry->getName().isEmpty() || Global::isFileUnfinished(entry->getName()))
       return;
 
@@ -403,27 +502,41 @@ void FileManager::entryAdded(Entry* entry)
    this->extensionIndex.addItem(entry->getExtension(), entry);
    if (!this->cacheLoading)
       this->sizeIndex.addItem(entry);
+   if (this->infixSearch)
+      this->trigramIndex.addItem(entry->getName(), entry);
    L_DEBU("Entry added to the index");
 }
 
 void FileManager::entryRemoved(Entry* entry)
 {
+   this->searchCache.invalidate();
    if (entry->getName().isEmpty())
       return;
 
+   if (!this->cacheLoading)
+      this->cacheJournal.entryRemoved(*entry);
+
    L_DEBU(QString("Removing entry '%1' from the index . . .").arg(entry->getName()));
    if (!this->wordIndex.rmItem(Common::StringUtils::splitInWords(entry->getName()), entry))
       L_DEBU(QString("The entry '%1' hasn't been found in the index!").arg(entry->getName()));
    this->extensionIndex.rmItem(entry->getExtension(), entry);
    this->sizeIndex.rmItem(entry);
+   if (this->infixSearch)
+      this->trigramIndex.rmItem(entry);
    L_DEBU("Entry removed from the index");
 }
 
 void FileManager::entryRenamed(Entry* entry, const QString& oldName)
 {
+   this->searchCache.invalidate();
+   if (!this->cacheLoading)
+      this->cacheJournal.entryRenamed(*entry, oldName);
+
    L_DEBU(QString("Renaming entry '%1' to '%2' in the index . . .").arg(entry->getName()).arg(oldName));
    this->wordIndex.renameItem(Common::StringUtils::splitInWords(oldName), Common::StringUtils::splitInWords(entry->getName()), entry);
    this->extensionIndex.changeItem(Common::KnownExtensions::getExtension(oldName), entry->getExtension(), entry);
+   if (this->infixSearch)
+      this->trigramIndex.addItem(entry->getName(), entry);
    L_DEBU("Entry renamed in the index");
 }
 
@@ -434,33 +547,48 @@ void FileManager::entryResizing(Entry* entry)
 
 void FileManager::entryResized(Entry* entry, qint64 oldSize)
 {
+   this->searchCache.invalidate();
    this->sizeIndex.addItem(entry);
+
+   // The hashes of a resized file are obsolete, the new ones will be journaled as they are computed.
+   if (entry->getType() == Entry::Type::FILE)
+      this->cacheJournal.entryRemoved(*entry);
 }
 
 void FileManager::chunkHashKnown(const QSharedPointer<Chunk>& chunk)
 {
+   this->searchCache.invalidate(); // The search results include the chunk hashes.
    L_DEBU(QString("Adding chunk '%1' to the index . . .").arg(chunk->getHash().toStr()));
    this->chunks.add(chunk);
    L_DEBU("Chunk added to the index");
-   this->setCacheChanged();
+
+   if (!this->cacheLoading)
+      this->cacheJournal.chunkChanged(*chunk);
 }
 
 void FileManager::chunkRemoved(const QSharedPointer<Chunk>& chunk)
 {
+   this->searchCache.invalidate(); // The search results include the chunk hashes.
    L_DEBU(QString("Removing chunk '%1' from the index . . .").arg(chunk->getHash().toStr()));
    this->chunks.rm(chunk);
    L_DEBU("Chunk removed from the index");
-   this->setCacheChanged();
+
+   if (!this->cacheLoading)
+      this->cacheJournal.chunkChanged(*chunk);
 }
 
 /**
   * Load the cache from a file. Called at start, by the constructor.
+  * The journals written since this snapshot are replayed on it, then a new journal is begun.
   * It will give the file cache to the fileUpdater and ask it
   * to load the cache.
   * It will also start the timer to persist the cache.
   */
 void FileManager::loadCacheFromFile()
 {
+   if (this->fastCacheLoading && this->loadCacheFromIndex())
+      return;
+
    // This hashes will be unallocated by the fileUpdater.
    Protos::FileCache::Hashes* savedCache = new Protos::FileCache::Hashes();
 
@@ -471,10 +599,30 @@ void FileManager::loadCacheFromFile()
       {
          L_ERRO(QString("The version (%1) of the file cache \"%2\" doesn't match the current version (%3)").arg(savedCache->version()).arg(Common::Constants::FILE_CACHE).arg(FILE_CACHE_VERSION));
          Common::PersistentData::rmValue(Common::Constants::FILE_CACHE, Common::Global::DataFolderType::LOCAL);
+         CacheJournal::removeAllJournals();
+         this->cacheJournal.open(0);
          delete savedCache;
          return;
       }
 
+      // The changes made after the snapshot, a new journal is begun to not append after a record cut by a crash.
+      int nbRecords;
+      this->cacheJournal.open(CacheJournal::replay(*savedCache, nbRecords) + 1);
+      if (nbRecords > 0)
+      {
+         L_USER(QString("%1 changes of the file cache have been restored from its journal").arg(nbRecords));
+         this->setCacheChanged(); // To compact the journals into a new snapshot once the cache is loaded.
+      }
+
+      // The hashes computed with another algorithm will be recomputed by the file updater, they are kept
+      // in the file cache until then, see 'Cache::keepPreviousHashes(..)'.
+      if (static_cast<Common::HashAlgorithm>(savedCache->hash_algorithm()) != Global::getHashAlgorithm())
+      {
+         L_WARN(QString("The chunk hashes of the file cache \"%1\" have been computed with another algorithm, they will be recomputed").arg(Common::Constants::FILE_CACHE));
+         for (int i = 0; i < savedCache->shareddir_size(); i++)
+            FileManager::setHashAlgorithmOfChunks(*savedCache->mutable_shareddir(i)->mutable_root(), savedCache->hash_algorithm());
+      }
+
       // Scan the shared directories and try to match the files against the saved cache.
       try
       {
@@ -489,17 +637,84 @@ void FileManager::loadCacheFromFile()
    catch (Common::UnknownValueException& e)
    {
       L_WARN(QString("The persisted file cache cannot be retrived (the file doesn't exist) : %1").arg(Common::Constants::FILE_CACHE));
+      CacheJournal::removeAllJournals(); // Without their snapshot the journals are useless.
+      this->cacheJournal.open(0);
    }
    catch (...)
    {
       L_WARN(QString("The persisted file cache cannot be retrived (Unkown exception) : %1").arg(Common::Constants::FILE_CACHE));
+      CacheJournal::removeAllJournals();
+      this->cacheJournal.open(0);
    }
 
    this->fileUpdater.setFileCache(savedCache);
 }
 
 /**
-  * Save the cache to a file.
+  * Set explicitly the algorithm of the chunks which have a hash and don't have an algorithm, see 'Protos.FileCache.Hashes.Chunk.hash_algorithm'.
+  */
+void FileManager::setHashAlgorithmOfChunks(Protos::FileCache::Hashes::Dir& dir, Protos::Common::HashAlgorithm algorithm)
+{
+   for (int i = 0; i < dir.file_size(); i++)
+   {
+      Protos::FileCache::Hashes::File* file = dir.mutable_file(i);
+      for (int j = 0; j < file->chunk_size(); j++)
+      {
+         Protos::FileCache::Hashes::Chunk* chunk = file->mutable_chunk(j);
+         if (chunk->has_hash() && !chunk->has_hash_algorithm())
+            chunk->set_hash_algorithm(algorithm);
+      }
+   }
+
+   for (int i = 0; i < dir.dir_size(); i++)
+      FileManager::setHashAlgorithmOfChunks(*dir.mutable_dir(i), algorithm);
+}
+
+/**
+  * Load the cache from its index, see 'CacheIndex'. The fileUpdater will build the tree from it without
+  * scanning the shared directories, it will check them once the cache is loaded.
+  * @return 'false' if the index doesn't exist or doesn't match the journal or the current settings, the snapshot must be loaded instead.
+  */
+bool FileManager::loadCacheFromIndex()
+{
+   // This index will be unallocated by the fileUpdater.
+   CacheIndex* index = new CacheIndex();
+
+   if (
+      !index->open() ||
+      CacheJournal::hasRecordsSince(index->getJournalGeneration()) ||
+      index->getChunkSize() != static_cast<quint32>(Chunk::CHUNK_SIZE) ||
+      index->getHashAlgorithm() != static_cast<quint32>(Global::getHashAlgorithm())
+   )
+   {
+      delete index;
+      return false;
+   }
+
+   L_DEBU(QString("Loading the file cache from its index (generation %1)").arg(index->getJournalGeneration()));
+
+   this->cacheJournal.open(index->getJournalGeneration());
+
+   Protos::FileCache::Hashes sharedDirs;
+   index->populateSharedDirs(sharedDirs);
+   try
+   {
+      this->cache.createSharedDirs(sharedDirs);
+   }
+   catch (DirsNotFoundException& e)
+   {
+      foreach (QString path, e.paths)
+         L_WARN(QString("During the file cache loading, this directory hasn't been found : %1").arg(path));
+   }
+
+   this->fileUpdater.setCacheIndex(index);
+   return true;
+}
+
+/**
+  * Save a snapshot of the cache to a file if a change hasn't been written to the journal or if the journal
+  * has reached 'cache_journal_max_size'. The journal is rotated before the snapshot is taken, the changes
+  * made while taking it are thus kept in the new journal. The snapshot is written by a background thread.
   * Restart the timer at the end of the operation.
   * Called by the fileUpdater when it needs to persist the cache.
   */
@@ -508,26 +723,22 @@ void FileManager::persistCacheToFile()
    QMutexLocker locker(&this->mutexPersistCache);
 
    QMutexLocker lockerCacheChanged(&this->mutexCacheChanged);
-   if (this->cacheChanged && !this->cacheLoading)
+   if (!this->cacheLoading && (this->cacheChanged || this->cacheJournal.getSize() > this->cacheJournalMaxSize))
    {
+      this->cacheChanged = false;
       lockerCacheChanged.unlock();
 
       L_DEBU("Persisting cache . . .");
 
-      Protos::FileCache::Hashes hashes;
-      this->cache.populateHashes(hashes);
+      // Will be deleted by the writer.
+      Protos::FileCache::Hashes* hashes = new Protos::FileCache::Hashes();
+      hashes->set_journal_generation(this->cacheJournal.rotate());
+      this->cache.populateHashes(*hashes);
+      this->cacheSnapshotWriter.write(hashes, this->fastCacheLoading ? this->cache.buildIndex(hashes->journal_generation()) : QByteArray());
 
-      try
-      {
-         Common::PersistentData::setValue(Common::Constants::FILE_CACHE, hashes, Common::Global::DataFolderType::LOCAL);
-      }
-      catch (Common::PersistentDataIOException& err)
-      {
-         L_ERRO(err.message);
-      }
-
-      lockerCacheChanged.relock();
-      this->cacheChanged = false;
+      // The names of the entries removed since the last persist aren't needed anymore.
+      const int nbNamesRemoved = this->cache.getNamePool().squeeze();
+      L_DEBU(QString("Number of names removed from the pool: %1").arg(nbNamesRemoved));
 
       L_DEBU("Persisting cache finished");
    }
@@ -566,5 +777,8 @@ void FileManager::fileCacheLoadingComplete()
       this->sizeIndex.addItem(entry);
    });
 
+   if (this->infixSearch)
+      L_USER(QString("Infix search: %1 names indexed by %2 trigrams, memory used: %3").arg(this->trigramIndex.getNbItems()).arg(this->trigramIndex.getNbTrigrams()).arg(Common::Global::formatByteSize(this->trigramIndex.getMemoryUsage())));
+
    emit fileCacheLoaded();
 }
@@ -24,12 +24,15 @@
 #include <QObject>
 #include <QSharedPointer>
 #include <QList>
+#include <QVector>
 #include <QBitArray>
+#include <QByteArray>
 #include <QMutex>
 #include <QTimer>
 
 #include <Protos/common.pb.h>
 #include <Protos/core_protocol.pb.h>
+#include <Protos/files_cache.pb.h>
 
 #include <Common/Uncopyable.h>
 
@@ -38,10 +41,14 @@
 #include <priv/FileUpdater/FileUpdater.h>
 #include <priv/Cache/Cache.h>
 #include <priv/Cache/Entry.h>
+#include <priv/Cache/CacheJournal.h>
+#include <priv/Cache/CacheSnapshotWriter.h>
 #include <priv/ChunkIndex/Chunks.h>
 #include <priv/WordIndex/WordIndex.h>
 #include <priv/ExtensionIndex.h>
+#include <priv/TrigramIndex.h>
 #include <priv/SizeIndexEntries.h>
+#include <priv/SearchCache.h>
 
 namespace FM
 {
@@ -75,10 +82,13 @@ namespace FM
 
       inline QList<Protos::Common::FindResult> find(const QString& words, int maxNbResult, int maxSize) { return this->find(words, QList<QString>(), 0, std::numeric_limits<qint64>::max(), Protos::Common::FindPattern::FILE_DIR, maxNbResult, maxSize); }
       QList<Protos::Common::FindResult> find(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize);
-      QBitArray haveChunks(const QList<Common::Hash>& hashes);
+      QList<QByteArray> findEncoded(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize, quint64 tag);
+      QBitArray haveChunks(const QVector<Common::Hash>& hashes);
       quint64 getAmount();
       CacheStatus getCacheStatus() const;
       int getProgress() const;
+      SearchCacheStats getSearchCacheStats() const;
+      FileEventStats getFileEventStats() const;
 
       void dumpWordIndex() const;
       void printSimilarFiles() const;
@@ -86,6 +96,11 @@ namespace FM
       Directory* getFittestDirectory(const QString& path);
       Entry* getEntry(const QString& path);
 
+   private:
+      QList<QByteArray> searchEncoded(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult, int maxSize);
+      QList<NodeResult<Entry*>> search(const QString& words, const QList<QString>& extensions, qint64 minFileSize, qint64 maxFileSize, Protos::Common::FindPattern_Category category, int maxNbResult);
+      static void populateEntryLevel(Protos::Common::FindResult::EntryLevel& entryLevel, const NodeResult<Entry*>& entry);
+
    private slots:
       void newSharedDirectory(SharedDirectory*);
       void sharedDirectoryRemoved(SharedDirectory*, Directory*);
@@ -100,6 +115,8 @@ namespace FM
 
    private:
       void loadCacheFromFile();
+      bool loadCacheFromIndex();
+      static void setHashAlgorithmOfChunks(Protos::FileCache::Hashes::Dir& dir, Protos::Common::HashAlgorithm algorithm);
 
    private slots:
       void persistCacheToFile();
@@ -117,12 +134,20 @@ namespace FM
       WordIndex<Entry*> wordIndex;
       ExtensionIndex<Entry*> extensionIndex;
       SizeIndexEntries sizeIndex;
+      const bool infixSearch; ///< The setting 'enable_infix_search'.
+      TrigramIndex<Entry*> trigramIndex; ///< Empty if 'infixSearch' is false.
+      SearchCache searchCache; ///< Invalidated each time an entry is added, removed, renamed or resized and each time a chunk hash is known or removed.
+
+      CacheJournal cacheJournal; ///< The changes of the cache since the last snapshot.
+      CacheSnapshotWriter cacheSnapshotWriter;
+      const qint64 cacheJournalMaxSize; ///< The setting 'cache_journal_max_size'.
+      const bool fastCacheLoading; ///< The setting 'fast_cache_loading'.
 
       QTimer timerPersistCache;
       QMutex mutexPersistCache;
       QMutex mutexCacheChanged; ///< We use a second mutex (instead of using 'mutexPersistCache') to avoid deadlock created by "File -> chunkHashKnown()" and "persistCacheToFile() -> File".
       bool cacheLoading; ///< Set to 'true' during cache loading. It avoids to persist the cache during loading.
-      bool cacheChanged;
+      bool cacheChanged; ///< Set to 'true' when a snapshot is needed, for a change which can't be written to the journal.
    };
 }
 #endif
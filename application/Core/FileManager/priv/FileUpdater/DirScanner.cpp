@@ -0,0 +1,267 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#include <priv/FileUpdater/DirScanner.h>
+using namespace FM;
+
+#include <QMutexLocker>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+
+#if defined(Q_OS_LINUX)
+   #include <fcntl.h>
+   #include <unistd.h>
+   #include <dirent.h>
+   #include <sys/stat.h>
+   #include <sys/syscall.h>
+#endif
+
+#include <priv/Cache/Directory.h>
+
+/**
+  * @class FM::DirScanner
+  *
+  * Read the content of many directories at the same time with a pool of threads, see the setting 'number_of_scanning_threads'.
+  * Most of the scanning time is spent waiting for the metadata of the files, reading several directories in parallel
+  * hides this latency. The workers only read the file system, the results are merged into the 'Directory' tree
+  * by the thread calling 'next(..)', see 'FileUpdater::scan(..)'.
+  */
+
+DirScanner::DirScanner(int nbThreads) :
+   nbRequestsInProgress(0),
+   toStop(false)
+{
+   for (int i = 0; i < nbThreads; i++)
+      this->workers << new Worker(this);
+}
+
+DirScanner::~DirScanner()
+{
+   this->mutex.lock();
+   this->toStop = true;
+   this->requestAdded.wakeAll();
+   this->mutex.unlock();
+
+   foreach (Worker* worker, this->workers)
+   {
+      worker->wait();
+      delete worker;
+   }
+}
+
+/**
+  * Queue a directory to be read, its path is taken now because the workers mustn't access the 'Directory' tree.
+  */
+void DirScanner::add(Directory* dir)
+{
+   Request request { dir, dir->getFullPath() };
+
+   QMutexLocker locker(&this->mutex);
+   this->requests << request;
+   this->requestAdded.wakeOne();
+}
+
+/**
+  * Wait for a directory to be read, the results come in any order.
+  * @return false if there is no directory queued or being read.
+  */
+bool DirScanner::next(Result& result)
+{
+   QMutexLocker locker(&this->mutex);
+
+   while (this->results.isEmpty() && (!this->requests.isEmpty() || this->nbRequestsInProgress > 0))
+      this->resultAdded.wait(&this->mutex);
+
+   if (this->results.isEmpty())
+      return false;
+
+   result = this->results.takeFirst();
+   return true;
+}
+
+/**
+  * Remove the queued directories and wait for the ones being read, their results are dropped.
+  */
+void DirScanner::abort()
+{
+   QMutexLocker locker(&this->mutex);
+
+   this->requests.clear();
+   while (this->nbRequestsInProgress > 0)
+      this->resultAdded.wait(&this->mutex);
+   this->results.clear();
+}
+
+/**
+  * Read the files and the sub directories of the given directory, the symbolic links, the hidden and
+  * the special files are ignored like 'QDir::entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks)' does.
+  * On Linux the entries are read by large batches with 'getdents64' and only the files are stated (with 'statx' when available),
+  * the type of the sub directories is given by 'getdents64'.
+  * @param dateLastModified The modification date of the directory, read before its content.
+  * @return false if the directory can't be read.
+  */
+bool DirScanner::read(const QString& path, QDateTime& dateLastModified, QList<ScannedEntry>& entries)
+{
+#if defined(Q_OS_LINUX)
+   static const int BUFFER_SIZE = 32 * 1024; // [Byte].
+
+   struct LinuxDirent64
+   {
+      quint64 d_ino;
+      qint64 d_off;
+      unsigned short d_reclen;
+      unsigned char d_type;
+      char d_name[1];
+   };
+
+   const int dirFd = open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+   if (dirFd == -1)
+      return false;
+
+   struct stat dirStat;
+   if (fstat(dirFd, &dirStat) == -1)
+   {
+      close(dirFd);
+      return false;
+   }
+   dateLastModified = QDateTime::fromMSecsSinceEpoch(qint64(dirStat.st_mtim.tv_sec) * 1000 + dirStat.st_mtim.tv_nsec / 1000000);
+
+   char buffer[BUFFER_SIZE];
+   forever
+   {
+      const long nbBytes = syscall(SYS_getdents64, dirFd, buffer, BUFFER_SIZE);
+      if (nbBytes <= 0)
+      {
+         close(dirFd);
+         return nbBytes == 0;
+      }
+
+      for (long pos = 0; pos < nbBytes;)
+      {
+         const LinuxDirent64* dirent = reinterpret_cast<const LinuxDirent64*>(buffer + pos);
+         pos += dirent->d_reclen;
+
+         if (dirent->d_name[0] == '.' || dirent->d_type == DT_LNK) // The hidden entries, '.' and '..'.
+            continue;
+
+         ScannedEntry entry;
+         entry.name = QFile::decodeName(dirent->d_name);
+
+         if (dirent->d_type == DT_DIR)
+         {
+            entry.isDir = true;
+            entry.size = 0;
+         }
+         else if (dirent->d_type == DT_REG || dirent->d_type == DT_UNKNOWN) // Some file systems don't give the type.
+         {
+#if defined(STATX_TYPE)
+            struct statx entryStat;
+            if (statx(dirFd, dirent->d_name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_TYPE | STATX_SIZE | STATX_MTIME, &entryStat) == -1)
+               continue;
+
+            const mode_t mode = entryStat.stx_mode;
+            entry.size = entryStat.stx_size;
+            entry.dateLastModified = QDateTime::fromMSecsSinceEpoch(qint64(entryStat.stx_mtime.tv_sec) * 1000 + entryStat.stx_mtime.tv_nsec / 1000000);
+#else
+            struct stat entryStat;
+            if (fstatat(dirFd, dirent->d_name, &entryStat, AT_SYMLINK_NOFOLLOW) == -1)
+               continue;
+
+            const mode_t mode = entryStat.st_mode;
+            entry.size = entryStat.st_size;
+            entry.dateLastModified = QDateTime::fromMSecsSinceEpoch(qint64(entryStat.st_mtim.tv_sec) * 1000 + entryStat.st_mtim.tv_nsec / 1000000);
+#endif
+            if (S_ISDIR(mode))
+               entry.isDir = true;
+            else if (S_ISREG(mode))
+               entry.isDir = false;
+            else
+               continue;
+         }
+         else
+            continue;
+
+         entries << entry;
+      }
+   }
+#else
+   const QDir dir(path);
+   if (!dir.exists())
+      return false;
+
+   dateLastModified = QFileInfo(path).lastModified();
+
+   foreach (QFileInfo fileInfo, dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks)) // TODO: Add an option to follow or not symlinks.
+   {
+      ScannedEntry entry;
+      entry.name = fileInfo.fileName();
+      entry.isDir = fileInfo.isDir();
+      entry.size = entry.isDir ? 0 : fileInfo.size();
+      entry.dateLastModified = fileInfo.lastModified();
+      entries << entry;
+   }
+
+   return true;
+#endif
+}
+
+void DirScanner::work()
+{
+   forever
+   {
+      this->mutex.lock();
+      while (this->requests.isEmpty() && !this->toStop)
+         this->requestAdded.wait(&this->mutex);
+
+      if (this->toStop)
+      {
+         this->mutex.unlock();
+         return;
+      }
+
+      const Request request = this->requests.takeFirst();
+      this->nbRequestsInProgress++;
+      this->mutex.unlock();
+
+      Result result;
+      result.dir = request.dir;
+      result.readable = DirScanner::read(request.path, result.dateLastModified, result.entries);
+
+      this->mutex.lock();
+      this->results << result;
+      this->nbRequestsInProgress--;
+      this->resultAdded.wakeAll();
+      this->mutex.unlock();
+   }
+}
+
+/////
+
+DirScanner::Worker::Worker(DirScanner* dirScanner) :
+   dirScanner(dirScanner)
+{
+   this->start();
+}
+
+void DirScanner::Worker::run()
+{
+   QThread::currentThread()->setObjectName("DirScanner");
+   this->dirScanner->work();
+}
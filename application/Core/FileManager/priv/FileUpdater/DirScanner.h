@@ -0,0 +1,97 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#ifndef FILEMANAGER_DIRSCANNER_H
+#define FILEMANAGER_DIRSCANNER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+#include <QList>
+#include <QLinkedList>
+#include <QDateTime>
+
+namespace FM
+{
+   class Directory;
+
+   class DirScanner
+   {
+   public:
+      struct ScannedEntry
+      {
+         QString name;
+         bool isDir;
+         qint64 size;
+         QDateTime dateLastModified;
+      };
+
+      struct Result
+      {
+         Directory* dir;
+         bool readable;
+         QDateTime dateLastModified; ///< The modification date of the directory itself, read before its content.
+         QList<ScannedEntry> entries;
+      };
+
+      DirScanner(int nbThreads);
+      ~DirScanner();
+
+      void add(Directory* dir);
+      bool next(Result& result);
+      void abort();
+
+      static bool read(const QString& path, QDateTime& dateLastModified, QList<ScannedEntry>& entries);
+
+   private:
+      struct Request
+      {
+         Directory* dir;
+         QString path;
+      };
+
+      void work();
+
+      class Worker : public QThread
+      {
+      public:
+         Worker(DirScanner* dirScanner);
+
+      protected:
+         void run();
+
+      private:
+         DirScanner* dirScanner;
+      };
+
+      QList<Worker*> workers;
+
+      QLinkedList<Request> requests; ///< The directories waiting for a worker.
+      QLinkedList<Result> results; ///< The directories read, waiting for 'next(..)'.
+      int nbRequestsInProgress;
+      bool toStop;
+
+      QMutex mutex;
+      QWaitCondition requestAdded;
+      QWaitCondition resultAdded;
+   };
+}
+
+#endif
@@ -26,6 +26,7 @@ using namespace FM;
 #if defined(Q_OS_WIN32)
    #include <priv/FileUpdater/DirWatcherWin.h>
 #elif defined(Q_OS_LINUX)
+   #include <priv/FileUpdater/DirWatcherFanotify.h>
    #include <priv/FileUpdater/DirWatcherLinux.h>
 #endif
 
@@ -34,6 +35,9 @@ DirWatcher* DirWatcher::getNewWatcher()
 #if defined(Q_OS_WIN32)
    return new DirWatcherWin();
 #elif defined(Q_OS_LINUX)
+   // fanotify is preferred because its cost doesn't depend on the number of watched directories.
+   if (DirWatcher* watcher = DirWatcherFanotify::create())
+      return watcher;
    return new DirWatcherLinux();
 #else
    L_WARN("Cannot create a watcher for the current platform, no implementation.");
@@ -0,0 +1,441 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#include <priv/FileUpdater/DirWatcherFanotify.h>
+using namespace FM;
+
+#include <cstring>
+
+#include <QMutexLocker>
+#include <QDir>
+#include <QFile>
+#include <QByteArray>
+
+#include <priv/FileUpdater/WaitConditionLinux.h>
+#include <priv/Log.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/select.h>
+#include <sys/statfs.h>
+#include <sys/fanotify.h>
+
+/**
+  * @class FM::DirWatcherFanotify
+  *
+  * Implementation of 'DirWatcher' for Linux with fanotify (Linux >= 5.9). Instead of one inotify watch per directory, the whole
+  * file system of a watched directory is marked once ('FAN_MARK_FILESYSTEM'), thus adding a directory costs the same whatever the size of its tree.
+  * The events give the handle of the parent directory and the name of the entry ('FAN_REPORT_DFID_NAME'), the handle is resolved to a path
+  * and the events outside the watched directories are ignored.
+  * Marking a file system requires the capability 'CAP_SYS_ADMIN': if 'fanotify_init(..)' fails, see 'create()', 'DirWatcherLinux' is used instead.
+  * A directory whose file system can't be marked (NFS or FUSE for example) is watched by an internal 'DirWatcherLinux'.
+  */
+
+const int DirWatcherFanotify::BUF_LEN = 64 * 1024; // [Byte].
+
+/**
+  * Return a new watcher or 'nullptr' if fanotify isn't available.
+  */
+DirWatcherFanotify* DirWatcherFanotify::create()
+{
+#if defined(FAN_REPORT_DFID_NAME)
+   const int fileDescriptor = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK | FAN_REPORT_DFID_NAME, O_RDONLY | O_LARGEFILE);
+   if (fileDescriptor == -1)
+   {
+      L_DEBU(QString("Unable to initialize fanotify (errno=%1), inotify is used instead").arg(errno)); // EPERM without 'CAP_SYS_ADMIN' and EINVAL before Linux 5.9.
+      return nullptr;
+   }
+
+   return new DirWatcherFanotify(fileDescriptor);
+#else
+   return nullptr;
+#endif
+}
+
+#if defined(FAN_REPORT_DFID_NAME)
+
+DirWatcherFanotify::DirWatcherFanotify(int fileDescriptor) :
+   fileDescriptor(fileDescriptor),
+#if defined(FAN_RENAME)
+   eventMask(FAN_CREATE | FAN_DELETE | FAN_CLOSE_WRITE | FAN_RENAME | FAN_ONDIR)
+#else
+   eventMask(FAN_CREATE | FAN_DELETE | FAN_CLOSE_WRITE | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_ONDIR)
+#endif
+{
+}
+
+DirWatcherFanotify::~DirWatcherFanotify()
+{
+   QMutexLocker locker(&this->mutex);
+
+   foreach (const FileSystem& fileSystem, this->fileSystems)
+      close(fileSystem.fileDescriptor);
+
+   // The marks are removed with the group.
+   if (close(this->fileDescriptor) < 0)
+      L_WARN(QString("DirWatcherFanotify::~DirWatcherFanotify: Unable to close file descriptor (fanotify)."));
+}
+
+/**
+  * @copydoc FM::DirWatcher::addDir(..)
+  */
+bool DirWatcherFanotify::addDir(const QString& path)
+{
+   QMutexLocker locker(&this->mutex);
+
+   const QString cleanedPath = QDir::cleanPath(path);
+   if (this->rootDirs.contains(cleanedPath))
+      return true;
+
+   struct statfs fileSystemStat;
+   if (statfs(QFile::encodeName(path).constData(), &fileSystemStat) == -1)
+      return false;
+
+   // The same id is given by the events, see 'getEventPath(..)'.
+   quint64 fileSystemId;
+   static_assert(sizeof(fileSystemId) == sizeof(fileSystemStat.f_fsid), "The file system id must be 64 bits");
+   memcpy(&fileSystemId, &fileSystemStat.f_fsid, sizeof(fileSystemId));
+
+   QHash<quint64, FileSystem>::iterator fileSystem = this->fileSystems.find(fileSystemId);
+   if (fileSystem == this->fileSystems.end())
+   {
+      const int fileSystemFd = open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (fileSystemFd == -1)
+         return false;
+
+      int result = fanotify_mark(this->fileDescriptor, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, this->eventMask, fileSystemFd, nullptr);
+#if defined(FAN_RENAME)
+      if (result == -1 && errno == EINVAL && (this->eventMask & FAN_RENAME)) // 'FAN_RENAME' requires Linux 5.17.
+      {
+         this->eventMask = (this->eventMask & ~FAN_RENAME) | FAN_MOVED_FROM | FAN_MOVED_TO;
+         result = fanotify_mark(this->fileDescriptor, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, this->eventMask, fileSystemFd, nullptr);
+      }
+#endif
+
+      if (result == -1)
+      {
+         L_DEBU(QString("Unable to mark the file system of %1 with fanotify (errno=%2), inotify is used instead").arg(path).arg(errno));
+         close(fileSystemFd);
+
+         if (!this->inotifyWatcher.addDir(path))
+            return false;
+         this->inotifyRootDirs << path;
+         return true;
+      }
+
+      fileSystem = this->fileSystems.insert(fileSystemId, FileSystem { fileSystemFd, 0 });
+   }
+
+   fileSystem->nbRoots++;
+   this->rootDirs.insert(cleanedPath, fileSystemId);
+   return true;
+}
+
+/**
+  * @copydoc FM::DirWatcher::rmDir(..)
+  */
+void DirWatcherFanotify::rmDir(const QString& path)
+{
+   QMutexLocker locker(&this->mutex);
+
+   const QString cleanedPath = QDir::cleanPath(path);
+   if (this->rootDirs.contains(cleanedPath))
+   {
+      this->rmRoot(cleanedPath);
+   }
+   else if (this->inotifyRootDirs.removeOne(path))
+   {
+      this->inotifyWatcher.rmDir(path);
+   }
+}
+
+/**
+  * @copydoc FM::DirWatcher::nbWatchedDir()
+  */
+int DirWatcherFanotify::nbWatchedDir()
+{
+   QMutexLocker locker(&this->mutex);
+   return this->rootDirs.size() + this->inotifyRootDirs.size();
+}
+
+/**
+  * @copydoc FM::DirWatcher::waitEvent(QList<WaitCondition*>)
+  */
+const QList<WatcherEvent> DirWatcherFanotify::waitEvent(QList<WaitCondition*> ws)
+{
+   return this->waitEvent(-1, ws);
+}
+
+/**
+  * @copydoc FM::DirWatcher::waitEvent(int, QList<WaitCondition*>)
+  */
+const QList<WatcherEvent> DirWatcherFanotify::waitEvent(int timeout, QList<WaitCondition*> ws)
+{
+   QMutexLocker locker(&this->mutex);
+
+   fd_set fds;
+   FD_ZERO(&fds);
+
+   FD_SET(this->fileDescriptor, &fds);
+   int fd_max = this->fileDescriptor;
+
+   const int inotifyFd = this->inotifyRootDirs.isEmpty() ? -1 : this->inotifyWatcher.getFileDescriptor();
+   if (inotifyFd >= 0)
+   {
+      FD_SET(inotifyFd, &fds);
+      if (inotifyFd > fd_max) fd_max = inotifyFd;
+   }
+
+   for (int i = 0; i < ws.size(); i++)
+   {
+      int wcfd = dynamic_cast<WaitConditionLinux*>(ws[i])->getFd();
+      FD_SET(wcfd, &fds);
+      if (wcfd > fd_max) fd_max = wcfd;
+   }
+
+   struct timeval time;
+   time.tv_sec = timeout / 1000;
+   time.tv_usec = (timeout % 1000) * 1000;
+
+   locker.unlock();
+   int sel = select(fd_max + 1, &fds, NULL, NULL, (timeout == -1 ? 0 : &time));
+   locker.relock();
+
+   if (sel < 0)
+   {
+      L_ERRO(QString("DirWatcherFanotify::waitEvent: select error."));
+      return QList<WatcherEvent>();
+   }
+   else if (!sel)
+   {
+      QList<WatcherEvent> events;
+      events.append(WatcherEvent(WatcherEvent::TIMEOUT));
+      return events;
+   }
+
+   // Test if select is released by a WaitCondition.
+   for (int i = 0; i < ws.size(); i++)
+   {
+      int wcfd = dynamic_cast<WaitConditionLinux*>(ws[i])->getFd();
+      if (FD_ISSET(wcfd, &fds))
+      {
+         static char dummy[4096];
+         while (read(wcfd, dummy, sizeof(dummy)) > 0);
+         return QList<WatcherEvent>();
+      }
+   }
+
+   QList<WatcherEvent> events;
+
+   if (inotifyFd >= 0 && FD_ISSET(inotifyFd, &fds))
+   {
+      foreach (WatcherEvent event, this->inotifyWatcher.waitEvent(0))
+      {
+         if (event.type == WatcherEvent::TIMEOUT)
+            continue;
+
+         // 'DirWatcherLinux' stops watching a deleted root directory by itself.
+         if (event.type == WatcherEvent::DELETED)
+            for (QMutableListIterator<QString> i(this->inotifyRootDirs); i.hasNext();)
+               if (QDir::cleanPath(i.next()) == event.path1)
+                  i.remove();
+
+         events << event;
+      }
+   }
+
+   if (FD_ISSET(this->fileDescriptor, &fds))
+      this->readEvents(events);
+
+   return events;
+}
+
+void DirWatcherFanotify::readEvents(QList<WatcherEvent>& events)
+{
+   char buffer[BUF_LEN];
+   ssize_t len = read(this->fileDescriptor, buffer, BUF_LEN);
+   if (len < 0)
+   {
+      if (errno != EINTR && errno != EAGAIN)
+         L_ERRO(QString("DirWatcherFanotify::readEvents: read fanotify event failed."));
+      return;
+   }
+
+   for (fanotify_event_metadata* metadata = reinterpret_cast<fanotify_event_metadata*>(buffer); FAN_EVENT_OK(metadata, len); metadata = FAN_EVENT_NEXT(metadata, len))
+   {
+      if (metadata->vers != FANOTIFY_METADATA_VERSION)
+      {
+         L_ERRO(QString("DirWatcherFanotify::readEvents: unsupported fanotify metadata version: %1").arg(metadata->vers));
+         return;
+      }
+
+      if (metadata->fd >= 0)
+         close(metadata->fd);
+
+      // Some events have been lost, all the watched directories must be rescanned.
+      if (metadata->mask & FAN_Q_OVERFLOW)
+      {
+         L_WARN("DirWatcherFanotify::readEvents: the fanotify queue has overflowed");
+         foreach (QString root, this->rootDirs.keys())
+            events << WatcherEvent(WatcherEvent::NEW, root);
+         continue;
+      }
+
+      QString path;
+      QString oldPath; // Only for 'FAN_RENAME'.
+      for (quint32 pos = metadata->metadata_len; pos + sizeof(fanotify_event_info_header) <= metadata->event_len;)
+      {
+         const fanotify_event_info_header* header = reinterpret_cast<const fanotify_event_info_header*>(reinterpret_cast<const char*>(metadata) + pos);
+         if (header->len == 0)
+            break;
+
+         const fanotify_event_info_fid* info = reinterpret_cast<const fanotify_event_info_fid*>(header);
+         switch (header->info_type)
+         {
+         case FAN_EVENT_INFO_TYPE_DFID_NAME:
+#if defined(FAN_RENAME)
+         case FAN_EVENT_INFO_TYPE_NEW_DFID_NAME:
+#endif
+            path = this->getEventPath(info);
+            break;
+#if defined(FAN_RENAME)
+         case FAN_EVENT_INFO_TYPE_OLD_DFID_NAME:
+            oldPath = this->getEventPath(info);
+            break;
+#endif
+         }
+
+         pos += header->len;
+      }
+
+      const QString root = this->getRoot(path);
+
+#if defined(FAN_RENAME)
+      if (metadata->mask & FAN_RENAME)
+      {
+         const QString oldRoot = this->getRoot(oldPath);
+         if (!oldRoot.isEmpty() && !root.isEmpty() && oldPath != oldRoot)
+         {
+            events << WatcherEvent(WatcherEvent::MOVE, oldPath, path);
+         }
+         else
+         {
+            if (!oldRoot.isEmpty())
+            {
+               events << WatcherEvent(WatcherEvent::DELETED, oldPath);
+               if (oldPath == oldRoot)
+                  this->rmRoot(oldRoot);
+            }
+            if (!root.isEmpty())
+               events << WatcherEvent(WatcherEvent::NEW, path);
+         }
+         continue;
+      }
+#endif
+
+      if (root.isEmpty())
+         continue;
+
+      if (metadata->mask & (FAN_CREATE | FAN_MOVED_TO))
+         events << WatcherEvent(WatcherEvent::NEW, path);
+
+      if (metadata->mask & FAN_CLOSE_WRITE)
+         events << WatcherEvent(WatcherEvent::CONTENT_CHANGED, path);
+
+      if (metadata->mask & (FAN_DELETE | FAN_MOVED_FROM))
+      {
+         events << WatcherEvent(WatcherEvent::DELETED, path);
+         if (path == root)
+            this->rmRoot(root);
+      }
+   }
+}
+
+/**
+  * Return the path of the entry given by an event: the path of its parent directory followed by its name.
+  * Return an empty string if the parent directory doesn't exist anymore.
+  */
+QString DirWatcherFanotify::getEventPath(const fanotify_event_info_fid* info) const
+{
+   quint64 fileSystemId;
+   memcpy(&fileSystemId, &info->fsid, sizeof(fileSystemId));
+
+   QHash<quint64, FileSystem>::const_iterator fileSystem = this->fileSystems.constFind(fileSystemId);
+   if (fileSystem == this->fileSystems.constEnd())
+      return QString();
+
+   struct file_handle* handle = reinterpret_cast<struct file_handle*>(const_cast<unsigned char*>(info->handle));
+   const char* name = reinterpret_cast<const char*>(handle->f_handle + handle->handle_bytes);
+
+   const int dirFd = open_by_handle_at(fileSystem->fileDescriptor, handle, O_PATH | O_CLOEXEC);
+   if (dirFd == -1)
+      return QString();
+
+   char dirPath[PATH_MAX];
+   const ssize_t length = readlink(QByteArray("/proc/self/fd/").append(QByteArray::number(dirFd)).constData(), dirPath, sizeof(dirPath));
+   close(dirFd);
+   if (length <= 0)
+      return QString();
+
+   QString path = QFile::decodeName(QByteArray(dirPath, length));
+   if (strcmp(name, ".") != 0)
+      path.append('/').append(QFile::decodeName(name));
+
+   return QDir::cleanPath(path);
+}
+
+/**
+  * Return the watched directory containing the given path or an empty string.
+  */
+QString DirWatcherFanotify::getRoot(const QString& path) const
+{
+   if (path.isEmpty())
+      return QString();
+
+   for (QMapIterator<QString, quint64> i(this->rootDirs); i.hasNext();)
+   {
+      const QString& root = i.next().key();
+      if (path == root || path.startsWith(root.endsWith('/') ? root : QString(root).append('/')))
+         return root;
+   }
+
+   return QString();
+}
+
+/**
+  * Stop watching a directory, the mark of its file system is removed with the last watched directory of the file system.
+  */
+void DirWatcherFanotify::rmRoot(const QString& path)
+{
+   const quint64 fileSystemId = this->rootDirs.take(path);
+
+   QHash<quint64, FileSystem>::iterator fileSystem = this->fileSystems.find(fileSystemId);
+   if (fileSystem != this->fileSystems.end() && --fileSystem->nbRoots == 0)
+   {
+      if (fanotify_mark(this->fileDescriptor, FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM, this->eventMask, fileSystem->fileDescriptor, nullptr) == -1)
+         L_WARN(QString("DirWatcherFanotify::rmRoot: Unable to remove a fanotify mark."));
+
+      close(fileSystem->fileDescriptor);
+      this->fileSystems.erase(fileSystem);
+   }
+}
+
+#endif
@@ -0,0 +1,77 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#ifndef FILEMANAGER_DIRWATCHERFANOTIFY_H
+#define FILEMANAGER_DIRWATCHERFANOTIFY_H
+
+#include <QMap>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QMutex>
+
+#include <priv/FileUpdater/DirWatcher.h>
+#include <priv/FileUpdater/DirWatcherLinux.h>
+
+struct fanotify_event_info_fid;
+
+namespace FM
+{
+   class DirWatcherFanotify : public DirWatcher
+   {
+   public:
+      static DirWatcherFanotify* create();
+      ~DirWatcherFanotify();
+
+      bool addDir(const QString& path);
+      void rmDir(const QString& path);
+      int nbWatchedDir();
+      const QList<WatcherEvent> waitEvent(QList<WaitCondition*> ws = QList<WaitCondition*>());
+      const QList<WatcherEvent> waitEvent(int timeout, QList<WaitCondition*> ws = QList<WaitCondition*>());
+
+   private:
+      DirWatcherFanotify(int fileDescriptor);
+
+      void readEvents(QList<WatcherEvent>& events);
+      QString getEventPath(const fanotify_event_info_fid* info) const;
+      QString getRoot(const QString& path) const;
+      void rmRoot(const QString& path);
+
+      static const int BUF_LEN;
+
+      struct FileSystem
+      {
+         int fileDescriptor; ///< A directory of the file system, used to open the file handles of the events.
+         int nbRoots;
+      };
+
+      const int fileDescriptor; // The fanotify group.
+      quint64 eventMask;
+
+      QMap<QString, quint64> rootDirs; ///< The watched directories and the id of their file system.
+      QHash<quint64, FileSystem> fileSystems; ///< The marked file systems, each one is marked once whatever the number of its watched directories.
+
+      DirWatcherLinux inotifyWatcher; ///< Used for the directories whose file system can't be marked, NFS or FUSE for example.
+      QList<QString> inotifyRootDirs;
+
+      QMutex mutex;
+   };
+}
+
+#endif
@@ -143,6 +143,14 @@ int DirWatcherLinux::nbWatchedDir()
    return this->rootDirs.size();
 }
 
+/**
+  * Return the inotify file descriptor or -1 if inotify isn't initialized. Used by 'DirWatcherFanotify' to wait on both watchers.
+  */
+int DirWatcherLinux::getFileDescriptor() const
+{
+   return this->initialized ? this->fileDescriptor : -1;
+}
+
 /**
   * @copydoc FM::DirWatcher::waitEvent(QList<WaitCondition*>)
   */
@@ -41,6 +41,8 @@ namespace FM
        const QList<WatcherEvent> waitEvent(QList<WaitCondition*> ws = QList<WaitCondition*>());
        const QList<WatcherEvent> waitEvent(int timeout, QList<WaitCondition*> ws = QList<WaitCondition*>());
 
+       int getFileDescriptor() const;
+
    private:
        static const int EVENT_SIZE; // Size of the event structure, not counting name.
        static const size_t BUF_LEN; // Reasonable guess as to size of 1024 events.
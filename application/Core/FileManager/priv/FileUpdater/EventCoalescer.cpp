@@ -0,0 +1,238 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#include <priv/FileUpdater/EventCoalescer.h>
+using namespace FM;
+
+#include <limits>
+
+#include <QMutexLocker>
+#include <QFileInfo>
+
+#include <priv/Global.h>
+
+/**
+  * @class FM::EventCoalescer
+  *
+  * Merge the file system events of a same path before they are applied to the file cache by 'FileUpdater::processEvents(..)'.
+  * While a large file is copied the watcher sends a continuous stream of 'NEW' and 'CONTENT_CHANGED' events, they are kept
+  * as a single pending event until the path stays unchanged during the quiet period: no event, same size and same modification date.
+  * Thus a file is scanned and queued for hashing once, when its copy is finished.
+  * The events 'MOVE' and 'DELETED' aren't delayed, they move or cancel the pending events of the path and of its children.
+  */
+
+EventCoalescer::EventCoalescer(int quietPeriod) :
+   QUIET_PERIOD(quietPeriod),
+   nbEventsReceived(0),
+   nbEventsCoalesced(0),
+   nbEventsProcessed(0),
+   nbUnstablePaths(0)
+{
+   this->timer.start();
+}
+
+void EventCoalescer::add(const QList<WatcherEvent>& events)
+{
+   QMutexLocker locker(&this->mutex);
+
+   foreach (WatcherEvent event, events)
+      this->add(event);
+}
+
+/**
+  * Return the events ready to be processed. The pending paths whose quiet period is over are checked,
+  * a path still changing stays pending for another quiet period.
+  */
+QList<WatcherEvent> EventCoalescer::takeReadyEvents()
+{
+   QMutexLocker locker(&this->mutex);
+
+   const qint64 now = this->timer.elapsed();
+   const QDateTime currentDate = QDateTime::currentDateTime();
+
+   for (QHash<QString, PendingPath>::iterator i = this->pendingPaths.begin(); i != this->pendingPaths.end();)
+   {
+      if (now - i->lastEventTime < this->QUIET_PERIOD)
+      {
+         ++i;
+         continue;
+      }
+
+      const QFileInfo fileInfo(i.key());
+      const qint64 size = fileInfo.isFile() ? fileInfo.size() : 0;
+      const QDateTime dateLastModified = fileInfo.lastModified();
+
+      // A path which doesn't exist anymore is given to 'FileUpdater', the scan will remove it from the cache.
+      if (
+         !fileInfo.exists() ||
+         (i->checked && i->size == size && i->dateLastModified == dateLastModified) ||
+         dateLastModified.msecsTo(currentDate) >= this->QUIET_PERIOD
+      )
+      {
+         this->readyEvents << WatcherEvent(i->type, i.key());
+         i = this->pendingPaths.erase(i);
+      }
+      else
+      {
+         this->nbUnstablePaths++;
+         i->lastEventTime = now;
+         i->checked = true;
+         i->size = size;
+         i->dateLastModified = dateLastModified;
+         ++i;
+      }
+   }
+
+   QList<WatcherEvent> events = this->readyEvents;
+   this->readyEvents.clear();
+   this->nbEventsProcessed += events.size();
+   return events;
+}
+
+/**
+  * Return the time in ms until the next call to 'takeReadyEvents()' may return some events, -1 if there is no pending event.
+  */
+int EventCoalescer::getTimeToNextCheck() const
+{
+   QMutexLocker locker(&this->mutex);
+
+   if (!this->readyEvents.isEmpty())
+      return 0;
+
+   if (this->pendingPaths.isEmpty())
+      return -1;
+
+   const qint64 now = this->timer.elapsed();
+   qint64 nextCheck = std::numeric_limits<qint64>::max();
+   for (QHashIterator<QString, PendingPath> i(this->pendingPaths); i.hasNext();)
+      nextCheck = qMin(nextCheck, i.next().value().lastEventTime + this->QUIET_PERIOD);
+
+   return qMax(0LL, nextCheck - now);
+}
+
+/**
+  * Return true if the given path is still changing, its event will be given later by 'takeReadyEvents()'.
+  */
+bool EventCoalescer::isPending(const QString& path) const
+{
+   QMutexLocker locker(&this->mutex);
+   return this->pendingPaths.contains(path);
+}
+
+IFileManager::FileEventStats EventCoalescer::getStats() const
+{
+   QMutexLocker locker(&this->mutex);
+   return IFileManager::FileEventStats { this->nbEventsReceived, this->nbEventsCoalesced, this->nbEventsProcessed, this->nbUnstablePaths, this->pendingPaths.size() };
+}
+
+void EventCoalescer::add(const WatcherEvent& event)
+{
+   if (event.type == WatcherEvent::TIMEOUT || event.type == WatcherEvent::UNKNOWN)
+      return;
+
+   this->nbEventsReceived++;
+
+   // The unfinished files are written by the downloads, their events are ignored by 'FileUpdater::processEvents(..)'.
+   if (this->QUIET_PERIOD == 0 || Global::isFileUnfinished(event.path1))
+   {
+      this->readyEvents << event;
+      return;
+   }
+
+   switch (event.type)
+   {
+   case WatcherEvent::NEW:
+   case WatcherEvent::CONTENT_CHANGED:
+      {
+         QHash<QString, PendingPath>::iterator i = this->pendingPaths.find(event.path1);
+         if (i == this->pendingPaths.end())
+         {
+            this->pendingPaths.insert(event.path1, PendingPath { event.type, this->timer.elapsed(), false, 0, QDateTime() });
+         }
+         else
+         {
+            this->nbEventsCoalesced++;
+            if (event.type == WatcherEvent::NEW)
+               i->type = WatcherEvent::NEW;
+            i->lastEventTime = this->timer.elapsed();
+            i->checked = false;
+         }
+         break;
+      }
+
+   case WatcherEvent::DELETED:
+      this->removePending(event.path1);
+      this->readyEvents << event;
+      break;
+
+   case WatcherEvent::MOVE:
+      this->movePending(event.path1, event.path2);
+      this->readyEvents << event;
+      break;
+
+   case WatcherEvent::TIMEOUT:
+   case WatcherEvent::UNKNOWN:
+      break;
+   }
+}
+
+/**
+  * Remove the pending events of the given path and of its children, they are counted as coalesced into the deletion.
+  */
+void EventCoalescer::removePending(const QString& path)
+{
+   const QString prefix = path.endsWith('/') ? path : QString(path).append('/');
+
+   for (QHash<QString, PendingPath>::iterator i = this->pendingPaths.begin(); i != this->pendingPaths.end();)
+   {
+      if (i.key() == path || i.key().startsWith(prefix))
+      {
+         this->nbEventsCoalesced++;
+         i = this->pendingPaths.erase(i);
+      }
+      else
+         ++i;
+   }
+}
+
+/**
+  * The pending events of the moved path and of its children follow it.
+  */
+void EventCoalescer::movePending(const QString& sourcePath, const QString& destinationPath)
+{
+   const QString prefix = sourcePath.endsWith('/') ? sourcePath : QString(sourcePath).append('/');
+
+   QHash<QString, PendingPath> movedPaths;
+   for (QHash<QString, PendingPath>::iterator i = this->pendingPaths.begin(); i != this->pendingPaths.end();)
+   {
+      if (i.key() == sourcePath || i.key().startsWith(prefix))
+      {
+         movedPaths.insert(QString(destinationPath).append(i.key().mid(sourcePath.size())), i.value());
+         i = this->pendingPaths.erase(i);
+      }
+      else
+         ++i;
+   }
+
+   for (QHashIterator<QString, PendingPath> i(movedPaths); i.hasNext();)
+   {
+      i.next();
+      this->pendingPaths.insert(i.key(), i.value());
+   }
+}
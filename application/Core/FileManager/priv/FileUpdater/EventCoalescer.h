@@ -0,0 +1,78 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+  
+#ifndef FILEMANAGER_EVENTCOALESCER_H
+#define FILEMANAGER_EVENTCOALESCER_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QMutex>
+
+#include <Common/Uncopyable.h>
+
+#include <IFileManager.h>
+#include <priv/FileUpdater/DirWatcher.h>
+
+namespace FM
+{
+   class EventCoalescer : Common::Uncopyable
+   {
+   public:
+      EventCoalescer(int quietPeriod);
+
+      void add(const QList<WatcherEvent>& events);
+      QList<WatcherEvent> takeReadyEvents();
+      int getTimeToNextCheck() const;
+      bool isPending(const QString& path) const;
+
+      IFileManager::FileEventStats getStats() const;
+
+   private:
+      void add(const WatcherEvent& event);
+      void removePending(const QString& path);
+      void movePending(const QString& sourcePath, const QString& destinationPath);
+
+      struct PendingPath
+      {
+         WatcherEvent::Type type; ///< 'NEW' or 'CONTENT_CHANGED'.
+         qint64 lastEventTime; ///< [ms], see 'timer'.
+         bool checked; ///< True if 'size' and 'dateLastModified' have been read.
+         qint64 size;
+         QDateTime dateLastModified;
+      };
+
+      const int QUIET_PERIOD; // [ms].
+
+      QElapsedTimer timer;
+      QHash<QString, PendingPath> pendingPaths;
+      QList<WatcherEvent> readyEvents; ///< The events which don't need to wait, in their original order.
+
+      quint64 nbEventsReceived;
+      quint64 nbEventsCoalesced;
+      quint64 nbEventsProcessed;
+      quint64 nbUnstablePaths;
+
+      mutable QMutex mutex; // 'getStats()' may be called from any thread.
+   };
+}
+
+#endif
@@ -21,6 +21,8 @@ using namespace FM;
 
 #include <QLinkedList>
 #include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
 #include <QElapsedTimer>
 
 #include <Common/Settings.h>
@@ -34,36 +36,55 @@ using namespace FM;
 #include <priv/Cache/SharedDirectory.h>
 #include <priv/Cache/Directory.h>
 #include <priv/Cache/File.h>
+#include <priv/Cache/CacheIndex.h>
 #include <priv/FileUpdater/WaitCondition.h>
+#include <priv/FileUpdater/HashingThread.h>
 
 /**
   * @class FM::FileUpdater
   *
+  * The hashes are computed by rounds, see 'computeSomeHashes()'. During a round the FileUpdater thread and
+  * the additional hashing threads ('HashingThread') take the files to hash from the same queues. The number of
+  * files hashed at the same time on one device is limited by the setting 'max_hashing_threads_per_device'.
   */
 
 FileUpdater::FileUpdater(FileManager* fileManager) :
    SCAN_PERIOD_UNWATCHABLE_DIRS(SETTINGS.get<quint32>("scan_period_unwatchable_dirs")),
    fileManager(fileManager),
    dirWatcher(DirWatcher::getNewWatcher()),
+   eventCoalescer(SETTINGS.get<quint32>("file_event_quiet_period")),
    fileCacheInformation(nullptr),
+   cacheIndex(nullptr),
    toStop(false),
    progress(0),
    mutex(QMutex::Recursive),
    currentScanningDir(nullptr),
+   dirScanner(SETTINGS.get<quint32>("number_of_scanning_threads")),
    toStopHashing(false),
+   nbActiveHashers(0),
    remainingSizeToHash(0)
 {
    this->dirEvent = WaitCondition::getNewWaitCondition();
+
+   const int NUMBER_OF_HASHING_THREADS = SETTINGS.get<quint32>("number_of_hashing_threads");
+   for (int i = 1; i < NUMBER_OF_HASHING_THREADS; i++) // The FileUpdater thread is also used to hash.
+      this->hashingThreads << new HashingThread(this);
 }
 
 FileUpdater::~FileUpdater()
 {
+   foreach (HashingThread* hashingThread, this->hashingThreads)
+      delete hashingThread;
+
    if (this->dirEvent)
       delete this->dirEvent;
 
    if (this->dirWatcher)
       delete this->dirWatcher;
 
+   if (this->cacheIndex)
+      delete this->cacheIndex;
+
    L_DEBU("FileUpdater deleted");
 }
 
@@ -126,7 +147,7 @@ void FileUpdater::rmRoot(SharedDirectory* dir, Directory* dir2)
    {
       QMutexLocker locker(&this->hashingMutex);
 
-      this->fileHasher.stop();
+      this->stopFileHashers();
       this->toStopHashing = true;
 
       // TODO: Find a more elegant way!
@@ -153,6 +174,16 @@ void FileUpdater::setFileCache(const Protos::FileCache::Hashes* fileCache)
    this->fileCacheInformation = new FileCacheInformation(fileCache);
 }
 
+/**
+  * Set the index to rebuild the cache from it instead of scanning the shared directories, see 'CacheIndex'.
+  * Muste be called before starting the fileUpdater, in place of 'setFileCache(..)'.
+  * This object must unallocated the index.
+  */
+void FileUpdater::setCacheIndex(CacheIndex* cacheIndex)
+{
+   this->cacheIndex = cacheIndex;
+}
+
 void FileUpdater::prioritizeAFileToHash(File* file)
 {
    QMutexLocker locker(&this->mutex);
@@ -163,21 +194,13 @@ void FileUpdater::prioritizeAFileToHash(File* file)
    {
       QMutexLocker lockerHashing(&this->hashingMutex);
 
-      if (this->filesWithoutHashes.removeOne(file))
-      {
-         this->remainingSizeToHash -= file->getSize();
-      }
-
-      if (!this->filesWithoutHashesPrioritized.contains(file))
-      {
-         this->filesWithoutHashesPrioritized << file;
+      if (this->filesToHash.prioritize(file))
          this->remainingSizeToHash += file->getSize();
-      }
 
       // Commmented to avoid this behavior:
       // When a lot of unhashed tiny file are asked the hashing process will constently abort the current hashing file
       // and will never finish it thus slow down the global hashing rate.
-      // this->fileHasher.stop();
+      // this->stopFileHashers();
 
       this->toStopHashing = true;
    }
@@ -195,7 +218,7 @@ bool FileUpdater::isScanning() const
 bool FileUpdater::isHashing() const
 {
    QMutexLocker locker(&this->mutex);
-   return !this->filesWithoutHashes.isEmpty() || !this->filesWithoutHashesPrioritized.isEmpty();
+   return !this->filesToHash.isEmpty();
 }
 
 int FileUpdater::getProgress() const
@@ -204,6 +227,11 @@ int FileUpdater::getProgress() const
    return this->progress;
 }
 
+IFileManager::FileEventStats FileUpdater::getFileEventStats() const
+{
+   return this->eventCoalescer.getStats();
+}
+
 void FileUpdater::run()
 {
    this->timerScanUnwatchable.start();
@@ -229,12 +257,21 @@ void FileUpdater::run()
       this->fileCacheInformation = nullptr;
    }
 
+   // Or rebuild them from the cache index, the file system is checked by the main loop once the cache is loaded.
+   if (this->cacheIndex)
+   {
+      this->restoreFromCacheIndex();
+      delete this->cacheIndex;
+      this->cacheIndex = nullptr;
+   }
+
    emit fileCacheLoaded();
 
    this->progress = 0;
 
    forever
    {
+      this->validateSomeRestoredDirs();
       this->computeSomeHashes();
 
       this->mutex.lock();
@@ -254,7 +291,7 @@ void FileUpdater::run()
       // we wait for an added directory.
       if (!this->dirWatcher || this->dirWatcher->nbWatchedDir() == 0 || !this->dirsToScan.empty())
       {
-         if (this->dirsToScan.isEmpty() && this->filesWithoutHashes.isEmpty() && this->filesWithoutHashesPrioritized.isEmpty())
+         if (this->dirsToScan.isEmpty() && this->pendingDirsToValidate.isEmpty() && this->filesToHash.isEmpty())
          {
             L_DEBU("Waiting for a new shared directory added..");
             this->mutex.unlock();
@@ -279,16 +316,22 @@ void FileUpdater::run()
       {
          // If we have no dir to scan and no file to hash we wait for a new shared file
          // or a filesystem event.
-         if (this->dirsToScan.isEmpty() && this->filesWithoutHashes.isEmpty() && this->filesWithoutHashesPrioritized.isEmpty())
+         if (this->dirsToScan.isEmpty() && this->pendingDirsToValidate.isEmpty() && this->filesToHash.isEmpty())
          {
+            int timeout = this->unwatchableDirs.isEmpty() ? -1 : SCAN_PERIOD_UNWATCHABLE_DIRS;
+            const int timeToNextCheck = this->eventCoalescer.getTimeToNextCheck(); // The pending events must be checked even if no new event occurs.
+            if (timeToNextCheck != -1 && (timeout == -1 || timeToNextCheck < timeout))
+               timeout = timeToNextCheck;
+
             this->mutex.unlock();
-            this->processEvents(this->dirWatcher->waitEvent(this->unwatchableDirs.isEmpty() ? -1 : SCAN_PERIOD_UNWATCHABLE_DIRS, QList<WaitCondition*>() << this->dirEvent));
+            this->eventCoalescer.add(this->dirWatcher->waitEvent(timeout, QList<WaitCondition*>() << this->dirEvent));
          }
          else
          {
             this->mutex.unlock();
-            this->processEvents(this->dirWatcher->waitEvent(0)); // Just pick the new events. (Don't wait for new event).
+            this->eventCoalescer.add(this->dirWatcher->waitEvent(0)); // Just pick the new events. (Don't wait for new event).
          }
+         this->processEvents(this->eventCoalescer.takeReadyEvents());
       }
 
       if (timerScanUnwatchable.elapsed() >= SCAN_PERIOD_UNWATCHABLE_DIRS)
@@ -314,8 +357,9 @@ void FileUpdater::run()
 }
 
 /**
-  * It will take some files from 'filesWithoutHashesPrioritized' or 'fileWithoutHashes' and compute theirs hashes.
+  * It will take some files from 'filesToHash' and compute theirs hashes.
   * The minimum duration of the compuation is equal to the setting 'minimum_duration_when_hashing'.
+  * The hashing threads compute some hashes concurrently and this method returns when all of them have finished.
   */
 void FileUpdater::computeSomeHashes()
 {
@@ -327,81 +371,106 @@ void FileUpdater::computeSomeHashes()
       return;
    }
 
-   if (this->filesWithoutHashes.isEmpty() && this->filesWithoutHashesPrioritized.isEmpty())
+   if (this->filesToHash.isEmpty())
       return;
 
    L_DEBU("Start computing some hashes . . .");
 
-   QElapsedTimer timer;
-   timer.start();
+   this->hashingRoundTimer.start();
+   this->nbActiveHashers = this->hashingThreads.size() + 1;
 
-   // We take the file from the prioritized list first.
-   QList<QList<File*>*> fileLists { &this->filesWithoutHashesPrioritized, &this->filesWithoutHashes };
-   for (QMutableListIterator<QList<File*>*> i(fileLists); i.hasNext();)
-   {
-      QList<File*>* fileList = i.next();
-      while (!fileList->empty())
-      {
-         File* nextFileToHash = fileList->first();
+   foreach (HashingThread* hashingThread, this->hashingThreads)
+      hashingThread->startHashing();
 
-         if (nextFileToHash->isComplete()) // A file can change its state from 'completed' to 'unfinished' if it's redownloaded.
-         {
-            locker.unlock();
-            bool gotAllHashes;
-            try
-            {
-               int hashedAmount = 0;
-               gotAllHashes = this->fileHasher.start(nextFileToHash->asFileForHasher(), 1, &hashedAmount); // Be carreful of methods 'prioritizeAFileToHash(..)' and 'rmRoot(..)' called concurrently here.
-               this->remainingSizeToHash -= hashedAmount;
-               this->updateHashingProgress();
-            }
-            catch (IOErrorException&)
-            {
-               gotAllHashes = true; // The hashes may be recomputed when a peer ask the hashes with a GET_HASHES request.
-            }
-            locker.relock();
+   locker.unlock();
+   this->computeHashes(this->fileHasher);
+   locker.relock();
 
-            // The current hashing file may have been removed from 'filesWithoutHashes' or 'filesWithoutHashesPrioritized' by 'rmRoot(..)'.
-            if (gotAllHashes && !fileList->isEmpty() && fileList->first() == nextFileToHash)
-               fileList->removeFirst();
+   while (this->nbActiveHashers > 0)
+      this->hashingRoundFinished.wait(&this->hashingMutex);
 
-            // Special case for the prioritized list, we put the file at the end after the computation of a hash.
-            else if (fileList == &this->filesWithoutHashesPrioritized && fileList->size() > 1 && fileList->first() == nextFileToHash)
-               fileList->move(0, fileList->size() - 1);
-         }
-         else
-         {
-            this->remainingSizeToHash -= fileList->first()->getSize();
-            fileList->removeFirst();
-         }
+   this->toStopHashing = false;
 
-         if (this->toStopHashing)
-         {
-            this->toStopHashing = false;
-            goto end;
-         }
+   L_DEBU(QString("Computing some hashes ended. this->filesToHash.size(): %1").arg(this->filesToHash.size()));
 
-         static const quint32 MINIMUM_DURATION_WHEN_HASHING = SETTINGS.get<quint32>("minimum_duration_when_hashing");
-         if (static_cast<quint32>(timer.elapsed()) >= MINIMUM_DURATION_WHEN_HASHING)
-            goto end;
-      }
+   if (this->filesToHash.isEmpty())
+   {
+      this->remainingSizeToHash = 0;
+      this->progress = 0;
    }
+}
 
-end:
-   L_DEBU(QString("Computing some hashes ended. this->filesWithoutHashes.size(): %1, this->filesWithoutHashesPrioritized.size(): %2").arg(this->filesWithoutHashes.size()).arg(this->filesWithoutHashesPrioritized.size()));
+/**
+  * Called by the FileUpdater thread and by each hashing thread during a round started by 'computeSomeHashes()'.
+  * Compute one hash at a time of the next file to hash until the round is over or there is no more file to hash.
+  */
+void FileUpdater::computeHashes(FileHasher& fileHasher)
+{
+   static const quint32 MINIMUM_DURATION_WHEN_HASHING = SETTINGS.get<quint32>("minimum_duration_when_hashing");
+   static const int MAX_HASHING_THREADS_PER_DEVICE = SETTINGS.get<quint32>("max_hashing_threads_per_device");
+
+   QMutexLocker locker(&this->hashingMutex);
 
-   if (this->filesWithoutHashes.isEmpty() && this->filesWithoutHashesPrioritized.isEmpty())
+   while (!this->toStopHashing && static_cast<quint32>(this->hashingRoundTimer.elapsed()) < MINIMUM_DURATION_WHEN_HASHING)
    {
-      this->remainingSizeToHash = 0;
-      this->progress = 0;
+      File* nextFileToHash = this->filesToHash.next(this->nbHashersPerDevice, MAX_HASHING_THREADS_PER_DEVICE, this->filesBeingHashed);
+      if (!nextFileToHash)
+         break;
+
+      if (!nextFileToHash->isComplete()) // A file can change its state from 'completed' to 'unfinished' if it's redownloaded.
+      {
+         this->remainingSizeToHash -= nextFileToHash->getSize();
+         this->filesToHash.remove(nextFileToHash);
+         continue;
+      }
+
+      const QString deviceId = nextFileToHash->getRoot()->getDeviceId();
+      this->filesBeingHashed.insert(nextFileToHash);
+      this->nbHashersPerDevice[deviceId]++;
+      locker.unlock();
+
+      bool gotAllHashes;
+      int hashedAmount = 0;
+      try
+      {
+         gotAllHashes = fileHasher.start(nextFileToHash->asFileForHasher(), 1, &hashedAmount); // Be carreful of methods 'prioritizeAFileToHash(..)' and 'rmRoot(..)' called concurrently here.
+      }
+      catch (IOErrorException&)
+      {
+         gotAllHashes = true; // The hashes may be recomputed when a peer ask the hashes with a GET_HASHES request.
+      }
+
+      locker.relock();
+
+      this->remainingSizeToHash -= hashedAmount;
+      const qint64 remainingSizeToHash = this->remainingSizeToHash;
+      this->filesBeingHashed.remove(nextFileToHash);
+      if (--this->nbHashersPerDevice[deviceId] == 0)
+         this->nbHashersPerDevice.remove(deviceId);
+
+      // The current hashing file may have been removed from 'filesToHash' by 'rmRoot(..)'.
+      if (gotAllHashes)
+         this->filesToHash.remove(nextFileToHash);
+      else
+         this->filesToHash.postpone(nextFileToHash);
+
+      locker.unlock();
+      this->updateHashingProgress(remainingSizeToHash); // Must not be called with 'hashingMutex' locked, see 'prioritizeAFileToHash(..)'.
+      locker.relock();
    }
+
+   if (--this->nbActiveHashers == 0)
+      this->hashingRoundFinished.wakeAll();
 }
 
-void FileUpdater::updateHashingProgress()
+/**
+  * @param remainingSizeToHash A value of 'remainingSizeToHash' read with 'hashingMutex' locked.
+  */
+void FileUpdater::updateHashingProgress(qint64 remainingSizeToHash)
 {
    const quint64 totalAmountOfData = this->fileManager->getAmount();
    QMutexLocker locker(&this->mutex);
-   this->progress = totalAmountOfData == 0 ? 0 : 10000LL * (totalAmountOfData - this->remainingSizeToHash) / totalAmountOfData;
+   this->progress = totalAmountOfData == 0 ? 0 : 10000LL * (totalAmountOfData - remainingSizeToHash) / totalAmountOfData;
 }
 
 /**
@@ -413,20 +482,32 @@ void FileUpdater::stopHashing()
    QMutexLocker lockerHashing(&this->hashingMutex);
    L_DEBU("Stop hashing . . .");
 
-   this->fileHasher.stop();
+   this->stopFileHashers();
 
    L_DEBU("Hashing stopped");
    this->toStopHashing = true;
 }
 
+/**
+  * Stop the hasher of the FileUpdater thread and the ones of the hashing threads.
+  * 'hashingMutex' must be locked.
+  */
+void FileUpdater::stopFileHashers()
+{
+   this->fileHasher.stop();
+   foreach (HashingThread* hashingThread, this->hashingThreads)
+      hashingThread->stopHashing();
+}
+
 /**
   * Synchronize the cache with the file system.
   * Scan recursively all the directories and files contained
   * in dir. Create the associated cached tree structure under the
   * given 'Directory*'.
   * The directories may already exist in the cache.
+  * @param recursive If 'false' only the new sub-directories are scanned.
   */
-void FileUpdater::scan(Directory* dir, bool addUnfinished)
+void FileUpdater::scan(Directory* dir, bool addUnfinished, bool recursive)
 {
    L_DEBU("Start scanning a shared directory : " + dir->getFullPath());
 
@@ -434,39 +515,45 @@ void FileUpdater::scan(Directory* dir, bool addUnfinished)
    this->currentScanningDir = dir;
    this->scanningMutex.unlock();
 
-   QLinkedList<Directory*> dirsToVisit;
-   dirsToVisit << dir;
+   // The directories are read by 'dirScanner' and merged here, in any order.
+   this->dirScanner.add(dir);
 
-   while (!dirsToVisit.isEmpty())
+   DirScanner::Result result;
+   while (this->dirScanner.next(result))
    {
-      Directory* currentDir = dirsToVisit.takeFirst();
+      Directory* currentDir = result.dir;
+
+      if (!result.readable)
+         L_DEBU("Unable to read the directory : " + currentDir->getFullPath());
 
       QLinkedList<Directory*> currentSubDirs = currentDir->getSubDirs();
       QList<File*> currentFiles = currentDir->getCompleteFiles(); // We don't care about the unfinished files.
 
-      foreach (QFileInfo entry, QDir(currentDir->getFullPath()).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks)) // TODO: Add an option to follow or not symlinks.
+      foreach (const DirScanner::ScannedEntry& entry, result.entries)
       {
          QMutexLocker locker(&this->scanningMutex);
 
          if (!this->currentScanningDir || this->toStop)
          {
             L_DEBU("Scanning aborted : " + dir->getFullPath());
+            this->dirScanner.abort();
             this->currentScanningDir = nullptr;
             this->scanningStopped.wakeOne();
             return;
          }
 
-         if (entry.isDir())
+         if (entry.isDir)
          {
-            Directory* dir = currentDir->createSubDir(entry.fileName());
-            dir->setScanned(false);
-            dirsToVisit << dir;
-
-            currentSubDirs.removeOne(dir);
+            Directory* dir = currentDir->createSubDir(entry.name);
+            if (!currentSubDirs.removeOne(dir) || recursive)
+            {
+               dir->setScanned(false);
+               this->dirScanner.add(dir);
+            }
          }
-         else if (addUnfinished || !Global::isFileUnfinished(entry.fileName()))
+         else if (addUnfinished || !Global::isFileUnfinished(entry.name))
          {
-            File* file = currentDir->getFile(entry.fileName());
+            File* file = currentDir->getFile(entry.name);
             QMutexLocker locker(&this->mutex);
 
             // Only used when loading the cache to compute the progress.
@@ -479,10 +566,9 @@ void FileUpdater::scan(Directory* dir, bool addUnfinished)
             if (file)
             {
                if (
-                   !this->filesWithoutHashes.contains(file) && // The case where a file is being copied and a lot of modification event is thrown (thus the file is in this->filesWithoutHashes).
-                   !this->filesWithoutHashesPrioritized.contains(file) &&
+                   !this->filesToHash.contains(file) && // The case where a file is being copied and a lot of modification event is thrown (thus the file is in this->filesToHash).
                    file->isComplete() &&
-                   !file->correspondTo(entry, file->hasAllHashes()) // If the hashes of a file can't be computed (IO error, the file is being written for example) we only compare their sizes.
+                   !file->correspondTo(entry.size, entry.dateLastModified, file->hasAllHashes()) // If the hashes of a file can't be computed (IO error, the file is being written for example) we only compare their sizes.
                )
                {
                   currentFiles.removeOne(file);
@@ -500,9 +586,9 @@ void FileUpdater::scan(Directory* dir, bool addUnfinished)
                // Very special case : there is a file 'a' without File* in cache and a file 'a.unfinished'.
                // This case occure when a file is redownloaded, the File* 'a' is renamed as 'a.unfinished' but the physical file 'a'
                // is not deleted.
-               File* unfinishedFile = currentDir->getFile(entry.fileName().append(Global::getUnfinishedSuffix()));
+               File* unfinishedFile = currentDir->getFile(QString(entry.name).append(Global::getUnfinishedSuffix()));
                if (!unfinishedFile)
-                  file = new File(currentDir, entry.fileName(), entry.size(), entry.lastModified());
+                  file = new File(currentDir, entry.name, entry.size, entry.dateLastModified);
                else
                {
                   currentFiles.removeOne(unfinishedFile);
@@ -511,9 +597,13 @@ void FileUpdater::scan(Directory* dir, bool addUnfinished)
             }
 
             // If a file is incomplete (unfinished) we can't compute its hashes because we don't have all data.
-            if (file->getSize() > 0 && !file->hasAllHashes() && file->isComplete() && !this->filesWithoutHashes.contains(file) && !this->filesWithoutHashesPrioritized.contains(file))
+            // A file still being written is deferred, its directory will be scanned again when its event is ready.
+            if (
+               file->getSize() > 0 && !file->hasAllHashes() && file->isComplete() && !this->filesToHash.contains(file) &&
+               !this->eventCoalescer.isPending(file->getFullPath())
+            )
             {
-               this->filesWithoutHashes << file;
+               this->filesToHash.add(file);
                this->remainingSizeToHash += file->getSize();
             }
          }
@@ -526,6 +616,7 @@ void FileUpdater::scan(Directory* dir, bool addUnfinished)
       foreach (Directory* d, currentSubDirs)
          this->deleteEntry(d);
 
+      currentDir->setDateLastModified(result.dateLastModified); // Read before the content, a change made during the scan will be detected by 'validateSomeRestoredDirs()'.
       currentDir->setScanned(true);
    }
 
@@ -583,10 +674,7 @@ void FileUpdater::deleteEntry(Entry* entry)
    }
    else if (File* file = dynamic_cast<File*>(entry))
    {
-      bool fileInAList = this->filesWithoutHashes.removeOne(file);
-      fileInAList |= this->filesWithoutHashesPrioritized.removeOne(file);
-
-      if (fileInAList)
+      if (this->filesToHash.remove(file))
          this->remainingSizeToHash -= file->getSize();
    }
 
@@ -595,14 +683,22 @@ void FileUpdater::deleteEntry(Entry* entry)
 }
 
 /**
-  * Remove a directory and its sub directories from 'this->dirsToScan'.
+  * Remove a directory and its sub directories from 'this->dirsToScan' and 'this->pendingDirsToValidate'.
+  * They are left in 'this->dirsToValidate' and skipped by 'validateSomeRestoredDirs()'.
   */
 void FileUpdater::removeFromDirsToScan(Directory* dir)
 {
    this->dirsToScan.removeOne(dir);
+   this->pendingDirsToValidate.remove(dir);
    DirIterator i(dir);
    while (Directory* subDir = i.next())
+   {
       this->dirsToScan.removeOne(subDir);
+      this->pendingDirsToValidate.remove(subDir);
+   }
+
+   if (this->pendingDirsToValidate.isEmpty())
+      this->dirsToValidate.clear();
 }
 
 /**
@@ -610,25 +706,8 @@ void FileUpdater::removeFromDirsToScan(Directory* dir)
   */
 void FileUpdater::removeFromFilesWithoutHashes(Directory* dir)
 {
-   for (QMutableListIterator<File*> i(this->filesWithoutHashes); i.hasNext();)
-   {
-      File* f = i.next();
-      if (f->hasAParentDir(dir))
-      {
-         this->remainingSizeToHash -= f->getSize();
-         i.remove();
-      }
-   }
-
-   for (QMutableListIterator<File*> i(this->filesWithoutHashesPrioritized); i.hasNext();)
-   {
-      File* f = i.next();
-      if (f->hasAParentDir(dir))
-      {
-         this->remainingSizeToHash -= f->getSize();
-         i.remove();
-      }
-   }
+   foreach (File* f, this->filesToHash.removeIf([dir](File* f) { return f->hasAParentDir(dir); }))
+      this->remainingSizeToHash -= f->getSize();
 }
 
 /**
@@ -650,20 +729,116 @@ void FileUpdater::restoreFromFileCache(SharedDirectory* dir)
       {
          QSet<File*> filesWithHashes = dir->restoreFromFileCache(this->fileCacheInformation->getFileCache()->shareddir(i).root()).toSet();
 
-         for (QMutableListIterator<File*> i(this->filesWithoutHashes); i.hasNext();)
+         foreach (File* f, this->filesToHash.removeIf([&filesWithHashes](File* f) { return filesWithHashes.contains(f); }))
+            this->remainingSizeToHash -= f->getSize();
+
+         break;
+      }
+
+   L_DEBU("Restoring terminated: " + dir->getFullPath());
+}
+
+/**
+  * Build the tree of each shared directory from the cache index, the file system isn't read.
+  * The restored shared directories are put in 'dirsToValidate', the ones which can't be restored are scanned.
+  */
+void FileUpdater::restoreFromCacheIndex()
+{
+   const int nbDirs = this->dirsToScan.size();
+   while (!this->dirsToScan.isEmpty())
+   {
+      SharedDirectory* dir = static_cast<SharedDirectory*>(this->dirsToScan.takeFirst());
+      L_DEBU("Start restoring a shared directory from the cache index : " + dir->getFullPath());
+
+      QList<File*> filesWithoutHashes;
+      if (this->cacheIndex->restore(dir, filesWithoutHashes))
+      {
+         QMutexLocker locker(&this->mutex);
+         this->dirsToValidate << dir;
+         this->pendingDirsToValidate.insert(dir);
+         foreach (File* file, filesWithoutHashes)
+         {
+            this->filesToHash.add(file);
+            this->remainingSizeToHash += file->getSize();
+         }
+      }
+      else
+      {
+         L_WARN(QString("Unable to restore this directory from the cache index, it will be scanned : %1").arg(dir->getFullPath()));
+         this->scan(dir, true);
+      }
+
+      QMutexLocker locker(&this->mutex);
+      this->progress = 10000LL * (nbDirs - this->dirsToScan.size()) / nbDirs;
+   }
+}
+
+/**
+  * Compare some directories restored from the cache index with the file system, called by the main loop between the other tasks.
+  * The modification date of each directory is compared, and the size and the modification date of each of its complete files,
+  * the files aren't read. The directories which have changed are scanned again without their known sub-directories.
+  * A pass lasts at most the setting 'minimum_duration_when_hashing'.
+  */
+void FileUpdater::validateSomeRestoredDirs()
+{
+   static const quint32 MAXIMUM_DURATION_WHEN_VALIDATING = SETTINGS.get<quint32>("minimum_duration_when_hashing");
+
+   QElapsedTimer timer;
+   timer.start();
+
+   while (timer.elapsed() < MAXIMUM_DURATION_WHEN_VALIDATING)
+   {
+      Directory* dir;
+      {
+         QMutexLocker locker(&this->mutex);
+         // The directories removed in the meantime aren't pending anymore.
+         do
+         {
+            if (this->toStop || this->dirsToValidate.isEmpty())
+               return;
+            dir = this->dirsToValidate.takeFirst();
+         } while (!this->pendingDirsToValidate.remove(dir));
+      }
+
+      const QFileInfo dirInfo(dir->getFullPath());
+
+      if (!dirInfo.isDir())
+      {
+         if (SharedDirectory* sharedDir = dynamic_cast<SharedDirectory*>(dir))
+            emit deleteSharedDir(sharedDir);
+         else
+            this->deleteEntry(dir);
+         continue;
+      }
+
+      bool changed = dirInfo.lastModified() != dir->getDateLastModified();
+      if (!changed)
+      {
+         // A file modified in place doesn't change the date of its directory.
+         foreach (File* file, dir->getFiles())
          {
-            File* f = i.next();
-            if (filesWithHashes.contains(f))
+            if (!file->isComplete())
+               continue;
+
+            const QFileInfo fileInfo(file->getFullPath());
+            if (!fileInfo.isFile() || !file->correspondTo(fileInfo.size(), fileInfo.lastModified(), file->hasAllHashes()))
             {
-               this->remainingSizeToHash -= f->getSize();
-               i.remove();
+               changed = true;
+               break;
             }
          }
-
-         break;
       }
 
-   L_DEBU("Restoring terminated: " + dir->getFullPath());
+      if (changed)
+         this->scan(dir, false, false);
+
+      QMutexLocker locker(&this->mutex);
+      foreach (Directory* subDir, dir->getSubDirs())
+      {
+         this->dirsToValidate << subDir;
+         this->pendingDirsToValidate.insert(subDir);
+      }
+   }
 }
 
 /**
@@ -24,11 +24,18 @@
 #include <QMutex>
 #include <QString>
 #include <QList>
+#include <QSet>
+#include <QHash>
 #include <QElapsedTimer>
 
 #include <Protos/files_cache.pb.h>
 
+#include <IFileManager.h>
+
 #include <priv/FileUpdater/DirWatcher.h>
+#include <priv/FileUpdater/DirScanner.h>
+#include <priv/FileUpdater/EventCoalescer.h>
+#include <priv/FileUpdater/FilesToHash.h>
 #include <priv/Cache/FileHasher.h>
 
 namespace FM
@@ -39,22 +46,28 @@ namespace FM
    class File;
    class Entry;
    class WaitCondition;
+   class HashingThread;
+   class CacheIndex;
 
    class FileUpdater : public QThread
    {
       Q_OBJECT
 
+      friend class HashingThread;
+
    public:
       FileUpdater(FileManager* fileManager);
       ~FileUpdater();
 
       void stop();
       void setFileCache(const Protos::FileCache::Hashes* fileCache);
+      void setCacheIndex(CacheIndex* cacheIndex);
       void prioritizeAFileToHash(File* file);
 
       bool isScanning() const;
       bool isHashing() const;
       int getProgress() const;
+      IFileManager::FileEventStats getFileEventStats() const;
 
    public slots:
       void addRoot(SharedDirectory* dir);
@@ -69,11 +82,13 @@ namespace FM
 
    private:
       void computeSomeHashes();
-      void updateHashingProgress();
+      void computeHashes(FileHasher& fileHasher);
+      void updateHashingProgress(qint64 remainingSizeToHash);
 
       void stopHashing();
+      void stopFileHashers();
 
-      void scan(Directory* dir, bool addUnfinished = false);
+      void scan(Directory* dir, bool addUnfinished = false, bool recursive = true);
 
       void stopScanning(Directory* dir = nullptr);
 
@@ -82,6 +97,8 @@ namespace FM
       void removeFromFilesWithoutHashes(Directory* dir);
 
       void restoreFromFileCache(SharedDirectory* dir);
+      void restoreFromCacheIndex();
+      void validateSomeRestoredDirs();
 
       bool processEvents(const QList<WatcherEvent>& events);
 
@@ -89,6 +106,7 @@ namespace FM
 
       FileManager* fileManager;
       DirWatcher* dirWatcher;
+      EventCoalescer eventCoalescer; ///< The events from 'dirWatcher' are merged before being processed, see the setting 'file_event_quiet_period'.
 
       class FileCacheInformation
       {
@@ -108,30 +126,39 @@ namespace FM
          int fileCacheNbFilesLoaded;
       };
       FileCacheInformation* fileCacheInformation; // Only used during the loading of 'fileCache'.
+      CacheIndex* cacheIndex; ///< Replaces 'fileCacheInformation' when the cache is loaded from its index. Only used at the begining of 'run()'.
 
       bool toStop; ///< Set to true when the service must be stopped.
 
       int progress;
 
       WaitCondition* dirEvent; ///< Using to wait when a sharing directory is added or deleted.
-      mutable QMutex mutex; ///< Prevent the access from many thread to the internal data like 'filesWithoutHashes' for example.
+      mutable QMutex mutex; ///< Prevent the access from many thread to the internal data like 'filesToHash' for example.
 
       QList<Directory*> unwatchableDirs;
       QElapsedTimer timerScanUnwatchable;
       QList<Directory*> dirsToScan; ///< When something change in a directory we put it in this list until it is scanned.
+      QList<Directory*> dirsToValidate; ///< The directories restored from the cache index not yet compared with the file system, see 'validateSomeRestoredDirs()'. May contain removed directories.
+      QSet<Directory*> pendingDirsToValidate; ///< The directories of 'dirsToValidate' which haven't been removed, allows to remove a directory in constant time.
       Directory* currentScanningDir;
       QWaitCondition scanningStopped;
       mutable QMutex scanningMutex;
+      DirScanner dirScanner; ///< Reads the directories to scan with several threads, see the setting 'number_of_scanning_threads'.
 
       mutable QMutex hashingMutex;
       bool toStopHashing;
-      FileHasher fileHasher;
+      FileHasher fileHasher; ///< Used by the FileUpdater thread itself.
+      QList<HashingThread*> hashingThreads; ///< The additional threads, see the setting 'number_of_hashing_threads'.
+      int nbActiveHashers; ///< The number of hashers which haven't finished the current round.
+      QWaitCondition hashingRoundFinished;
+      QElapsedTimer hashingRoundTimer;
+      QSet<File*> filesBeingHashed;
+      QHash<QString, int> nbHashersPerDevice; ///< Device id -> number of files being hashed on this device.
 
       QList<SharedDirectory*> dirsToRemove;
 
-      QList<File*> filesWithoutHashes;
-      QList<File*> filesWithoutHashesPrioritized;
-      qint64 remainingSizeToHash;
+      FilesToHash filesToHash;
+      qint64 remainingSizeToHash; ///< Protected by 'hashingMutex'.
    };
 }
 #endif
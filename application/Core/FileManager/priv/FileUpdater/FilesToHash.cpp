@@ -0,0 +1,161 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/FileUpdater/FilesToHash.h>
+using namespace FM;
+
+#include <priv/Cache/File.h>
+#include <priv/Cache/SharedDirectory.h>
+
+bool FilesToHash::isEmpty() const
+{
+   return this->fileDevices.isEmpty();
+}
+
+int FilesToHash::size() const
+{
+   return this->fileDevices.size();
+}
+
+bool FilesToHash::contains(File* file) const
+{
+   return this->fileDevices.contains(file);
+}
+
+/**
+  * Append a file to the queue of its device, nothing is done if the file is already queued.
+  */
+void FilesToHash::add(File* file)
+{
+   if (this->fileDevices.contains(file))
+      return;
+
+   const QString& deviceId = file->getRoot()->getDeviceId();
+   this->fileDevices.insert(file, deviceId);
+   this->devices[deviceId].normal << file;
+}
+
+/**
+  * Put a file at the end of the prioritized queue of its device, it's removed from the normal queue if needed.
+  * @return 'true' if the file wasn't queued before.
+  */
+bool FilesToHash::prioritize(File* file)
+{
+   auto i = this->fileDevices.constFind(file);
+   if (i == this->fileDevices.constEnd())
+   {
+      const QString& deviceId = file->getRoot()->getDeviceId();
+      this->fileDevices.insert(file, deviceId);
+      this->devices[deviceId].prioritized << file;
+      return true;
+   }
+
+   Queues& queues = this->devices[i.value()];
+   if (queues.normal.removeOne(file))
+      queues.prioritized << file;
+   return false;
+}
+
+/**
+  * @return 'true' if the file was queued.
+  */
+bool FilesToHash::remove(File* file)
+{
+   const QString deviceId = this->fileDevices.take(file);
+   if (deviceId.isNull())
+      return false;
+
+   auto i = this->devices.find(deviceId);
+   if (!i->prioritized.removeOne(file))
+      i->normal.removeOne(file);
+
+   if (i->prioritized.isEmpty() && i->normal.isEmpty())
+      this->devices.erase(i);
+
+   return true;
+}
+
+/**
+  * Remove all the files matching the predicate.
+  * @return The removed files.
+  */
+QList<File*> FilesToHash::removeIf(std::function<bool(File*)> predicate)
+{
+   QList<File*> removedFiles;
+
+   for (auto i = this->devices.begin(); i != this->devices.end();)
+   {
+      for (QList<File*>* files : { &i->prioritized, &i->normal })
+         for (QMutableListIterator<File*> j(*files); j.hasNext();)
+         {
+            File* file = j.next();
+            if (predicate(file))
+            {
+               removedFiles << file;
+               this->fileDevices.remove(file);
+               j.remove();
+            }
+         }
+
+      if (i->prioritized.isEmpty() && i->normal.isEmpty())
+         i = this->devices.erase(i);
+      else
+         ++i;
+   }
+
+   return removedFiles;
+}
+
+/**
+  * A prioritized file is put at the end of its queue after each computed hash, the other prioritized files aren't delayed
+  * by a big one. A file of the normal queue stays in place to be finished first.
+  */
+void FilesToHash::postpone(File* file)
+{
+   auto i = this->fileDevices.constFind(file);
+   if (i == this->fileDevices.constEnd())
+      return;
+
+   Queues& queues = this->devices[i.value()];
+   if (queues.prioritized.removeOne(file))
+      queues.prioritized << file;
+}
+
+/**
+  * Return the next file to hash, the prioritized ones first. The files already being hashed and the devices which have
+  * reached 'maxHashersPerDevice' are skipped, only the first files of each queue are read.
+  * Return 'nullptr' if there is no such file.
+  */
+File* FilesToHash::next(const QHash<QString, int>& nbHashersPerDevice, int maxHashersPerDevice, const QSet<File*>& filesBeingHashed) const
+{
+   for (bool prioritized : { true, false })
+      for (auto i = this->devices.constBegin(); i != this->devices.constEnd(); ++i)
+      {
+         if (nbHashersPerDevice.value(i.key()) >= maxHashersPerDevice)
+            continue;
+
+         for (QListIterator<File*> j(prioritized ? i->prioritized : i->normal); j.hasNext();)
+         {
+            File* file = j.next();
+            if (!filesBeingHashed.contains(file))
+               return file;
+         }
+      }
+
+   return nullptr;
+}
@@ -0,0 +1,68 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_FILESTOHASH_H
+#define FILEMANAGER_FILESTOHASH_H
+
+#include <functional>
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QSet>
+
+#include <Common/Uncopyable.h>
+
+namespace FM
+{
+   class File;
+
+   /**
+     * The files waiting to be hashed, with one queue per device: the next file of an idle device is found without going
+     * through the files of the busy ones. Each device has a prioritized queue, see 'FileUpdater::prioritizeAFileToHash(..)'.
+     * The device of a file is the one of its shared directory, see 'SharedDirectory::getDeviceId()'.
+     * This class isn't thread safe.
+     */
+   class FilesToHash : Common::Uncopyable
+   {
+   public:
+      bool isEmpty() const;
+      int size() const;
+      bool contains(File* file) const;
+
+      void add(File* file);
+      bool prioritize(File* file);
+      bool remove(File* file);
+      QList<File*> removeIf(std::function<bool(File*)> predicate);
+      void postpone(File* file);
+
+      File* next(const QHash<QString, int>& nbHashersPerDevice, int maxHashersPerDevice, const QSet<File*>& filesBeingHashed) const;
+
+   private:
+      struct Queues
+      {
+         QList<File*> prioritized;
+         QList<File*> normal;
+      };
+
+      QHash<QString, Queues> devices; ///< Device id -> its queues. A device without file is removed.
+      QHash<File*, QString> fileDevices; ///< File -> device id, the device is read only once per file.
+   };
+}
+
+#endif
@@ -0,0 +1,97 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/FileUpdater/HashingThread.h>
+using namespace FM;
+
+#include <QMutexLocker>
+
+#include <priv/FileUpdater/FileUpdater.h>
+
+/**
+  * @class FM::HashingThread
+  *
+  * An additional thread used by 'FileUpdater' to compute the hashes of many files at the same time.
+  * Each thread owns its 'FileHasher' and waits until a hashing round is started by 'FileUpdater::computeSomeHashes()',
+  * the files to hash are then taken from the 'FileUpdater' queues, see 'FileUpdater::computeHashes(..)'.
+  */
+
+HashingThread::HashingThread(FileUpdater* fileUpdater) :
+   fileUpdater(fileUpdater),
+   active(false),
+   toStop(false)
+{
+   this->start();
+}
+
+HashingThread::~HashingThread()
+{
+   this->mutex.lock();
+   this->toStop = true;
+   this->waitCondition.wakeOne();
+   this->mutex.unlock();
+
+   this->fileHasher.stop();
+
+   this->wait();
+}
+
+/**
+  * Begin a new hashing round, see 'FileUpdater::computeSomeHashes()'.
+  */
+void HashingThread::startHashing()
+{
+   QMutexLocker locker(&this->mutex);
+   this->active = true;
+   this->waitCondition.wakeOne();
+}
+
+/**
+  * Abort the current hashed file, it will be requeued by 'FileUpdater'.
+  */
+void HashingThread::stopHashing()
+{
+   this->fileHasher.stop();
+}
+
+void HashingThread::run()
+{
+   QString threadName = "HashingThread";
+#if DEBUG
+   threadName.append("_").append(QString::number((intptr_t)QThread::currentThreadId()));
+#endif
+   QThread::currentThread()->setObjectName(threadName);
+
+   forever
+   {
+      this->mutex.lock();
+      while (!this->active && !this->toStop)
+         this->waitCondition.wait(&this->mutex);
+
+      if (this->toStop)
+      {
+         this->mutex.unlock();
+         return;
+      }
+
+      this->active = false;
+      this->mutex.unlock();
+
+      this->fileUpdater->computeHashes(this->fileHasher);
+   }
+}
@@ -0,0 +1,56 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_HASHINGTHREAD_H
+#define FILEMANAGER_HASHINGTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <priv/Cache/FileHasher.h>
+
+namespace FM
+{
+   class FileUpdater;
+
+   class HashingThread : public QThread
+   {
+      Q_OBJECT
+   public:
+      HashingThread(FileUpdater* fileUpdater);
+      ~HashingThread();
+
+      void startHashing();
+      void stopHashing();
+
+   protected:
+      void run();
+
+   private:
+      FileUpdater* fileUpdater;
+      FileHasher fileHasher;
+
+      bool active; ///< Set to true by 'startHashing()' to begin a new round of hashing.
+      bool toStop;
+      QWaitCondition waitCondition;
+      QMutex mutex;
+   };
+}
+
+#endif
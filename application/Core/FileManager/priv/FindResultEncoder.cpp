@@ -0,0 +1,128 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/FindResultEncoder.h>
+using namespace FM;
+
+#include <cstring>
+
+#include <google/protobuf/io/coded_stream.h>
+using google::protobuf::io::CodedOutputStream;
+
+/**
+  * @param maxPayloadSize The maximum size of each payload, the 'tag' field included. It must be greater than the size of the 'tag' field.
+  */
+FindResultEncoder::FindResultEncoder(int maxPayloadSize) :
+   capacity(getCapacity(maxPayloadSize))
+{
+}
+
+/**
+  * Serialize the given entry into the first payload having enough room for it.
+  * @return 'false' if the entry is too big to fit in an empty payload, it's then ignored.
+  */
+bool FindResultEncoder::add(const Protos::Common::FindResult::EntryLevel& entryLevel)
+{
+   const int size = getEncodedSize(entryLevel);
+
+   const int i = firstFit(this->freeSpaces, this->capacity, size);
+   if (i == -1)
+      return false;
+
+   if (i == this->payloads.size())
+      this->payloads << QByteArray();
+
+   QByteArray& payload = this->payloads[i];
+   const int offset = payload.size();
+   payload.resize(offset + size);
+
+   quint8* target = reinterpret_cast<quint8*>(payload.data()) + offset;
+   *target++ = ENTRY_KEY;
+   target = CodedOutputStream::WriteVarint32ToArray(entryLevel.GetCachedSize(), target);
+   entryLevel.SerializeWithCachedSizesToArray(target);
+
+   return true;
+}
+
+/**
+  * Return the payloads, each one is a serialized 'Protos::Common::FindResult' without its field 'tag'.
+  * The encoder is then empty.
+  */
+QList<QByteArray> FindResultEncoder::takePayloads()
+{
+   this->freeSpaces.clear();
+   QList<QByteArray> result;
+   result.swap(this->payloads);
+   return result;
+}
+
+/**
+  * Return a whole 'Protos::Common::FindResult' from a payload returned by 'takePayloads()'.
+  * The field 'tag' is put first but the order of the fields doesn't matter to the parser.
+  */
+QByteArray FindResultEncoder::withTag(const QByteArray& payload, quint64 tag)
+{
+   QByteArray result(MAX_TAG_FIELD_SIZE + payload.size(), Qt::Uninitialized);
+   quint8* target = reinterpret_cast<quint8*>(result.data());
+   *target++ = TAG_KEY;
+   target = CodedOutputStream::WriteVarint64ToArray(tag, target);
+   memcpy(target, payload.constData(), payload.size());
+   result.truncate(reinterpret_cast<char*>(target) - result.constData() + payload.size());
+   return result;
+}
+
+/**
+  * Return the room left for the entries in a 'FindResult' of at most 'maxPayloadSize' bytes.
+  */
+int FindResultEncoder::getCapacity(int maxPayloadSize)
+{
+   Q_ASSERT_X(maxPayloadSize > MAX_TAG_FIELD_SIZE, "FindResultEncoder::getCapacity(..)", "The maximum size must leave room for the field 'tag'");
+   return qMax(0, maxPayloadSize - MAX_TAG_FIELD_SIZE);
+}
+
+/**
+  * Return the size of the field 'FindResult.entry' holding the given entry.
+  * The sizes of the sub-messages are cached for 'SerializeWithCachedSizesToArray(..)', the entry must not be modified afterwards.
+  */
+int FindResultEncoder::getEncodedSize(const Protos::Common::FindResult::EntryLevel& entryLevel)
+{
+   const int entryLevelSize = entryLevel.ByteSize();
+   return 1 + CodedOutputStream::VarintSize32(entryLevelSize) + entryLevelSize;
+}
+
+/**
+  * Return the index of the first 'FindResult' having at least 'size' bytes free and reserve them. A new 'FindResult' is
+  * accounted at the end of 'freeSpaces' if needed, its index is then 'freeSpaces.size() - 1'.
+  * Return -1 if 'size' is greater than an empty 'FindResult'.
+  * @param freeSpaces The remaining space of each 'FindResult'.
+  */
+int FindResultEncoder::firstFit(QVector<int>& freeSpaces, int capacity, int size)
+{
+   if (size > capacity)
+      return -1;
+
+   int i = 0;
+   while (i < freeSpaces.size() && freeSpaces[i] < size)
+      i++;
+
+   if (i == freeSpaces.size())
+      freeSpaces << capacity;
+
+   freeSpaces[i] -= size;
+   return i;
+}
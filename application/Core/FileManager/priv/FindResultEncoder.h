@@ -0,0 +1,69 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_FIND_RESULT_ENCODER_H
+#define FILEMANAGER_FIND_RESULT_ENCODER_H
+
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+
+#include <Protos/common.pb.h>
+
+#include <Common/Uncopyable.h>
+
+namespace FM
+{
+   /**
+     * Encodes the entries of a search result directly into the payloads of some 'Protos::Common::FindResult' messages, each
+     * payload can't exceed a given size (a UDP datagram).
+     * Each entry is serialized only once, at its final place. It goes into the first payload having enough room for it
+     * (first fit), thus a small entry can fill the space left at the end of a payload by a bigger one.
+     * The size of each entry is exact, it includes the key and the length prefix of the field 'FindResult.entry'.
+     *
+     * The payloads don't contain the field 'FindResult.tag' but have room for it, whatever its value, thus they can be
+     * cached and reused for different requests, see 'withTag(..)'.
+     * The payloads grow with their entries, the maximum size may be much greater than the results.
+     */
+   class FindResultEncoder : Common::Uncopyable
+   {
+   public:
+      FindResultEncoder(int maxPayloadSize);
+
+      bool add(const Protos::Common::FindResult::EntryLevel& entryLevel);
+      QList<QByteArray> takePayloads();
+
+      static QByteArray withTag(const QByteArray& payload, quint64 tag);
+
+      static int getCapacity(int maxPayloadSize);
+      static int getEncodedSize(const Protos::Common::FindResult::EntryLevel& entryLevel);
+      static int firstFit(QVector<int>& freeSpaces, int capacity, int size);
+
+   private:
+      static const quint8 TAG_KEY = 0x08; ///< The key of 'FindResult.tag': field 1, wire type varint (0).
+      static const quint8 ENTRY_KEY = 0x12; ///< The key of 'FindResult.entry': field 2, wire type length-delimited (2).
+      static const int MAX_TAG_FIELD_SIZE = 11; ///< The key and a varint of 64 bits.
+
+      const int capacity; ///< The maximum size of a payload without the tag.
+
+      QList<QByteArray> payloads; // Each one grows up to 'capacity' bytes.
+      QVector<int> freeSpaces; // The remaining space of each payload.
+   };
+}
+
+#endif
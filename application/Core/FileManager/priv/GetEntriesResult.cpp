@@ -19,7 +19,10 @@
 #include <priv/GetEntriesResult.h>
 using namespace FM;
 
+#include <Protos/core_protocol.pb.h>
+
 #include <Common/Settings.h>
+#include <Common/ProtoHelper.h>
 
 #include <priv/Log.h>
 
@@ -33,14 +36,15 @@ void GetEntriesResult::start()
    if (!this->dir)
    {
       L_DEBU("FM::GetEntriesResult::start(): null directory");
-      this->res.set_status(Protos::Core::GetEntriesResult::EntryResult::DONT_HAVE);
-      emit result(this->res);
+      Protos::Core::GetEntriesResult::EntryResult res;
+      res.set_status(Protos::Core::GetEntriesResult::EntryResult::DONT_HAVE);
+      emit result(Common::ProtoHelper::serialize(res));
    }
    else if (this->dir->isScanned())
    {
       L_DEBU(QString("FM::GetEntriesResult::start(): directory scanned: %1").arg(this->dir->getFullPath()));
       this->buildResult();
-      emit result(this->res);
+      emit result(this->encodedResult);
    }
    else
    {
@@ -71,17 +75,13 @@ void GetEntriesResult::sendResult()
    this->stopTimer();
 
    L_DEBU("FM::GetEntriesResult::sendResult()");
-   emit result(res);
+   emit result(this->encodedResult);
 }
 
+/**
+  * The listing is encoded only if it has changed since the last time, see 'Directory::getEncodedEntries(..)'.
+  */
 void GetEntriesResult::buildResult()
 {
-   this->res.set_status(Protos::Core::GetEntriesResult::EntryResult::OK);
-
-   foreach (Directory* dir, this->dir->getSubDirs())
-      dir->populateEntry(this->res.mutable_entries()->add_entry());
-
-   foreach (File* file, this->dir->getFiles())
-      if (file->isComplete())
-         file->populateEntry(this->res.mutable_entries()->add_entry(), false, this->maxNbHashesPerEntry);
+   this->encodedResult = this->dir->getEncodedEntries(this->maxNbHashesPerEntry);
 }
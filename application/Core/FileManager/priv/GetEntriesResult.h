@@ -43,7 +43,7 @@ namespace FM
    private:
       void buildResult();
 
-      Protos::Core::GetEntriesResult::EntryResult res;
+      QByteArray encodedResult;
       Directory* dir;
       const int maxNbHashesPerEntry;
    };
@@ -133,5 +133,17 @@ void GetHashesResult::sendNextHash(QSharedPointer<Chunk> chunk, bool direct)
    Protos::Core::HashResult hashResult;
    hashResult.set_num(chunk->getNum());
    hashResult.mutable_hash()->set_hash(chunk->getHash().getData(), Common::Hash::HASH_SIZE);
+
+   // Only the leaf hashes computed from our own data are sent, not the ones received from another peer.
+   QVector<Common::Hash> leafHashes;
+   const int leafSize = chunk->getVerifiedLeafHashes(leafHashes);
+   if (leafSize > 0)
+   {
+      hashResult.set_leaf_size(leafSize);
+      hashResult.mutable_leaf_hash()->Reserve(leafHashes.size());
+      for (QVectorIterator<Common::Hash> i(leafHashes); i.hasNext();)
+         hashResult.add_leaf_hash()->set_hash(i.next().getData(), Common::Hash::HASH_SIZE);
+   }
+
    emit nextHash(hashResult);
 }
@@ -19,6 +19,12 @@
 #include <priv/Global.h>
 using namespace FM;
 
+#include <QtGlobal>
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_DARWIN)
+   #include <sys/stat.h>
+#endif
+
 #include <Common/Settings.h>
 
 const QString& Global::getUnfinishedSuffix()
@@ -38,3 +44,40 @@ QString Global::removeUnfinishedSuffix(const QString& filename)
       return filename.left(filename.size() - Global::getUnfinishedSuffix().size());
    return filename;
 }
+
+/**
+  * Return an identifier of the device (partition) holding the given path.
+  * Two paths on the same device have the same identifier. An empty string is returned if the device is unknown.
+  */
+QString Global::getDeviceId(const QString& path)
+{
+#if defined(Q_OS_LINUX) || defined(Q_OS_DARWIN)
+   struct stat info;
+   if (stat(path.toUtf8().constData(), &info) == 0)
+      return QString::number(static_cast<quint64>(info.st_dev));
+#elif defined(Q_OS_WIN32)
+   const int colon = path.indexOf(':');
+   if (colon != -1)
+      return path.left(colon + 1).toUpper();
+#endif
+
+   return QString();
+}
+
+/**
+  * Return the algorithm used to compute the hashes of the chunks, see the setting "chunk_hash_algorithm".
+  */
+Common::HashAlgorithm Global::getHashAlgorithm()
+{
+   static const Common::HashAlgorithm algorithm = static_cast<Common::HashAlgorithm>(SETTINGS.get<quint32>("chunk_hash_algorithm"));
+   return algorithm;
+}
+
+/**
+  * Return the size of the leaves of the chunks, 0 if the leaf hashes aren't computed. See the setting "chunk_leaf_size".
+  */
+int Global::getLeafSize()
+{
+   static const int leafSize = SETTINGS.get<quint32>("chunk_leaf_size");
+   return leafSize;
+}
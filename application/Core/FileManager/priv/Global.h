@@ -21,6 +21,8 @@
 
 #include <QString>
 
+#include <Common/HashAlgorithm.h>
+
 namespace FM
 {
    class Global
@@ -29,6 +31,9 @@ namespace FM
       static const QString& getUnfinishedSuffix();
       static bool isFileUnfinished(const QString& filename);
       static QString removeUnfinishedSuffix(const QString& filename);
+      static QString getDeviceId(const QString& path);
+      static Common::HashAlgorithm getHashAlgorithm();
+      static int getLeafSize();
    };
 }
 
@@ -0,0 +1,90 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/SearchCache.h>
+using namespace FM;
+
+#include <QMutexLocker>
+
+/**
+  * @param maxSize [byte]. The maximum total size of the cached results, 0 to disable the cache.
+  */
+SearchCache::SearchCache(int maxSize) :
+   cache(maxSize), nbHits(0), nbMisses(0)
+{
+}
+
+/**
+  * Outdate all the cached results.
+  */
+void SearchCache::invalidate()
+{
+   this->generation.ref();
+}
+
+/**
+  * To be read before computing a result, then given to 'insert(..)'.
+  */
+int SearchCache::getGeneration() const
+{
+   return this->generation.load();
+}
+
+/**
+  * @return 'false' if there is no result for the given key or if it's outdated.
+  */
+bool SearchCache::get(const QString& key, QList<QByteArray>& payloads)
+{
+   QMutexLocker locker(&this->mutex);
+
+   if (CachedResult* result = this->cache.object(key))
+   {
+      if (result->generation == this->generation.load())
+      {
+         this->nbHits++;
+         payloads = result->payloads;
+         return true;
+      }
+      this->cache.remove(key);
+   }
+
+   this->nbMisses++;
+   return false;
+}
+
+/**
+  * The result isn't cached if the indexes have changed since 'generation' has been read, the result may be outdated.
+  */
+void SearchCache::insert(const QString& key, const QList<QByteArray>& payloads, int generation)
+{
+   if (generation != this->generation.load())
+      return;
+
+   int size = key.size() * sizeof(QChar);
+   for (QListIterator<QByteArray> i(payloads); i.hasNext();)
+      size += i.next().size();
+
+   QMutexLocker locker(&this->mutex);
+   this->cache.insert(key, new CachedResult { payloads, generation }, size);
+}
+
+IFileManager::SearchCacheStats SearchCache::getStats() const
+{
+   QMutexLocker locker(&this->mutex);
+   return IFileManager::SearchCacheStats { this->nbHits, this->nbMisses, this->cache.count(), this->cache.totalCost() };
+}
@@ -0,0 +1,71 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_SEARCH_CACHE_H
+#define FILEMANAGER_SEARCH_CACHE_H
+
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QAtomicInt>
+
+#include <Common/Uncopyable.h>
+
+#include <IFileManager.h>
+
+namespace FM
+{
+   /**
+     * A LRU cache of the serialized results of the searches, see 'FileManager::find(..)'.
+     * The whole cache is invalidated by 'invalidate()' each time the indexes change: it only increments a generation
+     * number, an outdated result is removed when it's asked.
+     * This class is thread safe.
+     */
+   class SearchCache : Common::Uncopyable
+   {
+   public:
+      SearchCache(int maxSize);
+
+      void invalidate();
+      int getGeneration() const;
+
+      bool get(const QString& key, QList<QByteArray>& payloads);
+      void insert(const QString& key, const QList<QByteArray>& payloads, int generation);
+
+      IFileManager::SearchCacheStats getStats() const;
+
+   private:
+      struct CachedResult
+      {
+         QList<QByteArray> payloads;
+         int generation;
+      };
+
+      QCache<QString, CachedResult> cache; // The cost of a result is its size in bytes.
+      QAtomicInt generation;
+
+      quint64 nbHits;
+      quint64 nbMisses;
+
+      mutable QMutex mutex; // Protects 'cache' and the counters, 'QCache' modifies itself when an object is read.
+   };
+}
+
+#endif
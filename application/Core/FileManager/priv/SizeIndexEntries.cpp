@@ -6,7 +6,7 @@ using namespace FM;
 class FakeEntry : public Entry
 {
 public:
-   FakeEntry(qint64 size) : Entry(nullptr, QString(), size) {}
+   FakeEntry(qint64 size) : Entry(nullptr, Type::FILE, QString(), size) {}
    ~FakeEntry() {}
 
    QString getFullPath() const { return QString(); }
@@ -70,3 +70,28 @@ QList<Entry*> SizeIndexEntries::search(qint64 sizeMin, qint64 sizeMax, int limit
 
    return result;
 }
+
+/**
+  * Return the number of entries 'search(sizeMin, sizeMax)' would return, in O(log n).
+  * The entries having the same size are not ordered by name, thus the result may be wrong by the number of entries having
+  * the size 'sizeMin' or 'sizeMax', it's enough to compare the selectivity of the indexes.
+  */
+int SizeIndexEntries::estimateCount(qint64 sizeMin, qint64 sizeMax) const
+{
+   QMutexLocker locker(&this->mutex);
+
+   if (this->index.isEmpty() || sizeMin > sizeMax)
+      return 0;
+
+   FakeEntry searchEntryMin(sizeMin);
+   int first = this->index.indexOfNearest(&searchEntryMin);
+   if (this->index.getFromIndex(first)->getSize() < sizeMin)
+      first++;
+
+   FakeEntry searchEntryMax(sizeMax);
+   int last = this->index.indexOfNearest(&searchEntryMax);
+   if (this->index.getFromIndex(last)->getSize() > sizeMax)
+      last--;
+
+   return qMax(0, last - first + 1);
+}
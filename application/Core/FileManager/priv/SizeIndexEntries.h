@@ -21,6 +21,7 @@ namespace FM
       void rmItem(Entry* item);
 
       QList<Entry*> search(qint64 sizeMin, qint64 sizeMax, int limit = std::numeric_limits<int>::max(), std::function<bool(const Entry*)> predicat = nullptr) const;
+      int estimateCount(qint64 sizeMin, qint64 sizeMax) const;
 
    private:
       Common::SortedArray<Entry*> index;
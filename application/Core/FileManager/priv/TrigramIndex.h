@@ -0,0 +1,327 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_TRIGRAM_INDEX_H
+#define FILEMANAGER_TRIGRAM_INDEX_H
+
+#include <functional>
+#include <algorithm>
+#include <limits>
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QVarLengthArray>
+#include <QString>
+#include <QStringList>
+#include <QReadWriteLock>
+
+#include <Common/Uncopyable.h>
+#include <Common/StringUtils.h>
+
+/**
+  * @class FM::TrigramIndex
+  *
+  * Index the names of a set of items of type 'T' by their trigrams (each sequence of three characters) to find the names
+  * containing a given string anywhere, for example "2023" in "report2023final".
+  *
+  * Each item has an ID which is never reused: the IDs are appended to the posting lists of its trigrams, the lists are thus
+  * always sorted and can be intersected with a galloping search. A removed item only leaves its ID as a tombstone until
+  * the number of tombstones exceeds the number of items, then the IDs are renumbered and the posting lists compacted.
+  *
+  * The trigrams are only candidates: each found item is checked against its current name given by 'getName'.
+  *
+  * This class is thread safe.
+  */
+
+namespace FM
+{
+   template<typename T>
+   class TrigramIndex : Common::Uncopyable
+   {
+   public:
+      static const int TRIGRAM_SIZE = 3; ///< The terms shorter than that can't be searched alone.
+
+      TrigramIndex(std::function<QString(const T&)> getName);
+
+      void addItem(const QString& name, const T& item);
+      void rmItem(const T& item);
+
+      QList<T> search(const QStringList& terms, int maxNbResult = std::numeric_limits<int>::max(), std::function<bool(const T&)> predicat = nullptr) const;
+
+      int getNbItems() const;
+      int getNbTrigrams() const;
+      qint64 getMemoryUsage() const;
+
+   private:
+      static const int MIN_NB_REMOVED_TO_COMPACT = 1024;
+
+      static quint64 trigram(const QChar* chars);
+      static int gallop(const QVector<quint32>& postingList, int from, quint32 id);
+
+      void rmItemWithoutLock(const T& item);
+      void compact();
+
+      const std::function<QString(const T&)> getName;
+
+      QHash<quint64, QVector<quint32>> postingLists; ///< Trigram -> sorted IDs.
+      QVector<T> items; ///< ID -> item.
+      QVector<bool> removed; ///< ID -> tombstone.
+      QHash<T, quint32> ids; ///< Item -> ID.
+      int nbRemoved;
+
+      mutable QReadWriteLock lock;
+   };
+}
+
+template<typename T>
+FM::TrigramIndex<T>::TrigramIndex(std::function<QString(const T&)> getName) :
+   getName(getName), nbRemoved(0)
+{
+}
+
+/**
+  * If the item is already indexed its previous name is replaced.
+  */
+template<typename T>
+void FM::TrigramIndex<T>::addItem(const QString& name, const T& item)
+{
+   const QString normalizedName = Common::StringUtils::toLowerAndRemoveAccents(name);
+
+   QVarLengthArray<quint64, 256> trigrams;
+   for (int i = 0; i + TRIGRAM_SIZE <= normalizedName.size(); i++)
+      trigrams.append(trigram(normalizedName.constData() + i));
+   std::sort(trigrams.begin(), trigrams.end());
+
+   QWriteLocker locker(&this->lock);
+
+   this->rmItemWithoutLock(item);
+
+   const quint32 id = this->items.size();
+   this->items << item;
+   this->removed << false;
+   this->ids.insert(item, id);
+
+   for (int i = 0; i < trigrams.size(); i++)
+      if (i == 0 || trigrams[i] != trigrams[i - 1])
+         this->postingLists[trigrams[i]] << id;
+}
+
+template<typename T>
+void FM::TrigramIndex<T>::rmItem(const T& item)
+{
+   QWriteLocker locker(&this->lock);
+   this->rmItemWithoutLock(item);
+}
+
+/**
+  * Return the items whose name contains all the given terms.
+  * The terms shorter than 'TRIGRAM_SIZE' are only checked on the items found with the longer ones, if there is no longer term nothing is returned.
+  */
+template<typename T>
+QList<T> FM::TrigramIndex<T>::search(const QStringList& terms, int maxNbResult, std::function<bool(const T&)> predicat) const
+{
+   QStringList normalizedTerms;
+   QVarLengthArray<quint64, 64> trigrams;
+   for (QStringListIterator i(terms); i.hasNext();)
+   {
+      const QString& term = Common::StringUtils::toLowerAndRemoveAccents(i.next());
+      normalizedTerms << term;
+      for (int j = 0; j + TRIGRAM_SIZE <= term.size(); j++)
+         trigrams.append(trigram(term.constData() + j));
+   }
+
+   QList<T> result;
+   if (trigrams.isEmpty())
+      return result;
+
+   std::sort(trigrams.begin(), trigrams.end());
+   trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+   QReadLocker locker(&this->lock);
+
+   QVarLengthArray<const QVector<quint32>*, 64> lists;
+   for (int i = 0; i < trigrams.size(); i++)
+   {
+      auto list = this->postingLists.constFind(trigrams[i]);
+      if (list == this->postingLists.constEnd())
+         return result;
+      lists.append(&list.value());
+   }
+
+   // The smallest list drives the intersection.
+   std::sort(lists.begin(), lists.end(), [](const QVector<quint32>* l1, const QVector<quint32>* l2) { return l1->size() < l2->size(); });
+
+   QVarLengthArray<int, 64> positions(lists.size());
+   for (int i = 0; i < positions.size(); i++)
+      positions[i] = 0;
+
+   for (auto i = lists[0]->constBegin(); i != lists[0]->constEnd() && result.size() < maxNbResult; ++i)
+   {
+      const quint32 id = *i;
+      if (this->removed[id])
+         continue;
+
+      bool inAllLists = true;
+      for (int j = 1; j < lists.size() && inAllLists; j++)
+      {
+         positions[j] = gallop(*lists[j], positions[j], id);
+         inAllLists = positions[j] < lists[j]->size() && (*lists[j])[positions[j]] == id;
+      }
+      if (!inAllLists)
+         continue;
+
+      const T& item = this->items[id];
+      const QString name = Common::StringUtils::toLowerAndRemoveAccents(this->getName(item));
+      bool containsAllTerms = true;
+      for (int j = 0; j < normalizedTerms.size() && containsAllTerms; j++)
+         containsAllTerms = name.contains(normalizedTerms[j]);
+
+      if (containsAllTerms && (!predicat || predicat(item)))
+         result << item;
+   }
+
+   return result;
+}
+
+template<typename T>
+int FM::TrigramIndex<T>::getNbItems() const
+{
+   QReadLocker locker(&this->lock);
+   return this->ids.size();
+}
+
+template<typename T>
+int FM::TrigramIndex<T>::getNbTrigrams() const
+{
+   QReadLocker locker(&this->lock);
+   return this->postingLists.size();
+}
+
+/**
+  * An estimation of the memory used by the index [byte].
+  * The overhead of a 'QHash' node and of a 'QVector' header is counted as 16 bytes each.
+  */
+template<typename T>
+qint64 FM::TrigramIndex<T>::getMemoryUsage() const
+{
+   static const int OVERHEAD = 16;
+
+   QReadLocker locker(&this->lock);
+
+   qint64 size = 0;
+   for (auto i = this->postingLists.constBegin(); i != this->postingLists.constEnd(); ++i)
+      size += OVERHEAD + sizeof(quint64) + sizeof(QVector<quint32>) + OVERHEAD + i.value().capacity() * sizeof(quint32);
+
+   size += this->items.capacity() * sizeof(T) + this->removed.capacity() * sizeof(bool);
+   size += this->ids.size() * (OVERHEAD + sizeof(T) + sizeof(quint32));
+   return size;
+}
+
+/**
+  * Pack three UTF-16 characters in a 64 bits word.
+  */
+template<typename T>
+quint64 FM::TrigramIndex<T>::trigram(const QChar* chars)
+{
+   return quint64(chars[0].unicode()) << 32 | quint64(chars[1].unicode()) << 16 | chars[2].unicode();
+}
+
+/**
+  * Return the index of the first ID not lower than 'id' starting at 'from', the distance is doubled at each step then a binary search is done.
+  */
+template<typename T>
+int FM::TrigramIndex<T>::gallop(const QVector<quint32>& postingList, int from, quint32 id)
+{
+   if (from >= postingList.size() || postingList[from] >= id)
+      return from;
+
+   int low = from; // Always lower than 'id'.
+   int high = from + 1;
+   int step = 1;
+   while (high < postingList.size() && postingList[high] < id)
+   {
+      low = high;
+      step *= 2;
+      high = from + step;
+   }
+   high = qMin(high, postingList.size());
+
+   return std::lower_bound(postingList.constBegin() + low + 1, postingList.constBegin() + high, id) - postingList.constBegin();
+}
+
+template<typename T>
+void FM::TrigramIndex<T>::rmItemWithoutLock(const T& item)
+{
+   auto i = this->ids.find(item);
+   if (i == this->ids.end())
+      return;
+
+   this->removed[i.value()] = true;
+   this->ids.erase(i);
+
+   if (++this->nbRemoved > MIN_NB_REMOVED_TO_COMPACT && this->nbRemoved > this->ids.size())
+      this->compact();
+}
+
+/**
+  * Renumber the remaining items and remove the tombstones from the posting lists, the order of the IDs is kept.
+  */
+template<typename T>
+void FM::TrigramIndex<T>::compact()
+{
+   QVector<quint32> newIds(this->items.size());
+   QVector<T> newItems;
+   newItems.reserve(this->ids.size());
+
+   for (int id = 0; id < this->items.size(); id++)
+   {
+      if (!this->removed[id])
+      {
+         newIds[id] = newItems.size();
+         this->ids[this->items[id]] = newItems.size();
+         newItems << this->items[id];
+      }
+   }
+
+   for (auto i = this->postingLists.begin(); i != this->postingLists.end();)
+   {
+      QVector<quint32>& list = i.value();
+      int n = 0;
+      for (int j = 0; j < list.size(); j++)
+         if (!this->removed[list[j]])
+            list[n++] = newIds[list[j]];
+
+      if (n == 0)
+      {
+         i = this->postingLists.erase(i);
+      }
+      else
+      {
+         list.resize(n);
+         list.squeeze();
+         ++i;
+      }
+   }
+
+   this->items = newItems;
+   this->removed = QVector<bool>(this->items.size(), false);
+   this->nbRemoved = 0;
+}
+
+#endif
@@ -0,0 +1,631 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_TRIE_H
+#define FILEMANAGER_TRIE_H
+
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include <QList>
+#include <QVector>
+#include <QVarLengthArray>
+#include <QString>
+#include <QChar>
+
+#include <Common/Uncopyable.h>
+
+#include <priv/WordIndex/Node.h>
+
+/**
+  * @class FM::Trie
+  *
+  * A compressed radix trie of items indexed by string, see the class 'WordIndex' for more explanations.
+  *
+  * The layout is made to reduce the memory footprint and the pointer chasing:
+  *  - The nodes are allocated by blocks of 'BLOCK_SIZE' (arena) and are referenced by a 32 bits index.
+  *    The children of a node form a linked list of siblings, the first character of each fragment is kept in the node.
+  *  - The fragments of the nodes are stored in a single UTF-16 pool and are interned, identical fragments share
+  *    the same characters. Splitting a node only changes the fragment ranges of the two nodes.
+  *    The pool is compacted when it has more garbage than live characters.
+  *  - The items of a node are stored in a small vector, a node with only one item doesn't need any allocation.
+  *
+  * This class isn't thread safe.
+  */
+
+namespace FM
+{
+   template<typename T>
+   class Trie : Common::Uncopyable
+   {
+   public:
+      static const int MAX_WORD_SIZE = 0xFFFF; ///< Longer words are not indexed.
+
+      Trie();
+      ~Trie();
+
+      /**
+        * Add an item indexed by the given word.
+        * If the item already exists for this word it is added a second time.
+        */
+      void addItem(const QStringRef& word, const T& item);
+
+      /**
+        * Remove the item from the given word.
+        * If the item doesn't exist nothing happen and 'false' is returned else the item is removed and 'true' is returned.
+        */
+      bool rmItem(const QString& word, const T& item);
+
+      QList<NodeResult<T>> search(const QString& word, bool alsoFromSubNodes = false, int maxNbResult = -1, std::function<bool(const T&)> predicat = nullptr) const;
+
+      /**
+        * Return the number of items 'search(word, alsoFromSubNodes)' would return without building the result.
+        * The count stops as soon as it reaches 'limit'.
+        */
+      int count(const QString& word, bool alsoFromSubNodes = false, int limit = std::numeric_limits<int>::max()) const;
+
+      QString toStringDebug() const;
+
+   private:
+      static const quint32 ROOT = 0;
+      static const quint32 NO_NODE = 0; ///< The root can't be a child or a sibling, its index is used as null value.
+      static const int BLOCK_SIZE = 1024;
+      static const int MIN_INTERN_TABLE_SIZE = 1024;
+      static const int MIN_POOL_SIZE_TO_COMPACT = 4096;
+
+      struct Node
+      {
+         Node() : fragmentOffset(0), fragmentLength(0), firstChild(NO_NODE), nextSibling(NO_NODE) {}
+
+         quint32 fragmentOffset;
+         quint16 fragmentLength;
+         QChar firstChar; ///< A copy of the first character of the fragment to find a child without reading the pool.
+         quint32 firstChild;
+         quint32 nextSibling;
+         QVarLengthArray<T, 1> items;
+      };
+
+      /**
+        * The position of a node: the 'node'th node is a child of 'parent' and follows 'previous' (or is the first child if 'previous' is 'NO_NODE').
+        */
+      struct Location
+      {
+         quint32 parent;
+         quint32 previous;
+         quint32 node;
+      };
+
+      inline Node& node(quint32 i) { return this->blocks[i / BLOCK_SIZE][i % BLOCK_SIZE]; }
+      inline const Node& node(quint32 i) const { return this->blocks[i / BLOCK_SIZE][i % BLOCK_SIZE]; }
+      inline const QChar* fragment(const Node& node) const { return this->pool.constData() + node.fragmentOffset; }
+
+      quint32 allocateNode();
+      void freeNode(quint32 i);
+      void replaceNode(const Location& location, quint32 newNode);
+      void splitNode(quint32 i, int p, quint32 newParent);
+      void mergeWithChild(quint32 i);
+      void removeEmptyNode(const Location& location);
+
+      Location getNode(const QString& word, bool exactMatch) const;
+      QList<NodeResult<T>> getItems(quint32 i, bool alsoFromSubNodes, int maxNbResult, std::function<bool(const T&)> predicat) const;
+
+      void setFragment(Node& node, const QChar* chars, int length);
+      quint32 intern(const QChar* chars, int length);
+      void growInternTable();
+      void compactPool();
+      static uint hashFragment(const QChar* chars, int length);
+
+      QList<Node*> blocks; ///< The blocks are never moved, a reference to a node stays valid when new nodes are allocated.
+      quint32 nbAllocatedNodes;
+      quint32 freeNodes; ///< A linked list of freed nodes, using 'Node::nextSibling'.
+
+      QVector<QChar> pool;
+      QVector<quint64> internTable; ///< An open addressing hash table of the interned fragments: (offset << 16 | length), 0 for an empty slot.
+      int nbInterned;
+      qint64 nbLiveChars; ///< The sum of the fragment lengths of all the nodes.
+   };
+}
+
+template <typename T>
+FM::Trie<T>::Trie() :
+   nbAllocatedNodes(0), freeNodes(NO_NODE), nbInterned(0), nbLiveChars(0)
+{
+   this->allocateNode(); // The root.
+}
+
+template <typename T>
+FM::Trie<T>::~Trie()
+{
+   for (QListIterator<Node*> i(this->blocks); i.hasNext();)
+      delete[] i.next();
+}
+
+template <typename T>
+void FM::Trie<T>::addItem(const QStringRef& word, const T& item)
+{
+   if (word.isEmpty() || word.size() > MAX_WORD_SIZE)
+      return;
+
+   const QChar* chars = word.unicode();
+   int remaining = word.size();
+   quint32 parent = ROOT;
+
+   forever
+   {
+      Location location { parent, NO_NODE, this->node(parent).firstChild };
+      while (location.node != NO_NODE && this->node(location.node).firstChar != chars[0])
+      {
+         location.previous = location.node;
+         location.node = this->node(location.node).nextSibling;
+      }
+
+      // No child shares a prefix with the word: a new child is appended.
+      if (location.node == NO_NODE)
+      {
+         const quint32 newNode = this->allocateNode();
+         this->setFragment(this->node(newNode), chars, remaining);
+         this->node(newNode).items.append(item);
+         this->replaceNode(location, newNode);
+         return;
+      }
+
+      Node& child = this->node(location.node);
+      int p = 1;
+      while (p < remaining && p < child.fragmentLength && chars[p] == this->fragment(child)[p])
+         p++;
+
+      if (p == remaining)
+      {
+         // The word and the fragment are equal.
+         if (p == child.fragmentLength)
+         {
+            child.items.append(item);
+         }
+         else // The word is the beginning of the fragment.
+         {
+            const quint32 newNode = this->allocateNode();
+            this->replaceNode(location, newNode);
+            this->splitNode(location.node, p, newNode);
+            this->node(newNode).items.append(item);
+         }
+         return;
+      }
+      else if (p == child.fragmentLength) // The fragment is the beginning of the word.
+      {
+         parent = location.node;
+         chars += p;
+         remaining -= p;
+      }
+      else
+      {
+         // The word and the fragment share at least one character from the beginning.
+         const quint32 newNodeSplit = this->allocateNode();
+         this->replaceNode(location, newNodeSplit);
+         this->splitNode(location.node, p, newNodeSplit);
+
+         const quint32 newNode = this->allocateNode();
+         this->setFragment(this->node(newNode), chars + p, remaining - p);
+         this->node(newNode).items.append(item);
+         this->node(location.node).nextSibling = newNode;
+         return;
+      }
+   }
+}
+
+template <typename T>
+bool FM::Trie<T>::rmItem(const QString& word, const T& item)
+{
+   const Location location = this->getNode(word, true);
+   if (location.node == NO_NODE)
+      return false;
+
+   QVarLengthArray<T, 1>& items = this->node(location.node).items;
+   for (int i = 0; i < items.size(); i++)
+   {
+      if (items[i] == item)
+      {
+         items.remove(i);
+         if (items.isEmpty())
+            this->removeEmptyNode(location);
+         return true;
+      }
+   }
+   return false;
+}
+
+template <typename T>
+QList<FM::NodeResult<T>> FM::Trie<T>::search(const QString& word, bool alsoFromSubNodes, int maxNbResult, std::function<bool(const T&)> predicat) const
+{
+   const Location location = this->getNode(word, !alsoFromSubNodes);
+   if (location.node == NO_NODE)
+      return QList<NodeResult<T>>();
+
+   return this->getItems(location.node, alsoFromSubNodes, maxNbResult, predicat);
+}
+
+template <typename T>
+int FM::Trie<T>::count(const QString& word, bool alsoFromSubNodes, int limit) const
+{
+   const Location location = this->getNode(word, !alsoFromSubNodes);
+   if (location.node == NO_NODE)
+      return 0;
+
+   int n = 0;
+   QVarLengthArray<quint32, 64> nodesToVisit;
+   nodesToVisit.append(location.node);
+
+   for (int j = 0; j < nodesToVisit.size() && n < limit; j++)
+   {
+      const Node& current = this->node(nodesToVisit[j]);
+      n += current.items.size();
+
+      if (!alsoFromSubNodes)
+         break;
+
+      for (quint32 child = current.firstChild; child != NO_NODE; child = this->node(child).nextSibling)
+         nodesToVisit.append(child);
+   }
+
+   return qMin(n, limit);
+}
+
+template <typename T>
+QString FM::Trie<T>::toStringDebug() const
+{
+   static const int INDENTATION = 3;
+   struct SubNode
+   {
+      int level;
+      quint32 node;
+   };
+
+   QString result;
+   QList<SubNode> nodesToProcess { SubNode { 0, ROOT } };
+
+   while (!nodesToProcess.isEmpty())
+   {
+      SubNode current = nodesToProcess.takeFirst();
+      const Node& node = this->node(current.node);
+      result.append(QString().fill(' ', INDENTATION * current.level));
+      result.append(QString(this->fragment(node), node.fragmentLength)).append(node.items.isEmpty() ? "" : QString(" N = %1").arg(node.items.size())).append('\n');
+
+      QList<SubNode> children;
+      for (quint32 child = node.firstChild; child != NO_NODE; child = this->node(child).nextSibling)
+         children << SubNode { current.level + 1, child };
+      nodesToProcess = children + nodesToProcess;
+   }
+
+   return result;
+}
+
+template <typename T>
+quint32 FM::Trie<T>::allocateNode()
+{
+   if (this->freeNodes != NO_NODE)
+   {
+      const quint32 i = this->freeNodes;
+      this->freeNodes = this->node(i).nextSibling;
+      this->node(i).nextSibling = NO_NODE;
+      return i;
+   }
+
+   if (this->nbAllocatedNodes % BLOCK_SIZE == 0)
+      this->blocks << new Node[BLOCK_SIZE];
+   return this->nbAllocatedNodes++;
+}
+
+template <typename T>
+void FM::Trie<T>::freeNode(quint32 i)
+{
+   Node& node = this->node(i);
+   this->nbLiveChars -= node.fragmentLength;
+   node.fragmentOffset = 0;
+   node.fragmentLength = 0;
+   node.firstChild = NO_NODE;
+   node.items.clear();
+   node.items.squeeze();
+   node.nextSibling = this->freeNodes;
+   this->freeNodes = i;
+}
+
+/**
+  * Put 'newNode' at the place of the node at 'location', which can be 'NO_NODE' to append 'newNode' to the children of 'location.parent'.
+  * The replaced node becomes detached.
+  */
+template <typename T>
+void FM::Trie<T>::replaceNode(const Location& location, quint32 newNode)
+{
+   if (location.node != NO_NODE)
+   {
+      this->node(newNode).nextSibling = this->node(location.node).nextSibling;
+      this->node(location.node).nextSibling = NO_NODE;
+   }
+
+   if (location.previous == NO_NODE)
+      this->node(location.parent).firstChild = newNode;
+   else
+      this->node(location.previous).nextSibling = newNode;
+}
+
+/**
+  * The first 'p' characters of the fragment of the node 'i' become the fragment of 'newParent', 'i' becomes its only child.
+  * No character is added to the pool.
+  */
+template <typename T>
+void FM::Trie<T>::splitNode(quint32 i, int p, quint32 newParent)
+{
+   Node& node = this->node(i);
+   Node& parent = this->node(newParent);
+
+   parent.fragmentOffset = node.fragmentOffset;
+   parent.fragmentLength = p;
+   parent.firstChar = node.firstChar;
+   parent.firstChild = i;
+
+   node.fragmentOffset += p;
+   node.fragmentLength -= p;
+   node.firstChar = this->pool[node.fragmentOffset];
+}
+
+/**
+  * The node 'i' has no item and only one child: the child is merged into it.
+  */
+template <typename T>
+void FM::Trie<T>::mergeWithChild(quint32 i)
+{
+   Node& node = this->node(i);
+   const quint32 childIndex = node.firstChild;
+   Node& child = this->node(childIndex);
+
+   // After a split the two fragments are often still contiguous in the pool.
+   if (node.fragmentOffset + node.fragmentLength == child.fragmentOffset)
+   {
+      node.fragmentLength += child.fragmentLength;
+      this->nbLiveChars += child.fragmentLength;
+   }
+   else
+   {
+      QVarLengthArray<QChar, 64> chars;
+      chars.append(this->fragment(node), node.fragmentLength);
+      chars.append(this->fragment(child), child.fragmentLength);
+      this->setFragment(node, chars.constData(), chars.size());
+   }
+
+   node.items = child.items;
+   node.firstChild = child.firstChild;
+   this->freeNode(childIndex);
+}
+
+/**
+  * The node at 'location' has no more item, remove it or merge it with its child if it's no longer useful.
+  */
+template <typename T>
+void FM::Trie<T>::removeEmptyNode(const Location& location)
+{
+   const Node& node = this->node(location.node);
+
+   if (node.firstChild == NO_NODE)
+   {
+      if (location.previous == NO_NODE)
+         this->node(location.parent).firstChild = node.nextSibling;
+      else
+         this->node(location.previous).nextSibling = node.nextSibling;
+      this->freeNode(location.node);
+
+      // The parent may now be a useless node with no item and only one child.
+      const Node& parent = this->node(location.parent);
+      if (location.parent != ROOT && parent.items.isEmpty() && this->node(parent.firstChild).nextSibling == NO_NODE)
+         this->mergeWithChild(location.parent);
+   }
+   else if (this->node(node.firstChild).nextSibling == NO_NODE)
+   {
+      this->mergeWithChild(location.node);
+   }
+
+   if (this->pool.size() > MIN_POOL_SIZE_TO_COMPACT && this->pool.size() > 2 * this->nbLiveChars)
+      this->compactPool();
+}
+
+/**
+  * Returns the location of the node matching the given word, 'Location::node' is 'NO_NODE' if there is no such node.
+  * If 'exactMatch' is false the word may also match the beginning of a node.
+  */
+template <typename T>
+typename FM::Trie<T>::Location FM::Trie<T>::getNode(const QString& word, bool exactMatch) const
+{
+   const QChar* chars = word.unicode();
+   int remaining = word.size();
+   Location location { ROOT, NO_NODE, NO_NODE };
+
+   if (remaining == 0)
+      return location;
+
+   forever
+   {
+      location.previous = NO_NODE;
+      location.node = this->node(location.parent).firstChild;
+      while (location.node != NO_NODE && this->node(location.node).firstChar != chars[0])
+      {
+         location.previous = location.node;
+         location.node = this->node(location.node).nextSibling;
+      }
+
+      if (location.node == NO_NODE)
+         return location;
+
+      const Node& child = this->node(location.node);
+      int p = 1;
+      while (p < remaining && p < child.fragmentLength && chars[p] == this->fragment(child)[p])
+         p++;
+
+      if (p == child.fragmentLength)
+      {
+         if (p == remaining)
+            return location;
+
+         location.parent = location.node;
+         chars += p;
+         remaining -= p;
+      }
+      else
+      {
+         if (p != remaining || exactMatch)
+            location.node = NO_NODE;
+         return location;
+      }
+   }
+}
+
+/**
+  * Return all items from the node 'i' and its sub nodes (breadth first) if 'alsoFromSubNodes' is true.
+  * The items of the node 'i' have a level of 0, the items of its sub nodes have a level of 1.
+  */
+template <typename T>
+QList<FM::NodeResult<T>> FM::Trie<T>::getItems(quint32 i, bool alsoFromSubNodes, int maxNbResult, std::function<bool(const T&)> predicat) const
+{
+   QList<NodeResult<T>> result;
+   QVarLengthArray<quint32, 64> nodesToVisit;
+   nodesToVisit.append(i);
+
+   for (int j = 0; j < nodesToVisit.size(); j++)
+   {
+      const Node& current = this->node(nodesToVisit[j]);
+
+      for (int k = 0; k < current.items.size(); k++)
+      {
+         const T& item = current.items[k];
+         if (!predicat || predicat(item))
+         {
+            result << NodeResult<T>(item, j == 0 ? 0 : 1); // 'level' == 0 means the item matches exactly.
+            if (result.size() == maxNbResult)
+               return result;
+         }
+      }
+
+      if (!alsoFromSubNodes)
+         break;
+
+      for (quint32 child = current.firstChild; child != NO_NODE; child = this->node(child).nextSibling)
+         nodesToVisit.append(child);
+   }
+
+   return result;
+}
+
+template <typename T>
+void FM::Trie<T>::setFragment(Node& node, const QChar* chars, int length)
+{
+   this->nbLiveChars += length - node.fragmentLength;
+   node.firstChar = chars[0];
+   node.fragmentOffset = this->intern(chars, length);
+   node.fragmentLength = length;
+}
+
+/**
+  * Return the offset of the given fragment in the pool, the fragment is added if it doesn't already exist.
+  * 'chars' must not point into the pool.
+  */
+template <typename T>
+quint32 FM::Trie<T>::intern(const QChar* chars, int length)
+{
+   if (this->internTable.size() < 2 * (this->nbInterned + 1))
+      this->growInternTable();
+
+   const int mask = this->internTable.size() - 1;
+   for (int i = hashFragment(chars, length) & mask;; i = (i + 1) & mask)
+   {
+      const quint64 entry = this->internTable[i];
+      if (entry == 0)
+      {
+         const quint32 offset = this->pool.size();
+         this->pool.resize(offset + length);
+         memcpy(this->pool.data() + offset, chars, length * sizeof(QChar));
+         this->internTable[i] = quint64(offset) << 16 | length;
+         this->nbInterned++;
+         return offset;
+      }
+
+      const quint32 offset = entry >> 16;
+      if ((entry & 0xFFFF) == quint64(length) && memcmp(this->pool.constData() + offset, chars, length * sizeof(QChar)) == 0)
+         return offset;
+   }
+}
+
+template <typename T>
+void FM::Trie<T>::growInternTable()
+{
+   const QVector<quint64> oldTable = this->internTable;
+   this->internTable = QVector<quint64>(qMax(int(MIN_INTERN_TABLE_SIZE), 2 * oldTable.size()), 0);
+
+   const int mask = this->internTable.size() - 1;
+   for (int i = 0; i < oldTable.size(); i++)
+   {
+      if (oldTable[i] == 0)
+         continue;
+
+      int j = hashFragment(this->pool.constData() + (oldTable[i] >> 16), oldTable[i] & 0xFFFF) & mask;
+      while (this->internTable[j] != 0)
+         j = (j + 1) & mask;
+      this->internTable[j] = oldTable[i];
+   }
+}
+
+/**
+  * Rebuild the pool with only the fragments of the current nodes.
+  */
+template <typename T>
+void FM::Trie<T>::compactPool()
+{
+   const QVector<QChar> oldPool = this->pool;
+   this->pool.clear();
+   this->internTable.clear();
+   this->nbInterned = 0;
+
+   QVarLengthArray<quint32, 64> nodesToVisit;
+   for (quint32 child = this->node(ROOT).firstChild; child != NO_NODE; child = this->node(child).nextSibling)
+      nodesToVisit.append(child);
+
+   while (!nodesToVisit.isEmpty())
+   {
+      Node& node = this->node(nodesToVisit.last());
+      nodesToVisit.removeLast();
+
+      node.fragmentOffset = this->intern(oldPool.constData() + node.fragmentOffset, node.fragmentLength);
+
+      for (quint32 child = node.firstChild; child != NO_NODE; child = this->node(child).nextSibling)
+         nodesToVisit.append(child);
+   }
+}
+
+/**
+  * FNV-1a.
+  */
+template <typename T>
+uint FM::Trie<T>::hashFragment(const QChar* chars, int length)
+{
+   uint hash = 2166136261u;
+   for (int i = 0; i < length; i++)
+   {
+      hash ^= chars[i].unicode();
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+#endif
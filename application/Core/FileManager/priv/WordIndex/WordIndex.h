@@ -20,17 +20,23 @@
 #define FILEMANAGER_WORDINDEX_H
 
 #include <functional>
+#include <algorithm>
+#include <limits>
 
 #include <QList>
+#include <QVector>
+#include <QVarLengthArray>
 #include <QString>
 #include <QChar>
-#include <QMutex>
+#include <QReadWriteLock>
 
 #include <Common/Uncopyable.h>
 #include <Common/Global.h>
+#include <Common/StringUtils.h>
 #include <Common/LogManager/ILoggable.h>
 
 #include <priv/WordIndex/Node.h>
+#include <priv/WordIndex/Trie.h>
 
 /**
   * @class FM::WordIndex
@@ -38,6 +44,8 @@
   * The purpose of the class 'WordIndex' is to index a set of item of type 'T' by string.
   *
   * This class is thread safe.
+  * The searches only take a read lock on the index: many searches can be done concurrently. They can only be blocked by
+  * a modification (add, remove or rename of an item) which holds the write lock for a single item at a time.
   */
 
 namespace FM
@@ -61,13 +69,21 @@ namespace FM
       QList<NodeResult<T>> search(const QString& word, int maxNbResult = -1, std::function<bool(const T&)> predicat = nullptr) const;
       QList<NodeResult<T>> search(const QStringList& words, int maxNbResult = -1, std::function<bool(const T&)> predicat = nullptr) const;
 
+      int estimateCount(const QStringList& words, int limit = std::numeric_limits<int>::max()) const;
+
       QString toStringLog() const;
 
       static QList<T> resultToList(const QList<NodeResult<T>>& result);
 
    private:
-      Node<T> root;
-      mutable QMutex mutex;
+      QList<NodeResult<T>> searchWithoutLock(const QString& word, int maxNbResult, std::function<bool(const T&)> predicat) const;
+
+      static QVector<NodeResult<T>> toPostingList(const QList<NodeResult<T>>& result);
+      static int gallop(const QVector<NodeResult<T>>& postingList, int from, const T& value);
+      static void intersectCombination(const QVector<QVector<NodeResult<T>>>& postingLists, const int* intersect, int nbIntersects, int level, int nbCombinations, QVector<QList<NodeResult<T>>>& resultsByNbPartialMatches);
+
+      Trie<T> trie;
+      mutable QReadWriteLock lock; // Not recursive, a read lock taken twice by the same thread may deadlock if a writer is waiting in between.
    };
 }
 
@@ -78,30 +94,29 @@ template<typename T>
 const int FM::WordIndex<T>::MIN_WORD_SIZE_PARTIAL_MATCH_KOREAN(1);
 
 template<typename T>
-   FM::WordIndex<T>::WordIndex() :
-      mutex(QMutex::Recursive)
+   FM::WordIndex<T>::WordIndex()
 {}
 
 template<typename T>
 void FM::WordIndex<T>::addItem(const QString& word, const T& item)
 {
-   QMutexLocker locker(&this->mutex);
-   this->root.addItem(&word, item);
+   QWriteLocker locker(&this->lock);
+   this->trie.addItem(&word, item);
 }
 
 template<typename T>
 void FM::WordIndex<T>::addItem(const QStringList& words, const T& item)
 {
-   QMutexLocker locker(&this->mutex);
+   QWriteLocker locker(&this->lock);
    for (QStringListIterator i(words); i.hasNext();)
-      this->root.addItem(&i.next(), item);
+      this->trie.addItem(&i.next(), item);
 }
 
 template<typename T>
 bool FM::WordIndex<T>::rmItem(const QString& word, const T& item)
 {
-   QMutexLocker locker(&this->mutex);
-   return this->root.rmItem(word, item);
+   QWriteLocker locker(&this->lock);
+   return this->trie.rmItem(word, item);
 }
 
 /**
@@ -110,29 +125,29 @@ bool FM::WordIndex<T>::rmItem(const QString& word, const T& item)
 template<typename T>
 bool FM::WordIndex<T>::rmItem(const QStringList& words, const T& item)
 {
-   QMutexLocker locker(&this->mutex);
+   QWriteLocker locker(&this->lock);
    bool itemRemoved = false;
    for (QStringListIterator i(words); i.hasNext();)
-      itemRemoved |= this->root.rmItem(i.next(), item);
+      itemRemoved |= this->trie.rmItem(i.next(), item);
    return itemRemoved;
 }
 
 template<typename T>
 void FM::WordIndex<T>::renameItem(const QString& oldWord, const QString& newWord, const T& item)
 {
-   QMutexLocker locker(&this->mutex);
-   this->root.rmItem(oldWord, item);
-   this->root.addItem(&newWord, item);
+   QWriteLocker locker(&this->lock);
+   this->trie.rmItem(oldWord, item);
+   this->trie.addItem(&newWord, item);
 }
 
 template<typename T>
 void FM::WordIndex<T>::renameItem(const QStringList& oldWords, const QStringList& newWords, const T& item)
 {
-   QMutexLocker locker(&this->mutex);
+   QWriteLocker locker(&this->lock);
    for (QStringListIterator i(oldWords); i.hasNext();)
-      this->root.rmItem(i.next(), item);
+      this->trie.rmItem(i.next(), item);
    for (QStringListIterator i(newWords); i.hasNext();)
-      this->root.addItem(&i.next(), item);
+      this->trie.addItem(&i.next(), item);
 }
 
 /**
@@ -142,74 +157,62 @@ void FM::WordIndex<T>::renameItem(const QStringList& oldWords, const QStringList
 template<typename T>
 QList<FM::NodeResult<T>> FM::WordIndex<T>::search(const QString& word, int maxNbResult, std::function<bool(const T&)> predicat) const
 {
-   QMutexLocker locker(&this->mutex);
-   return this->root.search(word, word.size() >= (Common::StringUtils::isKorean(word) ? MIN_WORD_SIZE_PARTIAL_MATCH_KOREAN : MIN_WORD_SIZE_PARTIAL_MATCH), maxNbResult, predicat);
+   QReadLocker locker(&this->lock);
+   return this->searchWithoutLock(word, maxNbResult, predicat);
 }
 
 /**
+  * The items matching the most terms come first. Among the items matching the same number of terms, those matching
+  * exactly their terms come first, then they are sorted by the combination of terms they match, the combinations being in
+  * lexicographic order. For example, for the terms [a, b, c]:
+  *  * a & b & c
+  *  * (a & b) \ c, (a & c) \ b, (b & c) \ a
+  *  * a \ b \ c, b \ a \ c, c \ a \ b
+  * The 'level' of each result reflects this order, the lowest level is the best.
+  *
+  * The results of each term are converted to a posting list sorted by item, the combinations are computed with a galloping
+  * intersection and the search stops as soon as the 'maxNbResult' best results are known.
   * @see http://dev.euphorik.ch/wiki/pmp/Algorithms#Word-indexing for more information.
   */
 template<typename T>
 QList<FM::NodeResult<T>> FM::WordIndex<T>::search(const QStringList& words, int maxNbResult, std::function<bool(const T&)> predicat) const
 {
-   QMutexLocker locker(&this->mutex);
+   QReadLocker locker(&this->lock);
 
    const int N = words.size();
+   if (maxNbResult < 0)
+      maxNbResult = std::numeric_limits<int>::max();
 
    // Launch a search for each term.
-   QVector<QSet<NodeResult<T>>> results(N);
+   QVector<QVector<NodeResult<T>>> postingLists(N);
    for (int i = 0; i < N; i++)
       // We can only limit the number of result for one term. When there is more than one term and thus some results set, say [a, b, c] for example, some good result may be contained in intersect, for example a & b or a & c.
-      results[i] += this->search(words[i], N == 1 ? maxNbResult : -1, predicat).toSet();
+      postingLists[i] = toPostingList(this->searchWithoutLock(words[i], N == 1 ? maxNbResult : -1, predicat));
 
    QList<NodeResult<T>> finalResult;
 
    int level = 0;
 
    // For each group of intersection number.
-   // For example, [a, b, c] :
-   //  * a & b & c
-   //  * (a & b) \ c
-   //    (a & c) \ b
-   //    (b & c) \ a
-   //  * a \ b \ c
    for (int i = 0; i < N && finalResult.size() < maxNbResult; i++)
    {
-      const int NB_INTERSECTS = N - i; // Number of set intersected.
-      int intersect[NB_INTERSECTS]; // A array of the results wich will be intersected.
-      for (int j = 0; j < NB_INTERSECTS; j++)
-         intersect[j] = j;
-
-      // For each combination of the current intersection group.
-      // For 2 intersections (NB_INTERSECTS == 2) among 3 elements [a, b, c]:
-      //  * (a, b)
-      //  * (a, c)
-      //  * (b, c)
-      QList<NodeResult<T>> nodesToSort;
+      const int NB_INTERSECTS = N - i; // Number of posting lists intersected.
       const int NB_COMBINATIONS = Common::Global::nCombinations(N, NB_INTERSECTS);
-      for (int j = 0; j < NB_COMBINATIONS && nodesToSort.size() + finalResult.size() < maxNbResult; j++)
-      {
-         // Apply intersects.
-         QSet<NodeResult<T>> currentLevelSet = results[intersect[0]];
-         for (QSetIterator<NodeResult<T>> k(currentLevelSet); k.hasNext();)
-         {
-            NodeResult<T>& node = const_cast<NodeResult<T>&>(k.next());
-            node.level = node.level ? NB_COMBINATIONS : 0;
-         }
-
-         for (int k = 1; k < NB_INTERSECTS; k++)
-            NodeResult<T>::intersect(currentLevelSet, results[intersect[k]], NB_COMBINATIONS);
+      const int nbResultsToFind = maxNbResult - finalResult.size();
 
-         // Apply substracts.
-         for (int k = -1; k < NB_INTERSECTS; k++)
-            for (int l = (k == -1 ? 0 : intersect[k] + 1); l < (k == NB_INTERSECTS - 1 ? N : intersect[k+1]); l++)
-               currentLevelSet -= results[l];
+      int intersect[NB_INTERSECTS]; // The posting lists which will be intersected.
+      for (int j = 0; j < NB_INTERSECTS; j++)
+         intersect[j] = j;
 
-         for (QSetIterator<NodeResult<T>> k(currentLevelSet); k.hasNext();)
-            const_cast<NodeResult<T>&>(k.next()).level += level;
+      // The results of this group by number of partially matched terms: for a given combination 'j' their level is
+      // 'level + j + NB_COMBINATIONS * nbPartialMatches', a result matching exactly its terms is always better than
+      // a partial one whatever its combination.
+      QVector<QList<NodeResult<T>>> resultsByNbPartialMatches(NB_INTERSECTS + 1);
 
-         // Sort by level.
-         nodesToSort << currentLevelSet.toList();
+      // For each combination of the current intersection group, stops when there is enough exact results (nothing better can come after).
+      for (int j = 0; j < NB_COMBINATIONS && resultsByNbPartialMatches[0].size() < nbResultsToFind; j++)
+      {
+         intersectCombination(postingLists, intersect, NB_INTERSECTS, level + j, NB_COMBINATIONS, resultsByNbPartialMatches);
 
          // Define positions of each intersect term.
          for (int k = NB_INTERSECTS - 1; k >= 0; k--)
@@ -220,15 +223,12 @@ QList<FM::NodeResult<T>> FM::WordIndex<T>::search(const QStringList& words, int
                   intersect[l] = intersect[k] + (l - k);
                break;
             }
-
-         level += 1;
       }
 
-      qSort(nodesToSort); // Sort by level
-
-      finalResult << nodesToSort;
+      for (int j = 0; j <= NB_INTERSECTS && finalResult.size() < maxNbResult; j++)
+         finalResult << resultsByNbPartialMatches[j];
 
-      level += NB_COMBINATIONS * NB_INTERSECTS;
+      level += NB_COMBINATIONS * (NB_INTERSECTS + 1);
    }
 
    if (finalResult.size() > maxNbResult)
@@ -240,8 +240,8 @@ QList<FM::NodeResult<T>> FM::WordIndex<T>::search(const QStringList& words, int
 template<typename T>
 QString FM::WordIndex<T>::toStringLog() const
 {
-   QMutexLocker locker(&mutex);
-   return this->root.toStringDebug();
+   QReadLocker locker(&this->lock);
+   return this->trie.toStringDebug();
 }
 
 template<typename T>
@@ -253,4 +253,126 @@ QList<T> FM::WordIndex<T>::resultToList(const QList<NodeResult<T>>& result)
    return l;
 }
 
+/**
+  * Return an upper bound of the number of items 'search(words)' would return, without building the result: an item matching
+  * more than one word is counted more than once. The count stops as soon as it reaches 'limit'.
+  * Used to choose the most selective index before a search.
+  */
+template<typename T>
+int FM::WordIndex<T>::estimateCount(const QStringList& words, int limit) const
+{
+   QReadLocker locker(&this->lock);
+
+   int n = 0;
+   for (QStringListIterator i(words); i.hasNext() && n < limit;)
+   {
+      const QString& word = i.next();
+      n += this->trie.count(word, word.size() >= (Common::StringUtils::isKorean(word) ? MIN_WORD_SIZE_PARTIAL_MATCH_KOREAN : MIN_WORD_SIZE_PARTIAL_MATCH), limit - n);
+   }
+   return n;
+}
+
+/**
+  * The caller must hold at least a read lock.
+  */
+template<typename T>
+QList<FM::NodeResult<T>> FM::WordIndex<T>::searchWithoutLock(const QString& word, int maxNbResult, std::function<bool(const T&)> predicat) const
+{
+   return this->trie.search(word, word.size() >= (Common::StringUtils::isKorean(word) ? MIN_WORD_SIZE_PARTIAL_MATCH_KOREAN : MIN_WORD_SIZE_PARTIAL_MATCH), maxNbResult, predicat);
+}
+
+/**
+  * Sort the results by item and remove the duplicates, an item matching exactly is kept over a partial match.
+  */
+template<typename T>
+QVector<FM::NodeResult<T>> FM::WordIndex<T>::toPostingList(const QList<NodeResult<T>>& result)
+{
+   QVector<NodeResult<T>> postingList;
+   postingList.reserve(result.size());
+   for (auto i = result.begin(); i != result.end(); ++i)
+      postingList << *i;
+
+   std::sort(postingList.begin(), postingList.end(), [](const NodeResult<T>& r1, const NodeResult<T>& r2) {
+      return std::less<T>()(r1.value, r2.value) || (!std::less<T>()(r2.value, r1.value) && r1.level < r2.level);
+   });
+   postingList.erase(std::unique(postingList.begin(), postingList.end()), postingList.end()); // Uses 'operator==' which compares only the values.
+
+   return postingList;
+}
+
+/**
+  * Return the index of the first posting not lower than 'value' starting at 'from'.
+  * The distance is doubled at each step then a binary search is done, it costs O(log(d)) where 'd' is the distance of the result from 'from'.
+  */
+template<typename T>
+int FM::WordIndex<T>::gallop(const QVector<NodeResult<T>>& postingList, int from, const T& value)
+{
+   const std::less<T> lower;
+   if (from >= postingList.size() || !lower(postingList[from].value, value))
+      return from;
+
+   int low = from; // Always lower than 'value'.
+   int high = from + 1;
+   int step = 1;
+   while (high < postingList.size() && lower(postingList[high].value, value))
+   {
+      low = high;
+      step *= 2;
+      high = from + step;
+   }
+   high = qMin(high, postingList.size());
+
+   return std::lower_bound(postingList.begin() + low + 1, postingList.begin() + high, value, [&](const NodeResult<T>& r, const T& v) { return lower(r.value, v); }) - postingList.begin();
+}
+
+/**
+  * Append to 'resultsByNbPartialMatches' the items present in all the posting lists of the combination 'intersect' and in none of the others.
+  */
+template<typename T>
+void FM::WordIndex<T>::intersectCombination(const QVector<QVector<NodeResult<T>>>& postingLists, const int* intersect, int nbIntersects, int level, int nbCombinations, QVector<QList<NodeResult<T>>>& resultsByNbPartialMatches)
+{
+   const int N = postingLists.size();
+
+   // The smallest posting list drives the intersection.
+   int smallest = intersect[0];
+   for (int k = 1; k < nbIntersects; k++)
+      if (postingLists[intersect[k]].size() < postingLists[smallest].size())
+         smallest = intersect[k];
+
+   QVarLengthArray<int, 16> positions(N);
+   for (int k = 0; k < N; k++)
+      positions[k] = 0;
+
+   for (auto i = postingLists[smallest].begin(); i != postingLists[smallest].end(); ++i)
+   {
+      int nbPartialMatches = 0;
+      bool match = true;
+
+      for (int l = 0, k = 0; l < N && match; l++)
+      {
+         const bool inCombination = k < nbIntersects && intersect[k] == l;
+         if (inCombination)
+            k++;
+
+         const QVector<NodeResult<T>>& postingList = postingLists[l];
+         const int p = positions[l] = gallop(postingList, positions[l], i->value);
+         const bool found = p < postingList.size() && postingList[p].value == i->value;
+
+         if (inCombination)
+         {
+            match = found;
+            if (found && postingList[p].level)
+               nbPartialMatches++;
+         }
+         else
+         {
+            match = !found;
+         }
+      }
+
+      if (match)
+         resultsByNbPartialMatches[nbPartialMatches] << NodeResult<T>(i->value, level + nbCombinations * nbPartialMatches);
+   }
+}
+
 #endif
@@ -20,6 +20,7 @@
 using namespace NL;
 
 #include <limits>
+#include <cstring>
 
 #if defined(Q_OS_LINUX)
    #include <netinet/in.h>
@@ -36,6 +37,7 @@ using namespace NL;
 #include <Common/Constants.h>
 #include <Common/Global.h>
 #include <Common/ProtoHelper.h>
+#include <Common/Hash.h>
 
 #include <Core/PeerManager/IPeer.h>
 
@@ -113,6 +115,34 @@ INetworkListener::SendStatus UDPListener::send(Common::MessageHeader::MessageTyp
    return INetworkListener::SendStatus::OK;
 }
 
+/**
+  * Send an UDP unicast message already serialized.
+  */
+INetworkListener::SendStatus UDPListener::send(Common::MessageHeader::MessageType type, const QByteArray& serializedMessage, const Common::Hash& peerID)
+{
+   PM::IPeer* peer = this->peerManager->getPeer(peerID);
+   if (!peer)
+      return INetworkListener::SendStatus::PEER_UNKNOWN;
+
+   int messageSize;
+   if (!(messageSize = this->writeMessageToBuffer(type, serializedMessage)))
+      return INetworkListener::SendStatus::MESSAGE_TOO_LARGE;
+
+   L_DEBU(QString("Send unicast UDP to %1, header.getType(): %2, message size: %3").
+      arg(peer->toStringLog()).
+      arg(Common::MessageHeader::messToStr(type)).
+      arg(messageSize)
+   );
+
+   if (this->unicastSocket.writeDatagram(this->buffer, messageSize, peer->getIP(), peer->getPort()) == -1)
+   {
+      L_WARN(QString("Unable to send datagram (unicast): error: %1").arg(this->unicastSocket.errorString()));
+      return INetworkListener::SendStatus::UNABLE_TO_SEND;
+   }
+
+   return INetworkListener::SendStatus::OK;
+}
+
 /**
   * Send an UDP multicast message.
   */
@@ -157,6 +187,11 @@ void UDPListener::sendIMAliveMessage()
    IMAliveMessage.set_download_rate(this->downloadManager->getDownloadRate());
    IMAliveMessage.set_upload_rate(this->uploadManager->getUploadRate());
 
+   static const Protos::Common::HashAlgorithm HASH_ALGORITHM = static_cast<Protos::Common::HashAlgorithm>(SETTINGS.get<quint32>("chunk_hash_algorithm"));
+   IMAliveMessage.set_hash_algorithm(HASH_ALGORITHM);
+   foreach (Common::HashAlgorithm algorithm, Common::Hasher::getSupportedAlgorithms())
+      IMAliveMessage.add_supported_hash_algorithm(static_cast<Protos::Common::HashAlgorithm>(algorithm));
+
    this->currentIMAliveTag = this->mtrand.randInt();
    this->currentIMAliveTag <<= 32;
    this->currentIMAliveTag |= this->mtrand.randInt();
@@ -235,6 +270,10 @@ void UDPListener::processPendingMulticastDatagrams()
             {
                const Protos::Core::IMAlive& IMAliveMessage = message.getMessage<Protos::Core::IMAlive>();
 
+               QList<Common::HashAlgorithm> supportedHashAlgorithms;
+               for (int i = 0; i < IMAliveMessage.supported_hash_algorithm_size(); i++)
+                  supportedHashAlgorithms << static_cast<Common::HashAlgorithm>(IMAliveMessage.supported_hash_algorithm(i));
+
                this->peerManager->updatePeer(
                   header.getSenderID(),
                   peerAddress,
@@ -244,12 +283,16 @@ void UDPListener::processPendingMulticastDatagrams()
                   Common::ProtoHelper::getStr(IMAliveMessage, &Protos::Core::IMAlive::core_version),
                   IMAliveMessage.download_rate(),
                   IMAliveMessage.upload_rate(),
-                  IMAliveMessage.version()
+                  IMAliveMessage.version(),
+                  supportedHashAlgorithms
                );
 
-               if (IMAliveMessage.chunk_size() > 0)
+               // The hashes of the asked chunks can't match ours if they have been computed with another algorithm.
+               static const Protos::Common::HashAlgorithm HASH_ALGORITHM = static_cast<Protos::Common::HashAlgorithm>(SETTINGS.get<quint32>("chunk_hash_algorithm"));
+               if (IMAliveMessage.chunk_size() > 0 && IMAliveMessage.hash_algorithm() == HASH_ALGORITHM)
                {
-                  QList<Common::Hash> hashes;
+                  // A 'QVector' stores the hashes contiguously: a single allocation for the whole message.
+                  QVector<Common::Hash> hashes;
                   hashes.reserve(IMAliveMessage.chunk_size());
                   for (int i = 0; i < IMAliveMessage.chunk_size(); i++)
                      hashes << IMAliveMessage.chunk(i).hash();
@@ -285,23 +328,21 @@ void UDPListener::processPendingMulticastDatagrams()
                   for (int i = 0; i < findMessage.pattern().extension_filter_size(); i++)
                      extensions << Common::ProtoHelper::getRepeatedStr(findMessage.pattern(), &Protos::Common::FindPattern::extension_filter, i);
 
-                  QList<Protos::Common::FindResult> results =
-                     this->fileManager->find(
+                  // The results are already serialized with their tag, they are only copied after the header.
+                  const QList<QByteArray>& results =
+                     this->fileManager->findEncoded(
                         Common::ProtoHelper::getStr(findMessage.pattern(), &Protos::Common::FindPattern::pattern),
                         extensions,
                         findMessage.pattern().min_size() == 0 ? std::numeric_limits<qint64>::min() : (qint64)findMessage.pattern().min_size(), // According the protocol.
                         findMessage.pattern().max_size() == 0 ? std::numeric_limits<qint64>::max() : (qint64)findMessage.pattern().max_size(), // According the protocol.
                         findMessage.pattern().category(),
                         SETTINGS.get<quint32>("max_number_of_search_result_to_send"),
-                        this->MAX_UDP_DATAGRAM_PAYLOAD_SIZE - Common::MessageHeader::HEADER_SIZE
+                        this->MAX_UDP_DATAGRAM_PAYLOAD_SIZE - Common::MessageHeader::HEADER_SIZE,
+                        findMessage.tag()
                      );
 
-                  for (QMutableListIterator<Protos::Common::FindResult> i(results); i.hasNext();)
-                  {
-                     Protos::Common::FindResult& result = i.next();
-                     result.set_tag(findMessage.tag());
-                     this->send(Common::MessageHeader::CORE_FIND_RESULT, result, header.getSenderID());
-                  }
+                  for (QListIterator<QByteArray> i(results); i.hasNext();)
+                     this->send(Common::MessageHeader::CORE_FIND_RESULT, i.next(), header.getSenderID());
                }
             }
             break;
@@ -447,6 +488,26 @@ int UDPListener::writeMessageToBuffer(Common::MessageHeader::MessageType type, c
    return nbBytesWritten;
 }
 
+/**
+  * Writes a given serialized message to the buffer (this->buffer) prefixed by a header.
+  * @return the total size (header size + message size). Return 0 if the total size is bigger than 'Protos.Core.Settings.max_udp_datagram_size'.
+  */
+int UDPListener::writeMessageToBuffer(Common::MessageHeader::MessageType type, const QByteArray& serializedMessage)
+{
+   const Common::MessageHeader header(type, serializedMessage.size(), this->getOwnID());
+
+   if (Common::MessageHeader::HEADER_SIZE + serializedMessage.size() > this->MAX_UDP_DATAGRAM_PAYLOAD_SIZE)
+   {
+      L_ERRO(QString("Datagram size too big: %1, max allowed: %2").arg(Common::MessageHeader::HEADER_SIZE + serializedMessage.size()).arg(this->MAX_UDP_DATAGRAM_PAYLOAD_SIZE));
+      return 0;
+   }
+
+   Common::MessageHeader::writeHeader(this->buffer, header);
+   memcpy(this->bodyBuffer, serializedMessage.constData(), serializedMessage.size());
+
+   return Common::MessageHeader::HEADER_SIZE + serializedMessage.size();
+}
+
 /**
   * @return A null header if error.
   */
@@ -22,6 +22,7 @@
 #include <QObject>
 #include <QUdpSocket>
 #include <QTimer>
+#include <QByteArray>
 #include <QSharedPointer>
 #include <QNetworkInterface>
 #include <QUdpSocket>
@@ -64,6 +65,7 @@ namespace NL
       );
 
       INetworkListener::SendStatus send(Common::MessageHeader::MessageType type, const google::protobuf::Message& message, const Common::Hash& peerID);
+      INetworkListener::SendStatus send(Common::MessageHeader::MessageType type, const QByteArray& serializedMessage, const Common::Hash& peerID);
       INetworkListener::SendStatus send(Common::MessageHeader::MessageType type, const google::protobuf::Message& message = Protos::Common::Null());
 
       void rebindSockets();
@@ -86,6 +88,7 @@ namespace NL
 
    private:
       int writeMessageToBuffer(Common::MessageHeader::MessageType type, const google::protobuf::Message& message);
+      int writeMessageToBuffer(Common::MessageHeader::MessageType type, const QByteArray& serializedMessage);
       Common::MessageHeader readDatagramToBuffer(QUdpSocket& socket, QHostAddress& peerAddress);
 
       Common::Hash getOwnID() const;
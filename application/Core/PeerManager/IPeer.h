@@ -21,12 +21,14 @@
 
 #include <QObject>
 #include <QSharedPointer>
+#include <QList>
 #include <QHostAddress>
 
 #include <Protos/common.pb.h>
 #include <Protos/core_protocol.pb.h>
 
 #include <Common/Hashes.h>
+#include <Common/HashAlgorithm.h>
 #include <Common/LogManager/ILoggable.h>
 #include <Core/PeerManager/IGetEntriesResult.h>
 #include <Core/PeerManager/IGetHashesResult.h>
@@ -101,6 +103,12 @@ namespace PM
 
       virtual quint32 getProtocolVersion() const = 0;
 
+      /**
+        * The algorithms the peer can compute the chunk hashes with, the fastest first, see 'IMAlive.supported_hash_algorithm'.
+        * Empty if the peer is an old one or if it hasn't been updated yet: only SHA-1 is supported.
+        */
+      virtual QList<Common::HashAlgorithm> getSupportedHashAlgorithms() const = 0;
+
       /**
         * Ask for the entries in a given directories.
         * Return a null pointer if the peer is not available.
@@ -86,7 +86,8 @@ namespace PM
          const QString& coreVersion,
          quint32 downloadRate,
          quint32 uploadRate,
-         quint32 protocolVersion
+         quint32 protocolVersion,
+         const QList<Common::HashAlgorithm>& supportedHashAlgorithms
       ) = 0;
 
       /**
@@ -70,7 +70,8 @@ void PeerUpdater::update()
                QString(),
                0,
                0,
-               Common::Constants::PROTOCOL_VERSION
+               Common::Constants::PROTOCOL_VERSION,
+               Common::Hasher::getSupportedAlgorithms()
             );
       }
    }
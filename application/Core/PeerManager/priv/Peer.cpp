@@ -155,6 +155,11 @@ quint32 Peer::getProtocolVersion() const
    return this->protocolVersion;
 }
 
+QList<Common::HashAlgorithm> Peer::getSupportedHashAlgorithms() const
+{
+   return this->supportedHashAlgorithms;
+}
+
 void Peer::update(
    const QHostAddress& IP,
    quint16 port,
@@ -163,7 +168,8 @@ void Peer::update(
    const QString& coreVersion,
    quint32 downloadRate,
    quint32 uploadRate,
-   quint32 protocolVersion
+   quint32 protocolVersion,
+   const QList<Common::HashAlgorithm>& supportedHashAlgorithms
 )
 {
    this->alive = true;
@@ -177,6 +183,7 @@ void Peer::update(
    this->downloadRate = downloadRate;
    this->uploadRate = uploadRate;
    this->protocolVersion = protocolVersion;
+   this->supportedHashAlgorithms = supportedHashAlgorithms;
 
    this->connectionPool.setIP(this->IP, this->port);
 }
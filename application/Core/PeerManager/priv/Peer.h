@@ -26,10 +26,12 @@
 #include <QHostAddress>
 #include <QSharedPointer>
 #include <QMutex>
+#include <QList>
 
 #include <google/protobuf/text_format.h>
 
 #include <Common/Hash.h>
+#include <Common/HashAlgorithm.h>
 #include <Common/Constants.h>
 #include <Common/Uncopyable.h>
 
@@ -71,6 +73,7 @@ namespace PM
       virtual bool isAlive() const;
       virtual bool isAvailable() const;
       virtual quint32 getProtocolVersion() const;
+      virtual QList<Common::HashAlgorithm> getSupportedHashAlgorithms() const;
       virtual void update(
          const QHostAddress& IP,
          quint16 port,
@@ -79,7 +82,8 @@ namespace PM
          const QString& coreVersion,
          quint32 downloadRate,
          quint32 uploadRate,
-         quint32 protocolVersion
+         quint32 protocolVersion,
+         const QList<Common::HashAlgorithm>& supportedHashAlgorithms
       );
       virtual void setAsDead();
 
@@ -123,6 +127,7 @@ namespace PM
       QTimer blockedTimer;
 
       quint32 protocolVersion;
+      QList<Common::HashAlgorithm> supportedHashAlgorithms;
    };
 }
 #endif
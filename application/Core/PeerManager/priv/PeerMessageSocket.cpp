@@ -19,8 +19,13 @@
 #include <priv/PeerMessageSocket.h>
 using namespace PM;
 
+#include <cstring>
+
 #include <QCoreApplication>
 
+#include <google/protobuf/io/coded_stream.h>
+using google::protobuf::io::CodedOutputStream;
+
 #include <Protos/core_protocol.pb.h>
 #include <Protos/common.pb.h>
 
@@ -128,6 +133,16 @@ void PeerMessageSocket::send(Common::MessageHeader::MessageType type, const goog
    this->MessageSocket::send(type, message);
 }
 
+void PeerMessageSocket::send(Common::MessageHeader::MessageType type, const QByteArray& serializedMessage)
+{
+   if (!this->isListening())
+      return;
+
+   this->setActive();
+
+   this->MessageSocket::send(type, serializedMessage);
+}
+
 /**
   * Is the socket currently been used?
   */
@@ -206,14 +221,14 @@ void PeerMessageSocket::nextAskedHash(Protos::Core::HashResult hash)
    }
 }
 
-void PeerMessageSocket::entriesResult(const Protos::Core::GetEntriesResult::EntryResult& result)
+void PeerMessageSocket::entriesResult(const QByteArray& encodedResult)
 {
    bool resultEmpty = true;
    for (int i = 0; i < this->entriesResultsToReceive.count(); i++)
    {
       if (this->entriesResultsToReceive[i] == this->sender())
       {
-         this->entriesResultMessage.mutable_result(i)->CopyFrom(result);
+         this->encodedEntriesResults[i] = encodedResult;
          this->entriesResultsToReceive[i].clear();
       }
       else if (!this->entriesResultsToReceive[i].isNull())
@@ -238,7 +253,9 @@ void PeerMessageSocket::entriesResultTimeout()
    {
       if (this->entriesResultsToReceive[i] == this->sender())
       {
-         this->entriesResultMessage.mutable_result(i)->set_status(Protos::Core::GetEntriesResult::EntryResult::TIMEOUT_SCANNING_IN_PROGRESS);
+         Protos::Core::GetEntriesResult::EntryResult result;
+         result.set_status(Protos::Core::GetEntriesResult::EntryResult::TIMEOUT_SCANNING_IN_PROGRESS);
+         this->encodedEntriesResults[i] = Common::ProtoHelper::serialize(result);
          this->entriesResultsToReceive[i].clear();
       }
       else if (!this->entriesResultsToReceive[i].isNull())
@@ -268,12 +285,16 @@ void PeerMessageSocket::onNewMessage(const Common::Message& message)
             connect(result.data(), &FM::IGetEntriesResult::result, this, &PeerMessageSocket::entriesResult, Qt::DirectConnection);
             connect(result.data(), &FM::IGetEntriesResult::timeout, this, &PeerMessageSocket::entriesResultTimeout, Qt::DirectConnection);
             this->entriesResultsToReceive << result;
-            this->entriesResultMessage.add_result();
+            this->encodedEntriesResults << QByteArray();
          }
 
          // Add the root directories if asked.
          if (getEntries.dirs().entry_size() == 0 || getEntries.get_roots())
-            this->entriesResultMessage.add_result()->mutable_entries()->CopyFrom(this->fileManager->getEntries());
+         {
+            Protos::Core::GetEntriesResult::EntryResult rootsResult;
+            rootsResult.mutable_entries()->CopyFrom(this->fileManager->getEntries());
+            this->encodedEntriesResults << Common::ProtoHelper::serialize(rootsResult);
+         }
 
          if (this->entriesResultsToReceive.isEmpty())
             this->sendEntriesResultMessage();
@@ -379,10 +400,27 @@ void PeerMessageSocket::initUnactiveTimer()
    this->inactiveTimer.start();
 }
 
+/**
+  * The results are already serialized, they are concatenated as the repeated field 'result' of a 'Protos::Core::GetEntriesResult'.
+  */
 void PeerMessageSocket::sendEntriesResultMessage()
 {
-   this->send(Common::MessageHeader::CORE_GET_ENTRIES_RESULT, this->entriesResultMessage);
-   this->entriesResultMessage.Clear();
+   int size = 0;
+   foreach (const QByteArray& encodedResult, this->encodedEntriesResults)
+      size += 1 + CodedOutputStream::VarintSize32(encodedResult.size()) + encodedResult.size();
+
+   QByteArray message(size, Qt::Uninitialized);
+   quint8* target = reinterpret_cast<quint8*>(message.data());
+   foreach (const QByteArray& encodedResult, this->encodedEntriesResults)
+   {
+      *target++ = ENTRY_RESULT_KEY;
+      target = CodedOutputStream::WriteVarint32ToArray(encodedResult.size(), target);
+      memcpy(target, encodedResult.constData(), encodedResult.size());
+      target += encodedResult.size();
+   }
+
+   this->send(Common::MessageHeader::CORE_GET_ENTRIES_RESULT, message);
+   this->encodedEntriesResults.clear();
    this->entriesResultsToReceive.clear();
    this->finished();
 }
@@ -25,6 +25,8 @@
 #include <QTimer>
 #include <QQueue>
 #include <QSharedPointer>
+#include <QList>
+#include <QByteArray>
 
 #include <google/protobuf/message.h>
 
@@ -77,6 +79,7 @@ namespace PM
       Common::Hash getRemotePeerID() const;
 
       void send(Common::MessageHeader::MessageType type, const google::protobuf::Message& message);
+      void send(Common::MessageHeader::MessageType type, const QByteArray& serializedMessage);
 
       bool isActive() const;
       void setActive();
@@ -97,7 +100,7 @@ namespace PM
 
    private slots:
       void nextAskedHash(Protos::Core::HashResult hash);
-      void entriesResult(const Protos::Core::GetEntriesResult::EntryResult& result);
+      void entriesResult(const QByteArray& encodedResult);
       void entriesResultTimeout();
 
    private:
@@ -108,8 +111,10 @@ namespace PM
 
       void sendEntriesResultMessage();
 
+      static const quint8 ENTRY_RESULT_KEY = 0x0A; ///< The key of 'GetEntriesResult.result': field 1, wire type length-delimited (2).
+
       QList<QSharedPointer<FM::IGetEntriesResult>> entriesResultsToReceive;
-      Protos::Core::GetEntriesResult entriesResultMessage;
+      QList<QByteArray> encodedEntriesResults; ///< Each one is a serialized 'Protos::Core::GetEntriesResult::EntryResult', see 'sendEntriesResultMessage()'.
 
       QSharedPointer<FM::IFileManager> fileManager;
 
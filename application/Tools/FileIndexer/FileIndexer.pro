@@ -26,5 +26,6 @@ SOURCES += main.cpp
 HEADERS += \
     ../../Core/FileManager/priv/WordIndex/WordIndex.h \
     ../../Core/FileManager/priv/WordIndex/Node.h \
+    ../../Core/FileManager/priv/WordIndex/Trie.h \
     OldWordIndex.h \
     OldNode.h
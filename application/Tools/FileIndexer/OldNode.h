@@ -19,11 +19,23 @@
 #ifndef OLD_NODE_H
 #define OLD_NODE_H
 
+#include <functional>
+
 #include <QList>
 #include <QSet>
-#include <QChar>
+#include <QString>
+#include <QPair>
 
 #include <Common/Uncopyable.h>
+#include <Common/StringUtils.h>
+
+/**
+  * @class Old::Node
+  *
+  * Indexed item by string, see the class 'WordIndex' for more explanations.
+  *
+  * The pointer-based radix trie used by the core before 'FM::Trie', kept to compare the two implementations.
+  */
 
 namespace Old
 {
@@ -37,130 +49,100 @@ namespace Old
       T value;
       int level;
    };
-}
 
-/**
-  * s1 <- s1 & s2.
-  * For all common items the 'level' fields are summed.
-  */
-template <typename T>
-void Old::NodeResult<T>::intersect(QSet<Old::NodeResult<T>>& s1, const QSet<Old::NodeResult<T>>& s2, int matchValue)
-{
-   for (QMutableSetIterator<NodeResult<T>> i(s1); i.hasNext();)
+   /**
+     * s1 <- s1 & s2.
+     * For all common items the 'level' fields are summed.
+     */
+   template <typename T>
+   void NodeResult<T>::intersect(QSet<NodeResult<T>>& s1, const QSet<NodeResult<T>>& s2, int matchValue)
    {
-      const NodeResult<T>& node = i.next();
-      typename QSet<NodeResult<T>>::const_iterator j = s2.find(node);
-      if (j == s2.constEnd())
-         i.remove();
-      else
-         const_cast<NodeResult<T>&>(node).level += j->level ? matchValue : 0;
+      for (QMutableSetIterator<NodeResult<T>> i(s1); i.hasNext();)
+      {
+         const NodeResult<T>& node = i.next();
+         typename QSet<NodeResult<T>>::const_iterator j = s2.find(node);
+         if (j == s2.constEnd())
+            i.remove();
+         else
+            const_cast<NodeResult<T>&>(node).level += j->level ? matchValue : 0;
+      }
    }
-}
 
-/**
-  * To sort from the best level (the lowest value) to the worse (the hightest value).
-  */
-template <typename T>
-inline bool operator<(const Old::NodeResult<T>& nr1, const Old::NodeResult<T>& nr2)
-{
-   return nr1.level < nr2.level;
-}
+   /**
+     * To sort from the best level (the lowest value) to the worse (the hightest value).
+     */
+   template <typename T>
+   inline bool operator<(const NodeResult<T>& nr1, const NodeResult<T>& nr2)
+   {
+      return nr1.level < nr2.level;
+   }
+
+   template <typename T>
+   inline bool operator==(const NodeResult<T>& nr1, const NodeResult<T>& nr2)
+   {
+      return nr1.value == nr2.value;
+   }
+
+   template <typename T>
+   inline uint qHash(const NodeResult<T>& nr)
+   {
+      return qHash(nr.value);
+   }
 
-/////
+   /////
 
-namespace Old
-{
    template<typename T>
    class Node : Common::Uncopyable
    {
    public:
-   /**
-     * Create a root node.
-     */
-   Node();
+      /**
+        * Create a root node.
+        */
+      Node();
+      ~Node();
 
-   ~Node();
+      /**
+        * Add an item to the node.
+        * If the item already exists (using operator==) nothing is added.
+        */
+      void addItem(const QStringRef& word, const T& item);
 
-   /**
-     * Add a child node and return it.
-     * If the node already exists it will returned.
-     */
-   Node<T>& addNode(const QChar& letter);
+      /**
+        * Remove the item from the node.
+        * If the item doesn't exist nothing happen and 'false' is returned else the item is removed and 'true' is returned.
+        */
+      bool rmItem(const QString& word, const T& item);
 
-   /**
-     * Remove a node for their children.
-     * If the node doesn't exist nothing happen.
-     */
-   void rmNode(Node<T>* const node);
+      QList<NodeResult<T>> search(const QString& word, bool alsoFromSubNodes = false, int maxNbResult = -1, std::function<bool(const T&)> predicat = nullptr) const;
 
-   /**
-     * Get a children node.
-     * /!\ If no one exists 0 is returned.
-     */
-   Node<T>* getNode(const QChar& letter) const;
-
-   /**
-     * Does the node have some children?
-     */
-   bool haveChildren() const;
-
-   /**
-     * Add an item to the node.
-     * If the item already exists (using operator==) nothing is added.
-     */
-   void addItem(T item);
+      QString toStringDebug() const;
 
-   /**
-     * Remove the item from the node.
-     * If the item doesn'exist nothing happen.
-     */
-   void rmItem(T item);
-
-   /**
-     * Return all items from the current node and its sub nodes (recursively) if 'alsoFromSubNodes' is true.
-     * For all direct sub nodes NodeResult::level is set to 0, for other sub nodes level is set to 1.
-     */
-   QList<NodeResult<T>> getItems(bool alsoFromSubNodes = false, int maxNbResult = -1) const;
+   private:
+      Node(const QString& part);
+      Node(const QString& part, const T& item);
 
-   /**
-     * Does the node own some items?
-     */
-   bool haveItems() const;
+      QPair<Node<T>*, int> getNode(const QString& word, bool exactMatch = false) const;
 
-   private:
-      Node(const QChar& letter);
+      /**
+        * Return all items from the current node and its sub nodes (recursively) if 'alsoFromSubNodes' is true.
+        * For all direct sub nodes NodeResult::level is set to 0, for other sub nodes level is set to 1.
+        */
+      QList<NodeResult<T>> getItems(bool alsoFromSubNodes = false, int maxNbResult = -1, std::function<bool(const T&)> predicat = nullptr) const;
 
-      const QChar letter; ///< The letter from an indexed word.
+      void remove(int i);
 
+      QString part;
       QList<Node<T>*> children; ///< The children nodes.
       QList<T> items; ///< The indexed items.
    };
-
-   template <typename T>
-   inline bool operator==(const NodeResult<T>& r1, const NodeResult<T>& r2)
-   {
-      return r1.value == r2.value;
-   }
-
-   template <typename T>
-   inline uint qHash(const NodeResult<T>& r)
-   {
-      uint h = 0;
-      static const int n = sizeof(T*) > sizeof(uint) ? sizeof(T*) / sizeof(uint) : 1;
-      for (int i = 0; i < n; i++)
-         h ^= intptr_t(&r.value) >> (i * sizeof(uint));
-      return h;
-   }
 }
 
-/***** Definition *****/
-
 template <typename T>
-Old::Node<T>::Node() :
-   letter('\0')
+Old::Node<T>::Node()
 {
 }
 
+
 template <typename T>
 Old::Node<T>::~Node()
 {
@@ -169,57 +151,169 @@ Old::Node<T>::~Node()
 }
 
 template <typename T>
-Old::Node<T>& Old::Node<T>::addNode(const QChar& letter)
+void Old::Node<T>::addItem(const QStringRef& word, const T& item)
 {
-   // Search if the letter already exists.
-   for (int i = 0; i < this->children.size(); i++)
+   if (this->children.isEmpty())
    {
-      if (this->children[i]->letter == letter)
-         return *this->children[i];
+      this->children << new Node(word.toString(), item);
+   }
+   else
+   {
+      for (int i = 0; i < this->children.size(); ++i)
+      {
+         Node<T>* child = this->children[i];
+         const int p = Common::StringUtils::commonPrefix(word, &child->part);
+         if (p != 0)
+         {
+            if (p == word.size())
+            {
+                // The word and the sub-part are equal.
+               if (p == child->part.size())
+               {
+                  child->items << item;
+               }
+               else // The word is the begining of the the sub-part.
+               {
+                  Node<T>* newNode = new Node<T>(word.toString(), item);
+                  child->part.remove(0, p);
+                  this->children.replace(i, newNode);
+                  newNode->children << child;
+               }
+            }
+            else if (p == child->part.size()) // The sub part is the begining of the word.
+            {
+               child->addItem(word.string()->midRef(word.position() + p, word.size() - p), item);
+            }
+            else
+            {
+               // The word and the sub part share at least one character from the begining.
+               Node<T>* newNodeSplit = new Node<T>(word.string()->mid(word.position(), p));
+               child->part.remove(0, p);
+               this->children.replace(i, newNodeSplit);
+               newNodeSplit->children << child;
+
+               Node<T>* newNode = new Node<T>(word.string()->mid(word.position() + p, word.size() - p), item);
+               newNodeSplit->children << newNode;
+            }
+            return;
+         }
+      }
+      this->children << new Node<T>(word.toString(), item);
+   }
+}
+
+template <typename T>
+bool Old::Node<T>::rmItem(const QString& word, const T& item)
+{
+   QPair<Node<T>*, int> nodes = this->getNode(word, true);
+   if (!nodes.first)
+      return false;
+
+   Node<T>* node = nodes.first->children[nodes.second];
+
+   if (node->items.size() == 1 && node->items[0] == item)
+   {
+      node->items.clear();
+      nodes.first->remove(nodes.second);
+      return true;
+   }
+   else
+   {
+      return node->items.removeOne(item);
    }
-   Node<T>* n = new Node(letter);
-   this->children.append(n);
-   return *n;
 }
 
 template <typename T>
-void Old::Node<T>::rmNode(Node<T>* const node)
+QList<Old::NodeResult<T>> Old::Node<T>::search(const QString& word, bool alsoFromSubNodes, int maxNbResult, std::function<bool(const T&)> predicat) const
 {
-   this->children.removeOne(node);
+   QPair<Node<T>*, int> nodes = this->getNode(word, !alsoFromSubNodes);
+   if (!nodes.first)
+      return QList<NodeResult<T>>();
+
+   return nodes.first->children[nodes.second]->getItems(alsoFromSubNodes, maxNbResult, predicat);
 }
 
 template <typename T>
-Old::Node<T>* Old::Node<T>::getNode(const QChar& letter) const
+QString Old::Node<T>::toStringDebug() const
 {
-   for (QListIterator<Node<T>*>i(this->children); i.hasNext();)
+   static const int INDENTATION = 3;
+   struct SubNode
+   {
+      int level;
+      const Node<T>* node;
+   };
+
+   QString result;
+   QList<SubNode> nodesToProcess { SubNode { 0, this } };
+
+   while (!nodesToProcess.isEmpty())
    {
-      Node<T>* node = i.next();
-      if (node->letter == letter)
-         return node;
+      SubNode current = nodesToProcess.takeFirst();
+      result.append(QString().fill(' ', INDENTATION * current.level));
+      result.append(current.node->part).append(current.node->items.isEmpty() ? "" : QString(" N = %1").arg(current.node->items.size())).append('\n');
+
+      QListIterator<Node<T>*> i(current.node->children);
+      i.toBack();
+      while (i.hasPrevious())
+         nodesToProcess.prepend(SubNode { current.level + 1, i.previous() });
    }
-   return 0;
+
+   return result;
 }
 
 template <typename T>
-bool Old::Node<T>::haveChildren() const
+Old::Node<T>::Node(const QString& part) :
+   part(part)
 {
-   return !this->children.empty();
 }
 
 template <typename T>
-void Old::Node<T>::addItem(T item)
+Old::Node<T>::Node(const QString& part, const T& item) :
+   part(part)
 {
    this->items << item;
 }
 
+/**
+  * Returns the node matching the given word as the 'QPair::second'th child of its parent 'QPair::first'.
+  */
 template <typename T>
-void Old::Node<T>::rmItem(T item)
+QPair<Old::Node<T>*, int> Old::Node<T>::getNode(const QString& word, bool exactMatch) const
 {
-   this->items.removeAll(item);
+   QString part = word;
+   Node<T>* currentParent = const_cast<Node<T>*>(this);
+   for (int i = 0; i < currentParent->children.size(); ++i)
+   {
+      Node<T>* child = currentParent->children[i];
+      int p = Common::StringUtils::commonPrefix(&part, &child->part);
+
+      if (p != 0)
+      {
+         if (p == child->part.size())
+         {
+            if (p == part.size())
+               return qMakePair(currentParent, i);
+
+            currentParent = child;
+            part.remove(0, p);
+            i = -1;
+            continue;
+         }
+         else if (p == part.size())
+         {
+            if (exactMatch)
+               break;
+            else
+               return qMakePair(currentParent, i);
+         }
+         break;
+      }
+   }
+   return QPair<Node<T>*, int>(nullptr, 0);
 }
 
 template <typename T>
-QList<Old::NodeResult<T>> Old::Node<T>::getItems(bool alsoFromSubNodes, int maxNbResult) const
+QList<Old::NodeResult<T>> Old::Node<T>::getItems(bool alsoFromSubNodes, int maxNbResult, std::function<bool(const T&)> predicat) const
 {
    QList<NodeResult<T>> result;
    QList<Node<T>*> nodesToVisit;
@@ -232,10 +326,13 @@ QList<Old::NodeResult<T>> Old::Node<T>::getItems(bool alsoFromSubNodes, int maxN
 
       for (QListIterator<T> i(current->items); i.hasNext();)
       {
-         // 'level' == 0 means the item matches exactly, it's a bit tricky..
-         result << NodeResult<T>(i.next(), current == this ? 0 : 1);
-         if (result.size() == maxNbResult)
-            return result;
+         const T& item = i.next();
+         if (!predicat || predicat(item))
+         {
+            result << NodeResult<T>(item, current == this ? 0 : 1); // 'level' == 0 means the item matches exactly, it's a bit tricky.
+            if (result.size() == maxNbResult)
+               return result;
+         }
       }
 
       if (!alsoFromSubNodes)
@@ -247,15 +344,47 @@ QList<Old::NodeResult<T>> Old::Node<T>::getItems(bool alsoFromSubNodes, int maxN
    return result;
 }
 
+/**
+  * Try to remove the i'th child.
+  */
 template <typename T>
-bool Old::Node<T>::haveItems() const
+void Old::Node<T>::remove(int i)
 {
-   return !this->items.empty();
-}
+   if (i >= this->children.size())
+      return;
 
-template <typename T>
-Old::Node<T>::Node(const QChar& letter) :
-   letter(letter)
-{}
+   Node<T>* nodeToDelete = this->children[i];
+
+   // If the node to delete has nothing to merge we just remove it.
+   if (nodeToDelete->children.isEmpty() && nodeToDelete->items.isEmpty())
+   {
+      this->children.removeAt(i);
+      delete nodeToDelete;
+
+      // If we have only one child maybe we can delete it.
+      if (this->children.size() == 1)
+         this->remove(0);
+   }
+   // If the parent has no item and only one child (nodeToDelete) then we merge its child and delete it.
+   else if (this->items.isEmpty() && this->children.size() == 1)
+   {
+      this->items << nodeToDelete->items;
+      this->children << nodeToDelete->children;
+      this->part.append(nodeToDelete->part);
+
+      this->children.removeAt(i);
+      nodeToDelete->children.clear();
+      delete nodeToDelete;
+
+      // If we have only one child maybe we can delete it.
+      if (this->children.size() == 1)
+         this->remove(0);
+   }
+   // If the node to delete has one child and no item we can merge its child.
+   else if (nodeToDelete->children.size() == 1 && nodeToDelete->items.isEmpty())
+   {
+      nodeToDelete->remove(0);
+   }
+}
 
 #endif
@@ -19,137 +19,236 @@
 #ifndef OLD_WORDINDEX_H
 #define OLD_WORDINDEX_H
 
+#include <functional>
+
 #include <QList>
 #include <QString>
 #include <QChar>
-#include <QMutex>
+#include <QReadWriteLock>
 
 #include <Common/Uncopyable.h>
+#include <Common/Global.h>
+#include <Common/LogManager/ILoggable.h>
 
 #include "OldNode.h"
 
+/**
+  * @class Old::WordIndex
+  *
+  * The purpose of the class 'WordIndex' is to index a set of item of type 'T' by string.
+  *
+  * This class is thread safe.
+  * The searches only take a read lock on the index: many searches can be done concurrently. They can only be blocked by
+  * a modification (add, remove or rename of an item) which holds the write lock for a single item at a time.
+  */
+
 namespace Old
 {
-   /**
-     * An collection of T indexed by word.
-     */
    template<typename T>
-   class WordIndex : Common::Uncopyable
+   class WordIndex : public LM::ILoggable, Common::Uncopyable
    {
-      static const int MIN_WORD_SIZE_PARTIAL_MATCH; ///< During a search, the words which have a size below this value must match entirely, for exemple 'of' match "conspiracy of one" and not "offspring".
    public:
+      static const int MIN_WORD_SIZE_PARTIAL_MATCH; ///< During a search, the words which have a size below this value must match entirely, for exemple 'of' match "conspiracy of one" and not "offspring".
+      static const int MIN_WORD_SIZE_PARTIAL_MATCH_KOREAN;
+
       WordIndex();
 
+      void addItem(const QString& word, const T& item);
       void addItem(const QStringList& words, const T& item);
-      void rmItem(const QStringList& words, const T& item);
-      QList<NodeResult<T>> search(const QStringList& words, int maxNbResultPerWord = -1) const;
-      QList<NodeResult<T>> search(const QString& word, int maxNbResult = -1) const;
+      bool rmItem(const QString& word, const T& item);
+      bool rmItem(const QStringList& words, const T& item);
+      void renameItem(const QString& oldWord, const QString& newWord, const T& item);
+      void renameItem(const QStringList& oldWords, const QStringList& newWords, const T& item);
+
+      QList<NodeResult<T>> search(const QString& word, int maxNbResult = -1, std::function<bool(const T&)> predicat = nullptr) const;
+      QList<NodeResult<T>> search(const QStringList& words, int maxNbResult = -1, std::function<bool(const T&)> predicat = nullptr) const;
+
+      QString toStringLog() const;
 
       static QList<T> resultToList(const QList<NodeResult<T>>& result);
 
    private:
-      Node<T> node;
-      mutable QMutex mutex;
+      QList<NodeResult<T>> searchWithoutLock(const QString& word, int maxNbResult, std::function<bool(const T&)> predicat) const;
+
+      Node<T> root;
+      mutable QReadWriteLock lock; // Not recursive, a read lock taken twice by the same thread may deadlock if a writer is waiting in between.
    };
 }
 
-/***** Definitions *****/
-
 template<typename T>
 const int Old::WordIndex<T>::MIN_WORD_SIZE_PARTIAL_MATCH(3);
 
 template<typename T>
-Old::WordIndex<T>::WordIndex()
+const int Old::WordIndex<T>::MIN_WORD_SIZE_PARTIAL_MATCH_KOREAN(1);
+
+template<typename T>
+   Old::WordIndex<T>::WordIndex()
 {}
 
 template<typename T>
-void Old::WordIndex<T>::addItem(const QStringList& words, const T& item)
+void Old::WordIndex<T>::addItem(const QString& word, const T& item)
 {
-   QMutexLocker locker(&mutex);
-
-   for (QListIterator<QString> i(words); i.hasNext();)
-   {
-      const QString& word = i.next();
-      Node<T>* currentNode = &this->node;
-      for (int j = 0; j < word.size(); j++)
-         currentNode = &currentNode->addNode(word[j]);
-      currentNode->addItem(item);
-   }
+   QWriteLocker locker(&this->lock);
+   this->root.addItem(&word, item);
 }
 
 template<typename T>
-void Old::WordIndex<T>::rmItem(const QStringList& words, const T& item)
+void Old::WordIndex<T>::addItem(const QStringList& words, const T& item)
 {
-   QMutexLocker locker(&mutex);
+   QWriteLocker locker(&this->lock);
+   for (QStringListIterator i(words); i.hasNext();)
+      this->root.addItem(&i.next(), item);
+}
 
-   for (QListIterator<QString> i(words); i.hasNext();)
-   {
-      const QString& word = i.next();
-      QList<Node<T>*> nodes;
-      Node<T>* currentNode = &this->node;
-      nodes.prepend(currentNode);
-      for (int j = 0; j < word.size(); j++)
-      {
-         if (!(currentNode = currentNode->getNode(word[j])))
-            goto nextWord;
-         nodes.prepend(currentNode);
-      }
+template<typename T>
+bool Old::WordIndex<T>::rmItem(const QString& word, const T& item)
+{
+   QWriteLocker locker(&this->lock);
+   return this->root.rmItem(word, item);
+}
 
-      currentNode->rmItem(item);
+/**
+  * @return 'true' if at least one item is removed.
+  */
+template<typename T>
+bool Old::WordIndex<T>::rmItem(const QStringList& words, const T& item)
+{
+   QWriteLocker locker(&this->lock);
+   bool itemRemoved = false;
+   for (QStringListIterator i(words); i.hasNext();)
+      itemRemoved |= this->root.rmItem(i.next(), item);
+   return itemRemoved;
+}
 
-      if (!currentNode->haveChildren())
-      {
-         Node<T>* nodeToRemove = nullptr;
-         for (QListIterator<Node<T>*> i(nodes); i.hasNext();)
-         {
-            Node<T>* n = i.next();
-            if (nodeToRemove)
-            {
-               n->rmNode(nodeToRemove);
-               delete nodeToRemove;
-            }
+template<typename T>
+void Old::WordIndex<T>::renameItem(const QString& oldWord, const QString& newWord, const T& item)
+{
+   QWriteLocker locker(&this->lock);
+   this->root.rmItem(oldWord, item);
+   this->root.addItem(&newWord, item);
+}
 
-            if (n->haveItems() || n->haveChildren())
-               break;
-            else
-               nodeToRemove = n;
-         }
-      }
+template<typename T>
+void Old::WordIndex<T>::renameItem(const QStringList& oldWords, const QStringList& newWords, const T& item)
+{
+   QWriteLocker locker(&this->lock);
+   for (QStringListIterator i(oldWords); i.hasNext();)
+      this->root.rmItem(i.next(), item);
+   for (QStringListIterator i(newWords); i.hasNext();)
+      this->root.addItem(&i.next(), item);
+}
 
-      nextWord :;
-   }
+/**
+  * Return a an unordered list of 'NodeResult' matching the given word. If 'NodeResult::level' is 0 then the item matches entirely the given word otherwise (level is 1) the word match the begining of the indexed string.
+  * There is a particular case when the word length is below 'MIN_WORD_SIZE_PARTIAL_MATCH', see the comment associated to this constant for more information.
+  */
+template<typename T>
+QList<Old::NodeResult<T>> Old::WordIndex<T>::search(const QString& word, int maxNbResult, std::function<bool(const T&)> predicat) const
+{
+   QReadLocker locker(&this->lock);
+   return this->searchWithoutLock(word, maxNbResult, predicat);
 }
 
+/**
+  * @see http://dev.euphorik.ch/wiki/pmp/Algorithms#Word-indexing for more information.
+  */
 template<typename T>
-QList<Old::NodeResult<T>> Old::WordIndex<T>::search(const QStringList& words, int maxNbResultPerWord) const
+QList<Old::NodeResult<T>> Old::WordIndex<T>::search(const QStringList& words, int maxNbResult, std::function<bool(const T&)> predicat) const
 {
-   QMutexLocker locker(&mutex);
+   QReadLocker locker(&this->lock);
+
+   const int N = words.size();
+
+   // Launch a search for each term.
+   QVector<QSet<NodeResult<T>>> results(N);
+   for (int i = 0; i < N; i++)
+      // We can only limit the number of result for one term. When there is more than one term and thus some results set, say [a, b, c] for example, some good result may be contained in intersect, for example a & b or a & c.
+      results[i] += this->searchWithoutLock(words[i], N == 1 ? maxNbResult : -1, predicat).toSet();
 
-   QList<NodeResult<T>> result;
-   for (QListIterator<QString> i(words); i.hasNext();)
+   QList<NodeResult<T>> finalResult;
+
+   int level = 0;
+
+   // For each group of intersection number.
+   // For example, [a, b, c] :
+   //  * a & b & c
+   //  * (a & b) \ c
+   //    (a & c) \ b
+   //    (b & c) \ a
+   //  * a \ b \ c
+   for (int i = 0; i < N && finalResult.size() < maxNbResult; i++)
    {
-      const QString& word = i.next();
-      const Node<T>* currentNode = &this->node;
-      for (int j = 0; j < word.size(); j++)
+      const int NB_INTERSECTS = N - i; // Number of set intersected.
+      int intersect[NB_INTERSECTS]; // A array of the results wich will be intersected.
+      for (int j = 0; j < NB_INTERSECTS; j++)
+         intersect[j] = j;
+
+      // For each combination of the current intersection group.
+      // For 2 intersections (NB_INTERSECTS == 2) among 3 elements [a, b, c]:
+      //  * (a, b)
+      //  * (a, c)
+      //  * (b, c)
+      QList<NodeResult<T>> nodesToSort;
+      const int NB_COMBINATIONS = Common::Global::nCombinations(N, NB_INTERSECTS);
+      for (int j = 0; j < NB_COMBINATIONS && nodesToSort.size() + finalResult.size() < maxNbResult; j++)
       {
-         if (!(currentNode = currentNode->getNode(word[j])))
-            goto nextWord;
+         // Apply intersects.
+         QSet<NodeResult<T>> currentLevelSet = results[intersect[0]];
+         for (QSetIterator<NodeResult<T>> k(currentLevelSet); k.hasNext();)
+         {
+            NodeResult<T>& node = const_cast<NodeResult<T>&>(k.next());
+            node.level = node.level ? NB_COMBINATIONS : 0;
+         }
+
+         for (int k = 1; k < NB_INTERSECTS; k++)
+            NodeResult<T>::intersect(currentLevelSet, results[intersect[k]], NB_COMBINATIONS);
+
+         // Apply substracts.
+         for (int k = -1; k < NB_INTERSECTS; k++)
+            for (int l = (k == -1 ? 0 : intersect[k] + 1); l < (k == NB_INTERSECTS - 1 ? N : intersect[k+1]); l++)
+               currentLevelSet -= results[l];
+
+         for (QSetIterator<NodeResult<T>> k(currentLevelSet); k.hasNext();)
+            const_cast<NodeResult<T>&>(k.next()).level += level;
+
+         // Sort by level.
+         nodesToSort << currentLevelSet.toList();
+
+         // Define positions of each intersect term.
+         for (int k = NB_INTERSECTS - 1; k >= 0; k--)
+            if  (intersect[k] < N - NB_INTERSECTS + k)
+            {
+               intersect[k] += 1;
+               for (int l = k + 1; l < NB_INTERSECTS; l++)
+                  intersect[l] = intersect[k] + (l - k);
+               break;
+            }
+
+         level += 1;
       }
 
-      result << currentNode->getItems(word.size() >= MIN_WORD_SIZE_PARTIAL_MATCH, maxNbResultPerWord);
-      nextWord :;
+      qSort(nodesToSort); // Sort by level
+
+      finalResult << nodesToSort;
+
+      level += NB_COMBINATIONS * NB_INTERSECTS;
    }
-   return result;
+
+   if (finalResult.size() > maxNbResult)
+      finalResult.erase(finalResult.end() - (finalResult.size() - maxNbResult), finalResult.end());
+
+   return finalResult;
 }
 
 template<typename T>
-QList<Old::NodeResult<T>> Old::WordIndex<T>::search(const QString& word, int maxNbResult) const
+QString Old::WordIndex<T>::toStringLog() const
 {
-   return this->search(QStringList() << word, maxNbResult);
+   QReadLocker locker(&this->lock);
+   return this->root.toStringDebug();
 }
 
 template<typename T>
-QList<T> Old::WordIndex<T>::resultToList(const QList<Old::NodeResult<T>>& result)
+QList<T> Old::WordIndex<T>::resultToList(const QList<NodeResult<T>>& result)
 {
    QList<T> l;
    for (auto i = result.begin(); i != result.end(); ++i)
@@ -157,4 +256,13 @@ QList<T> Old::WordIndex<T>::resultToList(const QList<Old::NodeResult<T>>& result
    return l;
 }
 
+/**
+  * The caller must hold at least a read lock.
+  */
+template<typename T>
+QList<Old::NodeResult<T>> Old::WordIndex<T>::searchWithoutLock(const QString& word, int maxNbResult, std::function<bool(const T&)> predicat) const
+{
+   return this->root.search(word, word.size() >= (Common::StringUtils::isKorean(word) ? MIN_WORD_SIZE_PARTIAL_MATCH_KOREAN : MIN_WORD_SIZE_PARTIAL_MATCH), maxNbResult, predicat);
+}
+
 #endif
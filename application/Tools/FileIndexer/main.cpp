@@ -18,77 +18,65 @@
   
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
+#include <QtCore/QFile>
 #include <QtCore/QLinkedList>
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QTextStream>
 #include <QtCore/QPair>
 #include <QtCore/QDebug>
 
-#include <Common/Global.h>
+#include <Common/StringUtils.h>
 
-#define IMPLEMENTATION NEW // OLD or NEW
+#include <OldWordIndex.h>
+#include <Core/FileManager/priv/WordIndex/WordIndex.h>
 
-#define NEW 1
-#define OLD 2
-
-#if IMPLEMENTATION == OLD
-   #include <OldWordIndex.h>
-   using namespace Old;
-#else
-   #include <Core/FileManager/priv/WordIndex/WordIndex.h>
-   using namespace FM;
-#endif
+/**
+  * Compare the pointer-based word index of the core ('Old::WordIndex') with the current one ('FM::WordIndex'):
+  * memory used to index all the given directories and latency of the searches.
+  */
 
 QTextStream in(stdin);
 QTextStream out(stdout);
 
-template <typename T>
-void add(WordIndex<T>& index, const QString& word, const T& item)
-{
-   out << "Add item : " << item << " indexed by " << word << endl;
-   index.addItem(word, item);
-}
-
 /**
-  * Repeated n times.
+  * The resident set size of the process in bytes, -1 if unknown.
   */
-template <typename T>
-void search(WordIndex<T>& index, const QString& word, int n)
+qint64 residentMemory()
 {
-   QElapsedTimer t;
-   t.start();
-
-   for (int i = 1; i < n; ++i)
-      index.search(word);
-
-   QList<T> items = WordIndex<T>::resultToList(index.search(word));
-
-   qint64 time = t.elapsed();
-
-   out << "Search \"" << word << "\" : " << items.count() << " items found" << endl;
-   foreach (T item, items)
-      out << " - " << item << endl;
-   out << " Time: " << double(time) / 1000 << " s" << endl;
+#ifdef Q_OS_LINUX
+   QFile statm("/proc/self/statm");
+   if (statm.open(QIODevice::ReadOnly))
+   {
+      const QList<QByteArray> values = statm.readAll().split(' ');
+      if (values.size() >= 2)
+         return values[1].toLongLong() * 4096;
+   }
+#endif
+   return -1;
 }
 
-template <typename T>
-void rm(WordIndex<T>& index, const QString& word, const T& item)
+QString formatMemory(qint64 bytes)
 {
-   out << "Remove " << item << " with word " << word << endl;
-   QList<QString> words;
-   words.append(word);
-   index.rmItem(words, item);
+   return bytes < 0 ? "unknown" : QString("%1 MiB").arg(double(bytes) / 1024 / 1024, 0, 'f', 1);
 }
 
 /**
-  * Index a file by its name.
+  * Repeated n times, return the average time of one search in microseconds.
   */
-template <typename T>
-void indexFile(WordIndex<T>& index, const QString& fileName, const T& item)
+template <typename Index>
+double search(const Index& index, const QString& word, int n, int* nbItems = nullptr)
 {
-   const QStringList& words = Common::Global::splitInWords(fileName);
+   QElapsedTimer t;
+   t.start();
+
+   int nb = 0;
+   for (int i = 0; i < n; ++i)
+      nb = index.search(word).size();
 
-   index.addItem(words, item);
+   if (nbItems)
+      *nbItems = nb;
+
+   return double(t.nsecsElapsed()) / 1000 / n;
 }
 
 template<typename T> T buildItem(const QFileInfo& entry);
@@ -107,11 +95,9 @@ QString buildItem<QString>(const QFileInfo& entry)
 }
 
 template <typename T>
-void buildIndex(WordIndex<T>& index, const QString& path)
+void scan(QLinkedList<QPair<QStringList, T>>& items, const QString& path)
 {
-   QLinkedList< QPair< QString, T > > items;
-
-   out << "Scanning..." << endl;
+   out << "Scanning " << path << "..." << endl;
 
    QLinkedList<QDir> dirsToVisit;
    dirsToVisit.append(path);
@@ -122,14 +108,23 @@ void buildIndex(WordIndex<T>& index, const QString& path)
          if (entry.fileName() == "." || entry.fileName() == "..")
             continue;
 
-         items << qMakePair(entry.fileName(), buildItem<T>(entry)); // entry.absoluteFilePath(), entry.fileName()
+         items << qMakePair(Common::StringUtils::splitInWords(entry.fileName()), buildItem<T>(entry));
 
          if (entry.isDir())
             dirsToVisit.append(entry.absoluteFilePath());
       }
    }
+}
+
+/**
+  * Index all the items and print the memory used and the average latency of a search for some words.
+  */
+template <typename Index, typename T>
+void buildIndex(Index& index, const QString& name, const QLinkedList<QPair<QStringList, T>>& items, const QStringList& wordsToSearch)
+{
+   out << "== " << name << " ==" << endl;
 
-   out << "Indexing..." << endl;
+   const qint64 memoryBefore = residentMemory();
    QElapsedTimer t;
    t.start();
 
@@ -137,10 +132,19 @@ void buildIndex(WordIndex<T>& index, const QString& path)
    for (auto i = items.begin(); i != items.end(); ++i)
    {
       n += 1;
-      indexFile(index, i->first, i->second);
+      index.addItem(i->first, i->second);
    }
 
-   out << n << " items indexed in " << double(t.elapsed()) / 1000 << " s" << endl;
+   const qint64 elapsed = t.elapsed();
+   const qint64 memoryAfter = residentMemory();
+
+   out << n << " items indexed in " << double(elapsed) / 1000 << " s" << endl;
+   out << "Memory: " << formatMemory(memoryBefore < 0 || memoryAfter < 0 ? -1 : memoryAfter - memoryBefore) << endl;
+
+   double totalLatency = 0;
+   for (QStringListIterator i(wordsToSearch); i.hasNext();)
+      totalLatency += search(index, i.next(), 100);
+   out << "Average search latency for " << wordsToSearch.size() << " words: " << (wordsToSearch.isEmpty() ? 0 : totalLatency / wordsToSearch.size()) << " us" << endl;
 }
 
 void printUsage(int argc, char *argv[])
@@ -154,11 +158,25 @@ int main(int argc, char *argv[])
 {
    if (argc >= 2)
    {
-      // WordIndex<QString> index; // If a word index of string is used the item corrsponds to fullpath + filename.
-      WordIndex<int> index;
+      // Replace 'int' by 'QString' to index the full path + filename as item.
+      QLinkedList<QPair<QStringList, int>> items;
 
       for (int i = 1; i < argc; i++)
-         buildIndex(index, argv[i]);
+         scan(items, argv[i]);
+
+      // Take some words to measure the search latency: one word every 1000 items, some of them truncated to match partially.
+      QStringList wordsToSearch;
+      int n = 0;
+      for (auto i = items.begin(); i != items.end(); ++i, ++n)
+         if (n % 1000 == 0 && !i->first.isEmpty())
+            wordsToSearch << (n % 2000 == 0 ? i->first.first() : i->first.first().left(3));
+
+      // The items are indexed by the previous implementation first, the memory of the scan is already allocated.
+      Old::WordIndex<int> oldIndex;
+      buildIndex(oldIndex, "Old (pointer radix trie)", items, wordsToSearch);
+
+      FM::WordIndex<int> index;
+      buildIndex(index, "Current (arena radix trie)", items, wordsToSearch);
 
       forever
       {
@@ -167,7 +185,12 @@ int main(int argc, char *argv[])
          const QString& itemToSearch = in.readLine();
          if (itemToSearch == "quit")
             return 0;
-         search(index, itemToSearch, 20000);
+
+         int nbItems = 0;
+         const double previousLatency = search(oldIndex, itemToSearch, 20000);
+         const double latency = search(index, itemToSearch, 20000, &nbItems);
+         out << "Search \"" << itemToSearch << "\" : " << nbItems << " items found" << endl;
+         out << " Time: previous: " << previousLatency << " us, current: " << latency << " us" << endl;
       }
    }
    else
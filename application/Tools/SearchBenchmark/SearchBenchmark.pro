@@ -0,0 +1,25 @@
+QT       += core
+QT       -= gui
+
+TARGET = SearchBenchmark
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+include(../../Common/common.pri)
+
+INCLUDEPATH += . ../.. ../../Core/FileManager ../FileIndexer
+
+LIBS += -L../../Common/output/$$FOLDER \
+    -lCommon
+PRE_TARGETDEPS += ../../Common/output/$$FOLDER/libCommon.a
+
+SOURCES += main.cpp
+
+HEADERS += \
+    ../../Core/FileManager/priv/WordIndex/WordIndex.h \
+    ../../Core/FileManager/priv/WordIndex/Node.h \
+    ../../Core/FileManager/priv/WordIndex/Trie.h \
+    ../FileIndexer/PreviousWordIndex.h \
+    ../FileIndexer/PreviousNode.h
@@ -0,0 +1,167 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <algorithm>
+
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTextStream>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include <Libs/MersenneTwister.h>
+
+#include <Common/StringUtils.h>
+
+#include <PreviousWordIndex.h>
+#include <Core/FileManager/priv/WordIndex/WordIndex.h>
+
+/**
+  * Measure the multi-word search of 'FM::WordIndex' (sorted posting lists, galloping intersection and top-k) against
+  * the one of 'Previous::WordIndex' (a 'QSet' per term intersected for each combination) for queries of 1 to 8 terms.
+  *
+  * The items are the names of the files and directories of the given directories or, without directory, some generated names.
+  * The words of the generated names follow a Zipf distribution to have some frequent words like a real set of file names.
+  */
+
+QTextStream out(stdout);
+
+const int MAX_NB_TERMS = 8;
+const int NB_QUERIES = 200; // For each number of terms.
+const int MAX_NB_RESULT = 300; // Default value of the setting 'max_number_of_search_result_to_send'.
+
+void scan(QList<QStringList>& items, const QString& path)
+{
+   QList<QDir> dirsToVisit;
+   dirsToVisit << QDir(path);
+   while (!dirsToVisit.isEmpty())
+   {
+      foreach (QFileInfo entry, dirsToVisit.takeFirst().entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot))
+      {
+         items << Common::StringUtils::splitInWords(entry.fileName());
+         if (entry.isDir())
+            dirsToVisit << QDir(entry.absoluteFilePath());
+      }
+   }
+}
+
+void generate(QList<QStringList>& items, int nbItems, MTRand& mtrand)
+{
+   const int VOCABULARY_SIZE = 50000;
+
+   // Cumulative Zipf distribution.
+   QVector<double> cumulative(VOCABULARY_SIZE);
+   double sum = 0;
+   for (int i = 0; i < VOCABULARY_SIZE; i++)
+      cumulative[i] = sum += 1.0 / (i + 1);
+
+   for (int i = 0; i < nbItems; i++)
+   {
+      QStringList words;
+      const int nbWords = 1 + mtrand.randInt(5);
+      for (int j = 0; j < nbWords; j++)
+      {
+         const int word = std::lower_bound(cumulative.begin(), cumulative.end(), mtrand.rand(sum)) - cumulative.begin();
+         words << QString::number(word, 36).prepend("w");
+      }
+      items << words;
+   }
+}
+
+template <typename Index>
+double benchmark(const Index& index, const QList<QStringList>& queries, int& nbResults)
+{
+   nbResults = 0;
+   QElapsedTimer timer;
+   timer.start();
+   for (QListIterator<QStringList> i(queries); i.hasNext();)
+      nbResults += index.search(i.next(), MAX_NB_RESULT).size();
+   return double(timer.nsecsElapsed()) / 1000 / queries.size();
+}
+
+void printUsage(char *argv[])
+{
+   out << "Usage : " << argv[0] << " [<number of generated items>|<directory>*]" << endl
+      << " <number of generated items> : 1000000 by default." << endl
+      << " <directory> : will scan recursively the directory and index each file and folder." << endl;
+}
+
+int main(int argc, char *argv[])
+{
+   MTRand mtrand(42);
+   QList<QStringList> items;
+
+   bool isNumber = false;
+   const int nbItems = argc == 2 ? QString(argv[1]).toInt(&isNumber) : 1000000;
+
+   if (argc == 1 || isNumber)
+   {
+      if (nbItems <= 0)
+      {
+         printUsage(argv);
+         return 1;
+      }
+      out << "Generating " << nbItems << " items..." << endl;
+      generate(items, nbItems, mtrand);
+   }
+   else
+   {
+      for (int i = 1; i < argc; i++)
+      {
+         out << "Scanning " << argv[i] << "..." << endl;
+         scan(items, argv[i]);
+      }
+   }
+
+   out << "Indexing " << items.size() << " items..." << endl;
+   Previous::WordIndex<int> previousIndex;
+   FM::WordIndex<int> index;
+   for (int i = 0; i < items.size(); i++)
+   {
+      previousIndex.addItem(items[i], i);
+      index.addItem(items[i], i);
+   }
+
+   out << "Nb terms | previous [us/query] | current [us/query] | speedup | results previous/current" << endl;
+   for (int nbTerms = 1; nbTerms <= MAX_NB_TERMS; nbTerms++)
+   {
+      // The terms of a query are taken among the words of the same item and of random items to have some partial intersections.
+      QList<QStringList> queries;
+      while (queries.size() < NB_QUERIES)
+      {
+         QStringList query;
+         while (query.size() < nbTerms)
+         {
+            const QStringList& words = items[mtrand.randInt(items.size() - 1)];
+            if (!words.isEmpty())
+               query << words[mtrand.randInt(words.size() - 1)];
+         }
+         queries << query;
+      }
+
+      int nbPreviousResults = 0;
+      int nbResults = 0;
+      const double previousTime = benchmark(previousIndex, queries, nbPreviousResults);
+      const double time = benchmark(index, queries, nbResults);
+
+      out << nbTerms << " | " << previousTime << " | " << time << " | " << previousTime / time << " | " << nbPreviousResults << "/" << nbResults << endl;
+   }
+
+   return 0;
+}